@@ -0,0 +1,104 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include "types.h"
+#include "pack.h"
+
+// 备份文件的随机访问读取：备份文件整体只读映射到内存，索引解析只是在映射上移动指针，
+// 文件数据优先由内核直接复制（Linux上的copy_file_range和sendfile），否则直接从映射的页面写出，不经过stdio缓冲区
+// 支持未压缩、未加密的MyPack（版本1和版本2）和Tar备份文件，其他备份文件只能顺序解包
+// 去重备份（尾部标志含PACK2_FLAG_CHUNKED）的分块文件从备份文件所在目录下的块数据文件中提取，块数据文件同样整体映射
+typedef struct Archive Archive;
+
+// 索引中的一个文件
+// 路径和符号链接目标可能直接指向映射中的数据，不保证以'\0'结尾，长度见item.path_length和item.symlink_length
+// 硬链接（item.flags含PACK2_ITEM_HARDLINK）没有数据，符号链接目标是链接到的文件的路径
+// 分块文件（item.flags含PACK2_ITEM_CHUNKED）的item.offset处是item.extent_count个ChunkRef
+typedef struct {
+    Pack2Item item;                 // 文件项（偏移量、大小、时间、权限等），各格式都转换为版本2的文件项
+    const char *path;               // 相对路径
+    const char *symlink_target;     // 符号链接目标
+} ArchiveEntry;
+
+// 提取统计
+typedef struct {
+    unsigned long long files;         // 提取的文件数量
+    unsigned long long bytes;         // 提取的数据字节数
+    unsigned long long copied_bytes;  // 其中由内核直接复制的字节数
+    double seconds;                   // 提取耗时（秒）
+} ArchiveStats;
+
+// 打开备份文件并读取索引，不是支持的格式（或已压缩、加密）时返回BACKUP_ERROR_PACK
+// 去重备份的块数据文件打不开时返回BACKUP_ERROR_FILE
+// MyPack版本2从尾部找到索引，版本1读取头部的文件项表，Tar逐个读取文件头
+BackupResult archive_open(const char *path, Archive **archive);
+void archive_close(Archive *archive);
+
+// 只读取备份文件的索引，用于列出文件：不读取任何文件数据（不检查数据范围，不打开去重备份的块数据文件），
+// MyPack只读取尾部和索引（版本1读取头部和文件项表），Tar只读取各文件头；这样打开的备份文件不能提取或校验
+BackupResult archive_open_index(const char *path, Archive **archive);
+
+// 索引中的文件，已排序的索引按路径升序排列（Tar在打开时排序）
+unsigned int archive_entry_count(const Archive *archive);
+const ArchiveEntry *archive_entry(const Archive *archive, unsigned int index);
+
+// 按路径查找文件（'/'和'\\'都视为分隔符），找不到时返回NULL
+const ArchiveEntry *archive_find(const Archive *archive, const char *path);
+
+// 文件项在映射中的数据，从item.offset开始（分块文件是块引用表，可能未对齐），硬链接和只读取了索引时返回NULL
+const unsigned char *archive_entry_data(const Archive *archive, const ArchiveEntry *entry);
+
+// 选中与paths匹配的文件（selected[i]置1，selected有archive_entry_count个元素），路径是目录时选中其下的所有文件
+// 有路径没有匹配的文件时返回BACKUP_ERROR_PATH
+BackupResult archive_select_paths(const Archive *archive, const char *const *paths, int path_count, unsigned char *selected);
+
+// 提取一个文件的数据到target_path，自动创建所在的目录（可以在多个线程中同时提取不同的文件），硬链接提取链接到的文件的数据
+// 有内容摘要（item.flags含PACK2_ITEM_HASHED）的文件先校验，数据损坏时返回BACKUP_ERROR_CHECKSUM
+BackupResult archive_extract_entry(Archive *archive, const ArchiveEntry *entry, const char *target_path);
+
+// 提取全部文件到target_dir下的相对路径
+// thread_count个线程同时提取不同的文件（0表示使用全部处理器），较大的文件先提取；只有一个线程时按数据偏移量顺序提取
+BackupResult archive_extract_all(Archive *archive, const char *target_dir, int thread_count);
+
+// 提取selected[i]不为0的文件到target_dir下的相对路径（selected有archive_entry_count个元素），线程数同archive_extract_all
+// 未选中的文件数据不会被读取；选中的硬链接链接到的文件未选中时，第一个硬链接提取其数据
+BackupResult archive_extract_selection(Archive *archive, const unsigned char *selected, const char *target_dir, int thread_count);
+
+// 提取指定的文件到target_dir下的相对路径，路径是目录时提取其下的所有文件
+// 不需要的文件数据不会被读取，线程数同archive_extract_all；有路径没有匹配的文件时返回BACKUP_ERROR_PATH
+BackupResult archive_extract_paths(Archive *archive, const char *const *paths, int path_count, const char *target_dir, int thread_count);
+
+// 打开以来的提取统计
+void archive_get_stats(const Archive *archive, ArchiveStats *stats);
+
+// 校验发现的问题
+typedef enum {
+    ARCHIVE_VERIFY_OK,              // 没有问题
+    ARCHIVE_VERIFY_CORRUPT,         // 备份中的数据与内容摘要不符
+    ARCHIVE_VERIFY_UNREADABLE,      // 读取备份中的数据出错（或差异块无法还原）
+    ARCHIVE_VERIFY_SOURCE_CHANGED,  // 与源目录中的文件大小或内容不同
+    ARCHIVE_VERIFY_SOURCE_MISSING   // 源目录中没有这个文件或无法读取
+} ArchiveVerifyProblem;
+
+// 校验发现问题时的回调，可能在多个校验线程中同时调用
+typedef void (*ArchiveVerifyReport)(const ArchiveEntry *entry, ArchiveVerifyProblem problem, void *context);
+
+// 校验统计
+typedef struct {
+    unsigned long long files;           // 校验的文件数量
+    unsigned long long hashed_files;    // 其中有内容摘要的文件数量，其他文件只能确认数据可读（或与源文件比较）
+    unsigned long long bytes;           // 读取并计算摘要的备份数据字节数
+    unsigned long long corrupt;         // 各种问题的文件数量，见ArchiveVerifyProblem
+    unsigned long long unreadable;
+    unsigned long long source_changed;
+    unsigned long long source_missing;
+    double seconds;                     // 校验耗时（秒）
+} ArchiveVerifyStats;
+
+// 校验备份文件：thread_count个线程（0表示使用全部处理器）同时校验不同的文件，较大的文件先校验，
+// 每个线程按偏移量读取（pread）各自文件的数据范围并重新计算内容摘要，与索引中记录的摘要比较
+// source_dir不为NULL时还与源目录下同一相对路径的文件比较（稀疏文件只比较各数据段）
+// 发现问题时调用report（可为NULL）并继续校验其他文件，有问题时返回BACKUP_ERROR_CHECKSUM
+BackupResult archive_verify(Archive *archive, const char *source_dir, int thread_count, ArchiveVerifyReport report, void *context, ArchiveVerifyStats *stats);
+
+#endif // ARCHIVE_H
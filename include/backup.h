@@ -2,8 +2,15 @@
 #define BACKUP_H
 
 #include "types.h"
+#include "pipeline.h"
 
 // 备份模块内部函数声明
 BackupResult copy_file(const char *source, const char *target);
 
+// 获取最近一次备份的流水线统计（各阶段的输入字节数和队列深度）
+void backup_get_pipeline_stats(PipelineStats *stats);
+
+// 获取最近一次去重备份的分块存储统计，不是去重备份时全部为0
+void backup_get_chunk_stats(ChunkStoreStats *stats);
+
 #endif // BACKUP_H
@@ -0,0 +1,103 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include "types.h"
+
+// 编号无效（根目录的父目录、没有符号链接目标）
+#define CATALOG_NONE 0xFFFFFFFFu
+
+// 根目录的编号，目录清单创建时即存在
+#define CATALOG_ROOT 0u
+
+// 项标志：分配的磁盘空间小于文件大小，文件中可能有空洞
+#define CATALOG_FLAG_SPARSE 0x1u
+
+// 项标志：普通文件有多个硬链接，加入时按设备号和inode编号归入硬链接组
+#define CATALOG_FLAG_LINKED 0x2u
+
+// 目录清单项（约80字节）
+// 路径不保存完整字符串，只保存父目录编号和文件名，文件名和符号链接目标保存在字符串区，项中只记录位置
+typedef struct {
+    unsigned int parent;            // 父目录编号，根目录为CATALOG_NONE
+    unsigned int name;              // 文件名在字符串区的位置
+    unsigned int symlink_target;    // 符号链接目标在字符串区的位置，没有时为CATALOG_NONE
+    unsigned int link;              // 硬链接组：同一文件第一个加入的项的编号，不是CATALOG_FLAG_LINKED时为CATALOG_NONE
+    unsigned short mode;            // 文件权限
+    unsigned char type;             // 文件类型（FileType）
+    unsigned char flags;            // 项标志（CATALOG_FLAG_*）
+    unsigned int uid;               // 用户ID
+    unsigned int gid;               // 组ID
+    unsigned long long size;        // 文件大小
+    unsigned long long inode;       // 文件在文件系统中的inode编号，平台不提供时为0
+    unsigned long long device;      // 文件所在设备的编号，与inode编号一起识别硬链接
+    long long create_time;          // 创建时间
+    long long modify_time;          // 修改时间
+    long long access_time;          // 访问时间
+} CatalogEntry;
+
+// 目录清单：遍历结果的紧凑表示，代替每项约800字节的FileMetadata数组
+// 项和字符串都分块存储，追加时已有的项和字符串不会移动：
+// 追加函数内部加锁，多个遍历线程可以同时追加；读取已经通过队列或锁交给本线程的项不需要加锁
+typedef struct Catalog Catalog;
+
+// 创建和释放目录清单
+Catalog *catalog_create(void);
+void catalog_destroy(Catalog *catalog);
+
+// 加入目录：相同父目录下的同名目录只保存一次，返回目录编号，失败时返回CATALOG_NONE
+unsigned int catalog_add_directory(Catalog *catalog, unsigned int parent, const char *name);
+
+// 加入文件：stat中的父目录、字符串位置和硬链接组被忽略，symlink_target可为NULL
+// 标记为CATALOG_FLAG_LINKED的文件按设备号和inode编号归入硬链接组
+// 文件同时按加入顺序记入文件列表，返回文件编号，失败时返回CATALOG_NONE
+unsigned int catalog_add_file(Catalog *catalog, unsigned int parent, const char *name, const CatalogEntry *stat, const char *symlink_target);
+
+// 按相对路径加入文件，路径中的各级目录自动加入（分隔符为'/'或'\\'）
+unsigned int catalog_add_path(Catalog *catalog, const char *path, const CatalogEntry *stat, const char *symlink_target);
+
+// 项和字符串
+const CatalogEntry *catalog_entry(const Catalog *catalog, unsigned int id);
+const char *catalog_name(const Catalog *catalog, unsigned int id);
+const char *catalog_symlink_target(const Catalog *catalog, unsigned int id);
+
+// 构建相对于根目录的路径（以PATH_SEPARATOR分隔），返回路径长度（不含结尾的'\0'）
+// 缓冲区不够时写入空串，调用方可根据返回值重新分配
+size_t catalog_path(const Catalog *catalog, unsigned int id, char *buffer, size_t size);
+
+// 构建路径到*buffer，容量不够时重新分配（*buffer可为NULL），失败时返回BACKUP_ERROR_MEMORY
+BackupResult catalog_path_buffer(const Catalog *catalog, unsigned int id, char **buffer, size_t *capacity);
+
+// 文件列表（不含目录），按加入顺序或catalog_sort()之后的顺序，应在追加结束后读取
+unsigned int catalog_file_count(const Catalog *catalog);
+unsigned int catalog_file_id(const Catalog *catalog, unsigned int index);
+
+// 按路径排序文件列表
+BackupResult catalog_sort(Catalog *catalog);
+
+// 按键值升序排列文件列表，keys[i]是文件列表中第i个文件的键值，键值相同的文件保持原来的顺序
+BackupResult catalog_sort_by_key(Catalog *catalog, const unsigned long long *keys);
+
+// 硬链接的数据归属：同一硬链接组中按处理顺序第一个出现的文件保存数据，之后出现的文件只记录指向它的链接
+// 文件列表可能被重新排序，流式打包时文件的处理顺序也不同于加入顺序，因此由处理文件的一方按自己的顺序判断；
+// 读取阶段和打包阶段按相同的顺序调用，得到相同的结果
+typedef struct {
+    unsigned int *slots;            // 开放寻址表，每组两项：组编号和保存数据的文件编号
+    unsigned int count;
+    unsigned int capacity;          // 组数，2的幂
+} CatalogLinks;
+
+// 初始化和释放
+void catalog_links_init(CatalogLinks *links);
+void catalog_links_free(CatalogLinks *links);
+
+// 处理文件id：*source返回已经保存了数据的同组文件编号，文件需要保存数据（不是硬链接或者是本组第一个）时为CATALOG_NONE
+BackupResult catalog_link_source(const Catalog *catalog, CatalogLinks *links, unsigned int id, unsigned int *source);
+
+// 占用的内存字节数（项、字符串区和文件列表）
+size_t catalog_memory_usage(const Catalog *catalog);
+
+// 与FileMetadata相互转换，路径超出FileMetadata的长度限制时返回BACKUP_ERROR_PATH
+void catalog_stat_from_metadata(const FileMetadata *metadata, CatalogEntry *stat);
+BackupResult catalog_to_metadata(const Catalog *catalog, unsigned int id, FileMetadata *metadata);
+
+#endif // CATALOG_H
@@ -0,0 +1,106 @@
+#ifndef CHUNK_STORE_H
+#define CHUNK_STORE_H
+
+#include "types.h"
+#include "stream.h"
+#include "hash.h"
+
+// 去重仓库的分块存储：文件数据按内容切分为可变长度的块，每个不同的块只保存一次
+// 仓库目录下有两个文件：
+//   chunks.dat：块数据，新块追加在末尾，块之间没有分隔
+//   chunks.idx：块索引，魔术字之后是ChunkRef数组，按写入顺序排列，打开仓库时整体读入内存的哈希表
+// 块数据先写入，结束时再追加索引，中途失败时块数据中多出的部分不会被引用，索引中不完整的项在下次打开时截去
+// 增量备份时修改过的文件的新块可以保存为差异块：相对于上一版本同一位置的块（基准块），只保存复制指令和变化的数据
+#define CHUNK_STORE_DATA_NAME "chunks.dat"
+#define CHUNK_STORE_INDEX_NAME "chunks.idx"
+#define CHUNK_STORE_INDEX_MAGIC "BACKCHK1"
+
+// 分块大小：FastCDC的最小、平均和最大块长度
+// 平均64KB时每TB数据约一千六百万个块，内存中的块索引约0.9GB
+#define CHUNK_MIN_SIZE (16 * 1024)
+#define CHUNK_AVG_SIZE (64 * 1024)
+#define CHUNK_MAX_SIZE (256 * 1024)
+
+// 块引用（48字节），块索引和备份文件中的分块文件项都使用这个结构
+// 差异块（delta_length不为0）在offset处保存的是差异编码，length仍是还原后的块长度，hash是还原后数据的摘要
+typedef struct {
+    unsigned long long offset;          // 块在chunks.dat中的偏移量
+    unsigned int length;                // 块长度
+    unsigned int delta_length;          // 差异编码的长度，0表示块数据原样保存
+    unsigned char hash[SHA256_SIZE];    // 块数据的SHA-256摘要，作为块的标识
+} ChunkRef;
+
+// 差异编码（rsync算法）：基准块按固定长度分为若干小块，以弱校验和（可滚动）建立签名表，
+// 新块逐字节滚动计算弱校验和，命中签名后逐字节比较确认，相同的小块记为复制指令，其余数据原样保存
+// 编码依次是ChunkDeltaHeader、op_count条ChunkDeltaOp和各新数据指令的数据；
+// 基准块总是原样保存的块，差异编码不超过块长度的一半时才保存为差异块
+#define CHUNK_DELTA_BLOCK_SIZE 2048
+#define CHUNK_DELTA_LITERAL 0xFFFFFFFFu
+
+typedef struct {
+    unsigned long long base_offset;     // 基准块在chunks.dat中的偏移量
+    unsigned int base_length;           // 基准块长度
+    unsigned int op_count;              // 指令条数
+} ChunkDeltaHeader;
+
+typedef struct {
+    unsigned int base_offset;           // 从基准块的这个位置复制，CHUNK_DELTA_LITERAL表示新数据
+    unsigned int length;                // 长度
+} ChunkDeltaOp;
+
+// chunk_read()的缓冲区大小：还原后的块以及差异块的编码和基准块
+#define CHUNK_READ_BUFFER_SIZE (3 * CHUNK_MAX_SIZE)
+
+// 分块存储统计
+typedef struct {
+    unsigned long long chunks;          // 本次写入的块数（包括重复的块）
+    unsigned long long bytes;           // 本次写入的字节数
+    unsigned long long new_chunks;      // 其中新保存的块数
+    unsigned long long new_bytes;       // 其中新保存的字节数（差异块按编码长度计）
+    unsigned long long delta_chunks;    // 新保存的块中差异块的块数
+    unsigned long long delta_bytes;     // 这些块还原后的字节数
+    unsigned long long stored_chunks;   // 仓库中块的总数
+} ChunkStoreStats;
+
+typedef struct ChunkStore ChunkStore;
+
+// 打开目录下的分块存储，不存在时创建，已有的块索引读入内存
+BackupResult chunk_store_open(const char *directory, ChunkStore **store);
+
+// 保存一个块：已有相同摘要的块时直接返回其引用，否则追加到chunks.dat
+// base不为NULL时是上一版本同一位置的块，差异编码足够小时保存为相对于它的差异块（base是差异块时以它的基准块为基准）
+// 同一个对象不能在多个线程中同时使用
+BackupResult chunk_store_put(ChunkStore *store, const unsigned char *data, size_t size, const ChunkRef *base, ChunkRef *ref);
+
+// 冲刷块数据并追加新块的索引，然后关闭；store为NULL时直接返回成功
+BackupResult chunk_store_close(ChunkStore *store);
+
+// 打开以来的统计
+void chunk_store_get_stats(const ChunkStore *store, ChunkStoreStats *stats);
+
+// 备份文件所在目录下的chunks.dat路径，路径过长时返回BACKUP_ERROR_PATH
+BackupResult chunk_store_data_path(const char *archive_path, char *buffer, size_t size);
+
+// 按差异编码delta和基准块base还原length字节的块到output，编码不完整或与长度不符时返回BACKUP_ERROR_PACK
+BackupResult chunk_delta_apply(const unsigned char *delta, size_t delta_size, const unsigned char *base, size_t base_size, unsigned char *output, size_t length);
+
+// 从块数据文件读取一块（差异块同时读取基准块后还原），块数据在buffer开头，buffer至少CHUNK_READ_BUFFER_SIZE字节
+BackupResult chunk_read(FILE *data, const ChunkRef *ref, unsigned char *buffer);
+
+// 找到第一个切分点，返回第一块的长度（FastCDC：Gear滚动哈希，平均长度之前使用较严格的掩码，之后使用较宽松的掩码）
+// 数据不超过最小长度时整体成为一块，到最大长度仍没有切分点时在最大长度处切分
+size_t chunk_cut(const unsigned char *data, size_t size);
+
+// 分块写入端：写入的数据按内容分块后存入仓库，每块的引用依次记录
+// finish结束当前文件，剩余的数据成为最后一块，之后可以继续写入下一个文件；文件的边界总是块的边界
+ByteWriter *chunk_writer_create(ChunkStore *store);
+
+// 设置当前文件上一版本的块引用表（refs可能未对齐），新块以上一版本中与它重叠最多的块为基准尝试差异编码
+// 只对当前文件有效，finish时清除
+void chunk_writer_set_base(ByteWriter *writer, const void *refs, unsigned int count);
+
+// 已完成的块引用，调用方取走后用chunk_writer_reset()清空
+const ChunkRef *chunk_writer_refs(ByteWriter *writer, unsigned int *count);
+void chunk_writer_reset(ByteWriter *writer);
+
+#endif // CHUNK_STORE_H
@@ -2,6 +2,13 @@
 #define COMPRESS_H
 
 #include "types.h"
+#include "stream.h"
+
+// 压缩文件格式版本
+// 版本1：整文件压缩，Huffman需要两遍读取输入
+// 版本2：流式压缩，Huffman按块编码，LZ77使用标志字节分组编码，可在处理链中单遍完成
+#define COMPRESS_VERSION_LEGACY 1
+#define COMPRESS_VERSION_STREAM 2
 
 // 压缩文件头部结构体
 typedef struct {
@@ -24,12 +31,32 @@ typedef struct HuffmanNode {
 BackupResult write_compress_header(FILE *fp, const CompressHeader *header);
 BackupResult read_compress_header(FILE *fp, CompressHeader *header);
 
-// Huffman压缩相关函数
+// 压缩解压数据流（含压缩文件头部）
+BackupResult compress_stream(ByteReader *input, ByteWriter *output, CompressAlgorithm algorithm);
+BackupResult decompress_stream(ByteReader *input, ByteWriter *output);
+
+// Huffman压缩相关函数（不含压缩文件头部，FILE*版本是流式版本的封装）
 BackupResult huffman_compress(FILE *input_fp, FILE *output_fp);
 BackupResult huffman_decompress(FILE *input_fp, FILE *output_fp);
+BackupResult huffman_compress_stream(ByteReader *input, ByteWriter *output);
+BackupResult huffman_decompress_stream(ByteReader *input, ByteWriter *output);
 
-// LZ77压缩相关函数
+// LZ77压缩相关函数（不含压缩文件头部，FILE*版本是流式版本的封装）
 BackupResult lz77_compress(FILE *input_fp, FILE *output_fp);
 BackupResult lz77_decompress(FILE *input_fp, FILE *output_fp);
+BackupResult lz77_compress_stream(ByteReader *input, ByteWriter *output);
+BackupResult lz77_decompress_stream(ByteReader *input, ByteWriter *output);
+
+// 版本1格式的解码（只用于读取旧的压缩文件）
+BackupResult huffman_decompress_legacy(FILE *input_fp, FILE *output_fp);
+BackupResult lz77_decompress_legacy(FILE *input_fp, FILE *output_fp);
+
+// 流式压缩处理阶段（版本2格式）
+ByteWriter *compress_writer_create(CompressAlgorithm algorithm, ByteWriter *next);
+ByteWriter *decompress_writer_create(ByteWriter *next, int *legacy_format);
+ByteWriter *huffman_encoder_create(ByteWriter *next);
+ByteWriter *huffman_decoder_create(ByteWriter *next);
+ByteWriter *lz77_encoder_create(ByteWriter *next);
+ByteWriter *lz77_decoder_create(ByteWriter *next);
 
 #endif // COMPRESS_H
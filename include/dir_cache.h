@@ -0,0 +1,25 @@
+#ifndef DIR_CACHE_H
+#define DIR_CACHE_H
+
+#include "types.h"
+
+// 还原时的目录创建缓存
+// 记录已经创建过的目录，每个目录只创建一次，已创建目录下的文件不再需要任何系统调用；
+// POSIX上新目录用mkdirat相对于目标目录（路径很深时相对于最近创建的目录路径上保持打开的上层目录）创建，
+// 不需要内核从根目录重新解析整个路径；其他平台上用完整路径逐级创建
+// 同一个对象不能在多个线程中同时使用
+typedef struct DirCache DirCache;
+
+// 创建缓存，目录相对于root（root必须已存在）
+DirCache *dir_cache_create(const char *root);
+
+// 释放缓存，关闭打开的目录
+void dir_cache_destroy(DirCache *cache);
+
+// 创建目录path（相对于root，'/'和'\\'都视为分隔符，长度为length）及其上层目录，目录已存在也视为成功
+BackupResult dir_cache_make(DirCache *cache, const char *path, size_t length);
+
+// 创建文件path（相对于root）所在的目录及其上层目录
+BackupResult dir_cache_make_parent(DirCache *cache, const char *path, size_t length);
+
+#endif // DIR_CACHE_H
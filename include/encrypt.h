@@ -2,6 +2,7 @@
 #define ENCRYPT_H
 
 #include "types.h"
+#include "stream.h"
 
 // 加密文件头部结构体
 typedef struct {
@@ -16,12 +17,28 @@ typedef struct {
 BackupResult write_encrypt_header(FILE *fp, const EncryptHeader *header);
 BackupResult read_encrypt_header(FILE *fp, EncryptHeader *header);
 
-// AES加密相关函数
+// 加密解密数据流（含加密文件头部）
+BackupResult encrypt_stream(ByteReader *input, ByteWriter *output, EncryptAlgorithm algorithm, const char *key);
+BackupResult decrypt_stream(ByteReader *input, ByteWriter *output, const char *key);
+
+// 通用加密解密实现（不含加密文件头部）
+BackupResult crypto_encrypt_decrypt_stream(ByteReader *input, ByteWriter *output, const char *password, const unsigned char *iv, EncryptAlgorithm algorithm);
+
+// AES加密相关函数（FILE*版本是流式版本的封装）
 BackupResult aes_encrypt(FILE *input_fp, FILE *output_fp, const char *key, unsigned char *iv);
 BackupResult aes_decrypt(FILE *input_fp, FILE *output_fp, const char *key, unsigned char *iv);
+BackupResult aes_encrypt_stream(ByteReader *input, ByteWriter *output, const char *key, const unsigned char *iv);
+BackupResult aes_decrypt_stream(ByteReader *input, ByteWriter *output, const char *key, const unsigned char *iv);
 
-// DES加密相关函数
+// DES加密相关函数（FILE*版本是流式版本的封装）
 BackupResult des_encrypt(FILE *input_fp, FILE *output_fp, const char *key);
 BackupResult des_decrypt(FILE *input_fp, FILE *output_fp, const char *key);
+BackupResult des_encrypt_stream(ByteReader *input, ByteWriter *output, const char *key);
+BackupResult des_decrypt_stream(ByteReader *input, ByteWriter *output, const char *key);
+
+// 流式加密处理阶段
+ByteWriter *cipher_writer_create(EncryptAlgorithm algorithm, const char *key, const unsigned char *iv, ByteWriter *next);
+ByteWriter *encrypt_writer_create(EncryptAlgorithm algorithm, const char *key, ByteWriter *next);
+ByteWriter *decrypt_writer_create(const char *key, ByteWriter *next);
 
 #endif // ENCRYPT_H
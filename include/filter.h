@@ -2,16 +2,35 @@
 #define FILTER_H
 
 #include "types.h"
+#include "catalog.h"
 
 // 主筛选函数声明
 int filter_file(const FileMetadata *metadata, const BackupOptions *options);
 
+// 按目录清单项筛选：name为文件名，path为相对路径（只在按目录筛选时使用，可为NULL）
+int filter_entry(const CatalogEntry *entry, const char *name, const char *path, const BackupOptions *options);
+
+// 是否需要文件的完整路径（按目录筛选时需要），不需要时遍历不必为每个文件构建路径
+int filter_needs_path(const BackupOptions *options);
+
+// 还原时是否设置了筛选条件
+int filter_restore_enabled(const RestoreOptions *options);
+
+// 还原时按备份文件索引中的文件项筛选，筛选逻辑与filter_entry相同，另外按包含模式筛选
+// name为文件名，path为相对路径
+int filter_restore_entry(const CatalogEntry *entry, const char *name, const char *path, const RestoreOptions *options);
+
 // 文件筛选模块内部函数声明
-int filter_by_type(const FileMetadata *metadata, FileType file_types);
-int filter_by_time(const FileMetadata *metadata, const TimeRange *create_range, const TimeRange *modify_range, const TimeRange *access_range);
-int filter_by_size(const FileMetadata *metadata, const SizeRange *size_range);
-int filter_by_user(const FileMetadata *metadata, const ExcludeUserGroup *exclude_usergroup);
-int filter_by_filename(const FileMetadata *metadata, const ExcludeFilename *exclude_filename);
-int filter_by_directory(const FileMetadata *metadata, const ExcludeDirectory *exclude_directory);
+int filter_by_type(const CatalogEntry *entry, FileType file_types);
+int filter_by_time(const CatalogEntry *entry, const TimeRange *create_range, const TimeRange *modify_range, const TimeRange *access_range);
+int filter_by_size(const CatalogEntry *entry, const SizeRange *size_range);
+int filter_by_user(const CatalogEntry *entry, const ExcludeUserGroup *exclude_usergroup);
+int filter_by_filename(const char *name, const ExcludeFilename *exclude_filename);
+int filter_by_directory(const char *path, const ExcludeDirectory *exclude_directory);
+int filter_by_include(const char *name, const char *path, const char *const *patterns, int count);
+
+// 通配符匹配：'*'匹配任意多个字符，'?'匹配一个字符，都不匹配分隔符；'**'匹配任意多级目录，"**/"也可以匹配空
+// '/'和'\\'都视为分隔符
+int filter_match_glob(const char *pattern, const char *text);
 
 #endif // FILTER_H
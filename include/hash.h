@@ -0,0 +1,43 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include "types.h"
+
+// SHA-256摘要的字节数
+#define SHA256_SIZE 32
+
+// SHA-256计算状态，数据可以分多次加入
+typedef struct {
+    unsigned int state[8];          // 中间哈希值
+    unsigned long long length;      // 已加入的字节数
+    unsigned char block[64];        // 未满一块的数据
+    size_t block_len;
+} Sha256;
+
+// 增量计算：初始化、加入数据、得到摘要
+void sha256_init(Sha256 *ctx);
+void sha256_update(Sha256 *ctx, const void *data, size_t size);
+void sha256_final(Sha256 *ctx, unsigned char digest[SHA256_SIZE]);
+
+// 一次计算一段数据的摘要
+void sha256(const void *data, size_t size, unsigned char digest[SHA256_SIZE]);
+
+// XXH64计算状态：非加密的64位哈希，用于文件内容摘要，检查备份文件和还原结果的数据损坏
+// 每32字节分给4个相互独立的累加器，乘法和移位可以在流水线中重叠执行，速度接近内存带宽
+typedef struct {
+    unsigned long long lanes[4];    // 累加器
+    unsigned long long seed;
+    unsigned long long length;      // 已加入的字节数
+    unsigned char block[32];        // 未满32字节的数据
+    size_t block_len;
+} Xxh64;
+
+// 增量计算：初始化、加入数据、得到摘要（不改变计算状态）
+void xxh64_init(Xxh64 *ctx, unsigned long long seed);
+void xxh64_update(Xxh64 *ctx, const void *data, size_t size);
+unsigned long long xxh64_final(const Xxh64 *ctx);
+
+// 一次计算一段数据的摘要
+unsigned long long xxh64(const void *data, size_t size, unsigned long long seed);
+
+#endif // HASH_H
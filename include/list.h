@@ -0,0 +1,25 @@
+#ifndef LIST_H
+#define LIST_H
+
+#include "types.h"
+#include "archive.h"
+
+// 列出的每个文件调用一次
+typedef void (*ListCallback)(const ArchiveEntry *entry, void *context);
+
+// 列出统计
+typedef struct {
+    unsigned long long files;  // 列出的文件数量
+    unsigned long long bytes;  // 这些文件的大小之和
+    double seconds;            // 耗时（秒），包括打开备份文件和回调
+} ListStats;
+
+// 列出备份文件中的文件而不还原：只读取索引（见archive_open_index），不读取任何文件数据，
+// 按索引中的顺序（已排序的索引按路径升序）对选中的文件调用callback，选择方式与还原相同（restore_select）
+// 压缩或加密的备份文件只能解码整个数据流才能找到索引，不支持，返回BACKUP_ERROR_PACK；有路径没有匹配的文件时返回BACKUP_ERROR_PATH
+BackupResult list_data(const ListOptions *options, ListCallback callback, void *context);
+
+// 获取最近一次列出的统计
+void list_get_stats(ListStats *stats);
+
+#endif // LIST_H
@@ -2,6 +2,7 @@
 #define MAIN_H
 
 #include "types.h"
+#include "stream.h"
 
 // 全局函数声明
 
@@ -16,7 +17,10 @@ int filter_file(const FileMetadata *metadata, const BackupOptions *options);
 
 // 打包解包模块
 BackupResult pack_files(const char *output_path, const FileMetadata *files, int file_count, PackAlgorithm algorithm);
+BackupResult pack_files_stream(ByteWriter *writer, const FileMetadata *files, int file_count, PackAlgorithm algorithm);
 BackupResult unpack_files(const char *input_path, FileMetadata **files, int *file_count, PackAlgorithm algorithm);
+ByteWriter *unpack_writer_create(FileMetadata **files, int *file_count);
+BackupResult unpack_writer_set_chunk_store(ByteWriter *writer, const char *data_path); // 分块文件的块数据文件（chunks.dat）
 
 // 压缩解压模块
 BackupResult compress_file(const char *input_path, const char *output_path, CompressAlgorithm algorithm);
@@ -0,0 +1,29 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include "types.h"
+#include "archive.h"
+#include "catalog.h"
+
+// 增量备份的上一次备份清单：打开去重仓库中上一次的备份文件，按路径建立哈希表
+// 路径、类型、大小、修改时间和inode都与上一次相同的普通文件视为没有变化，不再读取，直接沿用上一次记录的块引用表；
+// 修改过的文件以上一次的块引用表为基准，新块尽量保存为差异块；
+// 新的备份文件仍然记录完整的块引用表，可以单独还原，不依赖上一次的备份文件
+// 打开后只读，可以在多个线程中同时查找
+typedef struct Manifest Manifest;
+
+// 打开上一次的备份文件，文件不存在时返回BACKUP_ERROR_PATH，不是去重备份时返回BACKUP_ERROR_PACK
+BackupResult manifest_open(const char *path, Manifest **manifest);
+void manifest_close(Manifest *manifest);
+
+// 按相对路径查找上一次备份中的文件项，找不到时返回NULL
+const ArchiveEntry *manifest_find(const Manifest *manifest, const char *path);
+
+// 查找没有变化的文件：path是相对路径，entry是本次遍历得到的元数据
+// 上一次是分块文件且类型、大小、修改时间和inode都相同时返回其文件项，否则返回NULL
+const ArchiveEntry *manifest_find_unchanged(const Manifest *manifest, const char *path, const CatalogEntry *entry);
+
+// 文件项的块引用表（item.extent_count个ChunkRef，可能未对齐）
+const unsigned char *manifest_chunks(const Manifest *manifest, const ArchiveEntry *entry);
+
+#endif // MANIFEST_H
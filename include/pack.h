@@ -2,8 +2,15 @@
 #define PACK_H
 
 #include "types.h"
+#include "stream.h"
+#include "catalog.h"
+#include "chunk_store.h"
 
-// 打包文件头部结构体
+// MyPack格式版本：打包只写入版本2，版本1只用于读取以前的备份
+#define PACK_VERSION_1 1
+#define PACK_VERSION_2 2
+
+// 打包文件头部结构体（版本1）
 typedef struct {
     char magic[4];             // 魔术字，用于识别打包文件
     unsigned int version;      // 版本号
@@ -12,7 +19,7 @@ typedef struct {
     unsigned long data_offset; // 数据偏移量
 } PackHeader;
 
-// 打包文件项结构体
+// 打包文件项结构体（版本1）
 typedef struct {
     char path[256];            // 文件路径
     char name[256];            // 文件名
@@ -28,7 +35,134 @@ typedef struct {
     char symlink_target[256];  // 符号链接目标
 } PackFileItem;
 
-// 打包解包模块内部函数声明
+// MyPack版本2：文件数据顺序写入，索引和定长尾部放在文件末尾，打包时只需向前写一遍，可以输出到管道
+//   开头：Pack2Signature
+//   每个文件：标记"FILE"、Pack2Item、路径、符号链接目标、文件数据
+//   索引：标记"INDX"，每个文件一个Pack2Item、路径、符号链接目标，按路径排序
+//   尾部：Pack2Trailer
+// 路径和符号链接目标不含结尾的'\0'，长度不受限制；顺序解包只需要文件记录，随机访问从尾部找到索引
+// 文件项的结构固定，各项特性由文件项标志（PACK2_ITEM_*）表示，文件数据的内容随标志不同：
+//   稀疏文件：extent_count个Pack2Extent，之后依次是各数据段的数据，数据段之外的部分全为零
+//   硬链接：没有文件数据，符号链接目标的位置保存同一文件先前记录的路径
+//   分块文件（只用于去重备份）：extent_count个ChunkRef，按顺序拼接备份文件旁边分块存储中的各块得到文件内容
+//   有内容摘要：文件数据之后是8字节的内容摘要（XXH64），索引中的文件项记录同一摘要；文件记录中的文件项写在数据之前，其中的摘要为0
+// 整个备份的特性由尾部标志（PACK2_FLAG_*）表示
+#define PACK2_TAG_SIZE 4
+#define PACK2_TAG_FILE "FILE"
+#define PACK2_TAG_INDEX "INDX"
+#define PACK2_TRAILER_MAGIC "BACKIDX2"
+
+// 尾部标志：索引按路径（逐字节比较）升序排列，可以二分查找
+#define PACK2_FLAG_SORTED 0x1u
+
+// 尾部标志：去重备份，分块文件的数据在备份文件旁边的分块存储中
+#define PACK2_FLAG_CHUNKED 0x2u
+
+// 内容摘要（XXH64）的种子
+#define PACK2_HASH_SEED 0
+
+// 版本2的开头：魔术字与版本1相同，解包时根据版本号区分
+typedef struct {
+    char magic[4];                  // 魔术字"BACK"
+    unsigned int version;           // 版本号，为PACK_VERSION_2
+} Pack2Signature;
+
+// 版本2的文件项，文件记录和索引中相同
+typedef struct {
+    unsigned long long offset;      // 文件数据在打包文件中的偏移量
+    unsigned long long size;        // 文件大小
+    long long create_time;          // 创建时间
+    long long modify_time;          // 修改时间
+    long long access_time;          // 访问时间
+    unsigned int type;              // 文件类型
+    unsigned int mode;              // 文件权限
+    unsigned int uid;               // 用户ID
+    unsigned int gid;               // 组ID
+    unsigned int path_length;       // 路径长度
+    unsigned int symlink_length;    // 符号链接目标长度，不是符号链接时为0
+    unsigned int flags;             // 文件项标志（PACK2_ITEM_*）
+    unsigned int extent_count;      // 稀疏文件的数据段数量（分块文件的块数）
+    unsigned long long inode;       // 备份时文件的inode，增量备份据此判断文件是否变化
+    unsigned long long content_hash; // 内容摘要（flags含PACK2_ITEM_HASHED时有效）
+} Pack2Item;
+
+// 文件项标志：稀疏文件，文件数据从数据段表开始，size是包括空洞在内的文件大小
+#define PACK2_ITEM_SPARSE 0x1u
+
+// 文件项标志：硬链接，没有文件数据，size是链接到的文件的大小，符号链接目标是链接到的文件在备份中的路径
+#define PACK2_ITEM_HARDLINK 0x2u
+
+// 文件项标志：分块文件，文件数据是块引用表（ChunkRef），size是文件大小
+#define PACK2_ITEM_CHUNKED 0x4u
+
+// 文件项标志：有内容摘要，摘要覆盖备份中保存的文件内容（稀疏文件项是各数据段的数据依次拼接，分块文件是各块依次拼接）
+// 由数据来源直接复制的文件数据不经过打包模块，摘要由数据来源计算
+#define PACK2_ITEM_HASHED 0x8u
+
+// 稀疏文件的数据段
+typedef struct {
+    unsigned long long offset;      // 数据段在文件中的偏移量
+    unsigned long long length;      // 数据段长度
+} Pack2Extent;
+
+// 版本2的尾部，位于打包文件的最后
+typedef struct {
+    unsigned long long index_offset; // 索引（从标记"INDX"开始）在打包文件中的偏移量
+    unsigned long long index_size;   // 索引的字节数
+    unsigned int file_count;         // 文件数量
+    unsigned int flags;              // 标志（PACK2_FLAG_*）
+    char magic[8];                   // 魔术字"BACKIDX2"
+} Pack2Trailer;
+
+// 打包数据来源：为每个文件提供数据的读取端，读取端由打包模块释放
+// 打包时未指定数据来源则直接从磁盘读取文件
+// 设置了copy时文件数据不经过读取端，由数据来源自行写入备份文件（如由内核直接复制），写入长度必须严格等于size；
+// 不小于copy_min_size的文件数据不经过writer，hash不为NULL时由数据来源返回写入的数据的内容摘要（种子PACK2_HASH_SEED）；
+// 更小的文件由copy写入writer，hash不被设置
+typedef struct PackSource PackSource;
+struct PackSource {
+    ByteReader *(*open)(PackSource *source, const char *path, unsigned long long size);
+    BackupResult (*copy)(PackSource *source, ByteWriter *writer, const char *path, unsigned long long size, unsigned long long *hash); // 可为NULL
+    unsigned long long copy_min_size;
+};
+
+// 打包格式实现，按目录清单的文件列表顺序打包，MyPack写入版本2，普通文件同时计算内容摘要
+// 目录清单中标记为稀疏的文件不经过数据来源，直接从磁盘只读取数据段：MyPack只保存数据段，Tar的空洞部分直接写入零
+// 同一硬链接组中第一个打包的文件保存数据，之后的文件只记录硬链接（MyPack的硬链接文件项，Tar的类型'1'），
+// 这些文件不从数据来源读取；Tar中ustar字段放不下的路径和链接目标使用GNU长名称记录（类型'L'和'K'）
+BackupResult mypack_pack(ByteWriter *writer, const Catalog *catalog, PackSource *source);
+BackupResult tar_pack(ByteWriter *writer, const Catalog *catalog, PackSource *source);
+
+// 增量备份时上一次的备份清单（见manifest.h）
+typedef struct Manifest Manifest;
+
+// 去重打包：写入MyPack版本2（尾部标志含PACK2_FLAG_CHUNKED），普通文件（包括稀疏文件，空洞按零写入）的数据按内容分块存入store，备份文件中只记录块引用
+// previous不为NULL时为增量备份，与上一次相比没有变化的文件（manifest_find_unchanged）不从数据来源读取，直接沿用上一次的块引用表和内容摘要
+// 硬链接、符号链接与mypack_pack相同；数据来源不能设置copy
+BackupResult mypack_pack_chunked(ByteWriter *writer, const Catalog *catalog, PackSource *source, ChunkStore *store, const Manifest *previous);
+
+// 流式打包：文件逐个加入，不需要预先知道文件数量，可以边遍历边打包
+// 需要在开头写入文件数量的格式不支持流式打包，此时pack_stream_create()返回NULL
+// MyPack在结束时根据目录清单写入索引，加入的文件所在的目录清单在pack_stream_end()之前不能释放
+typedef struct PackStream PackStream;
+int pack_stream_supported(PackAlgorithm algorithm);
+PackStream *pack_stream_create(ByteWriter *writer, PackAlgorithm algorithm, PackSource *source);
+PackStream *pack_stream_create_chunked(ByteWriter *writer, PackSource *source, ChunkStore *store, const Manifest *previous); // 去重打包，格式为MyPack
+BackupResult pack_stream_add(PackStream *stream, const Catalog *catalog, unsigned int id);
+BackupResult pack_stream_end(PackStream *stream);
+void pack_stream_destroy(PackStream *stream);
+
+// 检查备份文件中的路径（length字节，不需要以'\0'结尾）能否作为还原路径，只有目标目录下的相对路径可以
+// 空路径、以'/'或'\\'开头的路径、带盘符的路径、含'\0'或".."组成部分的路径返回0，否则备份文件可以写到目标目录之外
+// 流式解包在创建目录、打开输出文件和建立硬链接之前检查，随机访问读取（archive.c）在解析索引时检查每个路径
+int pack_path_safe(const char *path, size_t length);
+
+// 解包实现（FILE*版本是流式版本的封装）
+BackupResult unpack_stream(ByteReader *reader, FileMetadata **files, int *file_count);
+BackupResult mypack_unpack(FILE *fp, FileMetadata **files, int *file_count);
+BackupResult tar_unpack(FILE *fp, FileMetadata **files, int *file_count);
+
+// 打包解包模块内部函数声明（版本1）
 BackupResult write_pack_header(FILE *fp, const PackHeader *header);
 BackupResult read_pack_header(FILE *fp, PackHeader *header);
 BackupResult write_pack_file_item(FILE *fp, const PackFileItem *item);
@@ -0,0 +1,67 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "types.h"
+#include "ring.h"
+#include "catalog.h"
+#include "chunk_store.h"
+#include "manifest.h"
+
+// 流水线各阶段之间传递的数据块大小
+#define PIPELINE_BLOCK_SIZE (1024 * 1024)
+
+// 每个阶段输入队列的数据块数量
+#define PIPELINE_QUEUE_DEPTH 4
+
+// 流式遍历时遍历阶段与读取阶段之间的文件队列长度
+#define PIPELINE_FILE_QUEUE_DEPTH 256
+
+// 流水线阶段，每个阶段在独立的线程中运行，相邻阶段之间通过有界环形队列连接
+typedef enum {
+    PIPELINE_STAGE_TRAVERSE,   // 遍历目录（仅流式遍历时启用）
+    PIPELINE_STAGE_READ,       // 读取源文件
+    PIPELINE_STAGE_PACK,       // 打包分帧
+    PIPELINE_STAGE_COMPRESS,   // 压缩（可选）
+    PIPELINE_STAGE_ENCRYPT,    // 加密（可选）
+    PIPELINE_STAGE_WRITE,      // 写入备份文件
+    PIPELINE_STAGE_COUNT
+} PipelineStage;
+
+// 阶段统计
+typedef struct {
+    int enabled;                  // 本次备份是否启用该阶段
+    unsigned long long bytes_in;  // 本阶段处理的输入字节数
+    RingStats input;              // 输入队列的统计（第一个阶段没有输入队列）
+} PipelineStageStats;
+
+// 流水线统计
+typedef struct {
+    PipelineStageStats stages[PIPELINE_STAGE_COUNT];
+    unsigned long long files;     // 打包的文件数量
+    unsigned long long bytes;     // 源文件数据的字节数
+    unsigned long long copied_bytes; // 其中由内核直接复制到备份文件的字节数
+    unsigned long long unchanged_files; // 增量备份时没有变化、沿用上一次块引用表的文件数量
+    unsigned long long unchanged_bytes; // 这些文件的字节数（不计入bytes）
+    int zero_copy;                // 是否零拷贝打包（较大文件的数据由写入阶段通过内核直接复制）
+    double seconds;               // 耗时（秒）
+} PipelineStats;
+
+// 多线程流水线备份：按目录清单的文件列表读取文件，经打包、压缩、加密后写入output_fp
+// 未压缩、未加密且平台支持时，较大文件的数据不经过读取和打包阶段，由写入阶段通过内核直接从源文件复制到备份文件
+// chunks不为NULL时为去重打包（MyPack），文件数据由打包阶段分块存入chunks，此时不直接复制；
+// previous不为NULL时为增量备份，与上一次相比没有变化的文件不读取
+// 当前工作目录应为源目录，chunks、previous和stats可为NULL
+BackupResult pipeline_backup(const Catalog *catalog, const BackupOptions *options, ChunkStore *chunks, const Manifest *previous, FILE *output_fp, PipelineStats *stats);
+
+// 流式遍历备份：遍历root_path的同时读取和打包已找到的文件，不需要先得到完整的文件列表
+// 遍历线程把文件放入有界队列，队列满时遍历暂停；打包格式必须支持流式打包（pack_stream_supported）
+// 当前工作目录应为源目录（root_path通常为"."），没有找到文件时返回BACKUP_ERROR_NO_FILES
+BackupResult pipeline_backup_tree(const char *root_path, const BackupOptions *options, ChunkStore *chunks, const Manifest *previous, FILE *output_fp, PipelineStats *stats);
+
+// 阶段名称
+const char *pipeline_stage_name(PipelineStage stage);
+
+// 根据队列统计推断瓶颈阶段：瓶颈阶段的输入队列经常是满的，而其下游的队列经常是空的
+PipelineStage pipeline_bottleneck(const PipelineStats *stats);
+
+#endif // PIPELINE_H
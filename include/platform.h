@@ -0,0 +1,108 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include "types.h"
+
+// 路径分隔符
+#ifdef _WIN32
+#define PATH_SEPARATOR '\\'
+#define PATH_SEPARATOR_STRING "\\"
+#else
+#define PATH_SEPARATOR '/'
+#define PATH_SEPARATOR_STRING "/"
+#endif
+
+// 平台相关的文件系统操作，Windows上使用Win32 API，其他平台使用POSIX接口
+
+// 检查路径是否存在，is_directory不为NULL时返回是否是目录
+int platform_path_exists(const char *path, int *is_directory);
+
+// 创建单级目录，目录已存在也视为成功
+int platform_make_directory(const char *path);
+
+// 递归创建目录（'/'和'\'都视为分隔符），目录已存在也视为成功
+int platform_make_directories(const char *path);
+
+// 创建文件所在的目录
+void platform_make_parent_directories(const char *path);
+
+// 获取和切换当前工作目录
+BackupResult platform_get_current_directory(char *buffer, size_t size);
+int platform_change_directory(const char *path);
+
+// 获取绝对路径
+BackupResult platform_full_path(const char *path, char *buffer, size_t size);
+
+// 删除和复制文件
+int platform_delete_file(const char *path);
+BackupResult platform_copy_file(const char *source, const char *target);
+
+// 将文件source改名为target，target已存在时被替换
+BackupResult platform_replace_file(const char *source, const char *target);
+
+// 创建指向existing的硬链接path，path已存在时先删除；文件系统不支持或跨设备时返回BACKUP_ERROR_FILE
+BackupResult platform_make_link(const char *existing, const char *path);
+
+// 定位文件读写位置，支持超过2GB的偏移量
+BackupResult platform_seek(FILE *fp, long long offset, int origin);
+long long platform_tell(FILE *fp);
+
+// 设置文件大小（先冲刷stdio缓冲区），扩大时新增的部分是空洞
+BackupResult platform_set_file_size(FILE *fp, unsigned long long size);
+
+// 稀疏文件中的一个数据段，数据段之外的部分是空洞（读出全为零）
+typedef struct {
+    unsigned long long offset;      // 数据段在文件中的偏移量
+    unsigned long long length;      // 数据段长度
+} PlatformExtent;
+
+// 查找文件前size字节中的数据段，按偏移量升序返回，*extents由调用方释放
+// 支持SEEK_DATA/SEEK_HOLE的平台上只返回分配了空间的部分，不支持时返回覆盖前size字节的一个数据段；
+// 调用后文件的读写位置回到开头
+BackupResult platform_file_extents(FILE *fp, unsigned long long size, PlatformExtent **extents, unsigned int *count);
+
+// 文件第一个数据段在磁盘上的物理位置（字节），用于按物理位置排列读取顺序
+// Linux上使用FIEMAP；文件没有已分配的数据段（空文件、数据内联在inode中、延迟分配）时为0
+// 平台或文件系统不支持时返回BACKUP_ERROR_PARAM，文件打不开时返回BACKUP_ERROR_FILE
+BackupResult platform_physical_offset(const char *path, unsigned long long *offset);
+
+// 在文件之间直接复制数据，数据不经过用户态缓冲区
+// 从source_fd的offset处读取size字节，写到target_fd的当前位置，copied返回实际复制的字节数
+// Linux上优先使用copy_file_range（同一文件系统内可由文件系统直接复制，NFS上可在服务器端复制），不支持时改用sendfile
+// 源文件提前结束、文件系统或平台不支持时copied小于size，调用方应从offset + copied处改用普通读写继续；
+// 只有读写出错时返回BACKUP_ERROR_FILE
+BackupResult platform_copy_range(int source_fd, unsigned long long offset, int target_fd, unsigned long long size, unsigned long long *copied);
+
+// 从fd的offset处读取size字节到buffer，不使用也不改变文件的读写位置，多个线程可以同时读取同一文件的不同范围
+// POSIX上使用pread，Windows上使用带偏移量的ReadFile；读取出错或文件提前结束时返回BACKUP_ERROR_FILE
+BackupResult platform_read_at(int fd, unsigned long long offset, void *buffer, size_t size);
+
+// 单调时钟的当前时间（秒），用于统计耗时
+double platform_monotonic_time(void);
+
+// 只读映射整个文件
+typedef struct {
+    const unsigned char *data;      // 映射的起始地址，空文件为NULL
+    unsigned long long size;        // 文件大小
+#ifdef _WIN32
+    void *file;                     // 文件句柄
+    void *mapping;                  // 映射对象句柄
+#endif
+} PlatformMap;
+
+// 访问方式提示
+typedef enum {
+    PLATFORM_ADVICE_SEQUENTIAL,     // 将顺序访问，可以加大预读
+    PLATFORM_ADVICE_RANDOM,         // 将随机访问，不需要预读
+    PLATFORM_ADVICE_WILLNEED,       // 即将访问，提前读入
+    PLATFORM_ADVICE_PREFAULT,       // 即将读取，提前读入并建立页表，避免逐页缺页
+    PLATFORM_ADVICE_DONTNEED        // 不再访问，可以释放
+} PlatformAdvice;
+
+BackupResult platform_map_file(const char *path, PlatformMap *map);
+void platform_unmap_file(PlatformMap *map);
+
+// 提示映射中一段范围的访问方式，范围自动扩展到页边界，不支持的平台上忽略
+void platform_advise(const PlatformMap *map, unsigned long long offset, unsigned long long length, PlatformAdvice advice);
+
+#endif // PLATFORM_H
@@ -2,9 +2,17 @@
 #define RESTORE_H
 
 #include "types.h"
+#include "archive.h"
 
 // 还原模块内部函数声明
 BackupResult extract_files(const char *backup_file, const char *target_path, const RestoreOptions *options);
 BackupResult restore_single_file(const char *source, const char *target, const FileMetadata *metadata);
 
+// 按指定的路径和筛选条件选中索引中的文件（selected有archive_entry_count个元素），列出命令使用同样的选择
+// 指定的路径不在索引中时返回BACKUP_ERROR_PATH，筛选后没有文件时返回BACKUP_ERROR_NO_FILES
+BackupResult restore_select(const Archive *archive, const RestoreOptions *options, unsigned char *selected);
+
+// 获取最近一次还原的提取统计，备份文件经过解包处理链（压缩或加密）还原时统计为空
+void restore_get_archive_stats(ArchiveStats *stats);
+
 #endif // RESTORE_H
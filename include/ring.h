@@ -0,0 +1,52 @@
+#ifndef RING_H
+#define RING_H
+
+#include "types.h"
+
+// 有界单生产者单消费者环形队列（无锁）
+// 队列中的元素是定长的槽位，生产者直接在槽位中填充数据后发布，
+// 消费者直接读取槽位中的数据后释放，数据在线程之间传递时不需要额外复制
+typedef struct RingBuffer RingBuffer;
+
+// 队列统计，用于判断流水线中哪个阶段是瓶颈
+typedef struct {
+    unsigned long long pushed;      // 发布的元素数量
+    unsigned long long depth_sum;   // 每次取出元素时的队列深度之和，除以pushed为平均深度
+    unsigned int max_depth;         // 最大队列深度
+    unsigned int capacity;          // 队列容量
+    unsigned long long full_waits;  // 生产者因队列满而等待的次数
+    unsigned long long empty_waits; // 消费者因队列空而等待的次数
+} RingStats;
+
+// 创建队列，capacity为槽位数量（向上取整为2的幂），element_size为每个槽位的字节数
+RingBuffer *ring_create(unsigned int capacity, size_t element_size);
+
+// 释放队列
+void ring_destroy(RingBuffer *ring);
+
+// 生产者：等待空闲槽位并返回，队列被中止时返回NULL
+void *ring_acquire(RingBuffer *ring);
+
+// 生产者：发布ring_acquire()返回的槽位
+void ring_publish(RingBuffer *ring);
+
+// 生产者：数据结束，消费者取完剩余元素后得到NULL
+void ring_close(RingBuffer *ring);
+
+// 消费者：等待下一个元素并返回，队列已关闭且为空或被中止时返回NULL
+void *ring_peek(RingBuffer *ring);
+
+// 消费者：释放ring_peek()返回的槽位
+void ring_release(RingBuffer *ring);
+
+// 中止队列，唤醒双方等待的线程（任意线程均可调用）
+void ring_abort(RingBuffer *ring);
+int ring_aborted(RingBuffer *ring);
+
+// 当前队列深度（任意线程均可调用）
+unsigned int ring_depth(RingBuffer *ring);
+
+// 获取队列统计（应在生产者和消费者都结束后调用）
+void ring_get_stats(RingBuffer *ring, RingStats *stats);
+
+#endif // RING_H
@@ -0,0 +1,28 @@
+#ifndef STAT_BATCH_H
+#define STAT_BATCH_H
+
+#include "types.h"
+#include "catalog.h"
+
+// 每批获取元数据的最大文件数
+#define STAT_BATCH_SIZE 256
+
+// 批量获取元数据
+// Linux上通过io_uring一次提交整批statx请求，由内核并发执行后统一收割结果；
+// io_uring不可用（内核过旧、被禁用或非Linux平台）时退回逐个同步调用
+typedef struct StatBatch StatBatch;
+
+// 创建批量获取元数据的对象，每个线程使用各自的对象
+StatBatch *stat_batch_create(void);
+
+// 释放对象
+void stat_batch_destroy(StatBatch *batch);
+
+// 是否使用io_uring异步获取
+int stat_batch_async(const StatBatch *batch);
+
+// 获取dir_fd目录下count个（不超过STAT_BATCH_SIZE）文件的元数据，不跟随符号链接
+// 填充stats[i]的类型、大小、时间、权限和所有者，成功的项ok[i]为1
+void stat_batch_run(StatBatch *batch, int dir_fd, const char *const names[], int count, CatalogEntry stats[], int ok[]);
+
+#endif // STAT_BATCH_H
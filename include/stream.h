@@ -0,0 +1,81 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "types.h"
+
+// 流式处理缓冲区大小
+#define STREAM_BUFFER_SIZE 65536
+
+// 字节流写入端（推模式）
+// 打包、压缩、加密等处理阶段都实现为写入端，并通过next串联成处理链，
+// 数据在内存中逐级传递，最终由终端写入端落盘，不再产生中间临时文件
+typedef struct ByteWriter ByteWriter;
+struct ByteWriter {
+    BackupResult (*write)(ByteWriter *writer, const unsigned char *data, size_t size); // 写入数据
+    BackupResult (*finish)(ByteWriter *writer); // 输入结束，冲刷本阶段缓存的数据（可为NULL）
+    void (*destroy)(ByteWriter *writer);        // 释放本阶段资源（可为NULL）
+    ByteWriter *next;                           // 下游阶段，终端写入端为NULL
+};
+
+// 字节流读取端（拉模式）
+// 读取到0字节表示数据结束
+typedef struct ByteReader ByteReader;
+struct ByteReader {
+    BackupResult (*read)(ByteReader *reader, unsigned char *buffer, size_t size, size_t *bytes_read); // 读取数据
+    void (*destroy)(ByteReader *reader);        // 释放资源（可为NULL）
+};
+
+// 向处理链写入数据
+BackupResult stream_write(ByteWriter *writer, const void *data, size_t size);
+
+// 结束处理链：从上游到下游依次冲刷各阶段
+BackupResult stream_finish(ByteWriter *writer);
+
+// 释放处理链中的所有阶段
+void stream_destroy(ByteWriter *writer);
+
+// 从读取端读取数据，bytes_read为0表示数据结束
+BackupResult stream_read(ByteReader *reader, void *buffer, size_t size, size_t *bytes_read);
+
+// 从读取端读取恰好size字节，数据不足时返回错误
+BackupResult stream_read_exact(ByteReader *reader, void *buffer, size_t size);
+
+// 释放读取端
+void reader_destroy(ByteReader *reader);
+
+// 将读取端的全部数据写入写入端（不结束写入端）
+BackupResult stream_copy(ByteReader *reader, ByteWriter *writer);
+
+// 将读取端的全部数据送入处理阶段stage，其输出写入output
+// 完成后冲刷并释放stage到output之间的各阶段，output本身不释放
+BackupResult stream_transform(ByteReader *reader, ByteWriter *stage, ByteWriter *output);
+
+// 文件读写端（不负责关闭文件）
+ByteWriter *file_writer_create(FILE *fp);
+ByteReader *file_reader_create(FILE *fp);
+
+// 按路径打开文件的读取端，释放时关闭文件
+ByteReader *file_reader_open(const char *path);
+
+// 文件描述符读写端（不负责关闭文件描述符）
+ByteWriter *fd_writer_create(int fd);
+ByteReader *fd_reader_create(int fd);
+
+// 内存读取端：读取调用方提供的缓冲区（不复制数据）
+ByteReader *memory_reader_create(const void *data, size_t size);
+
+// 内存写入端：写入的数据保存在自动扩展的缓冲区中
+ByteWriter *memory_writer_create(void);
+const unsigned char *memory_writer_data(ByteWriter *writer, size_t *size);
+
+// 管道：写入端写入的数据可从读取端读出，两端释放时各自关闭文件描述符
+BackupResult stream_pipe_create(ByteReader **reader, ByteWriter **writer);
+
+// 串联读取端：从source拉取数据，经处理链加工后再供读取，处理链只按读取需要推进
+// 使用方法：创建后以chained_reader_output()返回的写入端为终端构建处理链，
+// 再通过chained_reader_set_stage()设置处理链的首个阶段；释放时一并释放source和处理链
+ByteReader *chained_reader_create(ByteReader *source);
+ByteWriter *chained_reader_output(ByteReader *reader);
+void chained_reader_set_stage(ByteReader *reader, ByteWriter *stage);
+
+#endif // STREAM_H
@@ -0,0 +1,52 @@
+#ifndef THREAD_H
+#define THREAD_H
+
+#include "types.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+// 线程句柄
+typedef struct {
+#ifdef _WIN32
+    void *handle;              // Windows线程句柄
+#else
+    pthread_t handle;          // POSIX线程
+#endif
+} Thread;
+
+// 互斥锁
+typedef struct {
+#ifdef _WIN32
+    void *lock;                // SRWLOCK（与指针大小相同）
+#else
+    pthread_mutex_t lock;
+#endif
+} Mutex;
+
+// 线程入口函数
+typedef void (*ThreadFunc)(void *arg);
+
+// 创建线程并立即运行func(arg)
+BackupResult thread_create(Thread *thread, ThreadFunc func, void *arg);
+
+// 等待线程结束并释放线程资源
+void thread_join(Thread *thread);
+
+// 让出当前线程的剩余时间片
+void thread_yield(void);
+
+// 当前线程休眠指定的毫秒数
+void thread_sleep(unsigned int milliseconds);
+
+// 互斥锁操作
+void mutex_init(Mutex *mutex);
+void mutex_destroy(Mutex *mutex);
+void mutex_lock(Mutex *mutex);
+void mutex_unlock(Mutex *mutex);
+
+// 获取可用的处理器数量
+int thread_cpu_count(void);
+
+#endif // THREAD_H
@@ -2,11 +2,55 @@
 #define TRAVERSE_H
 
 #include "types.h"
+#include "catalog.h"
+
+// 并行遍历的最大线程数
+#define TRAVERSE_MAX_THREADS 64
 
 // 目录遍历算法函数声明
+// 多个线程并行扫描目录，每个线程维护自己的待扫描目录队列，空闲时从其他线程窃取目录，
+// 结果保存在目录清单中，线程数和是否按路径排序结果由options->traverse_threads和options->traverse_sort决定，
+// options->traverse_layout要求之后再按文件在磁盘上的物理位置排序（读取顺序即备份文件中的顺序）
+BackupResult traverse_catalog(const char *root_path, Catalog **catalog, const BackupOptions *options);
+
+// 兼容接口：结果转换为FileMetadata数组，路径超出FileMetadata长度限制的文件被跳过
 BackupResult traverse_directory(const char *root_path, FileMetadata **files, int *file_count, const BackupOptions *options);
 
+// 流式遍历的接收端：经过筛选的文件加入目录清单后逐个交给接收端
+// add()会被多个遍历线程同时调用，返回错误时遍历中止
+typedef struct TraverseSink TraverseSink;
+struct TraverseSink {
+    BackupResult (*add)(TraverseSink *sink, const Catalog *catalog, unsigned int id);
+};
+
+// 流式目录遍历，结果加入调用方提供的目录清单，文件按扫描顺序交给接收端（忽略options->traverse_sort）
+BackupResult traverse_directory_to(const char *root_path, Catalog *catalog, TraverseSink *sink, const BackupOptions *options);
+
 // 目录遍历过滤函数声明
 int filter_file(const FileMetadata *metadata, const BackupOptions *options);
 
-#endif // TRAVERSE_H
\ No newline at end of file
+// 遍历线程（由并行遍历框架提供给平台相关的目录扫描函数）
+typedef struct TraverseWorker TraverseWorker;
+
+// 扫描到的文件（当前目录下的文件名和属性），经过筛选后加入目录清单，symlink_target可为NULL
+BackupResult traverse_add_file(TraverseWorker *worker, const char *name, const CatalogEntry *stat, const char *symlink_target);
+
+// 扫描到的子目录（当前目录下的目录名），加入本线程的待扫描队列
+BackupResult traverse_add_directory(TraverseWorker *worker, const char *name);
+
+// 平台相关的目录扫描函数声明（traverse.c为Windows实现，traverse_posix.c为POSIX实现）
+typedef struct TraverseRoot TraverseRoot;
+TraverseRoot *traverse_root_open(const char *root_path);
+void traverse_root_close(TraverseRoot *root);
+
+// 平台相关的线程私有数据（例如批量获取元数据的资源），遍历线程开始时创建、结束时释放
+void *traverse_worker_data_create(TraverseRoot *root);
+void traverse_worker_data_destroy(void *data);
+
+// 获取本线程的私有数据
+void *traverse_worker_data(TraverseWorker *worker);
+
+// 扫描一个目录（rel_path为相对于根目录的路径，空串表示根目录，长度不限），目录打不开时跳过并返回成功
+BackupResult traverse_scan_directory(TraverseRoot *root, const char *rel_path, TraverseWorker *worker, const BackupOptions *options);
+
+#endif // TRAVERSE_H
@@ -116,6 +116,17 @@ typedef struct {
     int encrypt_enable;        // 是否启用加密
     EncryptAlgorithm encrypt_algorithm;
     char encrypt_key[64];      // 加密密钥
+
+    // 遍历选项
+    int traverse_threads;      // 并行遍历的线程数，0表示使用全部处理器
+    int traverse_sort;         // 是否按路径排序遍历结果，使备份文件中的顺序与线程调度无关
+    int traverse_layout;       // 是否按文件在磁盘上的物理位置排序遍历结果，使读取源文件时尽量顺序访问磁盘
+
+    // 去重仓库：文件数据按内容分块存入目标目录下的分块存储，相同的块只保存一次（只支持MyPack，不能加密）
+    int dedup;
+
+    // 增量备份（需要去重仓库，不能压缩）：与上一次的备份文件相比，路径、大小、修改时间和inode都没有变化的文件不再读取
+    int incremental;
 } BackupOptions;
 
 // 还原选项结构体
@@ -127,8 +138,51 @@ typedef struct {
     int encrypt_enable;        // 是否启用解密
     EncryptAlgorithm encrypt_algorithm;
     char encrypt_key[64];      // 解密密钥
+
+    // 选择性还原：只还原这些文件或目录（再按下面的条件筛选），通过备份文件中的索引直接定位
+    const char *paths[100];    // 相对路径
+    int path_count;            // 路径数量，为0时还原全部文件
+
+    // 按条件筛选：与BackupOptions的筛选条件相同，根据备份文件中的索引判断，只读取选中文件的数据
+    FileType file_types;       // 还原的文件类型，为0时不按类型筛选
+    TimeRange create_time_range;
+    TimeRange modify_time_range;
+    TimeRange access_time_range;
+    SizeRange size_range;
+    ExcludeFilename exclude_filename;
+    ExcludeDirectory exclude_directory;
+    const char *include_patterns[100]; // 只还原与其中之一匹配的文件（通配符模式，见filter_by_include）
+    int include_count;         // 模式数量，为0时不按模式筛选
+
+    // 并行提取
+    int threads;               // 同时提取文件的线程数，0表示使用全部处理器
 } RestoreOptions;
 
+// 校验选项结构体
+typedef struct {
+    char backup_file[256];     // 备份文件路径（未压缩、未加密）
+    char source_path[256];     // 源目录，不为空时还与其中的文件比较
+    int threads;               // 同时校验文件的线程数，0表示使用全部处理器
+} VerifyOptions;
+
+// 列出选项结构体
+typedef struct {
+    char backup_file[256];     // 备份文件路径（未压缩、未加密）
+    const char *paths[100];    // 只列出这些文件或目录（相对路径）
+    int path_count;            // 路径数量，为0时列出全部文件
+
+    // 按条件筛选：与RestoreOptions的筛选条件相同，根据备份文件中的索引判断
+    FileType file_types;       // 列出的文件类型，为0时不按类型筛选
+    TimeRange create_time_range;
+    TimeRange modify_time_range;
+    TimeRange access_time_range;
+    SizeRange size_range;
+    ExcludeFilename exclude_filename;
+    ExcludeDirectory exclude_directory;
+    const char *include_patterns[100]; // 只列出与其中之一匹配的文件（通配符模式，见filter_by_include）
+    int include_count;         // 模式数量，为0时不按模式筛选
+} ListOptions;
+
 // 函数返回值枚举
 typedef enum {
     BACKUP_SUCCESS = 0,
@@ -139,7 +193,8 @@ typedef enum {
     BACKUP_ERROR_COMPRESS = -5,
     BACKUP_ERROR_ENCRYPT = -6,
     BACKUP_ERROR_PACK = -7,
-    BACKUP_ERROR_NO_FILES = -8  // 没有文件需要备份
+    BACKUP_ERROR_NO_FILES = -8, // 没有文件需要备份（或没有与还原条件匹配的文件）
+    BACKUP_ERROR_CHECKSUM = -9  // 文件内容与备份时记录的摘要不符，数据已损坏
 } BackupResult;
 
 #endif // TYPES_H
\ No newline at end of file
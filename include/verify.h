@@ -0,0 +1,15 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "types.h"
+#include "archive.h"
+
+// 校验备份文件而不还原：读取索引，多个线程按偏移量读取各文件的数据并重新计算内容摘要
+// 备份文件需要未压缩、未加密（否则返回BACKUP_ERROR_PACK），发现问题时调用report（可为NULL，可能在多个线程中同时调用），
+// 全部文件校验完后有问题时返回BACKUP_ERROR_CHECKSUM
+BackupResult verify_data(const VerifyOptions *options, ArchiveVerifyReport report, void *context);
+
+// 获取最近一次校验的统计
+void verify_get_stats(ArchiveVerifyStats *stats);
+
+#endif // VERIFY_H
@@ -0,0 +1,1346 @@
+#include "archive.h"
+#include "platform.h"
+#include "dir_cache.h"
+#include "thread.h"
+#include <limits.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+// 每次写出的最大字节数：写出前预先建立这一段的页表，写出后释放已写出的映射页面
+#define ARCHIVE_WRITE_CHUNK (4ULL * 1024 * 1024)
+
+struct Archive {
+    PlatformMap map;           // 整个备份文件的只读映射
+    FILE *fp;                  // 直接复制文件数据时的来源，打开失败时只从映射写出
+    PlatformMap chunks;        // 去重备份的块数据文件的只读映射
+    FILE *chunks_fp;           // 直接复制块数据时的来源
+    ArchiveEntry *entries;     // 索引中的文件
+    unsigned int entry_count;
+    char *strings;             // Tar中由前缀和文件名拼接的路径（其他路径直接指向映射）
+    int sorted;                // 索引是否按路径排序
+    int index_only;            // 只读取了索引（archive_open_index），不能提取或校验
+    ArchiveStats stats;        // 提取统计
+};
+
+// 并行提取（校验）的最大线程数
+#define ARCHIVE_MAX_THREADS 64
+
+// 校验时每个线程按偏移量读取数据的缓冲区大小
+#define ARCHIVE_VERIFY_BUFFER (4 * 1024 * 1024)
+
+// 并行提取（校验）的共享状态
+typedef struct {
+    Archive *archive;
+    const ArchiveEntry **entries;  // 待提取的文件，按领取顺序排列
+    unsigned int count;
+    const char *target_dir;        // 提取的目标目录（校验时为比较的源目录，可为NULL）
+    ArchiveVerifyReport report;    // 校验发现问题时的回调，可为NULL
+    void *context;
+    atomic_uint next;              // 下一个待领取的文件
+    atomic_int error;              // 第一个错误
+} ArchiveJobs;
+
+// 提取（校验）线程
+typedef struct {
+    ArchiveJobs *jobs;
+    ArchiveStats stats;            // 本线程的统计，结束后合并
+    ArchiveVerifyStats verify;     // 本线程的校验统计，结束后合并
+    char *target;                  // 目标路径缓冲区
+    size_t target_capacity;
+    unsigned char *buffer;         // 校验时读取数据的缓冲区
+    Thread thread;
+    int started;
+} ArchiveWorker;
+
+// 辅助函数：比较路径（逐字节比较，较短的路径是较长路径的前缀时较短的在前，与strcmp的顺序相同）
+static int archive_compare_path(const char *path, size_t length, const char *key, size_t key_length) {
+    int result = memcmp(path, key, (length < key_length) ? length : key_length);
+    if (result != 0) {
+        return result;
+    }
+    return (length > key_length) - (length < key_length);
+}
+
+// 辅助函数：检查映射中的一段范围是否在文件内
+static int archive_in_range(const Archive *archive, unsigned long long offset, unsigned long long length) {
+    return offset <= archive->map.size && length <= archive->map.size - offset;
+}
+
+// 辅助函数：稀疏文件数据段表中的第index项（数据段表在映射中可能未对齐，复制出来）
+static void archive_extent(const Archive *archive, const ArchiveEntry *entry, unsigned int index, Pack2Extent *extent) {
+    memcpy(extent, archive->map.data + entry->item.offset + (unsigned long long)index * sizeof(Pack2Extent), sizeof(Pack2Extent));
+}
+
+// 辅助函数：分块文件块引用表中的第index项（块引用表在映射中可能未对齐，复制出来）
+static void archive_chunk(const Archive *archive, const ArchiveEntry *entry, unsigned int index, ChunkRef *ref) {
+    memcpy(ref, archive->map.data + entry->item.offset + (unsigned long long)index * sizeof(ChunkRef), sizeof(ChunkRef));
+}
+
+// 辅助函数：检查文件数据是否在备份文件内，稀疏文件还要检查数据段按偏移量升序、互不重叠且不超出文件大小，
+// 分块文件检查各块在块数据文件内且长度之和等于文件大小；硬链接没有文件数据
+static int archive_data_in_range(const Archive *archive, const ArchiveEntry *entry) {
+    const Pack2Item *item = &entry->item;
+    if (item->flags & PACK2_ITEM_HARDLINK) {
+        return 1;
+    }
+    if (item->flags & PACK2_ITEM_CHUNKED) {
+        if (!archive_in_range(archive, item->offset, (unsigned long long)item->extent_count * sizeof(ChunkRef))) {
+            return 0;
+        }
+        unsigned long long length = 0;
+        for (unsigned int i = 0; i < item->extent_count; i++) {
+            ChunkRef ref;
+            archive_chunk(archive, entry, i, &ref);
+            unsigned int stored = (ref.delta_length > 0) ? ref.delta_length : ref.length;
+            if (ref.offset > archive->chunks.size || stored > archive->chunks.size - ref.offset) {
+                return 0;
+            }
+            length += ref.length;
+        }
+        return length == item->size;
+    }
+    if (!(item->flags & PACK2_ITEM_SPARSE)) {
+        return archive_in_range(archive, item->offset, item->size);
+    }
+
+    unsigned long long table_size = (unsigned long long)item->extent_count * sizeof(Pack2Extent);
+    if (!archive_in_range(archive, item->offset, table_size)) {
+        return 0;
+    }
+    unsigned long long end = 0;
+    unsigned long long data_size = 0;
+    for (unsigned int i = 0; i < item->extent_count; i++) {
+        Pack2Extent extent;
+        archive_extent(archive, entry, i, &extent);
+        if (extent.offset < end || extent.offset > item->size || extent.length > item->size - extent.offset) {
+            return 0;
+        }
+        end = extent.offset + extent.length;
+        data_size += extent.length;
+    }
+    return archive_in_range(archive, item->offset + table_size, data_size);
+}
+
+// 辅助函数：解析MyPack版本2的索引，每个路径在这里检查一次（pack_path_safe），提取时直接使用
+static BackupResult archive_parse_mypack2(Archive *archive) {
+    const unsigned char *data = archive->map.data;
+    unsigned long long size = archive->map.size;
+
+    // 读取尾部
+    Pack2Trailer trailer;
+    if (size < sizeof(Pack2Signature) + sizeof(Pack2Trailer)) {
+        return BACKUP_ERROR_PACK;
+    }
+    memcpy(&trailer, data + size - sizeof(Pack2Trailer), sizeof(Pack2Trailer));
+
+    // 索引紧接在尾部之前：先确认索引大小在文件内，再由它推出索引的位置，避免偏移量与大小相加时溢出
+    if (memcmp(trailer.magic, PACK2_TRAILER_MAGIC, sizeof(trailer.magic)) != 0 ||
+        trailer.index_size > size - sizeof(Pack2Trailer) ||
+        trailer.index_offset != size - sizeof(Pack2Trailer) - trailer.index_size ||
+        trailer.index_offset < sizeof(Pack2Signature) ||
+        trailer.index_size < PACK2_TAG_SIZE ||
+        memcmp(data + trailer.index_offset, PACK2_TAG_INDEX, PACK2_TAG_SIZE) != 0) {
+        return BACKUP_ERROR_PACK;
+    }
+    // 每个文件项之后至少有1字节的路径，索引容纳不下的文件数量在分配之前排除
+    if (trailer.file_count > (trailer.index_size - PACK2_TAG_SIZE) / (sizeof(Pack2Item) + 1)) {
+        return BACKUP_ERROR_PACK;
+    }
+    platform_advise(&archive->map, trailer.index_offset, trailer.index_size, PLATFORM_ADVICE_WILLNEED);
+
+    archive->entries = (ArchiveEntry *)malloc((trailer.file_count > 0 ? trailer.file_count : 1) * sizeof(ArchiveEntry));
+    if (archive->entries == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    // 文件项之后紧接着路径和符号链接目标，路径直接指向映射
+    unsigned long long pos = trailer.index_offset + PACK2_TAG_SIZE;
+    unsigned long long end = trailer.index_offset + trailer.index_size;
+    for (unsigned int i = 0; i < trailer.file_count; i++) {
+        ArchiveEntry *entry = &archive->entries[i];
+        if (end - pos < sizeof(Pack2Item)) {
+            return BACKUP_ERROR_PACK;
+        }
+        memcpy(&entry->item, data + pos, sizeof(Pack2Item));
+        pos += sizeof(Pack2Item);
+
+        unsigned long long names = (unsigned long long)entry->item.path_length + entry->item.symlink_length;
+        if (entry->item.path_length == 0 || end - pos < names || (!archive->index_only && !archive_data_in_range(archive, entry))) {
+            return BACKUP_ERROR_PACK;
+        }
+        entry->path = (const char *)data + pos;
+        entry->symlink_target = (const char *)data + pos + entry->item.path_length;
+        if (!pack_path_safe(entry->path, entry->item.path_length)) {
+            return BACKUP_ERROR_PACK;
+        }
+        pos += names;
+        archive->entry_count++;
+    }
+    if (pos != end) {
+        return BACKUP_ERROR_PACK;
+    }
+
+    archive->sorted = (trailer.flags & PACK2_FLAG_SORTED) != 0;
+    return BACKUP_SUCCESS;
+}
+
+// 辅助函数：解析MyPack版本1的头部和文件项表
+static BackupResult archive_parse_mypack1(Archive *archive) {
+    const unsigned char *data = archive->map.data;
+    PackHeader header;
+
+    if (archive->map.size < sizeof(PackHeader)) {
+        return BACKUP_ERROR_PACK;
+    }
+    memcpy(&header, data, sizeof(PackHeader));
+    if (!archive_in_range(archive, sizeof(PackHeader), (unsigned long long)header.file_count * sizeof(PackFileItem))) {
+        return BACKUP_ERROR_PACK;
+    }
+
+    archive->entries = (ArchiveEntry *)malloc((header.file_count > 0 ? header.file_count : 1) * sizeof(ArchiveEntry));
+    if (archive->entries == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    // 文件项中的路径和符号链接目标是定长字段，直接指向映射
+    for (unsigned int i = 0; i < header.file_count; i++) {
+        const unsigned char *record = data + sizeof(PackHeader) + (size_t)i * sizeof(PackFileItem);
+        const char *path = (const char *)record + offsetof(PackFileItem, path);
+        const char *symlink_target = (const char *)record + offsetof(PackFileItem, symlink_target);
+        PackFileItem item;
+        memcpy(&item, record, sizeof(PackFileItem));
+
+        ArchiveEntry *entry = &archive->entries[i];
+        memset(&entry->item, 0, sizeof(Pack2Item));
+        entry->item.offset = item.offset;
+        entry->item.size = item.size;
+        entry->item.create_time = item.create_time;
+        entry->item.modify_time = item.modify_time;
+        entry->item.access_time = item.access_time;
+        entry->item.type = item.type;
+        entry->item.mode = item.mode;
+        entry->item.uid = item.uid;
+        entry->item.gid = item.gid;
+        entry->item.path_length = (unsigned int)strnlen(path, sizeof(item.path));
+        entry->item.symlink_length = (unsigned int)strnlen(symlink_target, sizeof(item.symlink_target));
+        entry->path = path;
+        entry->symlink_target = symlink_target;
+        if (!pack_path_safe(path, entry->item.path_length) || !archive_in_range(archive, entry->item.offset, entry->item.size)) {
+            return BACKUP_ERROR_PACK;
+        }
+        archive->entry_count++;
+    }
+    return BACKUP_SUCCESS;
+}
+
+// 辅助函数：解析Tar文件头中的八进制数（超出八进制范围的大小使用base-256编码）
+static unsigned long long tar_number(const unsigned char *field, size_t length) {
+    unsigned long long value = 0;
+
+    if (field[0] & 0x80) {
+        for (size_t i = 1; i < length; i++) {
+            value = (value << 8) | field[i];
+        }
+        return value;
+    }
+
+    size_t i = 0;
+    while (i < length && field[i] == ' ') {
+        i++;
+    }
+    while (i < length && field[i] >= '0' && field[i] <= '7') {
+        value = (value << 3) | (unsigned long long)(field[i] - '0');
+        i++;
+    }
+    return value;
+}
+
+// 辅助函数：检查Tar文件头的校验和（校验和字段按8个空格计算）
+static int tar_checksum_ok(const unsigned char *header) {
+    unsigned long long expected = tar_number(header + 148, 8);
+    unsigned long long sum = 0;
+    for (int i = 0; i < 512; i++) {
+        sum += (i >= 148 && i < 156) ? ' ' : header[i];
+    }
+    return sum == expected;
+}
+
+// 辅助函数：遍历Tar文件头，fill为0时只统计文件数量和拼接路径所需的字节数
+// 只收录普通文件、硬链接和符号链接，其他类型（目录、扩展头等）的数据被跳过
+// GNU长名称记录（类型'L'和'K'）给出下一项的完整路径或链接目标，路径直接指向映射中的记录数据
+// 拼接后的完整路径在收录时检查（pack_path_safe），指向目标目录之外的文件使整个备份文件无效
+static BackupResult archive_walk_tar(Archive *archive, int fill, unsigned int *count, size_t *strings_size) {
+    const unsigned char *data = archive->map.data;
+    unsigned long long size = archive->map.size;
+    unsigned long long pos = 0;
+    const char *long_path = NULL;
+    const char *long_link = NULL;
+    size_t long_path_length = 0;
+    size_t long_link_length = 0;
+
+    *count = 0;
+    *strings_size = 0;
+    while (pos + 512 <= size) {
+        const unsigned char *header = data + pos;
+
+        // 全零块表示结束
+        int all_zero = 1;
+        for (int i = 0; i < 512; i++) {
+            if (header[i] != 0) {
+                all_zero = 0;
+                break;
+            }
+        }
+        if (all_zero) {
+            break;
+        }
+        if (!tar_checksum_ok(header)) {
+            return BACKUP_ERROR_PACK;
+        }
+
+        unsigned long long file_size = tar_number(header + 124, 12);
+        unsigned long long data_offset = pos + 512;
+        if (!archive_in_range(archive, data_offset, file_size)) {
+            return BACKUP_ERROR_PACK;
+        }
+        pos = data_offset + (file_size + 511) / 512 * 512;
+
+        char type = (char)header[156];
+        if (type == 'L' || type == 'K') {
+            size_t length = strnlen((const char *)data + data_offset, (size_t)file_size);
+            if (length == 0 || length > UINT_MAX) {
+                return BACKUP_ERROR_PACK;
+            }
+            if (type == 'L') {
+                long_path = (const char *)data + data_offset;
+                long_path_length = length;
+            } else {
+                long_link = (const char *)data + data_offset;
+                long_link_length = length;
+            }
+            continue;
+        }
+        const char *entry_path = long_path;
+        const char *entry_link = long_link;
+        size_t entry_path_length = long_path_length;
+        size_t entry_link_length = long_link_length;
+        long_path = NULL;
+        long_link = NULL;
+        if (type != '0' && type != '\0' && type != '1' && type != '2') {
+            continue;
+        }
+
+        // 路径：ustar格式的较长路径分为前缀和文件名两部分，有长名称记录时使用其中的完整路径
+        size_t name_length = strnlen((const char *)header, 100);
+        size_t prefix_length = (memcmp(header + 257, "ustar", 5) == 0) ? strnlen((const char *)header + 345, 155) : 0;
+        if (entry_path != NULL) {
+            prefix_length = 0;
+        } else if (name_length == 0) {
+            continue;
+        }
+
+        if (fill) {
+            ArchiveEntry *entry = &archive->entries[*count];
+            memset(&entry->item, 0, sizeof(Pack2Item));
+            entry->item.offset = data_offset;
+            entry->item.size = (type == '1' || type == '2') ? 0 : file_size;
+            entry->item.modify_time = (long long)tar_number(header + 136, 12);
+            entry->item.create_time = entry->item.modify_time;
+            entry->item.access_time = entry->item.modify_time;
+            entry->item.type = (type == '2') ? FILE_TYPE_SYMLINK : FILE_TYPE_REGULAR;
+            entry->item.mode = (unsigned int)tar_number(header + 100, 8);
+            entry->item.uid = (unsigned int)tar_number(header + 108, 8);
+            entry->item.gid = (unsigned int)tar_number(header + 116, 8);
+            entry->item.flags = (type == '1') ? PACK2_ITEM_HARDLINK : 0;
+            entry->item.symlink_length = (type == '1' || type == '2') ? (unsigned int)strnlen((const char *)header + 157, 100) : 0;
+            entry->symlink_target = (const char *)header + 157;
+            if ((type == '1' || type == '2') && entry_link != NULL) {
+                entry->item.symlink_length = (unsigned int)entry_link_length;
+                entry->symlink_target = entry_link;
+            }
+
+            if (entry_path != NULL) {
+                entry->path = entry_path;
+                entry->item.path_length = (unsigned int)entry_path_length;
+            } else if (prefix_length > 0) {
+                char *path = archive->strings + *strings_size;
+                memcpy(path, header + 345, prefix_length);
+                path[prefix_length] = PATH_SEPARATOR;
+                memcpy(path + prefix_length + 1, header, name_length);
+                entry->path = path;
+                entry->item.path_length = (unsigned int)(prefix_length + 1 + name_length);
+            } else {
+                entry->path = (const char *)header;
+                entry->item.path_length = (unsigned int)name_length;
+            }
+            if (!pack_path_safe(entry->path, entry->item.path_length)) {
+                return BACKUP_ERROR_PACK;
+            }
+        }
+        if (prefix_length > 0) {
+            *strings_size += prefix_length + 1 + name_length;
+        }
+        (*count)++;
+    }
+    return BACKUP_SUCCESS;
+}
+
+// 辅助函数：按路径比较文件
+static int compare_entry_path(const void *a, const void *b) {
+    const ArchiveEntry *entry_a = (const ArchiveEntry *)a;
+    const ArchiveEntry *entry_b = (const ArchiveEntry *)b;
+    return archive_compare_path(entry_a->path, entry_a->item.path_length, entry_b->path, entry_b->item.path_length);
+}
+
+// 辅助函数：解析Tar备份文件，Tar没有索引，逐个读取文件头后按路径排序
+static BackupResult archive_parse_tar(Archive *archive) {
+    unsigned int count;
+    size_t strings_size;
+
+    BackupResult result = archive_walk_tar(archive, 0, &count, &strings_size);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+
+    archive->entries = (ArchiveEntry *)malloc((count > 0 ? count : 1) * sizeof(ArchiveEntry));
+    archive->strings = (char *)malloc(strings_size > 0 ? strings_size : 1);
+    if (archive->entries == NULL || archive->strings == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    result = archive_walk_tar(archive, 1, &count, &strings_size);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+    archive->entry_count = count;
+
+    qsort(archive->entries, count, sizeof(ArchiveEntry), compare_entry_path);
+    archive->sorted = 1;
+    return BACKUP_SUCCESS;
+}
+
+// 辅助函数：打开备份文件并读取索引，index_only为1时不检查文件数据（稀疏文件的数据段表、分块文件的块引用表）的范围，
+// 也不打开去重备份的块数据文件，只需要读取索引所在的页面
+static BackupResult archive_open_file(const char *path, int index_only, Archive **archive) {
+    if (path == NULL || archive == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+    *archive = NULL;
+
+    Archive *result_archive = (Archive *)calloc(1, sizeof(Archive));
+    if (result_archive == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    result_archive->index_only = index_only;
+
+    BackupResult result = platform_map_file(path, &result_archive->map);
+    if (result != BACKUP_SUCCESS) {
+        goto cleanup;
+    }
+    if (!index_only) {
+        result_archive->fp = fopen(path, "rb");
+    }
+    const unsigned char *data = result_archive->map.data;
+    unsigned long long size = result_archive->map.size;
+
+    // 根据开头的魔术字和版本号（或Tar的ustar魔术字）识别格式，压缩或加密后的备份文件在这里即被排除
+    Pack2Signature signature;
+    if (size >= sizeof(Pack2Signature)) {
+        memcpy(&signature, data, sizeof(Pack2Signature));
+    } else {
+        memset(&signature, 0, sizeof(Pack2Signature));
+    }
+    // 去重备份由尾部标志区分
+    int chunked = 0;
+    if (signature.version == PACK_VERSION_2 && size >= sizeof(Pack2Signature) + sizeof(Pack2Trailer)) {
+        Pack2Trailer trailer;
+        memcpy(&trailer, data + size - sizeof(Pack2Trailer), sizeof(Pack2Trailer));
+        chunked = (trailer.flags & PACK2_FLAG_CHUNKED) != 0;
+    }
+    if (memcmp(signature.magic, "BACK", 4) == 0 && chunked && !index_only) {
+        // 去重备份的文件数据在备份文件旁边的块数据文件中
+        char chunk_path[512];
+        result = chunk_store_data_path(path, chunk_path, sizeof(chunk_path));
+        if (result == BACKUP_SUCCESS && platform_map_file(chunk_path, &result_archive->chunks) != BACKUP_SUCCESS) {
+            result = BACKUP_ERROR_FILE;
+        }
+        if (result == BACKUP_SUCCESS) {
+            result_archive->chunks_fp = fopen(chunk_path, "rb");
+            result = archive_parse_mypack2(result_archive);
+        }
+    } else if (memcmp(signature.magic, "BACK", 4) == 0 && signature.version == PACK_VERSION_2) {
+        result = archive_parse_mypack2(result_archive);
+    } else if (memcmp(signature.magic, "BACK", 4) == 0 && signature.version == PACK_VERSION_1) {
+        result = archive_parse_mypack1(result_archive);
+    } else if (size >= 512 && memcmp(data + 257, "ustar", 5) == 0 && tar_checksum_ok(data)) {
+        result = archive_parse_tar(result_archive);
+    } else {
+        result = BACKUP_ERROR_PACK;
+    }
+
+cleanup:
+    if (result != BACKUP_SUCCESS) {
+        archive_close(result_archive);
+        return result;
+    }
+    *archive = result_archive;
+    return BACKUP_SUCCESS;
+}
+
+// 打开备份文件并读取索引
+BackupResult archive_open(const char *path, Archive **archive) {
+    return archive_open_file(path, 0, archive);
+}
+
+// 只读取备份文件的索引
+BackupResult archive_open_index(const char *path, Archive **archive) {
+    return archive_open_file(path, 1, archive);
+}
+
+// 关闭备份文件
+void archive_close(Archive *archive) {
+    if (archive != NULL) {
+        platform_unmap_file(&archive->map);
+        platform_unmap_file(&archive->chunks);
+        if (archive->fp != NULL) {
+            fclose(archive->fp);
+        }
+        if (archive->chunks_fp != NULL) {
+            fclose(archive->chunks_fp);
+        }
+        free(archive->entries);
+        free(archive->strings);
+        free(archive);
+    }
+}
+
+// 索引中的文件数量
+unsigned int archive_entry_count(const Archive *archive) {
+    return archive->entry_count;
+}
+
+// 索引中的第index个文件
+const ArchiveEntry *archive_entry(const Archive *archive, unsigned int index) {
+    return (index < archive->entry_count) ? &archive->entries[index] : NULL;
+}
+
+// 辅助函数：规范化查找路径，统一分隔符，去掉开头的"./"和分隔符以及结尾的分隔符
+static char *archive_normalize_path(const char *path) {
+    while (1) {
+        if (path[0] == '/' || path[0] == '\\') {
+            path++;
+        } else if (path[0] == '.' && (path[1] == '/' || path[1] == '\\')) {
+            path += 2;
+        } else {
+            break;
+        }
+    }
+
+    size_t length = strlen(path);
+    char *key = (char *)malloc(length + 1);
+    if (key == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < length; i++) {
+        key[i] = (path[i] == '/' || path[i] == '\\') ? PATH_SEPARATOR : path[i];
+    }
+    while (length > 0 && key[length - 1] == PATH_SEPARATOR) {
+        length--;
+    }
+    key[length] = '\0';
+    return key;
+}
+
+// 辅助函数：第一个路径不小于key的文件（二分查找）
+static unsigned int archive_lower_bound(const Archive *archive, const char *key, size_t key_length) {
+    unsigned int low = 0;
+    unsigned int high = archive->entry_count;
+    while (low < high) {
+        unsigned int middle = low + (high - low) / 2;
+        const ArchiveEntry *entry = &archive->entries[middle];
+        if (archive_compare_path(entry->path, entry->item.path_length, key, key_length) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// 辅助函数：按规范化的路径查找文件
+static const ArchiveEntry *archive_find_key(const Archive *archive, const char *key) {
+    size_t key_length = strlen(key);
+
+    if (archive->sorted) {
+        unsigned int index = archive_lower_bound(archive, key, key_length);
+        if (index < archive->entry_count) {
+            const ArchiveEntry *entry = &archive->entries[index];
+            if (archive_compare_path(entry->path, entry->item.path_length, key, key_length) == 0) {
+                return entry;
+            }
+        }
+        return NULL;
+    }
+
+    // 未排序的索引只能逐个比较
+    for (unsigned int i = 0; i < archive->entry_count; i++) {
+        const ArchiveEntry *entry = &archive->entries[i];
+        if (archive_compare_path(entry->path, entry->item.path_length, key, key_length) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// 按路径查找文件
+const ArchiveEntry *archive_find(const Archive *archive, const char *path) {
+    if (archive == NULL || path == NULL) {
+        return NULL;
+    }
+
+    char *key = archive_normalize_path(path);
+    if (key == NULL) {
+        return NULL;
+    }
+    const ArchiveEntry *entry = archive_find_key(archive, key);
+    free(key);
+    return entry;
+}
+
+// 文件项在映射中的数据
+const unsigned char *archive_entry_data(const Archive *archive, const ArchiveEntry *entry) {
+    if (archive == NULL || entry == NULL || archive->index_only || (entry->item.flags & PACK2_ITEM_HARDLINK)) {
+        return NULL;
+    }
+    return archive->map.data + entry->item.offset;
+}
+
+// 辅助函数：把映射的文件（备份文件或块数据文件，source是同一文件）中从offset开始的length字节写到输出文件的target_offset处（即输出文件的当前位置）
+// 数据优先由内核从映射的文件直接复制到输出文件，不能直接复制的部分从映射的页面写出，输出文件不使用stdio缓冲区；
+// 从映射写出时逐页缺页的开销与省下的复制相当，因此每段写出前一次性建立页表，写出后提示不再需要这些页面，避免占用内存
+static BackupResult archive_write_data(const PlatformMap *map, FILE *source, FILE *output, unsigned long long offset, unsigned long long target_offset, unsigned long long length, ArchiveStats *stats) {
+    BackupResult result = BACKUP_SUCCESS;
+    unsigned long long remaining = length;
+    if (source != NULL && remaining > 0) {
+        unsigned long long copied = 0;
+        result = platform_copy_range(fileno(source), offset, fileno(output), remaining, &copied);
+        if (result == BACKUP_SUCCESS && copied > 0 && copied < remaining) {
+            result = platform_seek(output, (long long)(target_offset + copied), SEEK_SET);
+        }
+        stats->copied_bytes += copied;
+        offset += copied;
+        remaining -= copied;
+    }
+
+    if (result == BACKUP_SUCCESS && remaining > 0) {
+        platform_advise(map, offset, remaining, PLATFORM_ADVICE_SEQUENTIAL);
+    }
+    while (result == BACKUP_SUCCESS && remaining > 0) {
+        size_t chunk = (size_t)((remaining < ARCHIVE_WRITE_CHUNK) ? remaining : ARCHIVE_WRITE_CHUNK);
+        platform_advise(map, offset, chunk, PLATFORM_ADVICE_PREFAULT);
+        if (fwrite(map->data + offset, 1, chunk, output) != chunk) {
+            result = BACKUP_ERROR_FILE;
+            break;
+        }
+        platform_advise(map, offset, chunk, PLATFORM_ADVICE_DONTNEED);
+        offset += chunk;
+        remaining -= chunk;
+    }
+    return result;
+}
+
+// 辅助函数：还原一个差异块到buffer，buffer是CHUNK_MAX_SIZE字节的缓冲区，第一次使用时分配
+// 差异编码和基准块都直接使用块数据文件的映射
+static BackupResult archive_decode_delta(const Archive *archive, const ChunkRef *ref, unsigned char **buffer) {
+    ChunkDeltaHeader header;
+    if (ref->length > CHUNK_MAX_SIZE || ref->delta_length < sizeof(ChunkDeltaHeader)) {
+        return BACKUP_ERROR_PACK;
+    }
+    memcpy(&header, archive->chunks.data + ref->offset, sizeof(ChunkDeltaHeader));
+    if (header.base_offset > archive->chunks.size || header.base_length > archive->chunks.size - header.base_offset) {
+        return BACKUP_ERROR_PACK;
+    }
+    if (*buffer == NULL) {
+        *buffer = (unsigned char *)malloc(CHUNK_MAX_SIZE);
+        if (*buffer == NULL) {
+            return BACKUP_ERROR_MEMORY;
+        }
+    }
+    return chunk_delta_apply(archive->chunks.data + ref->offset, ref->delta_length,
+                             archive->chunks.data + header.base_offset, header.base_length, *buffer, ref->length);
+}
+
+// 辅助函数：还原一个差异块并写到输出文件的当前位置
+static BackupResult archive_write_delta(const Archive *archive, FILE *output, const ChunkRef *ref, unsigned char **buffer) {
+    BackupResult result = archive_decode_delta(archive, ref, buffer);
+    if (result == BACKUP_SUCCESS && fwrite(*buffer, 1, ref->length, output) != ref->length) {
+        result = BACKUP_ERROR_FILE;
+    }
+    return result;
+}
+
+// 辅助函数：把文件中从offset开始的length字节计入摘要
+// buffer不为NULL且fd有效时按偏移量分段读入buffer（ARCHIVE_VERIFY_BUFFER字节）再计算，读取出错返回BACKUP_ERROR_FILE；
+// 否则直接读取映射
+static BackupResult archive_hash_range(const PlatformMap *map, int fd, unsigned long long offset, unsigned long long length, unsigned char *buffer, Xxh64 *state) {
+    if (buffer == NULL || fd < 0) {
+        xxh64_update(state, map->data + offset, (size_t)length);
+        return BACKUP_SUCCESS;
+    }
+    while (length > 0) {
+        size_t chunk = (size_t)((length < ARCHIVE_VERIFY_BUFFER) ? length : ARCHIVE_VERIFY_BUFFER);
+        if (platform_read_at(fd, offset, buffer, chunk) != BACKUP_SUCCESS) {
+            return BACKUP_ERROR_FILE;
+        }
+        xxh64_update(state, buffer, chunk);
+        offset += chunk;
+        length -= chunk;
+    }
+    return BACKUP_SUCCESS;
+}
+
+// 辅助函数：计算文件项保存的内容的摘要（普通文件是文件数据，稀疏文件是各数据段依次拼接，分块文件是各块依次拼接，差异块先还原）
+// buffer为NULL时直接读取映射，不经过输出文件，因此提取时仍可以由内核直接复制；否则见archive_hash_range
+// stored返回计入摘要的字节数，可为NULL
+static BackupResult archive_entry_hash(const Archive *archive, const ArchiveEntry *entry, unsigned char *buffer, unsigned long long *hash, unsigned long long *stored) {
+    Xxh64 state;
+    xxh64_init(&state, PACK2_HASH_SEED);
+    BackupResult result = BACKUP_SUCCESS;
+    unsigned long long length = entry->item.size;
+    if (entry->item.flags & PACK2_ITEM_CHUNKED) {
+        int fd = (archive->chunks_fp != NULL) ? fileno(archive->chunks_fp) : -1;
+        unsigned char *delta_buffer = NULL;
+        for (unsigned int i = 0; i < entry->item.extent_count && result == BACKUP_SUCCESS; i++) {
+            ChunkRef ref;
+            archive_chunk(archive, entry, i, &ref);
+            if (ref.delta_length == 0) {
+                result = archive_hash_range(&archive->chunks, fd, ref.offset, ref.length, buffer, &state);
+            } else if ((result = archive_decode_delta(archive, &ref, &delta_buffer)) == BACKUP_SUCCESS) {
+                xxh64_update(&state, delta_buffer, ref.length);
+            }
+        }
+        free(delta_buffer);
+    } else if (entry->item.flags & PACK2_ITEM_SPARSE) {
+        // 各数据段的数据紧接在数据段表之后，依次拼接
+        length = 0;
+        for (unsigned int i = 0; i < entry->item.extent_count; i++) {
+            Pack2Extent extent;
+            archive_extent(archive, entry, i, &extent);
+            length += extent.length;
+        }
+        result = archive_hash_range(&archive->map, (archive->fp != NULL) ? fileno(archive->fp) : -1,
+                                    entry->item.offset + (unsigned long long)entry->item.extent_count * sizeof(Pack2Extent), length, buffer, &state);
+    } else {
+        result = archive_hash_range(&archive->map, (archive->fp != NULL) ? fileno(archive->fp) : -1, entry->item.offset, length, buffer, &state);
+    }
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+    *hash = xxh64_final(&state);
+    if (stored != NULL) {
+        *stored = length;
+    }
+    return BACKUP_SUCCESS;
+}
+
+// 提取一个文件的数据，稀疏文件只写入各数据段，数据段之间和末尾的部分成为空洞，分块文件依次写入各块
+// 多个线程可以同时提取不同的文件：读取都指定偏移量，不使用备份文件的读写位置，统计记入调用方提供的stats
+// make_parents为0时调用方已经创建了所在的目录
+// 有内容摘要的文件先校验备份中的数据，与摘要不符时不创建输出文件，返回BACKUP_ERROR_CHECKSUM
+static BackupResult archive_extract_file(Archive *archive, const ArchiveEntry *entry, const char *target_path, int make_parents, ArchiveStats *stats) {
+    if (entry->item.flags & PACK2_ITEM_HASHED) {
+        unsigned long long hash;
+        BackupResult result = archive_entry_hash(archive, entry, NULL, &hash, NULL);
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+        if (hash != entry->item.content_hash) {
+            return BACKUP_ERROR_CHECKSUM;
+        }
+    }
+    if (make_parents) {
+        platform_make_parent_directories(target_path);
+    }
+    FILE *output = fopen(target_path, "wb");
+    if (output == NULL) {
+        return BACKUP_ERROR_FILE;
+    }
+    setvbuf(output, NULL, _IONBF, 0);
+
+    BackupResult result = BACKUP_SUCCESS;
+    if (entry->item.flags & PACK2_ITEM_CHUNKED) {
+        unsigned long long target_offset = 0;
+        unsigned char *delta_buffer = NULL;
+        for (unsigned int i = 0; i < entry->item.extent_count && result == BACKUP_SUCCESS; i++) {
+            ChunkRef ref;
+            archive_chunk(archive, entry, i, &ref);
+            if (ref.delta_length > 0) {
+                result = archive_write_delta(archive, output, &ref, &delta_buffer);
+            } else {
+                result = archive_write_data(&archive->chunks, archive->chunks_fp, output, ref.offset, target_offset, ref.length, stats);
+            }
+            target_offset += ref.length;
+        }
+        free(delta_buffer);
+    } else if (entry->item.flags & PACK2_ITEM_SPARSE) {
+        unsigned long long offset = entry->item.offset + (unsigned long long)entry->item.extent_count * sizeof(Pack2Extent);
+        for (unsigned int i = 0; i < entry->item.extent_count && result == BACKUP_SUCCESS; i++) {
+            Pack2Extent extent;
+            archive_extent(archive, entry, i, &extent);
+            result = platform_seek(output, (long long)extent.offset, SEEK_SET);
+            if (result == BACKUP_SUCCESS) {
+                result = archive_write_data(&archive->map, archive->fp, output, offset, extent.offset, extent.length, stats);
+            }
+            offset += extent.length;
+        }
+        if (result == BACKUP_SUCCESS) {
+            result = platform_set_file_size(output, entry->item.size);
+        }
+    } else {
+        result = archive_write_data(&archive->map, archive->fp, output, entry->item.offset, 0, entry->item.size, stats);
+    }
+
+    if (fclose(output) != 0 && result == BACKUP_SUCCESS) {
+        result = BACKUP_ERROR_FILE;
+    }
+    if (result == BACKUP_SUCCESS) {
+        stats->files++;
+        stats->bytes += entry->item.size;
+    }
+    return result;
+}
+
+// 辅助函数：硬链接链接到的文件，找不到或者也是硬链接时返回NULL
+static const ArchiveEntry *archive_link_source(const Archive *archive, const ArchiveEntry *entry) {
+    char *path = (char *)malloc((size_t)entry->item.symlink_length + 1);
+    if (path == NULL) {
+        return NULL;
+    }
+    memcpy(path, entry->symlink_target, entry->item.symlink_length);
+    path[entry->item.symlink_length] = '\0';
+
+    const ArchiveEntry *source = archive_find(archive, path);
+    free(path);
+    return (source != NULL && !(source->item.flags & PACK2_ITEM_HARDLINK)) ? source : NULL;
+}
+
+// 提取一个文件，硬链接提取链接到的文件的数据
+BackupResult archive_extract_entry(Archive *archive, const ArchiveEntry *entry, const char *target_path) {
+    if (archive == NULL || archive->index_only || entry == NULL || target_path == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+    if (entry->item.flags & PACK2_ITEM_HARDLINK) {
+        entry = archive_link_source(archive, entry);
+        if (entry == NULL) {
+            return BACKUP_ERROR_PACK;
+        }
+    }
+    return archive_extract_file(archive, entry, target_path, 1, &archive->stats);
+}
+
+// 辅助函数：选中与key匹配的文件，key是目录时选中其下的所有文件，返回选中的数量
+static unsigned int archive_select(const Archive *archive, const char *key, unsigned char *selected) {
+    unsigned int matched = 0;
+    size_t key_length = strlen(key);
+
+    // 空路径表示全部文件
+    if (key_length == 0) {
+        memset(selected, 1, archive->entry_count);
+        return archive->entry_count;
+    }
+
+    // 已排序的索引中，同一目录下的文件是连续的一段，从目录本身的位置开始查找
+    unsigned int first = archive->sorted ? archive_lower_bound(archive, key, key_length) : 0;
+    for (unsigned int i = first; i < archive->entry_count; i++) {
+        const ArchiveEntry *entry = &archive->entries[i];
+        size_t length = entry->item.path_length;
+        int prefix = length >= key_length && memcmp(entry->path, key, key_length) == 0;
+        if (prefix && (length == key_length || entry->path[key_length] == PATH_SEPARATOR)) {
+            selected[i] = 1;
+            matched++;
+        } else if (archive->sorted && !prefix) {
+            break;
+        }
+    }
+    return matched;
+}
+
+// 辅助函数：按数据偏移量比较
+static int compare_entry_offset(const void *a, const void *b) {
+    unsigned long long offset_a = (*(const ArchiveEntry *const *)a)->item.offset;
+    unsigned long long offset_b = (*(const ArchiveEntry *const *)b)->item.offset;
+    return (offset_a > offset_b) - (offset_a < offset_b);
+}
+
+// 辅助函数：按大小降序比较，大小相同时按数据偏移量
+static int compare_entry_size(const void *a, const void *b) {
+    unsigned long long size_a = (*(const ArchiveEntry *const *)a)->item.size;
+    unsigned long long size_b = (*(const ArchiveEntry *const *)b)->item.size;
+    if (size_a != size_b) {
+        return (size_a < size_b) - (size_a > size_b);
+    }
+    return compare_entry_offset(a, b);
+}
+
+// 辅助函数：构造文件在目标目录下的路径
+// 文件路径在解析索引时已经检查过（pack_path_safe），这里直接拼接，提取线程和硬链接都只使用索引中的文件
+static BackupResult archive_target_path(const char *target_dir, const ArchiveEntry *entry, char **buffer, size_t *capacity) {
+    size_t length = strlen(target_dir) + 1 + entry->item.path_length + 1;
+    if (length > *capacity) {
+        char *new_buffer = (char *)realloc(*buffer, length);
+        if (new_buffer == NULL) {
+            return BACKUP_ERROR_MEMORY;
+        }
+        *buffer = new_buffer;
+        *capacity = length;
+    }
+    snprintf(*buffer, *capacity, "%s%c%.*s", target_dir, PATH_SEPARATOR, (int)entry->item.path_length, entry->path);
+    return BACKUP_SUCCESS;
+}
+
+// 辅助函数：按索引创建选中文件所在的全部目录
+// 提取前在一个线程中按路径顺序一次创建完，每个目录只创建一次，提取线程之间也不会竞争创建同一个目录
+static BackupResult archive_make_directories(const Archive *archive, const unsigned char *selected, const char *target_dir) {
+    DirCache *dirs = dir_cache_create(target_dir);
+    if (dirs == NULL) {
+        return BACKUP_ERROR_PATH;
+    }
+
+    BackupResult result = BACKUP_SUCCESS;
+    for (unsigned int i = 0; i < archive->entry_count && result == BACKUP_SUCCESS; i++) {
+        if (selected == NULL || selected[i]) {
+            const ArchiveEntry *entry = &archive->entries[i];
+            result = dir_cache_make_parent(dirs, entry->path, entry->item.path_length);
+        }
+    }
+
+    dir_cache_destroy(dirs);
+    return result;
+}
+
+// 辅助函数：提取线程，依次领取下一个待提取的文件，直到全部领完或有线程失败
+static void archive_worker_run(void *arg) {
+    ArchiveWorker *worker = (ArchiveWorker *)arg;
+    ArchiveJobs *jobs = worker->jobs;
+
+    while (atomic_load(&jobs->error) == BACKUP_SUCCESS) {
+        unsigned int index = atomic_fetch_add(&jobs->next, 1);
+        if (index >= jobs->count) {
+            break;
+        }
+
+        const ArchiveEntry *entry = jobs->entries[index];
+        BackupResult result = archive_target_path(jobs->target_dir, entry, &worker->target, &worker->target_capacity);
+        if (result == BACKUP_SUCCESS) {
+            result = archive_extract_file(jobs->archive, entry, worker->target, 0, &worker->stats);
+        }
+        if (result != BACKUP_SUCCESS) {
+            int expected = BACKUP_SUCCESS;
+            atomic_compare_exchange_strong(&jobs->error, &expected, (int)result);
+            break;
+        }
+    }
+}
+
+// 辅助函数：在提取线程结束后还原选中的硬链接
+// 链接到已提取的文件：链接到的文件在本次提取之列时链接到它，否则第一个硬链接提取它的数据，同组其他硬链接链接到这里；
+// 文件系统不支持硬链接时提取链接到的文件的数据
+static BackupResult archive_extract_links(Archive *archive, const unsigned char *selected, const char *target_dir) {
+    char *target = NULL;
+    size_t target_capacity = 0;
+    char *source_target = NULL;
+    size_t source_capacity = 0;
+    BackupResult result = BACKUP_SUCCESS;
+
+    // 未选中的文件由哪个硬链接提取了数据（索引中的位置）
+    unsigned int *extracted = NULL;
+    if (selected != NULL) {
+        extracted = (unsigned int *)malloc((archive->entry_count + 1) * sizeof(unsigned int));
+        if (extracted == NULL) {
+            return BACKUP_ERROR_MEMORY;
+        }
+        memset(extracted, 0xFF, (archive->entry_count + 1) * sizeof(unsigned int));
+    }
+
+    for (unsigned int i = 0; i < archive->entry_count && result == BACKUP_SUCCESS; i++) {
+        const ArchiveEntry *entry = &archive->entries[i];
+        if (!(entry->item.flags & PACK2_ITEM_HARDLINK) || (selected != NULL && !selected[i])) {
+            continue;
+        }
+        const ArchiveEntry *source = archive_link_source(archive, entry);
+        if (source == NULL) {
+            result = BACKUP_ERROR_PACK;
+            break;
+        }
+
+        result = archive_target_path(target_dir, entry, &target, &target_capacity);
+        if (result != BACKUP_SUCCESS) {
+            break;
+        }
+        unsigned int source_index = (unsigned int)(source - archive->entries);
+        const ArchiveEntry *existing = NULL;
+        if (selected == NULL || selected[source_index]) {
+            existing = source;
+        } else if (extracted[source_index] != 0xFFFFFFFFu) {
+            existing = &archive->entries[extracted[source_index]];
+        }
+        if (existing != NULL) {
+            result = archive_target_path(target_dir, existing, &source_target, &source_capacity);
+            if (result == BACKUP_SUCCESS && platform_make_link(source_target, target) == BACKUP_SUCCESS) {
+                archive->stats.files++;
+                continue;
+            }
+        }
+        if (result == BACKUP_SUCCESS) {
+            result = archive_extract_file(archive, source, target, 0, &archive->stats);
+        }
+        if (result == BACKUP_SUCCESS && existing == NULL) {
+            extracted[source_index] = i;
+        }
+    }
+
+    free(extracted);
+    free(target);
+    free(source_target);
+    return result;
+}
+
+// 辅助函数：确定线程数（默认使用全部处理器，不超过文件数量）并排列领取顺序，创建线程状态
+// 只有一个线程时按数据偏移量顺序领取，顺序读取备份文件；多个线程时先领取较大的文件
+static ArchiveWorker *archive_workers_create(ArchiveJobs *jobs, int thread_count, int *worker_count) {
+    int count = (thread_count > 0) ? thread_count : thread_cpu_count();
+    if (count > ARCHIVE_MAX_THREADS) {
+        count = ARCHIVE_MAX_THREADS;
+    }
+    if ((unsigned int)count > jobs->count) {
+        count = (jobs->count > 0) ? (int)jobs->count : 1;
+    }
+    qsort(jobs->entries, jobs->count, sizeof(ArchiveEntry *), (count == 1) ? compare_entry_offset : compare_entry_size);
+    atomic_init(&jobs->next, 0);
+    atomic_init(&jobs->error, BACKUP_SUCCESS);
+
+    ArchiveWorker *workers = (ArchiveWorker *)calloc(count, sizeof(ArchiveWorker));
+    if (workers != NULL) {
+        for (int i = 0; i < count; i++) {
+            workers[i].jobs = jobs;
+        }
+    }
+    *worker_count = count;
+    return workers;
+}
+
+// 辅助函数：启动线程运行run并等待全部结束，只有一个线程时直接在当前线程中运行
+static void archive_workers_run(ArchiveWorker *workers, int worker_count, ThreadFunc run) {
+    if (worker_count == 1) {
+        run(&workers[0]);
+        return;
+    }
+    for (int i = 0; i < worker_count; i++) {
+        if (thread_create(&workers[i].thread, run, &workers[i]) != BACKUP_SUCCESS) {
+            // 已启动的线程仍然可以完成剩余的文件
+            break;
+        }
+        workers[i].started = 1;
+    }
+    if (!workers[0].started) {
+        run(&workers[0]);
+    }
+    for (int i = 0; i < worker_count; i++) {
+        if (workers[i].started) {
+            thread_join(&workers[i].thread);
+        }
+    }
+}
+
+// 辅助函数：提取选中的文件到目标目录下的相对路径，硬链接在其他文件提取完成后还原
+// 只有一个线程时按数据偏移量顺序提取，顺序读取备份文件；多个线程时先领取较大的文件，
+// 避免最后只剩一个线程在提取大文件，大量小文件的打开、关闭开销也分摊到各个线程
+static BackupResult archive_extract_selected(Archive *archive, const unsigned char *selected, const char *target_dir, int thread_count) {
+    double start_time = platform_monotonic_time();
+
+    BackupResult result = archive_make_directories(archive, selected, target_dir);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+
+    const ArchiveEntry **entries = (const ArchiveEntry **)malloc((archive->entry_count + 1) * sizeof(ArchiveEntry *));
+    if (entries == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < archive->entry_count; i++) {
+        if ((selected == NULL || selected[i]) && !(archive->entries[i].item.flags & PACK2_ITEM_HARDLINK)) {
+            entries[count++] = &archive->entries[i];
+        }
+    }
+
+    ArchiveJobs jobs;
+    memset(&jobs, 0, sizeof(ArchiveJobs));
+    jobs.archive = archive;
+    jobs.entries = entries;
+    jobs.count = count;
+    jobs.target_dir = target_dir;
+    int worker_count = 0;
+    ArchiveWorker *workers = archive_workers_create(&jobs, thread_count, &worker_count);
+    if (workers == NULL) {
+        free(entries);
+        return BACKUP_ERROR_MEMORY;
+    }
+    archive_workers_run(workers, worker_count, archive_worker_run);
+
+    // 合并各线程的统计
+    for (int i = 0; i < worker_count; i++) {
+        archive->stats.files += workers[i].stats.files;
+        archive->stats.bytes += workers[i].stats.bytes;
+        archive->stats.copied_bytes += workers[i].stats.copied_bytes;
+        free(workers[i].target);
+    }
+
+    result = (BackupResult)atomic_load(&jobs.error);
+    if (result == BACKUP_SUCCESS) {
+        result = archive_extract_links(archive, selected, target_dir);
+    }
+    archive->stats.seconds += platform_monotonic_time() - start_time;
+
+    free(workers);
+    free(entries);
+    return result;
+}
+
+// 提取全部文件
+BackupResult archive_extract_all(Archive *archive, const char *target_dir, int thread_count) {
+    if (archive == NULL || archive->index_only || target_dir == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+    return archive_extract_selected(archive, NULL, target_dir, thread_count);
+}
+
+// 提取选中的文件
+BackupResult archive_extract_selection(Archive *archive, const unsigned char *selected, const char *target_dir, int thread_count) {
+    if (archive == NULL || archive->index_only || selected == NULL || target_dir == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+    return archive_extract_selected(archive, selected, target_dir, thread_count);
+}
+
+// 选中指定的文件
+// 只能选中索引中的文件，它们的路径在解析索引时已经检查过，与索引中的文件都不匹配的路径（如"../x"）报告BACKUP_ERROR_PATH
+BackupResult archive_select_paths(const Archive *archive, const char *const *paths, int path_count, unsigned char *selected) {
+    if (archive == NULL || paths == NULL || selected == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    // 每个路径都必须有匹配的文件
+    BackupResult result = BACKUP_SUCCESS;
+    for (int i = 0; i < path_count && result == BACKUP_SUCCESS; i++) {
+        char *key = archive_normalize_path(paths[i]);
+        if (key == NULL) {
+            result = BACKUP_ERROR_MEMORY;
+        } else if (archive_select(archive, key, selected) == 0) {
+            result = BACKUP_ERROR_PATH;
+        }
+        free(key);
+    }
+    return result;
+}
+
+// 提取指定的文件
+BackupResult archive_extract_paths(Archive *archive, const char *const *paths, int path_count, const char *target_dir, int thread_count) {
+    if (archive == NULL || archive->index_only || paths == NULL || path_count <= 0 || target_dir == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    unsigned char *selected = (unsigned char *)calloc(archive->entry_count + 1, 1);
+    if (selected == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    BackupResult result = archive_select_paths(archive, paths, path_count, selected);
+    if (result == BACKUP_SUCCESS) {
+        result = archive_extract_selected(archive, selected, target_dir, thread_count);
+    }
+
+    free(selected);
+    return result;
+}
+
+// 辅助函数：按文件项保存内容的方式计算源文件的摘要（稀疏文件只读取各数据段），与archive_entry_hash的结果比较
+// 源文件打不开或读取出错时返回BACKUP_ERROR_PATH，大小与文件项不同时返回BACKUP_ERROR_CHECKSUM
+static BackupResult archive_source_hash(const Archive *archive, const ArchiveEntry *entry, const char *path, unsigned char *buffer, unsigned long long *hash) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return BACKUP_ERROR_PATH;
+    }
+    BackupResult result = platform_seek(fp, 0, SEEK_END);
+    if (result == BACKUP_SUCCESS && (unsigned long long)platform_tell(fp) != entry->item.size) {
+        result = BACKUP_ERROR_CHECKSUM;
+    }
+
+    Xxh64 state;
+    xxh64_init(&state, PACK2_HASH_SEED);
+    if (result == BACKUP_SUCCESS && (entry->item.flags & PACK2_ITEM_SPARSE)) {
+        for (unsigned int i = 0; i < entry->item.extent_count && result == BACKUP_SUCCESS; i++) {
+            Pack2Extent extent;
+            archive_extent(archive, entry, i, &extent);
+            result = archive_hash_range(NULL, fileno(fp), extent.offset, extent.length, buffer, &state);
+        }
+    } else if (result == BACKUP_SUCCESS) {
+        result = archive_hash_range(NULL, fileno(fp), 0, entry->item.size, buffer, &state);
+    }
+    fclose(fp);
+    if (result == BACKUP_ERROR_FILE) {
+        return BACKUP_ERROR_PATH;
+    }
+    *hash = xxh64_final(&state);
+    return result;
+}
+
+// 辅助函数：校验一个文件，返回发现的问题，没有问题时返回ARCHIVE_VERIFY_OK；内存不足等无法继续校验的错误由result返回
+static ArchiveVerifyProblem archive_verify_entry(ArchiveWorker *worker, const ArchiveEntry *entry, BackupResult *result) {
+    ArchiveJobs *jobs = worker->jobs;
+    unsigned long long hash;
+    unsigned long long stored = 0;
+    *result = archive_entry_hash(jobs->archive, entry, worker->buffer, &hash, &stored);
+    if (*result == BACKUP_ERROR_FILE || *result == BACKUP_ERROR_PACK) {
+        *result = BACKUP_SUCCESS;
+        return ARCHIVE_VERIFY_UNREADABLE;
+    }
+    if (*result != BACKUP_SUCCESS) {
+        return ARCHIVE_VERIFY_OK;
+    }
+    worker->verify.bytes += stored;
+    if (entry->item.flags & PACK2_ITEM_HASHED) {
+        worker->verify.hashed_files++;
+        if (hash != entry->item.content_hash) {
+            return ARCHIVE_VERIFY_CORRUPT;
+        }
+    }
+    if (jobs->target_dir == NULL) {
+        return ARCHIVE_VERIFY_OK;
+    }
+
+    // 与源目录中的文件比较：备份中的数据已经确认完好（或没有摘要），源文件的摘要不同说明源文件在备份后被修改
+    unsigned long long source_hash;
+    *result = archive_target_path(jobs->target_dir, entry, &worker->target, &worker->target_capacity);
+    if (*result != BACKUP_SUCCESS) {
+        return ARCHIVE_VERIFY_OK;
+    }
+    *result = archive_source_hash(jobs->archive, entry, worker->target, worker->buffer, &source_hash);
+    if (*result == BACKUP_ERROR_PATH) {
+        *result = BACKUP_SUCCESS;
+        return ARCHIVE_VERIFY_SOURCE_MISSING;
+    }
+    if (*result == BACKUP_ERROR_CHECKSUM || (*result == BACKUP_SUCCESS && source_hash != hash)) {
+        *result = BACKUP_SUCCESS;
+        return ARCHIVE_VERIFY_SOURCE_CHANGED;
+    }
+    return ARCHIVE_VERIFY_OK;
+}
+
+// 辅助函数：校验线程，依次领取下一个待校验的文件，发现的问题记入统计并回调，继续校验其他文件
+static void archive_verify_run(void *arg) {
+    ArchiveWorker *worker = (ArchiveWorker *)arg;
+    ArchiveJobs *jobs = worker->jobs;
+
+    worker->buffer = (unsigned char *)malloc(ARCHIVE_VERIFY_BUFFER);
+    if (worker->buffer == NULL) {
+        int expected = BACKUP_SUCCESS;
+        atomic_compare_exchange_strong(&jobs->error, &expected, (int)BACKUP_ERROR_MEMORY);
+        return;
+    }
+    while (atomic_load(&jobs->error) == BACKUP_SUCCESS) {
+        unsigned int index = atomic_fetch_add(&jobs->next, 1);
+        if (index >= jobs->count) {
+            break;
+        }
+
+        const ArchiveEntry *entry = jobs->entries[index];
+        BackupResult result;
+        ArchiveVerifyProblem problem = archive_verify_entry(worker, entry, &result);
+        if (result != BACKUP_SUCCESS) {
+            int expected = BACKUP_SUCCESS;
+            atomic_compare_exchange_strong(&jobs->error, &expected, (int)result);
+            break;
+        }
+        worker->verify.files++;
+        if (problem == ARCHIVE_VERIFY_OK) {
+            continue;
+        }
+        if (problem == ARCHIVE_VERIFY_CORRUPT) {
+            worker->verify.corrupt++;
+        } else if (problem == ARCHIVE_VERIFY_UNREADABLE) {
+            worker->verify.unreadable++;
+        } else if (problem == ARCHIVE_VERIFY_SOURCE_CHANGED) {
+            worker->verify.source_changed++;
+        } else {
+            worker->verify.source_missing++;
+        }
+        if (jobs->report != NULL) {
+            jobs->report(entry, problem, jobs->context);
+        }
+    }
+}
+
+// 校验备份文件
+BackupResult archive_verify(Archive *archive, const char *source_dir, int thread_count, ArchiveVerifyReport report, void *context, ArchiveVerifyStats *stats) {
+    if (archive == NULL || archive->index_only || stats == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+    double start_time = platform_monotonic_time();
+    memset(stats, 0, sizeof(ArchiveVerifyStats));
+
+    // 只校验有数据的普通文件，硬链接的数据随链接到的文件校验
+    const ArchiveEntry **entries = (const ArchiveEntry **)malloc((archive->entry_count + 1) * sizeof(ArchiveEntry *));
+    if (entries == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < archive->entry_count; i++) {
+        const Pack2Item *item = &archive->entries[i].item;
+        if (item->type == FILE_TYPE_REGULAR && !(item->flags & PACK2_ITEM_HARDLINK)) {
+            entries[count++] = &archive->entries[i];
+        }
+    }
+
+    ArchiveJobs jobs;
+    memset(&jobs, 0, sizeof(ArchiveJobs));
+    jobs.archive = archive;
+    jobs.entries = entries;
+    jobs.count = count;
+    jobs.target_dir = source_dir;
+    jobs.report = report;
+    jobs.context = context;
+    int worker_count = 0;
+    ArchiveWorker *workers = archive_workers_create(&jobs, thread_count, &worker_count);
+    if (workers == NULL) {
+        free(entries);
+        return BACKUP_ERROR_MEMORY;
+    }
+    archive_workers_run(workers, worker_count, archive_verify_run);
+
+    // 合并各线程的统计
+    for (int i = 0; i < worker_count; i++) {
+        stats->files += workers[i].verify.files;
+        stats->hashed_files += workers[i].verify.hashed_files;
+        stats->bytes += workers[i].verify.bytes;
+        stats->corrupt += workers[i].verify.corrupt;
+        stats->unreadable += workers[i].verify.unreadable;
+        stats->source_changed += workers[i].verify.source_changed;
+        stats->source_missing += workers[i].verify.source_missing;
+        free(workers[i].target);
+        free(workers[i].buffer);
+    }
+    stats->seconds = platform_monotonic_time() - start_time;
+
+    BackupResult result = (BackupResult)atomic_load(&jobs.error);
+    if (result == BACKUP_SUCCESS && stats->corrupt + stats->unreadable + stats->source_changed + stats->source_missing > 0) {
+        result = BACKUP_ERROR_CHECKSUM;
+    }
+    free(workers);
+    free(entries);
+    return result;
+}
+
+// 打开以来的提取统计
+void archive_get_stats(const Archive *archive, ArchiveStats *stats) {
+    *stats = archive->stats;
+}
@@ -1,32 +1,50 @@
 #include "backup.h"
 #include "main.h"
 #include "traverse.h"
-#include <windows.h>
-#include <tchar.h>
+#include "pipeline.h"
+#include "platform.h"
+#include "pack.h"
+#include "filter.h"
+#include "manifest.h"
+
+// 最近一次备份的流水线统计
+static PipelineStats last_pipeline_stats;
+
+// 最近一次去重备份的分块存储统计
+static ChunkStoreStats last_chunk_stats;
 
 // 辅助函数：递归创建目录
 int create_directory_recursive(const char *path) {
-    char temp_path[512];
-    strcpy(temp_path, path);
-    
-    // 替换所有的'/'为'\'
-    for (int i = 0; temp_path[i] != '\0'; i++) {
-        if (temp_path[i] == '/') {
-            temp_path[i] = '\\';
-        }
+    return platform_make_directories(path);
+}
+
+// 辅助函数：去重仓库中保留上一次的备份文件，按其修改时间改名为backup-YYYYMMDD-HHMMSS.dat，
+// 同一秒内的多个备份依次加上-1、-2等后缀，不覆盖已保留的备份；它引用的块仍在分块存储中，可以单独还原
+static BackupResult backup_keep_previous(const char *pack_file_path) {
+    FileMetadata metadata;
+    if (!platform_path_exists(pack_file_path, NULL)) {
+        return BACKUP_SUCCESS;
     }
-    
-    // 递归创建目录
-    char *ptr = temp_path + 1;
-    while ((ptr = strchr(ptr, '\\')) != NULL) {
-        *ptr = '\0';
-        CreateDirectory(temp_path, NULL);
-        *ptr = '\\';
-        ptr++;
+    if (get_file_metadata(pack_file_path, &metadata) != BACKUP_SUCCESS) {
+        return BACKUP_ERROR_FILE;
     }
-    
-    // 创建最终目录
-    return CreateDirectory(temp_path, NULL) != 0 || GetLastError() == ERROR_ALREADY_EXISTS;
+
+    char name[32];
+    char previous_path[512];
+    time_t modify_time = metadata.modify_time;
+    struct tm *local = localtime(&modify_time);
+    if (local == NULL || strftime(name, sizeof(name), "backup-%Y%m%d-%H%M%S", local) == 0) {
+        return BACKUP_ERROR_FILE;
+    }
+    size_t directory_length = strlen(pack_file_path) - strlen("backup.dat");
+    snprintf(previous_path, sizeof(previous_path), "%.*s%s.dat", (int)directory_length, pack_file_path, name);
+    for (int suffix = 1; platform_path_exists(previous_path, NULL); suffix++) {
+        if (suffix > 9999) {
+            return BACKUP_ERROR_FILE;
+        }
+        snprintf(previous_path, sizeof(previous_path), "%.*s%s-%d.dat", (int)directory_length, pack_file_path, name, suffix);
+    }
+    return (rename(pack_file_path, previous_path) == 0) ? BACKUP_SUCCESS : BACKUP_ERROR_FILE;
 }
 
 // 备份主函数
@@ -35,127 +53,211 @@ BackupResult backup_data(const BackupOptions *options) {
         return BACKUP_ERROR_PARAM;
     }
 
+    // 去重仓库的块不经过加密，只支持MyPack
+    memset(&last_chunk_stats, 0, sizeof(ChunkStoreStats));
+    if (options->dedup && (options->pack_algorithm != PACK_ALGORITHM_MYPACK || options->encrypt_enable)) {
+        return BACKUP_ERROR_PARAM;
+    }
+    // 增量备份随机访问上一次的备份文件的索引，备份文件不能压缩
+    if (options->incremental && (!options->dedup || options->compress_algorithm != COMPRESS_ALGORITHM_NONE)) {
+        return BACKUP_ERROR_PARAM;
+    }
+
     // 检查源路径是否存在
-    DWORD file_attr = GetFileAttributes(options->source_path);
-    if (file_attr == INVALID_FILE_ATTRIBUTES) {
+    int source_is_directory = 0;
+    if (!platform_path_exists(options->source_path, &source_is_directory)) {
         return BACKUP_ERROR_PATH;
     }
 
     // 创建目标目录
-    if (CreateDirectory(options->target_path, NULL) == 0 && GetLastError() != ERROR_ALREADY_EXISTS) {
+    if (!platform_make_directory(options->target_path)) {
         return BACKUP_ERROR_PATH;
     }
 
+    // 源路径是目录、打包格式支持流式打包且不需要排序时，边遍历边打包，不需要先得到完整的文件列表
+    int streaming = source_is_directory && pack_stream_supported(options->pack_algorithm) &&
+                    !options->traverse_sort && !options->traverse_layout;
+
+    // 打包时的工作目录：源路径是文件时为其所在目录
+    char source_dir[512];
+    snprintf(source_dir, sizeof(source_dir), "%s", options->source_path);
+
     // 遍历目录，收集文件
-    FileMetadata *files = NULL;
-    int file_count = 0;
+    Catalog *catalog = NULL;
     BackupResult result;
     
-    if (file_attr & FILE_ATTRIBUTE_DIRECTORY) {
+    if (streaming) {
+        // 文件由流水线的遍历阶段逐个提供
+    } else if (source_is_directory) {
         // 源路径是目录，遍历目录
-        result = traverse_directory(options->source_path, &files, &file_count, options);
+        result = traverse_catalog(options->source_path, &catalog, options);
         if (result != BACKUP_SUCCESS) {
             return result;
         }
     } else {
         // 源路径是文件，直接处理单个文件
-        files = (FileMetadata *)malloc(sizeof(FileMetadata));
-        if (files == NULL) {
-            return BACKUP_ERROR_MEMORY;
-        }
-        
-        result = get_file_metadata(options->source_path, &files[0]);
+        FileMetadata metadata;
+        result = get_file_metadata(options->source_path, &metadata);
         if (result != BACKUP_SUCCESS) {
-            free(files);
             return result;
         }
+
+        // 以文件名加入目录清单，打包时切换到文件所在的目录
+        char *separator = strrchr(source_dir, '/');
+#ifdef _WIN32
+        char *backslash = strrchr(source_dir, '\\');
+        if (separator == NULL || (backslash != NULL && backslash > separator)) {
+            separator = backslash;
+        }
+#endif
+        const char *name = options->source_path + ((separator != NULL) ? (size_t)(separator - source_dir) + 1 : 0);
+        if (separator == NULL) {
+            strcpy(source_dir, ".");
+        } else if (separator == source_dir) {
+            source_dir[1] = '\0';
+        } else {
+            *separator = '\0';
+        }
+
+        catalog = catalog_create();
+        if (catalog == NULL) {
+            return BACKUP_ERROR_MEMORY;
+        }
         
         // 筛选文件
-        if (filter_file(&files[0], options)) {
-            file_count = 1;
-        } else {
-            free(files);
-            files = NULL;
-            file_count = 0;
+        CatalogEntry stat;
+        catalog_stat_from_metadata(&metadata, &stat);
+        if (filter_entry(&stat, name, options->source_path, options) &&
+            catalog_add_file(catalog, CATALOG_ROOT, name, &stat, metadata.symlink_target) == CATALOG_NONE) {
+            catalog_destroy(catalog);
+            return BACKUP_ERROR_MEMORY;
         }
     }
 
     // 检查是否有文件需要打包
-    if (file_count == 0) {
-        free(files);
+    if (!streaming && catalog_file_count(catalog) == 0) {
+        catalog_destroy(catalog);
         return BACKUP_ERROR_NO_FILES;
     }
 
-    // 构建打包文件路径，确保使用绝对路径
+    // 构建备份文件路径，确保使用绝对路径
     char pack_file_path[512];
-    char compress_file_path[512];
-    char encrypt_file_path[512];
-    char current_pack_path[512];
-    
-    // 生成绝对路径的打包文件名
-    GetFullPathName(options->target_path, sizeof(pack_file_path), pack_file_path, NULL);
-    strcat(pack_file_path, "\\backup.dat");
     
+    // 生成绝对路径的备份文件名
+    if (platform_full_path(options->target_path, pack_file_path, sizeof(pack_file_path) - 16) != BACKUP_SUCCESS) {
+        catalog_destroy(catalog);
+        return BACKUP_ERROR_PATH;
+    }
+
+    // 去重仓库：打开目标目录下的分块存储，保留上一次的备份文件
+    ChunkStore *chunks = NULL;
+    if (options->dedup) {
+        result = chunk_store_open(pack_file_path, &chunks);
+        if (result != BACKUP_SUCCESS) {
+            catalog_destroy(catalog);
+            return result;
+        }
+    }
+    strcat(pack_file_path, PATH_SEPARATOR_STRING "backup.dat");
+
+    // 增量备份：打开上一次的备份文件作为清单，没有上一次的去重备份时做完整备份
+    Manifest *previous = NULL;
+    if (options->incremental) {
+        result = manifest_open(pack_file_path, &previous);
+        if (result != BACKUP_SUCCESS && result != BACKUP_ERROR_PATH && result != BACKUP_ERROR_PACK) {
+            chunk_store_close(chunks);
+            catalog_destroy(catalog);
+            return result;
+        }
+    }
+
+    // 打开备份文件：新的备份先写入临时文件，成功后才保留或替换上一次的备份文件，失败时上一次的备份不受影响
+    // 零拷贝打包时写入阶段要读回直接复制的数据计算内容摘要，因此以读写方式打开
+    char temp_file_path[sizeof(pack_file_path) + 8];
+    snprintf(temp_file_path, sizeof(temp_file_path), "%s.tmp", pack_file_path);
+    FILE *output_fp = fopen(temp_file_path, "w+b");
+    if (output_fp == NULL) {
+        manifest_close(previous);
+        chunk_store_close(chunks);
+        catalog_destroy(catalog);
+        return BACKUP_ERROR_FILE;
+    }
+    setvbuf(output_fp, NULL, _IOFBF, STREAM_BUFFER_SIZE);
+
     // 保存当前工作目录
-    char current_dir[256];
-    GetCurrentDirectory(256, current_dir);
+    char current_dir[512];
+    if (platform_get_current_directory(current_dir, sizeof(current_dir)) != BACKUP_SUCCESS) {
+        fclose(output_fp);
+        manifest_close(previous);
+        chunk_store_close(chunks);
+        catalog_destroy(catalog);
+        return BACKUP_ERROR_PATH;
+    }
     
-    // 切换到源目录，以便pack_files能正确找到相对路径的文件
-    if (!SetCurrentDirectory(options->source_path)) {
-        free(files);
+    // 切换到源目录，以便打包时能正确找到相对路径的文件
+    if (!platform_change_directory(source_dir)) {
+        fclose(output_fp);
+        manifest_close(previous);
+        chunk_store_close(chunks);
+        catalog_destroy(catalog);
         return BACKUP_ERROR_PATH;
     }
     
-    // 打包文件
-    result = pack_files(pack_file_path, files, file_count, options->pack_algorithm);
+    // 读取、打包、压缩（可选）、加密（可选）、写入各在一个线程中运行，阶段之间通过有界队列传递数据块
+    // 源文件只读取一次，备份文件只写入一次，吞吐量取决于最慢的阶段
+    if (streaming) {
+        result = pipeline_backup_tree(".", options, chunks, previous, output_fp, &last_pipeline_stats);
+    } else {
+        result = pipeline_backup(catalog, options, chunks, previous, output_fp, &last_pipeline_stats);
+    }
+    manifest_close(previous);
     
     // 切换回原始工作目录
-    SetCurrentDirectory(current_dir);
+    platform_change_directory(current_dir);
     
-    if (result != BACKUP_SUCCESS) {
-        free(files);
-        return result;
+    if (fclose(output_fp) != 0 && result == BACKUP_SUCCESS) {
+        result = BACKUP_ERROR_FILE;
     }
 
-    // 保存当前打包文件路径，用于后续处理
-    strcpy(current_pack_path, pack_file_path);
-    
-    // 压缩打包文件（如果需要）
-    if (options->compress_algorithm != COMPRESS_ALGORITHM_NONE) {
-        sprintf(compress_file_path, "%s\\backup_compressed.dat", options->target_path);
-        
-        result = compress_file(current_pack_path, compress_file_path, options->compress_algorithm);
-        if (result != BACKUP_SUCCESS) {
-            free(files);
-            return result;
+    // 备份失败时已经写入的块仍然有效，同样记入块索引，下次备份可以直接引用
+    if (chunks != NULL) {
+        chunk_store_get_stats(chunks, &last_chunk_stats);
+        if (chunk_store_close(chunks) != BACKUP_SUCCESS && result == BACKUP_SUCCESS) {
+            result = BACKUP_ERROR_FILE;
         }
-        
-        // 更新当前处理的文件路径为压缩后的文件
-        strcpy(current_pack_path, compress_file_path);
     }
 
-    // 加密文件（如果需要）
-    if (options->encrypt_enable) {
-        sprintf(encrypt_file_path, "%s\\backup_encrypted.dat", options->target_path);
-        
-        result = encrypt_file(current_pack_path, encrypt_file_path, options->encrypt_algorithm, options->encrypt_key);
-        if (result != BACKUP_SUCCESS) {
-            free(files);
-            return result;
-        }
-        
-        // 更新当前处理的文件路径为加密后的文件
-        strcpy(current_pack_path, encrypt_file_path);
+    // 去重仓库中保留上一次的备份文件，再把新的备份文件改名为backup.dat
+    if (result == BACKUP_SUCCESS && options->dedup) {
+        result = backup_keep_previous(pack_file_path);
+    }
+    if (result == BACKUP_SUCCESS) {
+        result = platform_replace_file(temp_file_path, pack_file_path);
+    }
+
+    // 流式遍历没有找到文件或备份失败时，删除不完整的备份文件
+    if (result != BACKUP_SUCCESS) {
+        platform_delete_file(temp_file_path);
     }
+    catalog_destroy(catalog);
+    return result;
+}
 
-    free(files);
-    return BACKUP_SUCCESS;
+// 获取最近一次备份的流水线统计
+void backup_get_pipeline_stats(PipelineStats *stats) {
+    if (stats != NULL) {
+        *stats = last_pipeline_stats;
+    }
+}
+
+// 获取最近一次去重备份的分块存储统计
+void backup_get_chunk_stats(ChunkStoreStats *stats) {
+    if (stats != NULL) {
+        *stats = last_chunk_stats;
+    }
 }
 
 // 复制文件
 BackupResult copy_file(const char *source, const char *target) {
-    if (CopyFile(source, target, FALSE) == 0) {
-        return BACKUP_ERROR_FILE;
-    }
-    return BACKUP_SUCCESS;
+    return platform_copy_file(source, target);
 }
@@ -0,0 +1,652 @@
+#include "catalog.h"
+#include "platform.h"
+#include "thread.h"
+
+// 项分块存储，每块的项数（2的幂），最多约2.7亿项
+#define CATALOG_ENTRY_CHUNK_SHIFT 12
+#define CATALOG_ENTRY_CHUNK (1u << CATALOG_ENTRY_CHUNK_SHIFT)
+#define CATALOG_MAX_ENTRY_CHUNKS 65536u
+
+// 字符串区分块存储，字符串位置的高位是块号，低位是块内偏移
+#define CATALOG_STRING_CHUNK_SHIFT 20
+#define CATALOG_STRING_CHUNK (1u << CATALOG_STRING_CHUNK_SHIFT)
+#define CATALOG_MAX_STRING_CHUNKS (1u << (32 - CATALOG_STRING_CHUNK_SHIFT))
+
+struct Catalog {
+    Mutex lock;                     // 追加互斥
+
+    // 项：块指针表固定大小，追加时已有的项不会移动
+    CatalogEntry *entry_chunks[CATALOG_MAX_ENTRY_CHUNKS];
+    unsigned int entry_count;
+
+    // 字符串区
+    char *string_chunks[CATALOG_MAX_STRING_CHUNKS];
+    unsigned int string_chunk_count;
+    unsigned int string_used;       // 最后一块已使用的字节数
+    size_t string_bytes;            // 字符串总字节数
+
+    // 文件列表（文件编号）
+    unsigned int *files;
+    unsigned int file_count;
+    unsigned int file_capacity;
+
+    // 目录查找表（开放寻址），按父目录编号和文件名查找目录编号
+    unsigned int *directories;
+    unsigned int directory_count;
+    unsigned int directory_capacity; // 2的幂
+
+    // 硬链接查找表（开放寻址），按设备号和inode编号查找硬链接组第一个加入的文件编号
+    unsigned int *links;
+    unsigned int link_count;
+    unsigned int link_capacity;      // 2的幂
+};
+
+// 辅助函数：取得项的地址
+static CatalogEntry *entry_at(const Catalog *catalog, unsigned int id) {
+    return &catalog->entry_chunks[id >> CATALOG_ENTRY_CHUNK_SHIFT][id & (CATALOG_ENTRY_CHUNK - 1)];
+}
+
+// 辅助函数：取得字符串的地址
+static const char *string_at(const Catalog *catalog, unsigned int position) {
+    return catalog->string_chunks[position >> CATALOG_STRING_CHUNK_SHIFT] + (position & (CATALOG_STRING_CHUNK - 1));
+}
+
+// 辅助函数：字符串存入字符串区，返回位置，失败时返回CATALOG_NONE
+static unsigned int string_add(Catalog *catalog, const char *text) {
+    size_t length = strlen(text) + 1;
+    if (length > CATALOG_STRING_CHUNK) {
+        return CATALOG_NONE;
+    }
+
+    // 当前块放不下时开始新的一块，字符串不跨块
+    if (catalog->string_chunk_count == 0 || catalog->string_used + length > CATALOG_STRING_CHUNK) {
+        if (catalog->string_chunk_count == CATALOG_MAX_STRING_CHUNKS) {
+            return CATALOG_NONE;
+        }
+        char *chunk = (char *)malloc(CATALOG_STRING_CHUNK);
+        if (chunk == NULL) {
+            return CATALOG_NONE;
+        }
+        catalog->string_chunks[catalog->string_chunk_count++] = chunk;
+        catalog->string_used = 0;
+    }
+
+    unsigned int chunk_index = catalog->string_chunk_count - 1;
+    unsigned int position = (chunk_index << CATALOG_STRING_CHUNK_SHIFT) | catalog->string_used;
+    memcpy(catalog->string_chunks[chunk_index] + catalog->string_used, text, length);
+    catalog->string_used += (unsigned int)length;
+    catalog->string_bytes += length;
+    return position;
+}
+
+// 辅助函数：追加一项，返回编号，失败时返回CATALOG_NONE
+static unsigned int entry_add(Catalog *catalog, unsigned int parent, const char *name, const CatalogEntry *stat, const char *symlink_target) {
+    unsigned int id = catalog->entry_count;
+    unsigned int chunk_index = id >> CATALOG_ENTRY_CHUNK_SHIFT;
+    if (chunk_index >= CATALOG_MAX_ENTRY_CHUNKS) {
+        return CATALOG_NONE;
+    }
+    if (catalog->entry_chunks[chunk_index] == NULL) {
+        catalog->entry_chunks[chunk_index] = (CatalogEntry *)malloc(CATALOG_ENTRY_CHUNK * sizeof(CatalogEntry));
+        if (catalog->entry_chunks[chunk_index] == NULL) {
+            return CATALOG_NONE;
+        }
+    }
+
+    CatalogEntry entry = *stat;
+    entry.parent = parent;
+    entry.link = CATALOG_NONE;
+    entry.name = string_add(catalog, name);
+    entry.symlink_target = CATALOG_NONE;
+    if (entry.name == CATALOG_NONE) {
+        return CATALOG_NONE;
+    }
+    if (symlink_target != NULL && symlink_target[0] != '\0') {
+        entry.symlink_target = string_add(catalog, symlink_target);
+        if (entry.symlink_target == CATALOG_NONE) {
+            return CATALOG_NONE;
+        }
+    }
+
+    *entry_at(catalog, id) = entry;
+    catalog->entry_count++;
+    return id;
+}
+
+// 辅助函数：目录查找表的哈希值
+static unsigned int directory_hash(unsigned int parent, const char *name) {
+    unsigned int hash = 2166136261u ^ parent;
+    for (const unsigned char *p = (const unsigned char *)name; *p != '\0'; p++) {
+        hash = (hash ^ *p) * 16777619u;
+    }
+    return hash;
+}
+
+// 辅助函数：在目录查找表中插入目录编号（表中有空位）
+static void directory_insert(Catalog *catalog, unsigned int id) {
+    const CatalogEntry *entry = entry_at(catalog, id);
+    unsigned int mask = catalog->directory_capacity - 1;
+    unsigned int slot = directory_hash(entry->parent, string_at(catalog, entry->name)) & mask;
+
+    while (catalog->directories[slot] != CATALOG_NONE) {
+        slot = (slot + 1) & mask;
+    }
+    catalog->directories[slot] = id;
+    catalog->directory_count++;
+}
+
+// 辅助函数：目录查找表超过一半时扩容
+static BackupResult directory_reserve(Catalog *catalog) {
+    if ((catalog->directory_count + 1) * 2 <= catalog->directory_capacity) {
+        return BACKUP_SUCCESS;
+    }
+
+    unsigned int *old = catalog->directories;
+    unsigned int old_capacity = catalog->directory_capacity;
+    unsigned int capacity = (old_capacity > 0) ? old_capacity * 2 : 256;
+
+    catalog->directories = (unsigned int *)malloc(capacity * sizeof(unsigned int));
+    if (catalog->directories == NULL) {
+        catalog->directories = old;
+        return BACKUP_ERROR_MEMORY;
+    }
+    memset(catalog->directories, 0xFF, capacity * sizeof(unsigned int));
+    catalog->directory_capacity = capacity;
+    catalog->directory_count = 0;
+
+    for (unsigned int i = 0; i < old_capacity; i++) {
+        if (old[i] != CATALOG_NONE) {
+            directory_insert(catalog, old[i]);
+        }
+    }
+    free(old);
+    return BACKUP_SUCCESS;
+}
+
+// 辅助函数：设备号和inode编号的哈希值
+static unsigned int link_hash(unsigned long long device, unsigned long long inode) {
+    unsigned long long hash = (inode ^ (device * 0x9E3779B97F4A7C15ull)) * 0xFF51AFD7ED558CCDull;
+    return (unsigned int)(hash >> 32);
+}
+
+// 辅助函数：在硬链接查找表中插入文件编号（表中有空位）
+static void link_insert(Catalog *catalog, unsigned int id) {
+    const CatalogEntry *entry = entry_at(catalog, id);
+    unsigned int mask = catalog->link_capacity - 1;
+    unsigned int slot = link_hash(entry->device, entry->inode) & mask;
+
+    while (catalog->links[slot] != CATALOG_NONE) {
+        slot = (slot + 1) & mask;
+    }
+    catalog->links[slot] = id;
+    catalog->link_count++;
+}
+
+// 辅助函数：硬链接查找表超过一半时扩容
+static BackupResult link_reserve(Catalog *catalog) {
+    if ((catalog->link_count + 1) * 2 <= catalog->link_capacity) {
+        return BACKUP_SUCCESS;
+    }
+
+    unsigned int *old = catalog->links;
+    unsigned int old_capacity = catalog->link_capacity;
+    unsigned int capacity = (old_capacity > 0) ? old_capacity * 2 : 256;
+
+    catalog->links = (unsigned int *)malloc(capacity * sizeof(unsigned int));
+    if (catalog->links == NULL) {
+        catalog->links = old;
+        return BACKUP_ERROR_MEMORY;
+    }
+    memset(catalog->links, 0xFF, capacity * sizeof(unsigned int));
+    catalog->link_capacity = capacity;
+    catalog->link_count = 0;
+
+    for (unsigned int i = 0; i < old_capacity; i++) {
+        if (old[i] != CATALOG_NONE) {
+            link_insert(catalog, old[i]);
+        }
+    }
+    free(old);
+    return BACKUP_SUCCESS;
+}
+
+// 辅助函数：新加入的有多个硬链接的文件归入硬链接组，同一文件第一次加入时成为新的一组
+static BackupResult link_assign(Catalog *catalog, unsigned int id) {
+    BackupResult result = link_reserve(catalog);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+
+    CatalogEntry *entry = entry_at(catalog, id);
+    unsigned int mask = catalog->link_capacity - 1;
+    unsigned int slot = link_hash(entry->device, entry->inode) & mask;
+    while (catalog->links[slot] != CATALOG_NONE) {
+        const CatalogEntry *first = entry_at(catalog, catalog->links[slot]);
+        if (first->device == entry->device && first->inode == entry->inode) {
+            entry->link = catalog->links[slot];
+            return BACKUP_SUCCESS;
+        }
+        slot = (slot + 1) & mask;
+    }
+    entry->link = id;
+    link_insert(catalog, id);
+    return BACKUP_SUCCESS;
+}
+
+// 创建目录清单，根目录的编号为CATALOG_ROOT
+Catalog *catalog_create(void) {
+    Catalog *catalog = (Catalog *)calloc(1, sizeof(Catalog));
+    if (catalog == NULL) {
+        return NULL;
+    }
+    mutex_init(&catalog->lock);
+
+    CatalogEntry root;
+    memset(&root, 0, sizeof(CatalogEntry));
+    root.type = FILE_TYPE_DIRECTORY;
+    if (entry_add(catalog, CATALOG_NONE, "", &root, NULL) != CATALOG_ROOT) {
+        catalog_destroy(catalog);
+        return NULL;
+    }
+    return catalog;
+}
+
+// 释放目录清单
+void catalog_destroy(Catalog *catalog) {
+    if (catalog == NULL) {
+        return;
+    }
+
+    for (unsigned int i = 0; i < CATALOG_MAX_ENTRY_CHUNKS && catalog->entry_chunks[i] != NULL; i++) {
+        free(catalog->entry_chunks[i]);
+    }
+    for (unsigned int i = 0; i < catalog->string_chunk_count; i++) {
+        free(catalog->string_chunks[i]);
+    }
+    free(catalog->files);
+    free(catalog->directories);
+    free(catalog->links);
+    mutex_destroy(&catalog->lock);
+    free(catalog);
+}
+
+// 加入目录
+unsigned int catalog_add_directory(Catalog *catalog, unsigned int parent, const char *name) {
+    unsigned int id = CATALOG_NONE;
+
+    mutex_lock(&catalog->lock);
+    if (directory_reserve(catalog) == BACKUP_SUCCESS) {
+        // 查找已有的同名目录
+        unsigned int mask = catalog->directory_capacity - 1;
+        unsigned int slot = directory_hash(parent, name) & mask;
+        while (catalog->directories[slot] != CATALOG_NONE) {
+            const CatalogEntry *entry = entry_at(catalog, catalog->directories[slot]);
+            if (entry->parent == parent && strcmp(string_at(catalog, entry->name), name) == 0) {
+                id = catalog->directories[slot];
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+
+        if (id == CATALOG_NONE) {
+            CatalogEntry stat;
+            memset(&stat, 0, sizeof(CatalogEntry));
+            stat.type = FILE_TYPE_DIRECTORY;
+            id = entry_add(catalog, parent, name, &stat, NULL);
+            if (id != CATALOG_NONE) {
+                directory_insert(catalog, id);
+            }
+        }
+    }
+    mutex_unlock(&catalog->lock);
+
+    return id;
+}
+
+// 加入文件
+unsigned int catalog_add_file(Catalog *catalog, unsigned int parent, const char *name, const CatalogEntry *stat, const char *symlink_target) {
+    unsigned int id = CATALOG_NONE;
+
+    mutex_lock(&catalog->lock);
+    if (catalog->file_count == catalog->file_capacity) {
+        unsigned int capacity = (catalog->file_capacity > 0) ? catalog->file_capacity * 2 : 1024;
+        unsigned int *files = (unsigned int *)realloc(catalog->files, capacity * sizeof(unsigned int));
+        if (files != NULL) {
+            catalog->files = files;
+            catalog->file_capacity = capacity;
+        }
+    }
+    if (catalog->file_count < catalog->file_capacity) {
+        id = entry_add(catalog, parent, name, stat, symlink_target);
+        if (id != CATALOG_NONE && (stat->flags & CATALOG_FLAG_LINKED) && link_assign(catalog, id) != BACKUP_SUCCESS) {
+            entry_at(catalog, id)->flags &= ~CATALOG_FLAG_LINKED;
+        }
+        if (id != CATALOG_NONE) {
+            catalog->files[catalog->file_count++] = id;
+        }
+    }
+    mutex_unlock(&catalog->lock);
+
+    return id;
+}
+
+// 按相对路径加入文件
+unsigned int catalog_add_path(Catalog *catalog, const char *path, const CatalogEntry *stat, const char *symlink_target) {
+    unsigned int parent = CATALOG_ROOT;
+    char component[256];
+
+    // 逐级加入目录，跳过空的路径分量
+    for (;;) {
+        while (*path == '/' || *path == '\\') {
+            path++;
+        }
+        size_t length = strcspn(path, "/\\");
+        if (path[length] == '\0') {
+            break;
+        }
+        if (length >= sizeof(component)) {
+            return CATALOG_NONE;
+        }
+        memcpy(component, path, length);
+        component[length] = '\0';
+
+        parent = catalog_add_directory(catalog, parent, component);
+        if (parent == CATALOG_NONE) {
+            return CATALOG_NONE;
+        }
+        path += length;
+    }
+
+    if (*path == '\0') {
+        return CATALOG_NONE;
+    }
+    return catalog_add_file(catalog, parent, path, stat, symlink_target);
+}
+
+// 取得项
+const CatalogEntry *catalog_entry(const Catalog *catalog, unsigned int id) {
+    return entry_at(catalog, id);
+}
+
+// 取得文件名
+const char *catalog_name(const Catalog *catalog, unsigned int id) {
+    return string_at(catalog, entry_at(catalog, id)->name);
+}
+
+// 取得符号链接目标，没有时返回空串
+const char *catalog_symlink_target(const Catalog *catalog, unsigned int id) {
+    unsigned int position = entry_at(catalog, id)->symlink_target;
+    return (position != CATALOG_NONE) ? string_at(catalog, position) : "";
+}
+
+// 构建相对于根目录的路径：先计算长度，再从末尾向前填写各级文件名
+size_t catalog_path(const Catalog *catalog, unsigned int id, char *buffer, size_t size) {
+    size_t length = 0;
+    for (unsigned int current = id; current != CATALOG_ROOT && current != CATALOG_NONE; current = entry_at(catalog, current)->parent) {
+        if (length > 0) {
+            length++;
+        }
+        length += strlen(catalog_name(catalog, current));
+    }
+
+    if (length + 1 > size) {
+        if (size > 0) {
+            buffer[0] = '\0';
+        }
+        return length;
+    }
+
+    size_t end = length;
+    buffer[end] = '\0';
+    for (unsigned int current = id; current != CATALOG_ROOT && current != CATALOG_NONE; current = entry_at(catalog, current)->parent) {
+        const char *name = catalog_name(catalog, current);
+        size_t name_length = strlen(name);
+        if (end < length) {
+            buffer[--end] = PATH_SEPARATOR;
+        }
+        end -= name_length;
+        memcpy(buffer + end, name, name_length);
+    }
+    return length;
+}
+
+// 构建路径到可增长的缓冲区，缓冲区不够时重新分配
+BackupResult catalog_path_buffer(const Catalog *catalog, unsigned int id, char **buffer, size_t *capacity) {
+    size_t length = catalog_path(catalog, id, NULL, 0);
+    if (length + 1 > *capacity) {
+        size_t new_capacity = (*capacity > 0) ? *capacity : 256;
+        while (new_capacity < length + 1) {
+            new_capacity *= 2;
+        }
+        char *new_buffer = (char *)realloc(*buffer, new_capacity);
+        if (new_buffer == NULL) {
+            return BACKUP_ERROR_MEMORY;
+        }
+        *buffer = new_buffer;
+        *capacity = new_capacity;
+    }
+    catalog_path(catalog, id, *buffer, *capacity);
+    return BACKUP_SUCCESS;
+}
+
+// 文件数量
+unsigned int catalog_file_count(const Catalog *catalog) {
+    return catalog->file_count;
+}
+
+// 文件列表中第index个文件的编号
+unsigned int catalog_file_id(const Catalog *catalog, unsigned int index) {
+    return catalog->files[index];
+}
+
+// 排序时的路径和编号
+typedef struct {
+    char *path;
+    unsigned int id;
+} CatalogSortItem;
+
+// 辅助函数：按路径比较
+static int compare_sort_item(const void *a, const void *b) {
+    return strcmp(((const CatalogSortItem *)a)->path, ((const CatalogSortItem *)b)->path);
+}
+
+// 按路径排序文件列表，排序期间临时构建每个文件的完整路径
+BackupResult catalog_sort(Catalog *catalog) {
+    unsigned int count = catalog->file_count;
+    if (count < 2) {
+        return BACKUP_SUCCESS;
+    }
+
+    CatalogSortItem *items = (CatalogSortItem *)calloc(count, sizeof(CatalogSortItem));
+    if (items == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    BackupResult result = BACKUP_SUCCESS;
+    for (unsigned int i = 0; i < count; i++) {
+        unsigned int id = catalog->files[i];
+        size_t length = catalog_path(catalog, id, NULL, 0);
+        items[i].id = id;
+        items[i].path = (char *)malloc(length + 1);
+        if (items[i].path == NULL) {
+            result = BACKUP_ERROR_MEMORY;
+            break;
+        }
+        catalog_path(catalog, id, items[i].path, length + 1);
+    }
+
+    if (result == BACKUP_SUCCESS) {
+        qsort(items, count, sizeof(CatalogSortItem), compare_sort_item);
+        for (unsigned int i = 0; i < count; i++) {
+            catalog->files[i] = items[i].id;
+        }
+    }
+
+    for (unsigned int i = 0; i < count; i++) {
+        free(items[i].path);
+    }
+    free(items);
+    return result;
+}
+
+// 按键值排序时的键值、原来的位置和编号
+typedef struct {
+    unsigned long long key;
+    unsigned int index;
+    unsigned int id;
+} CatalogKeyItem;
+
+// 辅助函数：按键值比较，键值相同时按原来的位置
+static int compare_key_item(const void *a, const void *b) {
+    const CatalogKeyItem *item_a = (const CatalogKeyItem *)a;
+    const CatalogKeyItem *item_b = (const CatalogKeyItem *)b;
+    if (item_a->key != item_b->key) {
+        return (item_a->key > item_b->key) - (item_a->key < item_b->key);
+    }
+    return (item_a->index > item_b->index) - (item_a->index < item_b->index);
+}
+
+// 按键值排序文件列表
+BackupResult catalog_sort_by_key(Catalog *catalog, const unsigned long long *keys) {
+    unsigned int count = catalog->file_count;
+    if (count < 2) {
+        return BACKUP_SUCCESS;
+    }
+
+    CatalogKeyItem *items = (CatalogKeyItem *)malloc(count * sizeof(CatalogKeyItem));
+    if (items == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        items[i].key = keys[i];
+        items[i].index = i;
+        items[i].id = catalog->files[i];
+    }
+    qsort(items, count, sizeof(CatalogKeyItem), compare_key_item);
+    for (unsigned int i = 0; i < count; i++) {
+        catalog->files[i] = items[i].id;
+    }
+
+    free(items);
+    return BACKUP_SUCCESS;
+}
+
+// 初始化硬链接的数据归属表
+void catalog_links_init(CatalogLinks *links) {
+    memset(links, 0, sizeof(CatalogLinks));
+}
+
+// 释放硬链接的数据归属表
+void catalog_links_free(CatalogLinks *links) {
+    free(links->slots);
+    memset(links, 0, sizeof(CatalogLinks));
+}
+
+// 辅助函数：在数据归属表中查找组，返回该组所在的位置或应当插入的空位
+static unsigned int links_find(const CatalogLinks *links, unsigned int group) {
+    unsigned int mask = links->capacity - 1;
+    unsigned int slot = (group * 2654435761u) & mask;
+    while (links->slots[slot * 2] != CATALOG_NONE && links->slots[slot * 2] != group) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// 辅助函数：数据归属表超过一半时扩容
+static BackupResult links_reserve(CatalogLinks *links) {
+    if ((links->count + 1) * 2 <= links->capacity) {
+        return BACKUP_SUCCESS;
+    }
+
+    CatalogLinks grown;
+    grown.capacity = (links->capacity > 0) ? links->capacity * 2 : 256;
+    grown.count = links->count;
+    grown.slots = (unsigned int *)malloc((size_t)grown.capacity * 2 * sizeof(unsigned int));
+    if (grown.slots == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    memset(grown.slots, 0xFF, (size_t)grown.capacity * 2 * sizeof(unsigned int));
+
+    for (unsigned int i = 0; i < links->capacity; i++) {
+        if (links->slots[i * 2] != CATALOG_NONE) {
+            unsigned int slot = links_find(&grown, links->slots[i * 2]);
+            grown.slots[slot * 2] = links->slots[i * 2];
+            grown.slots[slot * 2 + 1] = links->slots[i * 2 + 1];
+        }
+    }
+    free(links->slots);
+    *links = grown;
+    return BACKUP_SUCCESS;
+}
+
+// 判断文件需要保存数据还是链接到已保存数据的同组文件
+BackupResult catalog_link_source(const Catalog *catalog, CatalogLinks *links, unsigned int id, unsigned int *source) {
+    *source = CATALOG_NONE;
+    unsigned int group = entry_at(catalog, id)->link;
+    if (group == CATALOG_NONE) {
+        return BACKUP_SUCCESS;
+    }
+
+    BackupResult result = links_reserve(links);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+    unsigned int slot = links_find(links, group);
+    if (links->slots[slot * 2] == group) {
+        *source = links->slots[slot * 2 + 1];
+    } else {
+        links->slots[slot * 2] = group;
+        links->slots[slot * 2 + 1] = id;
+        links->count++;
+    }
+    return BACKUP_SUCCESS;
+}
+
+// 占用的内存字节数
+size_t catalog_memory_usage(const Catalog *catalog) {
+    return (size_t)catalog->entry_count * sizeof(CatalogEntry) + catalog->string_bytes +
+           (size_t)catalog->file_capacity * sizeof(unsigned int) +
+           (size_t)catalog->directory_capacity * sizeof(unsigned int) +
+           (size_t)catalog->link_capacity * sizeof(unsigned int);
+}
+
+// FileMetadata转换为目录清单项的属性部分
+void catalog_stat_from_metadata(const FileMetadata *metadata, CatalogEntry *stat) {
+    memset(stat, 0, sizeof(CatalogEntry));
+    stat->parent = CATALOG_NONE;
+    stat->name = CATALOG_NONE;
+    stat->symlink_target = CATALOG_NONE;
+    stat->link = CATALOG_NONE;
+    stat->type = (unsigned char)metadata->type;
+    stat->mode = (unsigned short)metadata->mode;
+    stat->uid = metadata->uid;
+    stat->gid = metadata->gid;
+    stat->size = metadata->size;
+    stat->create_time = metadata->create_time;
+    stat->modify_time = metadata->modify_time;
+    stat->access_time = metadata->access_time;
+}
+
+// 目录清单项转换为FileMetadata
+BackupResult catalog_to_metadata(const Catalog *catalog, unsigned int id, FileMetadata *metadata) {
+    const CatalogEntry *entry = entry_at(catalog, id);
+    const char *name = catalog_name(catalog, id);
+    const char *target = catalog_symlink_target(catalog, id);
+
+    memset(metadata, 0, sizeof(FileMetadata));
+    if (strlen(name) >= sizeof(metadata->name) || strlen(target) >= sizeof(metadata->symlink_target) ||
+        catalog_path(catalog, id, metadata->path, sizeof(metadata->path)) >= sizeof(metadata->path)) {
+        return BACKUP_ERROR_PATH;
+    }
+    strcpy(metadata->name, name);
+    strcpy(metadata->symlink_target, target);
+    metadata->type = (FileType)entry->type;
+    metadata->size = (unsigned long)entry->size;
+    metadata->create_time = (time_t)entry->create_time;
+    metadata->modify_time = (time_t)entry->modify_time;
+    metadata->access_time = (time_t)entry->access_time;
+    metadata->mode = entry->mode;
+    metadata->uid = entry->uid;
+    metadata->gid = entry->gid;
+    return BACKUP_SUCCESS;
+}
@@ -0,0 +1,741 @@
+#include "chunk_store.h"
+#include "platform.h"
+
+// FastCDC的判断掩码：平均长度之前要求更多的位为零（切分概率较低），之后要求较少的位为零，使块长度集中在平均长度附近
+// Gear哈希每字节左移一位，高位取决于最近的64字节，因此使用高位
+#define CHUNK_MASK_SMALL 0xFFFFC00000000000ull   // 18位
+#define CHUNK_MASK_LARGE 0xFFFC000000000000ull   // 14位
+
+// 差异编码签名表的桶数
+#define CHUNK_DELTA_BUCKETS 256
+
+// Gear表：每个字节值对应一个64位随机数，由固定种子生成，所有版本的切分点相同
+static unsigned long long chunk_gear[256];
+static int chunk_gear_ready = 0;
+
+struct ChunkStore {
+    FILE *data;                     // chunks.dat，追加写入
+    FILE *index;                    // chunks.idx，追加写入
+    unsigned long long data_size;   // chunks.dat的大小，即下一个新块的偏移量
+    ChunkRef *refs;                 // 仓库中的全部块，先是索引中已有的，之后是本次新保存的
+    unsigned int count;
+    unsigned int capacity;
+    unsigned int committed;         // 已写入索引文件的块数
+    unsigned int *slots;            // 按摘要查找块的开放寻址表，保存refs中的位置
+    unsigned int slot_capacity;     // 2的幂
+    char data_path[512];            // chunks.dat的路径
+    FILE *reader;                   // chunks.dat，读取差异编码的基准块，第一次差异编码时打开
+    unsigned long long readable_size; // 打开时chunks.dat的大小，这之前的块都已落盘，可以作为基准块
+    unsigned char *delta_buffer;    // 基准块、指令和新数据，第一次差异编码时分配
+    ChunkStoreStats stats;
+};
+
+// 分块写入端
+typedef struct {
+    ByteWriter base;
+    ChunkStore *store;
+    unsigned char *buffer;          // 尚未切分的数据，最多CHUNK_MAX_SIZE字节
+    size_t buffer_len;
+    ChunkRef *refs;                 // 当前文件已完成的块
+    unsigned int ref_count;
+    unsigned int ref_capacity;
+    unsigned long long file_offset; // 缓冲区开头在当前文件中的偏移量
+    const unsigned char *base_refs; // 当前文件上一版本的块引用表，可能未对齐
+    unsigned int base_count;
+    unsigned int base_index;        // 上一版本中第一个在file_offset之后结束的块
+    unsigned long long base_start;  // 该块在上一版本文件中的偏移量
+} ChunkWriter;
+
+#define CHUNK_SLOT_EMPTY 0xFFFFFFFFu
+
+// 辅助函数：生成Gear表（splitmix64）
+static void chunk_gear_init(void) {
+    if (chunk_gear_ready) {
+        return;
+    }
+    unsigned long long seed = 0x6368756E6B736565ull;
+    for (int i = 0; i < 256; i++) {
+        seed += 0x9E3779B97F4A7C15ull;
+        unsigned long long value = seed;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        chunk_gear[i] = value ^ (value >> 31);
+    }
+    chunk_gear_ready = 1;
+}
+
+// 找到第一个切分点
+size_t chunk_cut(const unsigned char *data, size_t size) {
+    if (size <= CHUNK_MIN_SIZE) {
+        return size;
+    }
+    size_t limit = (size < CHUNK_MAX_SIZE) ? size : CHUNK_MAX_SIZE;
+    size_t normal = (limit < CHUNK_AVG_SIZE) ? limit : CHUNK_AVG_SIZE;
+
+    // 最小长度之前不可能切分，直接跳过
+    unsigned long long hash = 0;
+    size_t i = CHUNK_MIN_SIZE;
+    for (; i < normal; i++) {
+        hash = (hash << 1) + chunk_gear[data[i]];
+        if ((hash & CHUNK_MASK_SMALL) == 0) {
+            return i + 1;
+        }
+    }
+    for (; i < limit; i++) {
+        hash = (hash << 1) + chunk_gear[data[i]];
+        if ((hash & CHUNK_MASK_LARGE) == 0) {
+            return i + 1;
+        }
+    }
+    return limit;
+}
+
+// 辅助函数：摘要的哈希值（摘要本身是均匀分布的，直接取前4字节）
+static unsigned int chunk_slot_hash(const unsigned char *hash) {
+    unsigned int value;
+    memcpy(&value, hash, sizeof(value));
+    return value;
+}
+
+// 辅助函数：按摘要查找块，返回查找表中的位置（找不到时是应当插入的空位）
+static unsigned int chunk_find_slot(const ChunkStore *store, const unsigned char *hash) {
+    unsigned int mask = store->slot_capacity - 1;
+    unsigned int slot = chunk_slot_hash(hash) & mask;
+    while (store->slots[slot] != CHUNK_SLOT_EMPTY &&
+           memcmp(store->refs[store->slots[slot]].hash, hash, SHA256_SIZE) != 0) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// 辅助函数：块数组和查找表留出加入一块的空间，查找表超过一半时扩容
+static BackupResult chunk_reserve(ChunkStore *store) {
+    if (store->count == store->capacity) {
+        unsigned int capacity = (store->capacity > 0) ? store->capacity * 2 : 4096;
+        ChunkRef *refs = (ChunkRef *)realloc(store->refs, (size_t)capacity * sizeof(ChunkRef));
+        if (refs == NULL) {
+            return BACKUP_ERROR_MEMORY;
+        }
+        store->refs = refs;
+        store->capacity = capacity;
+    }
+
+    if ((store->count + 1) * 2 <= store->slot_capacity) {
+        return BACKUP_SUCCESS;
+    }
+    unsigned int *old = store->slots;
+    unsigned int capacity = (store->slot_capacity > 0) ? store->slot_capacity * 2 : 8192;
+    store->slots = (unsigned int *)malloc((size_t)capacity * sizeof(unsigned int));
+    if (store->slots == NULL) {
+        store->slots = old;
+        return BACKUP_ERROR_MEMORY;
+    }
+    memset(store->slots, 0xFF, (size_t)capacity * sizeof(unsigned int));
+    store->slot_capacity = capacity;
+    free(old);
+
+    for (unsigned int i = 0; i < store->count; i++) {
+        store->slots[chunk_find_slot(store, store->refs[i].hash)] = i;
+    }
+    return BACKUP_SUCCESS;
+}
+
+// 辅助函数：读入块索引，去掉超出块数据的项（块数据没有写完整）和末尾不完整的项，截去索引文件中无效的部分
+static BackupResult chunk_store_load(ChunkStore *store) {
+    char magic[sizeof(CHUNK_STORE_INDEX_MAGIC) - 1];
+    if (platform_seek(store->index, 0, SEEK_SET) != BACKUP_SUCCESS) {
+        return BACKUP_ERROR_FILE;
+    }
+    size_t bytes_read = fread(magic, 1, sizeof(magic), store->index);
+    if (bytes_read == 0) {
+        // 新建的仓库
+        if (fwrite(CHUNK_STORE_INDEX_MAGIC, 1, sizeof(magic), store->index) != sizeof(magic) || fflush(store->index) != 0) {
+            return BACKUP_ERROR_FILE;
+        }
+        return BACKUP_SUCCESS;
+    }
+    if (bytes_read != sizeof(magic) || memcmp(magic, CHUNK_STORE_INDEX_MAGIC, sizeof(magic)) != 0) {
+        return BACKUP_ERROR_PACK;
+    }
+
+    ChunkRef ref;
+    while (fread(&ref, 1, sizeof(ChunkRef), store->index) == sizeof(ChunkRef)) {
+        unsigned int stored = (ref.delta_length > 0) ? ref.delta_length : ref.length;
+        if (ref.offset > store->data_size || stored > store->data_size - ref.offset) {
+            break;
+        }
+        BackupResult result = chunk_reserve(store);
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+        unsigned int slot = chunk_find_slot(store, ref.hash);
+        if (store->slots[slot] == CHUNK_SLOT_EMPTY) {
+            store->refs[store->count] = ref;
+            store->slots[slot] = store->count++;
+        }
+    }
+
+    // 以后追加的索引项紧接在有效项之后（重复的项已去掉，重新写出的索引不会更长）
+    unsigned long long valid = sizeof(magic) + (unsigned long long)store->count * sizeof(ChunkRef);
+    if (platform_seek(store->index, 0, SEEK_END) != BACKUP_SUCCESS) {
+        return BACKUP_ERROR_FILE;
+    }
+    if ((unsigned long long)platform_tell(store->index) != valid) {
+        if (platform_set_file_size(store->index, sizeof(magic)) != BACKUP_SUCCESS) {
+            return BACKUP_ERROR_FILE;
+        }
+        if (platform_seek(store->index, 0, SEEK_END) != BACKUP_SUCCESS ||
+            fwrite(store->refs, sizeof(ChunkRef), store->count, store->index) != store->count ||
+            fflush(store->index) != 0) {
+            return BACKUP_ERROR_FILE;
+        }
+    }
+    store->committed = store->count;
+    store->stats.stored_chunks = store->count;
+    return BACKUP_SUCCESS;
+}
+
+// 打开分块存储
+BackupResult chunk_store_open(const char *directory, ChunkStore **store) {
+    if (directory == NULL || store == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+    *store = NULL;
+    chunk_gear_init();
+
+    char data_path[512];
+    char index_path[512];
+    int data_length = snprintf(data_path, sizeof(data_path), "%s%c%s", directory, PATH_SEPARATOR, CHUNK_STORE_DATA_NAME);
+    int index_length = snprintf(index_path, sizeof(index_path), "%s%c%s", directory, PATH_SEPARATOR, CHUNK_STORE_INDEX_NAME);
+    if (data_length <= 0 || (size_t)data_length >= sizeof(data_path) || index_length <= 0 || (size_t)index_length >= sizeof(index_path)) {
+        return BACKUP_ERROR_PATH;
+    }
+
+    ChunkStore *result_store = (ChunkStore *)calloc(1, sizeof(ChunkStore));
+    if (result_store == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    BackupResult result = BACKUP_SUCCESS;
+    result_store->data = fopen(data_path, "ab");
+    result_store->index = fopen(index_path, "a+b");
+    if (result_store->data == NULL || result_store->index == NULL) {
+        result = BACKUP_ERROR_FILE;
+        goto cleanup;
+    }
+    if (platform_seek(result_store->data, 0, SEEK_END) != BACKUP_SUCCESS) {
+        result = BACKUP_ERROR_FILE;
+        goto cleanup;
+    }
+    result_store->data_size = (unsigned long long)platform_tell(result_store->data);
+    result_store->readable_size = result_store->data_size;
+    strcpy(result_store->data_path, data_path);
+    setvbuf(result_store->data, NULL, _IOFBF, STREAM_BUFFER_SIZE);
+
+    result = chunk_reserve(result_store);
+    if (result == BACKUP_SUCCESS) {
+        result = chunk_store_load(result_store);
+    }
+
+cleanup:
+    if (result != BACKUP_SUCCESS) {
+        if (result_store->data != NULL) {
+            fclose(result_store->data);
+        }
+        if (result_store->index != NULL) {
+            fclose(result_store->index);
+        }
+        free(result_store->refs);
+        free(result_store->slots);
+        free(result_store);
+        return result;
+    }
+    *store = result_store;
+    return BACKUP_SUCCESS;
+}
+
+// 辅助函数：rsync弱校验和，a是各字节之和，b是按到窗口末尾的距离加权之和，各取低16位
+static unsigned int chunk_delta_weak(unsigned int a, unsigned int b) {
+    return (a & 0xFFFF) | (b << 16);
+}
+
+// 辅助函数：一个小块的弱校验和的两个部分
+static void chunk_delta_sums(const unsigned char *data, unsigned int *a, unsigned int *b) {
+    *a = 0;
+    *b = 0;
+    for (unsigned int i = 0; i < CHUNK_DELTA_BLOCK_SIZE; i++) {
+        *a += data[i];
+        *b += (CHUNK_DELTA_BLOCK_SIZE - i) * data[i];
+    }
+}
+
+// 辅助函数：签名表的桶
+static unsigned int chunk_delta_bucket(unsigned int weak) {
+    return (weak ^ (weak >> 16)) & (CHUNK_DELTA_BUCKETS - 1);
+}
+
+// 辅助函数：相对于delta_buffer开头的基准块对新块做差异编码，指令和新数据写在基准块之后，
+// 返回编码长度（含头部），超过limit时返回0
+static size_t chunk_delta_encode(ChunkStore *store, size_t base_size, const unsigned char *data, size_t size, size_t limit, unsigned int *op_count) {
+    const unsigned char *base = store->delta_buffer;
+    ChunkDeltaOp *ops = (ChunkDeltaOp *)(store->delta_buffer + CHUNK_MAX_SIZE);
+    unsigned char *literals = store->delta_buffer + CHUNK_MAX_SIZE + CHUNK_MAX_SIZE / 2;
+    int heads[CHUNK_DELTA_BUCKETS];
+    int next[CHUNK_MAX_SIZE / CHUNK_DELTA_BLOCK_SIZE];
+    unsigned int weak[CHUNK_MAX_SIZE / CHUNK_DELTA_BLOCK_SIZE];
+    unsigned int a, b;
+
+    // 签名表：基准块各小块的弱校验和，同一个桶的小块串成链表
+    int block_count = (int)(base_size / CHUNK_DELTA_BLOCK_SIZE);
+    if (block_count == 0 || size < CHUNK_DELTA_BLOCK_SIZE) {
+        return 0;
+    }
+    memset(heads, 0xFF, sizeof(heads));
+    for (int i = block_count - 1; i >= 0; i--) {
+        chunk_delta_sums(base + (size_t)i * CHUNK_DELTA_BLOCK_SIZE, &a, &b);
+        weak[i] = chunk_delta_weak(a, b);
+        next[i] = heads[chunk_delta_bucket(weak[i])];
+        heads[chunk_delta_bucket(weak[i])] = i;
+    }
+
+    // 逐字节滚动：命中时输出之前的新数据和复制指令（与上一条复制指令相邻时合并），跳过整个小块
+    unsigned int count = 0;
+    size_t used = sizeof(ChunkDeltaHeader);
+    size_t literal_size = 0;
+    size_t literal_start = 0;
+    size_t position = 0;
+    chunk_delta_sums(data, &a, &b);
+    while (position + CHUNK_DELTA_BLOCK_SIZE <= size) {
+        unsigned int value = chunk_delta_weak(a, b);
+        int match = heads[chunk_delta_bucket(value)];
+        while (match >= 0 && (weak[match] != value ||
+               memcmp(base + (size_t)match * CHUNK_DELTA_BLOCK_SIZE, data + position, CHUNK_DELTA_BLOCK_SIZE) != 0)) {
+            match = next[match];
+        }
+        if (match < 0) {
+            if (position + CHUNK_DELTA_BLOCK_SIZE < size) {
+                unsigned int out = data[position];
+                a = a - out + data[position + CHUNK_DELTA_BLOCK_SIZE];
+                b = b - CHUNK_DELTA_BLOCK_SIZE * out + a;
+            }
+            position++;
+            continue;
+        }
+
+        if (position > literal_start) {
+            used += sizeof(ChunkDeltaOp) + (position - literal_start);
+            if (used > limit) {
+                return 0;
+            }
+            ops[count].base_offset = CHUNK_DELTA_LITERAL;
+            ops[count].length = (unsigned int)(position - literal_start);
+            memcpy(literals + literal_size, data + literal_start, position - literal_start);
+            literal_size += position - literal_start;
+            count++;
+        }
+        unsigned int offset = (unsigned int)match * CHUNK_DELTA_BLOCK_SIZE;
+        if (count > 0 && ops[count - 1].base_offset != CHUNK_DELTA_LITERAL &&
+            ops[count - 1].base_offset + ops[count - 1].length == offset) {
+            ops[count - 1].length += CHUNK_DELTA_BLOCK_SIZE;
+        } else {
+            used += sizeof(ChunkDeltaOp);
+            if (used > limit) {
+                return 0;
+            }
+            ops[count].base_offset = offset;
+            ops[count].length = CHUNK_DELTA_BLOCK_SIZE;
+            count++;
+        }
+        position += CHUNK_DELTA_BLOCK_SIZE;
+        literal_start = position;
+        if (position + CHUNK_DELTA_BLOCK_SIZE <= size) {
+            chunk_delta_sums(data + position, &a, &b);
+        }
+    }
+
+    // 末尾没有命中的数据
+    if (size > literal_start) {
+        used += sizeof(ChunkDeltaOp) + (size - literal_start);
+        if (used > limit) {
+            return 0;
+        }
+        ops[count].base_offset = CHUNK_DELTA_LITERAL;
+        ops[count].length = (unsigned int)(size - literal_start);
+        memcpy(literals + literal_size, data + literal_start, size - literal_start);
+        count++;
+    }
+    *op_count = count;
+    return used;
+}
+
+// 辅助函数：尝试把新块保存为相对于base的差异块，写入时设置ref->delta_length
+// 基准块不可用（本次才写入、读取失败）或编码超过块长度的一半时不写入，由调用方原样保存
+static BackupResult chunk_store_write_delta(ChunkStore *store, const unsigned char *data, size_t size, const ChunkRef *base, ChunkRef *ref) {
+    if (size < 2 * CHUNK_DELTA_BLOCK_SIZE) {
+        return BACKUP_SUCCESS;
+    }
+    if (store->delta_buffer == NULL) {
+        store->delta_buffer = (unsigned char *)malloc(2 * CHUNK_MAX_SIZE);
+        if (store->delta_buffer == NULL) {
+            return BACKUP_ERROR_MEMORY;
+        }
+    }
+    if (store->reader == NULL) {
+        store->reader = fopen(store->data_path, "rb");
+        if (store->reader == NULL) {
+            return BACKUP_SUCCESS;
+        }
+    }
+
+    // 基准块是差异块时改用它的基准块，基准块总是原样保存的块
+    ChunkDeltaHeader header;
+    header.base_offset = base->offset;
+    header.base_length = base->length;
+    if (base->delta_length > 0) {
+        if (base->offset + sizeof(ChunkDeltaHeader) > store->readable_size ||
+            platform_seek(store->reader, (long long)base->offset, SEEK_SET) != BACKUP_SUCCESS ||
+            fread(&header, sizeof(ChunkDeltaHeader), 1, store->reader) != 1) {
+            return BACKUP_SUCCESS;
+        }
+    }
+    if (header.base_length > CHUNK_MAX_SIZE || header.base_offset > store->readable_size ||
+        header.base_length > store->readable_size - header.base_offset ||
+        platform_seek(store->reader, (long long)header.base_offset, SEEK_SET) != BACKUP_SUCCESS ||
+        fread(store->delta_buffer, 1, header.base_length, store->reader) != header.base_length) {
+        return BACKUP_SUCCESS;
+    }
+
+    size_t length = chunk_delta_encode(store, header.base_length, data, size, size / 2, &header.op_count);
+    if (length == 0) {
+        return BACKUP_SUCCESS;
+    }
+    size_t ops_size = (size_t)header.op_count * sizeof(ChunkDeltaOp);
+    size_t literal_size = length - sizeof(ChunkDeltaHeader) - ops_size;
+    if (fwrite(&header, sizeof(ChunkDeltaHeader), 1, store->data) != 1 ||
+        fwrite(store->delta_buffer + CHUNK_MAX_SIZE, 1, ops_size, store->data) != ops_size ||
+        fwrite(store->delta_buffer + CHUNK_MAX_SIZE + CHUNK_MAX_SIZE / 2, 1, literal_size, store->data) != literal_size) {
+        return BACKUP_ERROR_FILE;
+    }
+    ref->delta_length = (unsigned int)length;
+    return BACKUP_SUCCESS;
+}
+
+// 保存一个块
+BackupResult chunk_store_put(ChunkStore *store, const unsigned char *data, size_t size, const ChunkRef *base, ChunkRef *ref) {
+    memset(ref, 0, sizeof(ChunkRef));
+    sha256(data, size, ref->hash);
+    ref->length = (unsigned int)size;
+    store->stats.chunks++;
+    store->stats.bytes += size;
+
+    BackupResult result = chunk_reserve(store);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+    unsigned int slot = chunk_find_slot(store, ref->hash);
+    if (store->slots[slot] != CHUNK_SLOT_EMPTY) {
+        // 已有的块可能是差异块
+        *ref = store->refs[store->slots[slot]];
+        return BACKUP_SUCCESS;
+    }
+
+    if (base != NULL) {
+        result = chunk_store_write_delta(store, data, size, base, ref);
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+    }
+    unsigned long long stored = size;
+    if (ref->delta_length > 0) {
+        stored = ref->delta_length;
+        store->stats.delta_chunks++;
+        store->stats.delta_bytes += size;
+    } else if (size > 0 && fwrite(data, 1, size, store->data) != size) {
+        return BACKUP_ERROR_FILE;
+    }
+    ref->offset = store->data_size;
+    store->data_size += stored;
+    store->refs[store->count] = *ref;
+    store->slots[slot] = store->count++;
+    store->stats.new_chunks++;
+    store->stats.new_bytes += stored;
+    store->stats.stored_chunks = store->count;
+    return BACKUP_SUCCESS;
+}
+
+// 冲刷块数据并追加新块的索引，然后关闭
+BackupResult chunk_store_close(ChunkStore *store) {
+    if (store == NULL) {
+        return BACKUP_SUCCESS;
+    }
+
+    // 块数据落盘之后才写入引用它们的索引项
+    BackupResult result = BACKUP_SUCCESS;
+    if (fflush(store->data) != 0) {
+        result = BACKUP_ERROR_FILE;
+    }
+    unsigned int pending = store->count - store->committed;
+    if (result == BACKUP_SUCCESS && pending > 0 &&
+        fwrite(store->refs + store->committed, sizeof(ChunkRef), pending, store->index) != pending) {
+        result = BACKUP_ERROR_FILE;
+    }
+    if (fclose(store->index) != 0 && result == BACKUP_SUCCESS) {
+        result = BACKUP_ERROR_FILE;
+    }
+    if (fclose(store->data) != 0 && result == BACKUP_SUCCESS) {
+        result = BACKUP_ERROR_FILE;
+    }
+    if (store->reader != NULL) {
+        fclose(store->reader);
+    }
+
+    free(store->delta_buffer);
+    free(store->refs);
+    free(store->slots);
+    free(store);
+    return result;
+}
+
+// 打开以来的统计
+void chunk_store_get_stats(const ChunkStore *store, ChunkStoreStats *stats) {
+    *stats = store->stats;
+}
+
+// 备份文件所在目录下的chunks.dat路径
+BackupResult chunk_store_data_path(const char *archive_path, char *buffer, size_t size) {
+    const char *separator = strrchr(archive_path, '/');
+#ifdef _WIN32
+    const char *backslash = strrchr(archive_path, '\\');
+    if (separator == NULL || (backslash != NULL && backslash > separator)) {
+        separator = backslash;
+    }
+#endif
+    int length;
+    if (separator == NULL) {
+        length = snprintf(buffer, size, "%s", CHUNK_STORE_DATA_NAME);
+    } else {
+        length = snprintf(buffer, size, "%.*s%s", (int)(separator - archive_path + 1), archive_path, CHUNK_STORE_DATA_NAME);
+    }
+    return (length > 0 && (size_t)length < size) ? BACKUP_SUCCESS : BACKUP_ERROR_PATH;
+}
+
+// 按差异编码还原一块
+BackupResult chunk_delta_apply(const unsigned char *delta, size_t delta_size, const unsigned char *base, size_t base_size, unsigned char *output, size_t length) {
+    ChunkDeltaHeader header;
+    if (delta_size < sizeof(ChunkDeltaHeader)) {
+        return BACKUP_ERROR_PACK;
+    }
+    memcpy(&header, delta, sizeof(ChunkDeltaHeader));
+    if (header.op_count > (delta_size - sizeof(ChunkDeltaHeader)) / sizeof(ChunkDeltaOp)) {
+        return BACKUP_ERROR_PACK;
+    }
+    const unsigned char *op_data = delta + sizeof(ChunkDeltaHeader);
+    const unsigned char *literal = op_data + (size_t)header.op_count * sizeof(ChunkDeltaOp);
+    size_t literal_left = delta_size - (size_t)(literal - delta);
+
+    size_t position = 0;
+    for (unsigned int i = 0; i < header.op_count; i++) {
+        ChunkDeltaOp op;
+        memcpy(&op, op_data + (size_t)i * sizeof(ChunkDeltaOp), sizeof(ChunkDeltaOp));
+        if (op.length > length - position) {
+            return BACKUP_ERROR_PACK;
+        }
+        if (op.base_offset == CHUNK_DELTA_LITERAL) {
+            if (op.length > literal_left) {
+                return BACKUP_ERROR_PACK;
+            }
+            memcpy(output + position, literal, op.length);
+            literal += op.length;
+            literal_left -= op.length;
+        } else {
+            if (op.base_offset > base_size || op.length > base_size - op.base_offset) {
+                return BACKUP_ERROR_PACK;
+            }
+            memcpy(output + position, base + op.base_offset, op.length);
+        }
+        position += op.length;
+    }
+    return (position == length && literal_left == 0) ? BACKUP_SUCCESS : BACKUP_ERROR_PACK;
+}
+
+// 从块数据文件读取一块
+BackupResult chunk_read(FILE *data, const ChunkRef *ref, unsigned char *buffer) {
+    if (ref->length > CHUNK_MAX_SIZE || ref->delta_length > CHUNK_MAX_SIZE) {
+        return BACKUP_ERROR_PACK;
+    }
+    if (ref->delta_length == 0) {
+        if (platform_seek(data, (long long)ref->offset, SEEK_SET) != BACKUP_SUCCESS) {
+            return BACKUP_ERROR_FILE;
+        }
+        return (fread(buffer, 1, ref->length, data) == ref->length) ? BACKUP_SUCCESS : BACKUP_ERROR_PACK;
+    }
+
+    // 差异块：编码和基准块读入缓冲区的后两部分，还原到开头
+    unsigned char *delta = buffer + CHUNK_MAX_SIZE;
+    unsigned char *base = buffer + 2 * CHUNK_MAX_SIZE;
+    ChunkDeltaHeader header;
+    if (platform_seek(data, (long long)ref->offset, SEEK_SET) != BACKUP_SUCCESS) {
+        return BACKUP_ERROR_FILE;
+    }
+    if (ref->delta_length < sizeof(ChunkDeltaHeader) || fread(delta, 1, ref->delta_length, data) != ref->delta_length) {
+        return BACKUP_ERROR_PACK;
+    }
+    memcpy(&header, delta, sizeof(ChunkDeltaHeader));
+    if (header.base_length > CHUNK_MAX_SIZE) {
+        return BACKUP_ERROR_PACK;
+    }
+    if (platform_seek(data, (long long)header.base_offset, SEEK_SET) != BACKUP_SUCCESS) {
+        return BACKUP_ERROR_FILE;
+    }
+    if (fread(base, 1, header.base_length, data) != header.base_length) {
+        return BACKUP_ERROR_PACK;
+    }
+    return chunk_delta_apply(delta, ref->delta_length, base, header.base_length, buffer, ref->length);
+}
+
+// 辅助函数：上一版本中与当前文件[file_offset, file_offset + length)重叠最多的块，没有重叠的块时返回0
+// 当前文件的块按顺序切分，上一版本的块表只需要向前扫描
+static int chunk_writer_base(ChunkWriter *chunker, size_t length, ChunkRef *base) {
+    unsigned long long start = chunker->file_offset;
+    unsigned long long end = start + length;
+    ChunkRef ref;
+    while (chunker->base_index < chunker->base_count) {
+        memcpy(&ref, chunker->base_refs + (size_t)chunker->base_index * sizeof(ChunkRef), sizeof(ChunkRef));
+        if (chunker->base_start + ref.length > start) {
+            break;
+        }
+        chunker->base_start += ref.length;
+        chunker->base_index++;
+    }
+
+    unsigned long long best = 0;
+    unsigned long long position = chunker->base_start;
+    for (unsigned int i = chunker->base_index; i < chunker->base_count && position < end; i++) {
+        memcpy(&ref, chunker->base_refs + (size_t)i * sizeof(ChunkRef), sizeof(ChunkRef));
+        unsigned long long overlap_start = (position > start) ? position : start;
+        unsigned long long overlap_end = (position + ref.length < end) ? position + ref.length : end;
+        if (overlap_end > overlap_start && overlap_end - overlap_start > best) {
+            best = overlap_end - overlap_start;
+            *base = ref;
+        }
+        position += ref.length;
+    }
+    return best > 0;
+}
+
+// 辅助函数：切下缓冲区开头的一块存入仓库，记录其引用
+static BackupResult chunk_writer_emit(ChunkWriter *chunker, size_t length) {
+    if (chunker->ref_count == chunker->ref_capacity) {
+        unsigned int capacity = (chunker->ref_capacity > 0) ? chunker->ref_capacity * 2 : 64;
+        ChunkRef *refs = (ChunkRef *)realloc(chunker->refs, (size_t)capacity * sizeof(ChunkRef));
+        if (refs == NULL) {
+            return BACKUP_ERROR_MEMORY;
+        }
+        chunker->refs = refs;
+        chunker->ref_capacity = capacity;
+    }
+
+    ChunkRef base;
+    int has_base = chunker->base_refs != NULL && chunk_writer_base(chunker, length, &base);
+    BackupResult result = chunk_store_put(chunker->store, chunker->buffer, length, has_base ? &base : NULL, &chunker->refs[chunker->ref_count]);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+    chunker->ref_count++;
+    chunker->file_offset += length;
+    chunker->buffer_len -= length;
+    memmove(chunker->buffer, chunker->buffer + length, chunker->buffer_len);
+    return BACKUP_SUCCESS;
+}
+
+// 分块写入端：缓冲区满（达到最大块长度）时才切分，保证切分点只取决于内容
+static BackupResult chunk_writer_write(ByteWriter *writer, const unsigned char *data, size_t size) {
+    ChunkWriter *chunker = (ChunkWriter *)writer;
+
+    while (size > 0) {
+        size_t chunk = CHUNK_MAX_SIZE - chunker->buffer_len;
+        if (chunk > size) {
+            chunk = size;
+        }
+        memcpy(chunker->buffer + chunker->buffer_len, data, chunk);
+        chunker->buffer_len += chunk;
+        data += chunk;
+        size -= chunk;
+
+        if (chunker->buffer_len == CHUNK_MAX_SIZE) {
+            BackupResult result = chunk_writer_emit(chunker, chunk_cut(chunker->buffer, chunker->buffer_len));
+            if (result != BACKUP_SUCCESS) {
+                return result;
+            }
+        }
+    }
+    return BACKUP_SUCCESS;
+}
+
+// 分块写入端：结束当前文件，剩余的数据依次切分
+static BackupResult chunk_writer_finish(ByteWriter *writer) {
+    ChunkWriter *chunker = (ChunkWriter *)writer;
+
+    while (chunker->buffer_len > 0) {
+        BackupResult result = chunk_writer_emit(chunker, chunk_cut(chunker->buffer, chunker->buffer_len));
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+    }
+    chunk_writer_set_base(writer, NULL, 0);
+    return BACKUP_SUCCESS;
+}
+
+// 分块写入端：释放资源（不关闭仓库）
+static void chunk_writer_destroy(ByteWriter *writer) {
+    ChunkWriter *chunker = (ChunkWriter *)writer;
+    free(chunker->buffer);
+    free(chunker->refs);
+    free(chunker);
+}
+
+// 创建分块写入端
+ByteWriter *chunk_writer_create(ChunkStore *store) {
+    if (store == NULL) {
+        return NULL;
+    }
+
+    ChunkWriter *chunker = (ChunkWriter *)calloc(1, sizeof(ChunkWriter));
+    if (chunker == NULL) {
+        return NULL;
+    }
+    chunker->buffer = (unsigned char *)malloc(CHUNK_MAX_SIZE);
+    if (chunker->buffer == NULL) {
+        free(chunker);
+        return NULL;
+    }
+    chunker->store = store;
+    chunker->base.write = chunk_writer_write;
+    chunker->base.finish = chunk_writer_finish;
+    chunker->base.destroy = chunk_writer_destroy;
+    chunker->base.next = NULL;
+    return &chunker->base;
+}
+
+// 设置当前文件上一版本的块引用表
+void chunk_writer_set_base(ByteWriter *writer, const void *refs, unsigned int count) {
+    ChunkWriter *chunker = (ChunkWriter *)writer;
+    chunker->base_refs = (const unsigned char *)refs;
+    chunker->base_count = count;
+    chunker->base_index = 0;
+    chunker->base_start = 0;
+    chunker->file_offset = 0;
+}
+
+// 已完成的块引用
+const ChunkRef *chunk_writer_refs(ByteWriter *writer, unsigned int *count) {
+    ChunkWriter *chunker = (ChunkWriter *)writer;
+    *count = chunker->ref_count;
+    return chunker->refs;
+}
+
+// 清空已完成的块引用
+void chunk_writer_reset(ByteWriter *writer) {
+    ChunkWriter *chunker = (ChunkWriter *)writer;
+    chunker->ref_count = 0;
+}
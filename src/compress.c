@@ -4,13 +4,44 @@
 #include "compress.h"
 #include "types.h"
 
+// 辅助函数：初始化压缩文件头部
+static void init_compress_header(CompressHeader *header, CompressAlgorithm algorithm) {
+    memset(header, 0, sizeof(CompressHeader));
+    header->magic[0] = 'C';
+    header->magic[1] = 'O';
+    header->magic[2] = 'M';
+    header->magic[3] = 'P';
+    header->version = COMPRESS_VERSION_STREAM;
+    header->algorithm = algorithm;
+    header->original_size = 0;
+    header->compressed_size = 0;
+}
+
+// 压缩数据流：写入压缩文件头部和压缩数据
+BackupResult compress_stream(ByteReader *input, ByteWriter *output, CompressAlgorithm algorithm) {
+    if (input == NULL || output == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    return stream_transform(input, compress_writer_create(algorithm, output), output);
+}
+
+// 解压数据流：根据压缩文件头部自动选择解码算法
+BackupResult decompress_stream(ByteReader *input, ByteWriter *output) {
+    if (input == NULL || output == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    return stream_transform(input, decompress_writer_create(output, NULL), output);
+}
+
 // 压缩文件
 BackupResult compress_file(const char *input_path, const char *output_path, CompressAlgorithm algorithm) {
     FILE *input_fp = NULL;
     FILE *output_fp = NULL;
     CompressHeader header;
-    long original_size;
-    long compressed_size;
+    ByteReader *input = NULL;
+    ByteWriter *output = NULL;
     BackupResult result = BACKUP_SUCCESS;
 
     // 检查参数
@@ -31,57 +62,23 @@ BackupResult compress_file(const char *input_path, const char *output_path, Comp
         return BACKUP_ERROR_FILE;
     }
 
-    // 获取原始文件大小
-    fseek(input_fp, 0, SEEK_END);
-    original_size = ftell(input_fp);
-    fseek(input_fp, 0, SEEK_SET);
-
-    // 写入压缩文件头部（初始版本）
-    header.magic[0] = 'C';
-    header.magic[1] = 'O';
-    header.magic[2] = 'M';
-    header.magic[3] = 'P';
-    header.version = 1;
-    header.algorithm = algorithm;
-    header.original_size = (unsigned long)original_size;
-    header.compressed_size = 0; // 后续更新
-
-    if (write_compress_header(output_fp, &header) != BACKUP_SUCCESS) {
-        result = BACKUP_ERROR_COMPRESS;
+    input = file_reader_create(input_fp);
+    output = file_writer_create(output_fp);
+    if (input == NULL || output == NULL) {
+        result = BACKUP_ERROR_MEMORY;
         goto cleanup;
     }
 
-    // 根据算法进行压缩
-    switch (algorithm) {
-        case COMPRESS_ALGORITHM_HAFF:
-            result = huffman_compress(input_fp, output_fp);
-            break;
-        case COMPRESS_ALGORITHM_LZ77:
-            result = lz77_compress(input_fp, output_fp);
-            break;
-        default:
-            {
-                // 不压缩，直接复制文件
-                char buffer[4096];
-                size_t bytes_read, bytes_written;
-                while ((bytes_read = fread(buffer, 1, sizeof(buffer), input_fp)) > 0) {
-                    bytes_written = fwrite(buffer, 1, bytes_read, output_fp);
-                    if (bytes_written != bytes_read) {
-                        result = BACKUP_ERROR_FILE;
-                        goto cleanup;
-                    }
-                }
-            }
-            break;
-    }
-
+    // 压缩数据
+    result = compress_stream(input, output, algorithm);
     if (result != BACKUP_SUCCESS) {
         goto cleanup;
     }
 
-    // 更新压缩后文件大小
-    compressed_size = ftell(output_fp);
-    header.compressed_size = (unsigned long)(compressed_size - sizeof(CompressHeader));
+    // 输出是普通文件，可以回填原始大小和压缩后大小
+    init_compress_header(&header, algorithm);
+    header.original_size = (unsigned long)ftell(input_fp);
+    header.compressed_size = (unsigned long)(ftell(output_fp) - sizeof(CompressHeader));
 
     // 重新写入压缩文件头部
     fseek(output_fp, 0, SEEK_SET);
@@ -91,6 +88,8 @@ BackupResult compress_file(const char *input_path, const char *output_path, Comp
     }
 
 cleanup:
+    reader_destroy(input);
+    stream_destroy(output);
     fclose(input_fp);
     fclose(output_fp);
     return result;
@@ -101,6 +100,8 @@ BackupResult decompress_file(const char *input_path, const char *output_path, Co
     FILE *input_fp = NULL;
     FILE *output_fp = NULL;
     CompressHeader header;
+    ByteReader *input = NULL;
+    ByteWriter *output = NULL;
     BackupResult result = BACKUP_SUCCESS;
 
     // 检查参数
@@ -133,31 +134,46 @@ BackupResult decompress_file(const char *input_path, const char *output_path, Co
         goto cleanup;
     }
 
-    // 根据算法进行解压
-    switch (header.algorithm) {
-        case COMPRESS_ALGORITHM_HAFF:
-            result = huffman_decompress(input_fp, output_fp);
-            break;
-        case COMPRESS_ALGORITHM_LZ77:
-            result = lz77_decompress(input_fp, output_fp);
-            break;
-        default:
-            {
-                // 不压缩，直接复制文件
-                char buffer[4096];
-                size_t bytes_read, bytes_written;
-                while ((bytes_read = fread(buffer, 1, sizeof(buffer), input_fp)) > 0) {
-                    bytes_written = fwrite(buffer, 1, bytes_read, output_fp);
-                    if (bytes_written != bytes_read) {
-                        result = BACKUP_ERROR_FILE;
-                        goto cleanup;
+    // 版本1格式使用整文件解码
+    if (header.version == COMPRESS_VERSION_LEGACY) {
+        switch (header.algorithm) {
+            case COMPRESS_ALGORITHM_HAFF:
+                result = huffman_decompress_legacy(input_fp, output_fp);
+                break;
+            case COMPRESS_ALGORITHM_LZ77:
+                result = lz77_decompress_legacy(input_fp, output_fp);
+                break;
+            default:
+                {
+                    // 不压缩，直接复制文件
+                    char buffer[4096];
+                    size_t bytes_read, bytes_written;
+                    while ((bytes_read = fread(buffer, 1, sizeof(buffer), input_fp)) > 0) {
+                        bytes_written = fwrite(buffer, 1, bytes_read, output_fp);
+                        if (bytes_written != bytes_read) {
+                            result = BACKUP_ERROR_FILE;
+                            goto cleanup;
+                        }
                     }
                 }
-            }
-            break;
+                break;
+        }
+        goto cleanup;
+    }
+
+    // 版本2格式从头部开始交给解压处理阶段
+    fseek(input_fp, 0, SEEK_SET);
+    input = file_reader_create(input_fp);
+    output = file_writer_create(output_fp);
+    if (input == NULL || output == NULL) {
+        result = BACKUP_ERROR_MEMORY;
+        goto cleanup;
     }
+    result = decompress_stream(input, output);
 
 cleanup:
+    reader_destroy(input);
+    stream_destroy(output);
     fclose(input_fp);
     fclose(output_fp);
     return result;
@@ -193,113 +209,11 @@ BackupResult read_compress_header(FILE *fp, CompressHeader *header) {
 
 // LZ77压缩算法的配置
 #define LZ77_WINDOW_SIZE 4096   // 滑动窗口大小
-#define LZ77_LOOKAHEAD_SIZE 18  // 前瞻缓冲区大小
 #define LZ77_MIN_MATCH_LENGTH 3  // 最小匹配长度
 #define LZ77_MAX_MATCH_LENGTH 18 // 最大匹配长度
 
-// LZ77压缩实现
-BackupResult lz77_compress(FILE *input_fp, FILE *output_fp) {
-    unsigned char window[LZ77_WINDOW_SIZE] = {0}; // 滑动窗口
-    unsigned char lookahead[LZ77_LOOKAHEAD_SIZE]; // 前瞻缓冲区
-    int window_pos = 0; // 窗口当前位置
-    int lookahead_pos = 0; // 前瞻缓冲区当前位置
-    int lookahead_size = 0; // 前瞻缓冲区中有效数据的大小
-    size_t bytes_read, bytes_written;
-    int i;
-    
-    // 初始化前瞻缓冲区
-    lookahead_size = fread(lookahead, 1, LZ77_LOOKAHEAD_SIZE, input_fp);
-    if (lookahead_size == 0) {
-        return BACKUP_SUCCESS;
-    }
-    
-    // 开始压缩
-    while (lookahead_pos < lookahead_size) {
-        unsigned short best_offset = 0; // 最佳匹配偏移量，使用unsigned short确保2字节
-        int best_length = 0; // 最佳匹配长度
-        
-        // 在滑动窗口中搜索最佳匹配
-        for (i = 0; i < window_pos; i++) {
-            int match_len = 0; // 当前匹配长度
-            
-            // 比较滑动窗口和前瞻缓冲区
-            while (match_len < lookahead_size - lookahead_pos && 
-                   i + match_len < window_pos && 
-                   window[i + match_len] == lookahead[lookahead_pos + match_len]) {
-                match_len++;
-            }
-            
-            // 更新最佳匹配
-            if (match_len >= LZ77_MIN_MATCH_LENGTH && match_len > best_length) {
-                best_offset = window_pos - i;
-                best_length = match_len;
-                
-                // 如果找到最大可能匹配，提前结束搜索
-                if (match_len == LZ77_MAX_MATCH_LENGTH) {
-                    break;
-                }
-            }
-        }
-        
-        if (best_length >= LZ77_MIN_MATCH_LENGTH) {
-            // 写入匹配标记
-            unsigned char token = 0x80 | best_length;
-            bytes_written = fwrite(&token, 1, 1, output_fp);
-            if (bytes_written != 1) return BACKUP_ERROR_FILE;
-            
-            // 写入偏移量，确保写入2字节
-            bytes_written = fwrite(&best_offset, sizeof(unsigned short), 1, output_fp);
-            if (bytes_written != 1) return BACKUP_ERROR_FILE;
-            
-            // 将匹配的数据从前瞻缓冲区复制到滑动窗口
-            for (i = 0; i < best_length; i++) {
-                if (window_pos < LZ77_WINDOW_SIZE) {
-                    window[window_pos++] = lookahead[lookahead_pos + i];
-                } else {
-                    // 窗口已满，滑动窗口
-                    memmove(window, window + 1, LZ77_WINDOW_SIZE - 1);
-                    window[LZ77_WINDOW_SIZE - 1] = lookahead[lookahead_pos + i];
-                }
-            }
-            
-            // 更新前瞻缓冲区位置
-            lookahead_pos += best_length;
-        } else {
-            // 写入字面量
-            unsigned char c = lookahead[lookahead_pos];
-            bytes_written = fwrite(&c, 1, 1, output_fp);
-            if (bytes_written != 1) return BACKUP_ERROR_FILE;
-            
-            // 将字面量添加到滑动窗口
-            if (window_pos < LZ77_WINDOW_SIZE) {
-                window[window_pos++] = c;
-            } else {
-                // 窗口已满，滑动窗口
-                memmove(window, window + 1, LZ77_WINDOW_SIZE - 1);
-                window[LZ77_WINDOW_SIZE - 1] = c;
-            }
-            
-            // 更新前瞻缓冲区位置
-            lookahead_pos++;
-        }
-        
-        // 重新填充前瞻缓冲区
-        if (lookahead_pos > lookahead_size - LZ77_MAX_MATCH_LENGTH) {
-            // 将未处理的数据移到缓冲区开头
-            memmove(lookahead, lookahead + lookahead_pos, lookahead_size - lookahead_pos);
-            
-            // 读取更多数据
-            bytes_read = fread(lookahead + lookahead_size - lookahead_pos, 1, lookahead_pos, input_fp);
-            lookahead_size = (lookahead_size - lookahead_pos) + bytes_read;
-            lookahead_pos = 0;
-        }
-    }
-    
-    return BACKUP_SUCCESS;
-}
-
-// LZ77解压实现
-BackupResult lz77_decompress(FILE *input_fp, FILE *output_fp) {
+// LZ77解压实现（版本1格式）
+BackupResult lz77_decompress_legacy(FILE *input_fp, FILE *output_fp) {
     unsigned char window[LZ77_WINDOW_SIZE] = {0}; // 滑动窗口
     int window_pos = 0; // 窗口当前位置
     size_t bytes_read, bytes_written;
@@ -371,3 +285,568 @@ BackupResult lz77_decompress(FILE *input_fp, FILE *output_fp) {
     
     return BACKUP_SUCCESS;
 }
+
+
+// LZ77流式编码的配置（版本2格式）
+// 每8个编码项前有一个标志字节，标志位为1表示匹配项（2字节：12位偏移量和4位长度），为0表示1字节字面量
+#define LZ77_HASH_BITS 12
+#define LZ77_HASH_SIZE (1 << LZ77_HASH_BITS)
+#define LZ77_MAX_CHAIN 32       // 哈希链最大搜索次数
+#define LZ77_INPUT_SIZE (STREAM_BUFFER_SIZE + LZ77_WINDOW_SIZE)
+#define LZ77_GROUP_SIZE (1 + 8 * 2) // 标志字节加8个匹配项
+
+// LZ77流式编码阶段
+typedef struct {
+    ByteWriter base;
+    unsigned char input[LZ77_INPUT_SIZE]; // 输入缓冲区，前部保留滑动窗口历史数据
+    size_t input_len;                     // 输入缓冲区中的数据量
+    size_t input_pos;                     // 当前编码位置
+    long long input_base;                 // input[0]在整个流中的绝对位置
+    long long head[LZ77_HASH_SIZE];       // 哈希表：每个哈希值最近出现的绝对位置
+    long long prev[LZ77_WINDOW_SIZE];     // 哈希链：同一哈希值的上一个位置
+    unsigned char group[LZ77_GROUP_SIZE]; // 当前编码组
+    int group_len;
+    int group_items;
+    unsigned char output[STREAM_BUFFER_SIZE];
+    size_t output_len;
+} Lz77Encoder;
+
+// LZ77流式解码阶段
+typedef struct {
+    ByteWriter base;
+    unsigned char window[LZ77_WINDOW_SIZE]; // 环形滑动窗口
+    unsigned long long total;               // 已解码的字节数
+    unsigned char pending[LZ77_GROUP_SIZE]; // 跨写入调用的不完整编码组
+    size_t pending_len;
+    unsigned char output[STREAM_BUFFER_SIZE];
+    size_t output_len;
+} Lz77Decoder;
+
+// 计算3字节前缀的哈希值
+static unsigned int lz77_hash(const unsigned char *data) {
+    unsigned int value = ((unsigned int)data[0] << 16) | ((unsigned int)data[1] << 8) | data[2];
+    return (value * 2654435761u) >> (32 - LZ77_HASH_BITS);
+}
+
+// 将输出缓冲区写入下游
+static BackupResult lz77_flush_output(ByteWriter *next, unsigned char *output, size_t *output_len) {
+    if (*output_len == 0) {
+        return BACKUP_SUCCESS;
+    }
+
+    BackupResult result = stream_write(next, output, *output_len);
+    *output_len = 0;
+    return result;
+}
+
+// 将当前编码组写入输出缓冲区
+static BackupResult lz77_flush_group(Lz77Encoder *encoder) {
+    if (encoder->group_items == 0) {
+        return BACKUP_SUCCESS;
+    }
+
+    if (encoder->output_len + encoder->group_len > sizeof(encoder->output)) {
+        BackupResult result = lz77_flush_output(encoder->base.next, encoder->output, &encoder->output_len);
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+    }
+
+    memcpy(encoder->output + encoder->output_len, encoder->group, encoder->group_len);
+    encoder->output_len += encoder->group_len;
+    encoder->group[0] = 0;
+    encoder->group_len = 1;
+    encoder->group_items = 0;
+    return BACKUP_SUCCESS;
+}
+
+// 输出一个编码项（length为0表示字面量）
+static BackupResult lz77_emit(Lz77Encoder *encoder, unsigned char literal, unsigned int offset, int length) {
+    if (length >= LZ77_MIN_MATCH_LENGTH) {
+        encoder->group[0] |= (unsigned char)(1 << encoder->group_items);
+        encoder->group[encoder->group_len++] = (unsigned char)(offset & 0xFF);
+        encoder->group[encoder->group_len++] = (unsigned char)(((offset >> 8) << 4) | (length - LZ77_MIN_MATCH_LENGTH));
+    } else {
+        encoder->group[encoder->group_len++] = literal;
+    }
+
+    encoder->group_items++;
+    if (encoder->group_items == 8) {
+        return lz77_flush_group(encoder);
+    }
+    return BACKUP_SUCCESS;
+}
+
+// 编码输入缓冲区中的数据，非结束状态下保留最大匹配长度的数据等待后续输入
+static BackupResult lz77_encode(Lz77Encoder *encoder, int final) {
+    size_t limit = encoder->input_len;
+    if (!final) {
+        limit = (encoder->input_len > LZ77_MAX_MATCH_LENGTH) ? encoder->input_len - LZ77_MAX_MATCH_LENGTH : 0;
+    }
+
+    while (encoder->input_pos < limit) {
+        size_t pos = encoder->input_pos;
+        size_t avail = encoder->input_len - pos;
+        int max_length = (avail < LZ77_MAX_MATCH_LENGTH) ? (int)avail : LZ77_MAX_MATCH_LENGTH;
+        long long abs_pos = encoder->input_base + (long long)pos;
+        const unsigned char *current = encoder->input + pos;
+        int best_length = 0;
+        unsigned int best_offset = 0;
+
+        // 沿哈希链在滑动窗口中搜索最长匹配
+        if (max_length >= LZ77_MIN_MATCH_LENGTH) {
+            long long candidate = encoder->head[lz77_hash(current)];
+            int chain = LZ77_MAX_CHAIN;
+            while (candidate >= 0 && abs_pos - candidate < LZ77_WINDOW_SIZE && chain-- > 0) {
+                const unsigned char *match = encoder->input + (candidate - encoder->input_base);
+                int length = 0;
+                while (length < max_length && match[length] == current[length]) {
+                    length++;
+                }
+                if (length > best_length) {
+                    best_length = length;
+                    best_offset = (unsigned int)(abs_pos - candidate);
+                    if (length == max_length) {
+                        break;
+                    }
+                }
+
+                long long previous = encoder->prev[candidate & (LZ77_WINDOW_SIZE - 1)];
+                if (previous >= candidate) {
+                    break;
+                }
+                candidate = previous;
+            }
+        }
+
+        int step = 1;
+        BackupResult result;
+        if (best_length >= LZ77_MIN_MATCH_LENGTH) {
+            result = lz77_emit(encoder, 0, best_offset, best_length);
+            step = best_length;
+        } else {
+            result = lz77_emit(encoder, *current, 0, 0);
+        }
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+
+        // 将已编码的位置加入哈希链
+        for (int i = 0; i < step; i++) {
+            size_t p = pos + i;
+            if (p + LZ77_MIN_MATCH_LENGTH <= encoder->input_len) {
+                unsigned int hash = lz77_hash(encoder->input + p);
+                long long abs_p = encoder->input_base + (long long)p;
+                encoder->prev[abs_p & (LZ77_WINDOW_SIZE - 1)] = encoder->head[hash];
+                encoder->head[hash] = abs_p;
+            }
+        }
+        encoder->input_pos += step;
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+// LZ77编码阶段：写入数据
+static BackupResult lz77_encoder_write(ByteWriter *writer, const unsigned char *data, size_t size) {
+    Lz77Encoder *encoder = (Lz77Encoder *)writer;
+
+    while (size > 0) {
+        if (encoder->input_len == LZ77_INPUT_SIZE) {
+            BackupResult result = lz77_encode(encoder, 0);
+            if (result != BACKUP_SUCCESS) {
+                return result;
+            }
+
+            // 只保留滑动窗口大小的历史数据
+            size_t shift = (encoder->input_pos > LZ77_WINDOW_SIZE) ? encoder->input_pos - LZ77_WINDOW_SIZE : 0;
+            memmove(encoder->input, encoder->input + shift, encoder->input_len - shift);
+            encoder->input_len -= shift;
+            encoder->input_pos -= shift;
+            encoder->input_base += (long long)shift;
+        }
+
+        size_t space = LZ77_INPUT_SIZE - encoder->input_len;
+        size_t chunk = (size < space) ? size : space;
+        memcpy(encoder->input + encoder->input_len, data, chunk);
+        encoder->input_len += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+// LZ77编码阶段：编码剩余数据
+static BackupResult lz77_encoder_finish(ByteWriter *writer) {
+    Lz77Encoder *encoder = (Lz77Encoder *)writer;
+
+    BackupResult result = lz77_encode(encoder, 1);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+
+    result = lz77_flush_group(encoder);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+
+    return lz77_flush_output(encoder->base.next, encoder->output, &encoder->output_len);
+}
+
+// 创建LZ77编码阶段
+ByteWriter *lz77_encoder_create(ByteWriter *next) {
+    Lz77Encoder *encoder = (Lz77Encoder *)calloc(1, sizeof(Lz77Encoder));
+    if (encoder == NULL) {
+        return NULL;
+    }
+
+    encoder->base.write = lz77_encoder_write;
+    encoder->base.finish = lz77_encoder_finish;
+    encoder->base.destroy = NULL;
+    encoder->base.next = next;
+    for (int i = 0; i < LZ77_HASH_SIZE; i++) {
+        encoder->head[i] = -1;
+    }
+    encoder->group_len = 1;
+
+    return &encoder->base;
+}
+
+// 输出一个解码后的字节
+static BackupResult lz77_decoder_put(Lz77Decoder *decoder, unsigned char c) {
+    decoder->window[decoder->total & (LZ77_WINDOW_SIZE - 1)] = c;
+    decoder->total++;
+    decoder->output[decoder->output_len++] = c;
+
+    if (decoder->output_len == sizeof(decoder->output)) {
+        return lz77_flush_output(decoder->base.next, decoder->output, &decoder->output_len);
+    }
+    return BACKUP_SUCCESS;
+}
+
+// 计算编码组的完整长度
+static size_t lz77_group_size(unsigned char flag) {
+    size_t size = 1;
+    for (int i = 0; i < 8; i++) {
+        size += (flag & (1 << i)) ? 2 : 1;
+    }
+    return size;
+}
+
+// 解码一个编码组，流末尾的编码组可以不足8项
+static BackupResult lz77_decode_group(Lz77Decoder *decoder, const unsigned char *group, size_t size) {
+    unsigned char flag = group[0];
+    size_t pos = 1;
+    BackupResult result;
+
+    for (int i = 0; i < 8 && pos < size; i++) {
+        if (flag & (1 << i)) {
+            if (pos + 2 > size) {
+                return BACKUP_ERROR_COMPRESS;
+            }
+
+            unsigned int offset = group[pos] | ((unsigned int)(group[pos + 1] >> 4) << 8);
+            int length = (group[pos + 1] & 0x0F) + LZ77_MIN_MATCH_LENGTH;
+            pos += 2;
+            if (offset == 0 || offset > decoder->total) {
+                return BACKUP_ERROR_COMPRESS;
+            }
+
+            for (int j = 0; j < length; j++) {
+                result = lz77_decoder_put(decoder, decoder->window[(decoder->total - offset) & (LZ77_WINDOW_SIZE - 1)]);
+                if (result != BACKUP_SUCCESS) {
+                    return result;
+                }
+            }
+        } else {
+            result = lz77_decoder_put(decoder, group[pos++]);
+            if (result != BACKUP_SUCCESS) {
+                return result;
+            }
+        }
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+// LZ77解码阶段：写入压缩数据
+static BackupResult lz77_decoder_write(ByteWriter *writer, const unsigned char *data, size_t size) {
+    Lz77Decoder *decoder = (Lz77Decoder *)writer;
+    BackupResult result;
+
+    // 先补全上次遗留的不完整编码组
+    if (decoder->pending_len > 0) {
+        size_t need = lz77_group_size(decoder->pending[0]) - decoder->pending_len;
+        size_t chunk = (size < need) ? size : need;
+        memcpy(decoder->pending + decoder->pending_len, data, chunk);
+        decoder->pending_len += chunk;
+        data += chunk;
+        size -= chunk;
+        if (chunk < need) {
+            return BACKUP_SUCCESS;
+        }
+
+        result = lz77_decode_group(decoder, decoder->pending, decoder->pending_len);
+        decoder->pending_len = 0;
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+    }
+
+    // 直接解码输入中的完整编码组
+    while (size > 0) {
+        size_t group_size = lz77_group_size(data[0]);
+        if (size < group_size) {
+            memcpy(decoder->pending, data, size);
+            decoder->pending_len = size;
+            break;
+        }
+
+        result = lz77_decode_group(decoder, data, group_size);
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+        data += group_size;
+        size -= group_size;
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+// LZ77解码阶段：解码末尾的编码组
+static BackupResult lz77_decoder_finish(ByteWriter *writer) {
+    Lz77Decoder *decoder = (Lz77Decoder *)writer;
+
+    if (decoder->pending_len > 0) {
+        BackupResult result = lz77_decode_group(decoder, decoder->pending, decoder->pending_len);
+        decoder->pending_len = 0;
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+    }
+
+    return lz77_flush_output(decoder->base.next, decoder->output, &decoder->output_len);
+}
+
+// 创建LZ77解码阶段
+ByteWriter *lz77_decoder_create(ByteWriter *next) {
+    Lz77Decoder *decoder = (Lz77Decoder *)calloc(1, sizeof(Lz77Decoder));
+    if (decoder == NULL) {
+        return NULL;
+    }
+
+    decoder->base.write = lz77_decoder_write;
+    decoder->base.finish = lz77_decoder_finish;
+    decoder->base.destroy = NULL;
+    decoder->base.next = next;
+
+    return &decoder->base;
+}
+
+// LZ77压缩数据流（不含压缩文件头部）
+BackupResult lz77_compress_stream(ByteReader *input, ByteWriter *output) {
+    return stream_transform(input, lz77_encoder_create(output), output);
+}
+
+// LZ77解压数据流（不含压缩文件头部）
+BackupResult lz77_decompress_stream(ByteReader *input, ByteWriter *output) {
+    return stream_transform(input, lz77_decoder_create(output), output);
+}
+
+// LZ77压缩实现
+BackupResult lz77_compress(FILE *input_fp, FILE *output_fp) {
+    ByteReader *input = file_reader_create(input_fp);
+    ByteWriter *output = file_writer_create(output_fp);
+    BackupResult result = (input != NULL && output != NULL) ? lz77_compress_stream(input, output) : BACKUP_ERROR_MEMORY;
+
+    reader_destroy(input);
+    stream_destroy(output);
+    return result;
+}
+
+// LZ77解压实现
+BackupResult lz77_decompress(FILE *input_fp, FILE *output_fp) {
+    ByteReader *input = file_reader_create(input_fp);
+    ByteWriter *output = file_writer_create(output_fp);
+    BackupResult result = (input != NULL && output != NULL) ? lz77_decompress_stream(input, output) : BACKUP_ERROR_MEMORY;
+
+    reader_destroy(input);
+    stream_destroy(output);
+    return result;
+}
+
+// 创建压缩处理阶段：先向下游写入版本2格式的压缩文件头部，再返回对应算法的编码阶段
+ByteWriter *compress_writer_create(CompressAlgorithm algorithm, ByteWriter *next) {
+    CompressHeader header;
+    ByteWriter *encoder = NULL;
+
+    if (next == NULL) {
+        return NULL;
+    }
+
+    switch (algorithm) {
+        case COMPRESS_ALGORITHM_NONE:
+            // 不压缩，头部之后直接写入原始数据
+            encoder = next;
+            break;
+        case COMPRESS_ALGORITHM_HAFF:
+            encoder = huffman_encoder_create(next);
+            break;
+        case COMPRESS_ALGORITHM_LZ77:
+            encoder = lz77_encoder_create(next);
+            break;
+        default:
+            return NULL;
+    }
+    if (encoder == NULL) {
+        return NULL;
+    }
+
+    // 流式写入时原始大小和压缩后大小都未知，记为0
+    init_compress_header(&header, algorithm);
+
+    if (stream_write(next, &header, sizeof(CompressHeader)) != BACKUP_SUCCESS) {
+        if (encoder != next) {
+            encoder->next = NULL;
+            stream_destroy(encoder);
+        }
+        return NULL;
+    }
+
+    return encoder;
+}
+
+// 自动识别的解压处理阶段
+typedef struct {
+    ByteWriter base;
+    unsigned char header[sizeof(CompressHeader)]; // 头部缓冲区
+    size_t header_len;
+    int resolved;                 // 是否已识别数据格式
+    ByteWriter *decoder;          // 识别出的解码阶段，直通时为NULL
+    int *legacy_format;           // 遇到版本1格式时置1
+} DecompressWriter;
+
+// 根据头部识别数据格式：版本2压缩数据交给解码阶段，非压缩数据原样直通
+static BackupResult decompress_writer_resolve(DecompressWriter *writer) {
+    CompressHeader header;
+
+    writer->resolved = 1;
+    if (writer->header_len < sizeof(CompressHeader)) {
+        return stream_write(writer->base.next, writer->header, writer->header_len);
+    }
+
+    memcpy(&header, writer->header, sizeof(CompressHeader));
+    if (memcmp(header.magic, "COMP", 4) != 0) {
+        return stream_write(writer->base.next, writer->header, writer->header_len);
+    }
+
+    // 版本1格式需要整文件读取，无法在处理链中解码
+    if (header.version != COMPRESS_VERSION_STREAM) {
+        if (writer->legacy_format != NULL) {
+            *writer->legacy_format = 1;
+        }
+        return BACKUP_ERROR_COMPRESS;
+    }
+
+    switch (header.algorithm) {
+        case COMPRESS_ALGORITHM_NONE:
+            // 未压缩的数据直接写入下游
+            return BACKUP_SUCCESS;
+        case COMPRESS_ALGORITHM_HAFF:
+            writer->decoder = huffman_decoder_create(writer->base.next);
+            break;
+        case COMPRESS_ALGORITHM_LZ77:
+            writer->decoder = lz77_decoder_create(writer->base.next);
+            break;
+        default:
+            return BACKUP_ERROR_COMPRESS;
+    }
+    if (writer->decoder == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+// 自动识别的解压阶段：写入数据
+static BackupResult decompress_writer_write(ByteWriter *writer, const unsigned char *data, size_t size) {
+    DecompressWriter *decompress = (DecompressWriter *)writer;
+
+    if (!decompress->resolved) {
+        size_t need = sizeof(CompressHeader) - decompress->header_len;
+        size_t chunk = (size < need) ? size : need;
+        memcpy(decompress->header + decompress->header_len, data, chunk);
+        decompress->header_len += chunk;
+        data += chunk;
+        size -= chunk;
+        if (decompress->header_len < sizeof(CompressHeader)) {
+            return BACKUP_SUCCESS;
+        }
+
+        BackupResult result = decompress_writer_resolve(decompress);
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+    }
+
+    if (size == 0) {
+        return BACKUP_SUCCESS;
+    }
+    if (decompress->decoder != NULL) {
+        return stream_write(decompress->decoder, data, size);
+    }
+    return stream_write(decompress->base.next, data, size);
+}
+
+// 自动识别的解压阶段：冲刷解码阶段
+static BackupResult decompress_writer_finish(ByteWriter *writer) {
+    DecompressWriter *decompress = (DecompressWriter *)writer;
+
+    // 数据不足一个头部时按非压缩数据处理
+    if (!decompress->resolved) {
+        BackupResult result = decompress_writer_resolve(decompress);
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+    }
+
+    if (decompress->decoder != NULL && decompress->decoder->finish != NULL) {
+        return decompress->decoder->finish(decompress->decoder);
+    }
+    return BACKUP_SUCCESS;
+}
+
+// 自动识别的解压阶段：释放资源（解码阶段与本阶段共用下游，只释放解码阶段自身）
+static void decompress_writer_destroy(ByteWriter *writer) {
+    DecompressWriter *decompress = (DecompressWriter *)writer;
+
+    if (decompress->decoder != NULL) {
+        decompress->decoder->next = NULL;
+        stream_destroy(decompress->decoder);
+    }
+    free(decompress);
+}
+
+// 创建解压处理阶段：根据数据头部自动识别压缩算法，非压缩数据原样写入下游
+ByteWriter *decompress_writer_create(ByteWriter *next, int *legacy_format) {
+    if (next == NULL) {
+        return NULL;
+    }
+
+    DecompressWriter *decompress = (DecompressWriter *)calloc(1, sizeof(DecompressWriter));
+    if (decompress == NULL) {
+        return NULL;
+    }
+
+    decompress->base.write = decompress_writer_write;
+    decompress->base.finish = decompress_writer_finish;
+    decompress->base.destroy = decompress_writer_destroy;
+    decompress->base.next = next;
+    decompress->legacy_format = legacy_format;
+    if (legacy_format != NULL) {
+        *legacy_format = 0;
+    }
+
+    return &decompress->base;
+}
@@ -0,0 +1,358 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "dir_cache.h"
+#include "platform.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 每隔多少级保持打开一级目录，其间的目录相对于最近的已打开目录用多级相对路径创建
+// 打开、关闭目录的开销比内核解析几级相对路径更大，因此只在很深的路径上保持打开的目录
+#define DIR_CACHE_OPEN_INTERVAL 8
+
+// 最多保持打开的目录数
+#define DIR_CACHE_MAX_OPEN 64
+
+// 已创建目录集合的初始容量（2的幂）
+#define DIR_CACHE_INITIAL_CAPACITY 1024
+
+// 已创建的目录
+typedef struct {
+    char *path;                     // 规范化的相对路径，NULL表示空槽
+    size_t length;
+    unsigned int hash;
+} DirCacheSlot;
+
+// 最近创建的目录路径上的一级目录
+typedef struct {
+    size_t end;                     // 该级目录在路径中的结束位置
+#ifndef _WIN32
+    int fd;                         // 打开的目录，不保持打开时为-1
+#endif
+} DirCacheLevel;
+
+struct DirCache {
+    DirCacheSlot *slots;            // 已创建目录的集合（开放寻址哈希表）
+    size_t capacity;
+    size_t count;
+    char *key;                      // 正在创建的目录（规范化后）
+    char *current;                  // 最近创建的目录，levels是它的各级目录
+    size_t path_capacity;           // key和current的容量
+    DirCacheLevel *levels;
+    int depth;
+    int level_capacity;
+#ifdef _WIN32
+    char *root;                     // 目标目录，创建时拼接完整路径
+    char *full_path;
+    size_t full_capacity;
+#else
+    int root_fd;                    // 目标目录
+#endif
+};
+
+// 辅助函数：路径的哈希值
+static unsigned int dir_cache_hash(const char *path, size_t length) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)path[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// 辅助函数：目录是否已经创建过
+static int dir_cache_contains(const DirCache *cache, const char *path, size_t length, unsigned int hash) {
+    size_t mask = cache->capacity - 1;
+    for (size_t slot = hash & mask; cache->slots[slot].path != NULL; slot = (slot + 1) & mask) {
+        const DirCacheSlot *entry = &cache->slots[slot];
+        if (entry->hash == hash && entry->length == length && memcmp(entry->path, path, length) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 辅助函数：把槽放入哈希表（调用方保证有空槽且不重复）
+static void dir_cache_place(DirCacheSlot *slots, size_t capacity, const DirCacheSlot *entry) {
+    size_t mask = capacity - 1;
+    size_t slot = entry->hash & mask;
+    while (slots[slot].path != NULL) {
+        slot = (slot + 1) & mask;
+    }
+    slots[slot] = *entry;
+}
+
+// 辅助函数：记录已创建的目录，装载率超过一半时扩容
+static BackupResult dir_cache_insert(DirCache *cache, const char *path, size_t length, unsigned int hash) {
+    if ((cache->count + 1) * 2 > cache->capacity) {
+        size_t capacity = cache->capacity * 2;
+        DirCacheSlot *slots = (DirCacheSlot *)calloc(capacity, sizeof(DirCacheSlot));
+        if (slots == NULL) {
+            return BACKUP_ERROR_MEMORY;
+        }
+        for (size_t i = 0; i < cache->capacity; i++) {
+            if (cache->slots[i].path != NULL) {
+                dir_cache_place(slots, capacity, &cache->slots[i]);
+            }
+        }
+        free(cache->slots);
+        cache->slots = slots;
+        cache->capacity = capacity;
+    }
+
+    DirCacheSlot entry;
+    entry.path = (char *)malloc(length + 1);
+    if (entry.path == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    memcpy(entry.path, path, length);
+    entry.path[length] = '\0';
+    entry.length = length;
+    entry.hash = hash;
+    dir_cache_place(cache->slots, cache->capacity, &entry);
+    cache->count++;
+    return BACKUP_SUCCESS;
+}
+
+// 创建缓存
+DirCache *dir_cache_create(const char *root) {
+    if (root == NULL) {
+        return NULL;
+    }
+
+    DirCache *cache = (DirCache *)calloc(1, sizeof(DirCache));
+    if (cache == NULL) {
+        return NULL;
+    }
+    cache->capacity = DIR_CACHE_INITIAL_CAPACITY;
+    cache->slots = (DirCacheSlot *)calloc(cache->capacity, sizeof(DirCacheSlot));
+#ifdef _WIN32
+    cache->root = (char *)malloc(strlen(root) + 1);
+    if (cache->slots == NULL || cache->root == NULL) {
+        dir_cache_destroy(cache);
+        return NULL;
+    }
+    strcpy(cache->root, root);
+#else
+    cache->root_fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (cache->slots == NULL || cache->root_fd < 0) {
+        dir_cache_destroy(cache);
+        return NULL;
+    }
+#endif
+    return cache;
+}
+
+// 辅助函数：关闭第depth级及更深的目录
+static void dir_cache_pop(DirCache *cache, int depth) {
+#ifndef _WIN32
+    for (int i = depth; i < cache->depth; i++) {
+        if (cache->levels[i].fd >= 0) {
+            close(cache->levels[i].fd);
+        }
+    }
+#endif
+    if (depth < cache->depth) {
+        cache->depth = depth;
+    }
+}
+
+// 释放缓存
+void dir_cache_destroy(DirCache *cache) {
+    if (cache == NULL) {
+        return;
+    }
+
+    dir_cache_pop(cache, 0);
+    if (cache->slots != NULL) {
+        for (size_t i = 0; i < cache->capacity; i++) {
+            free(cache->slots[i].path);
+        }
+    }
+#ifdef _WIN32
+    free(cache->root);
+    free(cache->full_path);
+#else
+    if (cache->root_fd >= 0) {
+        close(cache->root_fd);
+    }
+#endif
+    free(cache->slots);
+    free(cache->key);
+    free(cache->current);
+    free(cache->levels);
+    free(cache);
+}
+
+// 辅助函数：创建key中的第level级目录，exists表示已经创建过，只需要按需打开
+static BackupResult dir_cache_make_level(DirCache *cache, int level, int exists) {
+    size_t end = cache->levels[level].end;
+#ifdef _WIN32
+    if (exists) {
+        return BACKUP_SUCCESS;
+    }
+
+    size_t root_length = strlen(cache->root);
+    size_t length = root_length + 1 + end + 1;
+    if (length > cache->full_capacity) {
+        char *full_path = (char *)realloc(cache->full_path, length);
+        if (full_path == NULL) {
+            return BACKUP_ERROR_MEMORY;
+        }
+        cache->full_path = full_path;
+        cache->full_capacity = length;
+    }
+    memcpy(cache->full_path, cache->root, root_length);
+    cache->full_path[root_length] = PATH_SEPARATOR;
+    memcpy(cache->full_path + root_length + 1, cache->key, end);
+    cache->full_path[root_length + 1 + end] = '\0';
+    return platform_make_directory(cache->full_path) ? BACKUP_SUCCESS : BACKUP_ERROR_PATH;
+#else
+    // 相对于最近的已打开上层目录创建，名称可能是多级相对路径
+    int parent_fd = cache->root_fd;
+    size_t start = 0;
+    for (int i = level - 1; i >= 0; i--) {
+        if (cache->levels[i].fd >= 0) {
+            parent_fd = cache->levels[i].fd;
+            start = cache->levels[i].end + 1;
+            break;
+        }
+    }
+
+    char saved = cache->key[end];
+    cache->key[end] = '\0';
+    const char *name = cache->key + start;
+    BackupResult result = BACKUP_SUCCESS;
+    if (!exists && mkdirat(parent_fd, name, 0755) != 0 && errno != EEXIST) {
+        result = BACKUP_ERROR_PATH;
+    }
+    cache->levels[level].fd = -1;
+    if (result == BACKUP_SUCCESS && (level + 1) % DIR_CACHE_OPEN_INTERVAL == 0 &&
+        level / DIR_CACHE_OPEN_INTERVAL < DIR_CACHE_MAX_OPEN) {
+        cache->levels[level].fd = openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (cache->levels[level].fd < 0) {
+            result = BACKUP_ERROR_PATH;
+        }
+    }
+    cache->key[end] = saved;
+    return result;
+#endif
+}
+
+// 创建目录及其上层目录
+BackupResult dir_cache_make(DirCache *cache, const char *path, size_t length) {
+    if (cache == NULL || path == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    if (length + 1 > cache->path_capacity) {
+        size_t capacity = (length + 1 > cache->path_capacity * 2) ? length + 1 : cache->path_capacity * 2;
+        char *key = (char *)realloc(cache->key, capacity);
+        if (key == NULL) {
+            return BACKUP_ERROR_MEMORY;
+        }
+        cache->key = key;
+        char *current = (char *)realloc(cache->current, capacity);
+        if (current == NULL) {
+            return BACKUP_ERROR_MEMORY;
+        }
+        cache->current = current;
+        cache->path_capacity = capacity;
+    }
+
+    // 规范化：统一分隔符，去掉开头、结尾和重复的分隔符
+    size_t n = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (path[i] == '/' || path[i] == '\\') {
+            if (n > 0 && cache->key[n - 1] != PATH_SEPARATOR) {
+                cache->key[n++] = PATH_SEPARATOR;
+            }
+        } else {
+            cache->key[n++] = path[i];
+        }
+    }
+    while (n > 0 && cache->key[n - 1] == PATH_SEPARATOR) {
+        n--;
+    }
+    cache->key[n] = '\0';
+
+    // 根目录本身和已创建过的目录不需要任何操作
+    if (n == 0 || dir_cache_contains(cache, cache->key, n, dir_cache_hash(cache->key, n))) {
+        return BACKUP_SUCCESS;
+    }
+
+    // 保留与最近创建的目录相同的上层目录，关闭其余各级
+    int level = 0;
+    while (level < cache->depth) {
+        size_t end = cache->levels[level].end;
+        if (end > n || memcmp(cache->current, cache->key, end) != 0 || (end < n && cache->key[end] != PATH_SEPARATOR)) {
+            break;
+        }
+        level++;
+    }
+    dir_cache_pop(cache, level);
+
+    // 逐级创建（或打开）其余的目录
+    BackupResult result = BACKUP_SUCCESS;
+    size_t start = (level > 0) ? cache->levels[level - 1].end + 1 : 0;
+    while (start < n && result == BACKUP_SUCCESS) {
+        size_t end = start;
+        while (end < n && cache->key[end] != PATH_SEPARATOR) {
+            end++;
+        }
+
+        if (cache->depth == cache->level_capacity) {
+            int capacity = (cache->level_capacity > 0) ? cache->level_capacity * 2 : 16;
+            DirCacheLevel *levels = (DirCacheLevel *)realloc(cache->levels, capacity * sizeof(DirCacheLevel));
+            if (levels == NULL) {
+                result = BACKUP_ERROR_MEMORY;
+                break;
+            }
+            cache->levels = levels;
+            cache->level_capacity = capacity;
+        }
+
+        unsigned int hash = dir_cache_hash(cache->key, end);
+        int exists = dir_cache_contains(cache, cache->key, end, hash);
+        cache->levels[cache->depth].end = end;
+        result = dir_cache_make_level(cache, cache->depth, exists);
+        if (result != BACKUP_SUCCESS) {
+            break;
+        }
+        cache->depth++;
+        if (!exists) {
+            result = dir_cache_insert(cache, cache->key, end, hash);
+        }
+        start = end + 1;
+    }
+
+    // 失败时各级目录与current不再对应，全部关闭
+    if (result != BACKUP_SUCCESS) {
+        dir_cache_pop(cache, 0);
+        return result;
+    }
+    memcpy(cache->current, cache->key, n + 1);
+    return BACKUP_SUCCESS;
+}
+
+// 创建文件所在的目录
+BackupResult dir_cache_make_parent(DirCache *cache, const char *path, size_t length) {
+    if (cache == NULL || path == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    // 最后一个分隔符之前是所在的目录，没有分隔符时文件直接位于根目录
+    size_t end = length;
+    while (end > 0 && path[end - 1] != '/' && path[end - 1] != '\\') {
+        end--;
+    }
+    if (end == 0) {
+        return BACKUP_SUCCESS;
+    }
+    return dir_cache_make(cache, path, end - 1);
+}
@@ -3,8 +3,22 @@
 #include <string.h>
 #include <time.h>
 
-// 定义加密缓冲区大小
-#define ENCRYPT_BUFFER_SIZE 4096
+// 最大密钥长度
+#define ENCRYPT_MAX_KEY_SIZE 16
+
+// 流式加密阶段
+typedef struct {
+    ByteWriter base;
+    unsigned char key[ENCRYPT_MAX_KEY_SIZE];
+    int key_size;
+    unsigned long long position;          // 已处理的字节数，决定密钥的起始位置
+    unsigned char output[STREAM_BUFFER_SIZE];
+
+    // 解密时先从数据流中读取加密文件头部，再派生密钥
+    unsigned char header[sizeof(EncryptHeader)];
+    size_t header_len;
+    char password[64];
+} CipherWriter;
 
 // 辅助函数：生成随机数据
 BackupResult generate_random(unsigned char *buffer, int buffer_size) {
@@ -46,13 +60,10 @@ BackupResult generate_key(const char *password, unsigned char *key, int key_size
     return BACKUP_SUCCESS;
 }
 
-// 通用加密解密实现
-BackupResult crypto_encrypt_decrypt(FILE *input_fp, FILE *output_fp, const char *password, unsigned char *iv, EncryptAlgorithm algorithm, int encrypt) {
-    unsigned char buffer[ENCRYPT_BUFFER_SIZE];
-    unsigned char out_buffer[ENCRYPT_BUFFER_SIZE];
-    size_t bytes_read, bytes_written;
+// 辅助函数：根据算法派生加密密钥，返回密钥长度
+static int derive_cipher_key(const char *password, const unsigned char *iv, EncryptAlgorithm algorithm, unsigned char *key) {
     int key_size;
-    
+
     // 根据算法选择密钥大小
     switch (algorithm) {
         case ENCRYPT_ALGORITHM_AES:
@@ -62,44 +73,274 @@ BackupResult crypto_encrypt_decrypt(FILE *input_fp, FILE *output_fp, const char
             key_size = 8;
             break;
         default:
-            return BACKUP_ERROR_PARAM;
+            return 0;
     }
-    
+
     // 生成密钥
-    unsigned char key[key_size];
     if (generate_key(password, key, key_size) != BACKUP_SUCCESS) {
-        return BACKUP_ERROR_ENCRYPT;
+        return 0;
     }
-    
+
     // 结合IV增强密钥
     if (iv != NULL) {
         for (size_t i = 0; i < key_size; i++) {
             key[i] ^= iv[i % key_size];
         }
     }
-    
-    // 处理输入数据
-    while ((bytes_read = fread(buffer, 1, sizeof(buffer), input_fp)) > 0) {
-        for (size_t i = 0; i < bytes_read; i++) {
-            out_buffer[i] = buffer[i] ^ key[i % key_size];
+
+    return key_size;
+}
+
+// 写入加密文件头部
+BackupResult write_encrypt_header(FILE *fp, const EncryptHeader *header) {
+    if (fp == NULL || header == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    size_t bytes_written = fwrite(header, sizeof(EncryptHeader), 1, fp);
+    if (bytes_written != 1) {
+        return BACKUP_ERROR_FILE;
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+// 读取加密文件头部
+BackupResult read_encrypt_header(FILE *fp, EncryptHeader *header) {
+    if (fp == NULL || header == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    size_t bytes_read = fread(header, sizeof(EncryptHeader), 1, fp);
+    if (bytes_read != 1) {
+        return BACKUP_ERROR_FILE;
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+// 流式加密阶段：加密数据并写入下游
+static BackupResult cipher_writer_write(ByteWriter *writer, const unsigned char *data, size_t size) {
+    CipherWriter *cipher = (CipherWriter *)writer;
+
+    while (size > 0) {
+        size_t chunk = (size < sizeof(cipher->output)) ? size : sizeof(cipher->output);
+        size_t key_pos = (size_t)(cipher->position % cipher->key_size);
+
+        for (size_t i = 0; i < chunk; i++) {
+            cipher->output[i] = data[i] ^ cipher->key[key_pos];
+            if (++key_pos == (size_t)cipher->key_size) {
+                key_pos = 0;
+            }
         }
-        
-        bytes_written = fwrite(out_buffer, 1, bytes_read, output_fp);
-        if (bytes_written != bytes_read) {
-            return BACKUP_ERROR_FILE;
+
+        BackupResult result = stream_write(cipher->base.next, cipher->output, chunk);
+        if (result != BACKUP_SUCCESS) {
+            return result;
         }
+
+        cipher->position += chunk;
+        data += chunk;
+        size -= chunk;
     }
-    
+
     return BACKUP_SUCCESS;
 }
 
+// 创建流式加解密阶段（不读写加密文件头部），异或运算的加密和解密过程相同
+ByteWriter *cipher_writer_create(EncryptAlgorithm algorithm, const char *key, const unsigned char *iv, ByteWriter *next) {
+    if (next == NULL || key == NULL) {
+        return NULL;
+    }
+
+    CipherWriter *cipher = (CipherWriter *)calloc(1, sizeof(CipherWriter));
+    if (cipher == NULL) {
+        return NULL;
+    }
+
+    cipher->key_size = derive_cipher_key(key, iv, algorithm, cipher->key);
+    if (cipher->key_size == 0) {
+        free(cipher);
+        return NULL;
+    }
+
+    cipher->base.write = cipher_writer_write;
+    cipher->base.finish = NULL;
+    cipher->base.destroy = NULL;
+    cipher->base.next = next;
+    cipher->header_len = sizeof(EncryptHeader);
+    cipher->position = 0;
+
+    return &cipher->base;
+}
+
+// 创建流式加密阶段：先向下游写入加密文件头部
+ByteWriter *encrypt_writer_create(EncryptAlgorithm algorithm, const char *key, ByteWriter *next) {
+    EncryptHeader header;
+
+    if (next == NULL || key == NULL || key[0] == 0) {
+        return NULL;
+    }
+
+    CipherWriter *cipher = (CipherWriter *)calloc(1, sizeof(CipherWriter));
+    if (cipher == NULL) {
+        return NULL;
+    }
+
+    // 生成随机初始化向量并派生密钥
+    memset(&header, 0, sizeof(EncryptHeader));
+    if (generate_random(header.iv, 16) != BACKUP_SUCCESS) {
+        free(cipher);
+        return NULL;
+    }
+    cipher->key_size = derive_cipher_key(key, header.iv, algorithm, cipher->key);
+    if (cipher->key_size == 0) {
+        free(cipher);
+        return NULL;
+    }
+
+    // 流式写入时原始大小未知，记为0
+    memcpy(header.magic, "ENCR", 4);
+    header.version = 1;
+    header.algorithm = algorithm;
+    header.original_size = 0;
+
+    if (stream_write(next, &header, sizeof(EncryptHeader)) != BACKUP_SUCCESS) {
+        free(cipher);
+        return NULL;
+    }
+
+    cipher->base.write = cipher_writer_write;
+    cipher->base.finish = NULL;
+    cipher->base.destroy = NULL;
+    cipher->base.next = next;
+    cipher->position = 0;
+
+    return &cipher->base;
+}
+
+// 流式解密阶段：读取加密文件头部后解密数据
+static BackupResult decipher_writer_write(ByteWriter *writer, const unsigned char *data, size_t size) {
+    CipherWriter *cipher = (CipherWriter *)writer;
+
+    if (cipher->header_len < sizeof(EncryptHeader)) {
+        EncryptHeader header;
+        size_t need = sizeof(EncryptHeader) - cipher->header_len;
+        size_t chunk = (size < need) ? size : need;
+        memcpy(cipher->header + cipher->header_len, data, chunk);
+        cipher->header_len += chunk;
+        data += chunk;
+        size -= chunk;
+        if (cipher->header_len < sizeof(EncryptHeader)) {
+            return BACKUP_SUCCESS;
+        }
+
+        // 检查魔术字并派生密钥
+        memcpy(&header, cipher->header, sizeof(EncryptHeader));
+        if (memcmp(header.magic, "ENCR", 4) != 0) {
+            return BACKUP_ERROR_ENCRYPT;
+        }
+        cipher->key_size = derive_cipher_key(cipher->password, header.iv, header.algorithm, cipher->key);
+        if (cipher->key_size == 0) {
+            return BACKUP_ERROR_ENCRYPT;
+        }
+    }
+
+    if (size == 0) {
+        return BACKUP_SUCCESS;
+    }
+    return cipher_writer_write(writer, data, size);
+}
+
+// 流式解密阶段：检查是否读到完整的头部
+static BackupResult decipher_writer_finish(ByteWriter *writer) {
+    CipherWriter *cipher = (CipherWriter *)writer;
+
+    if (cipher->header_len < sizeof(EncryptHeader)) {
+        return BACKUP_ERROR_ENCRYPT;
+    }
+    return BACKUP_SUCCESS;
+}
+
+// 创建流式解密阶段，加密算法和初始化向量从数据流的头部读取
+ByteWriter *decrypt_writer_create(const char *key, ByteWriter *next) {
+    if (next == NULL || key == NULL || key[0] == 0) {
+        return NULL;
+    }
+
+    CipherWriter *cipher = (CipherWriter *)calloc(1, sizeof(CipherWriter));
+    if (cipher == NULL) {
+        return NULL;
+    }
+
+    strncpy(cipher->password, key, sizeof(cipher->password) - 1);
+    cipher->base.write = decipher_writer_write;
+    cipher->base.finish = decipher_writer_finish;
+    cipher->base.destroy = NULL;
+    cipher->base.next = next;
+    cipher->position = 0;
+
+    return &cipher->base;
+}
+
+// 通用加密解密实现（数据流版本）
+BackupResult crypto_encrypt_decrypt_stream(ByteReader *input, ByteWriter *output, const char *password, const unsigned char *iv, EncryptAlgorithm algorithm) {
+    if (input == NULL || output == NULL || password == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+    if (algorithm != ENCRYPT_ALGORITHM_AES && algorithm != ENCRYPT_ALGORITHM_DES) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    ByteWriter *cipher = cipher_writer_create(algorithm, password, iv, output);
+    if (cipher == NULL) {
+        return BACKUP_ERROR_ENCRYPT;
+    }
+    return stream_transform(input, cipher, output);
+}
+
+// 通用加密解密实现
+BackupResult crypto_encrypt_decrypt(FILE *input_fp, FILE *output_fp, const char *password, unsigned char *iv, EncryptAlgorithm algorithm, int encrypt) {
+    ByteReader *input = file_reader_create(input_fp);
+    ByteWriter *output = file_writer_create(output_fp);
+    BackupResult result = (input != NULL && output != NULL) ? crypto_encrypt_decrypt_stream(input, output, password, iv, algorithm) : BACKUP_ERROR_MEMORY;
+
+    (void)encrypt;
+    reader_destroy(input);
+    stream_destroy(output);
+    return result;
+}
+
+// 加密数据流：写入加密文件头部和加密数据
+BackupResult encrypt_stream(ByteReader *input, ByteWriter *output, EncryptAlgorithm algorithm, const char *key) {
+    if (input == NULL || output == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    ByteWriter *cipher = encrypt_writer_create(algorithm, key, output);
+    if (cipher == NULL) {
+        return BACKUP_ERROR_ENCRYPT;
+    }
+    return stream_transform(input, cipher, output);
+}
+
+// 解密数据流：从加密文件头部读取算法和初始化向量
+BackupResult decrypt_stream(ByteReader *input, ByteWriter *output, const char *key) {
+    if (input == NULL || output == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    ByteWriter *decipher = decrypt_writer_create(key, output);
+    if (decipher == NULL) {
+        return BACKUP_ERROR_ENCRYPT;
+    }
+    return stream_transform(input, decipher, output);
+}
+
 // 加密文件
 BackupResult encrypt_file(const char *input_path, const char *output_path, EncryptAlgorithm algorithm, const char *key) {
     FILE *input_fp = NULL;
     FILE *output_fp = NULL;
-    EncryptHeader header;
-    long original_size;
-    BackupResult result = BACKUP_SUCCESS;
 
     // 检查参数
     if (input_path == NULL || output_path == NULL || key == NULL || key[0] == 0) {
@@ -119,49 +360,21 @@ BackupResult encrypt_file(const char *input_path, const char *output_path, Encry
         return BACKUP_ERROR_FILE;
     }
 
-    // 获取原始文件大小
-    fseek(input_fp, 0, SEEK_END);
-    original_size = ftell(input_fp);
-    fseek(input_fp, 0, SEEK_SET);
-
-    // 生成随机初始化向量
-    if (generate_random(header.iv, 16) != BACKUP_SUCCESS) {
-        result = BACKUP_ERROR_ENCRYPT;
-        goto cleanup;
-    }
-
-    // 写入加密文件头部
-    header.magic[0] = 'E';
-    header.magic[1] = 'N';
-    header.magic[2] = 'C';
-    header.magic[3] = 'R';
-    header.version = 1;
-    header.algorithm = algorithm;
-    header.original_size = (unsigned long)original_size;
+    ByteReader *input = file_reader_create(input_fp);
+    ByteWriter *output = file_writer_create(output_fp);
+    BackupResult result = (input != NULL && output != NULL) ? encrypt_stream(input, output, algorithm, key) : BACKUP_ERROR_MEMORY;
 
-    if (write_encrypt_header(output_fp, &header) != BACKUP_SUCCESS) {
-        result = BACKUP_ERROR_ENCRYPT;
-        goto cleanup;
-    }
-
-    // 根据算法进行加密
-    result = crypto_encrypt_decrypt(input_fp, output_fp, key, header.iv, algorithm, 1);
-    if (result != BACKUP_SUCCESS) {
-        goto cleanup;
-    }
-
-cleanup:
+    reader_destroy(input);
+    stream_destroy(output);
     fclose(input_fp);
     fclose(output_fp);
     return result;
 }
 
-// 解密文件
+// 解密文件（算法从加密文件头部读取）
 BackupResult decrypt_file(const char *input_path, const char *output_path, EncryptAlgorithm algorithm, const char *key) {
     FILE *input_fp = NULL;
     FILE *output_fp = NULL;
-    EncryptHeader header;
-    BackupResult result = BACKUP_SUCCESS;
 
     // 检查参数
     if (input_path == NULL || output_path == NULL || key == NULL || key[0] == 0) {
@@ -181,56 +394,35 @@ BackupResult decrypt_file(const char *input_path, const char *output_path, Encry
         return BACKUP_ERROR_FILE;
     }
 
-    // 读取加密文件头部
-    if (read_encrypt_header(input_fp, &header) != BACKUP_SUCCESS) {
-        result = BACKUP_ERROR_ENCRYPT;
-        goto cleanup;
-    }
-
-    // 检查魔术字
-    if (memcmp(header.magic, "ENCR", 4) != 0) {
-        result = BACKUP_ERROR_ENCRYPT;
-        goto cleanup;
-    }
-
-    // 根据算法进行解密
-    result = crypto_encrypt_decrypt(input_fp, output_fp, key, header.iv, header.algorithm, 0);
-    if (result != BACKUP_SUCCESS) {
-        goto cleanup;
-    }
+    ByteReader *input = file_reader_create(input_fp);
+    ByteWriter *output = file_writer_create(output_fp);
+    BackupResult result = (input != NULL && output != NULL) ? decrypt_stream(input, output, key) : BACKUP_ERROR_MEMORY;
 
-cleanup:
+    reader_destroy(input);
+    stream_destroy(output);
     fclose(input_fp);
     fclose(output_fp);
     return result;
 }
 
-// 写入加密文件头部
-BackupResult write_encrypt_header(FILE *fp, const EncryptHeader *header) {
-    if (fp == NULL || header == NULL) {
-        return BACKUP_ERROR_PARAM;
-    }
-
-    size_t bytes_written = fwrite(header, sizeof(EncryptHeader), 1, fp);
-    if (bytes_written != 1) {
-        return BACKUP_ERROR_FILE;
-    }
-
-    return BACKUP_SUCCESS;
+// AES加密实现
+BackupResult aes_encrypt_stream(ByteReader *input, ByteWriter *output, const char *key, const unsigned char *iv) {
+    return crypto_encrypt_decrypt_stream(input, output, key, iv, ENCRYPT_ALGORITHM_AES);
 }
 
-// 读取加密文件头部
-BackupResult read_encrypt_header(FILE *fp, EncryptHeader *header) {
-    if (fp == NULL || header == NULL) {
-        return BACKUP_ERROR_PARAM;
-    }
+// AES解密实现
+BackupResult aes_decrypt_stream(ByteReader *input, ByteWriter *output, const char *key, const unsigned char *iv) {
+    return crypto_encrypt_decrypt_stream(input, output, key, iv, ENCRYPT_ALGORITHM_AES);
+}
 
-    size_t bytes_read = fread(header, sizeof(EncryptHeader), 1, fp);
-    if (bytes_read != 1) {
-        return BACKUP_ERROR_FILE;
-    }
+// DES加密实现
+BackupResult des_encrypt_stream(ByteReader *input, ByteWriter *output, const char *key) {
+    return crypto_encrypt_decrypt_stream(input, output, key, NULL, ENCRYPT_ALGORITHM_DES);
+}
 
-    return BACKUP_SUCCESS;
+// DES解密实现
+BackupResult des_decrypt_stream(ByteReader *input, ByteWriter *output, const char *key) {
+    return crypto_encrypt_decrypt_stream(input, output, key, NULL, ENCRYPT_ALGORITHM_DES);
 }
 
 // AES加密实现
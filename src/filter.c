@@ -7,71 +7,132 @@ int filter_file(const FileMetadata *metadata, const BackupOptions *options) {
         return 0;
     }
 
+    CatalogEntry entry;
+    catalog_stat_from_metadata(metadata, &entry);
+    return filter_entry(&entry, metadata->name, metadata->path, options);
+}
+
+// 是否需要文件的完整路径（只有按目录筛选时需要）
+int filter_needs_path(const BackupOptions *options) {
+    return options != NULL && options->exclude_directory.count > 0;
+}
+
+// 按目录清单项筛选，path只在按目录筛选时使用
+int filter_entry(const CatalogEntry *entry, const char *name, const char *path, const BackupOptions *options) {
+    if (entry == NULL || name == NULL || options == NULL) {
+        return 0;
+    }
+
     // 按文件类型筛选
-    if (!filter_by_type(metadata, options->file_types)) {
+    if (!filter_by_type(entry, options->file_types)) {
         return 0;
     }
 
     // 按时间筛选
-    if (!filter_by_time(metadata, &options->create_time_range, &options->modify_time_range, &options->access_time_range)) {
+    if (!filter_by_time(entry, &options->create_time_range, &options->modify_time_range, &options->access_time_range)) {
         return 0;
     }
 
     // 按大小筛选
-    if (!filter_by_size(metadata, &options->size_range)) {
+    if (!filter_by_size(entry, &options->size_range)) {
         return 0;
     }
 
     // 按用户/组筛选
-    if (!filter_by_user(metadata, &options->exclude_usergroup)) {
+    if (!filter_by_user(entry, &options->exclude_usergroup)) {
         return 0;
     }
 
     // 按文件名筛选
-    if (!filter_by_filename(metadata, &options->exclude_filename)) {
+    if (!filter_by_filename(name, &options->exclude_filename)) {
         return 0;
     }
 
     // 按目录筛选
-    if (!filter_by_directory(metadata, &options->exclude_directory)) {
+    if (filter_needs_path(options) && !filter_by_directory((path != NULL) ? path : "", &options->exclude_directory)) {
         return 0;
     }
 
     return 1;
 }
 
+// 还原时是否设置了筛选条件
+int filter_restore_enabled(const RestoreOptions *options) {
+    return options != NULL &&
+           (options->file_types != 0 ||
+            options->create_time_range.enable || options->modify_time_range.enable || options->access_time_range.enable ||
+            options->size_range.min_size > 0 || options->size_range.max_size > 0 ||
+            options->exclude_filename.pattern[0] != 0 || options->exclude_directory.count > 0 ||
+            options->include_count > 0);
+}
+
+// 还原时按索引中的文件项筛选
+int filter_restore_entry(const CatalogEntry *entry, const char *name, const char *path, const RestoreOptions *options) {
+    if (entry == NULL || name == NULL || path == NULL || options == NULL) {
+        return 0;
+    }
+
+    // 按文件类型筛选，未指定类型时不筛选
+    if (options->file_types != 0 && !filter_by_type(entry, options->file_types)) {
+        return 0;
+    }
+
+    // 按时间筛选
+    if (!filter_by_time(entry, &options->create_time_range, &options->modify_time_range, &options->access_time_range)) {
+        return 0;
+    }
+
+    // 按大小筛选
+    if (!filter_by_size(entry, &options->size_range)) {
+        return 0;
+    }
+
+    // 按文件名筛选
+    if (!filter_by_filename(name, &options->exclude_filename)) {
+        return 0;
+    }
+
+    // 按目录筛选
+    if (!filter_by_directory(path, &options->exclude_directory)) {
+        return 0;
+    }
+
+    // 按包含模式筛选
+    return filter_by_include(name, path, options->include_patterns, options->include_count);
+}
+
 // 按文件类型筛选
-int filter_by_type(const FileMetadata *metadata, FileType file_types) {
-    if (metadata == NULL) {
+int filter_by_type(const CatalogEntry *entry, FileType file_types) {
+    if (entry == NULL) {
         return 0;
     }
 
-    return (metadata->type & file_types) != 0;
+    return (entry->type & file_types) != 0;
 }
 
 // 按时间筛选
-int filter_by_time(const FileMetadata *metadata, const TimeRange *create_range, const TimeRange *modify_range, const TimeRange *access_range) {
-    if (metadata == NULL) {
+int filter_by_time(const CatalogEntry *entry, const TimeRange *create_range, const TimeRange *modify_range, const TimeRange *access_range) {
+    if (entry == NULL) {
         return 0;
     }
 
     // 检查创建时间
     if (create_range->enable) {
-        if (metadata->create_time < create_range->start_time || metadata->create_time > create_range->end_time) {
+        if (entry->create_time < create_range->start_time || entry->create_time > create_range->end_time) {
             return 0;
         }
     }
 
     // 检查修改时间
     if (modify_range->enable) {
-        if (metadata->modify_time < modify_range->start_time || metadata->modify_time > modify_range->end_time) {
+        if (entry->modify_time < modify_range->start_time || entry->modify_time > modify_range->end_time) {
             return 0;
         }
     }
 
     // 检查访问时间
     if (access_range->enable) {
-        if (metadata->access_time < access_range->start_time || metadata->access_time > access_range->end_time) {
+        if (entry->access_time < access_range->start_time || entry->access_time > access_range->end_time) {
             return 0;
         }
     }
@@ -80,22 +141,22 @@ int filter_by_time(const FileMetadata *metadata, const TimeRange *create_range,
 }
 
 // 按大小筛选
-int filter_by_size(const FileMetadata *metadata, const SizeRange *size_range) {
-    if (metadata == NULL || size_range == NULL) {
+int filter_by_size(const CatalogEntry *entry, const SizeRange *size_range) {
+    if (entry == NULL || size_range == NULL) {
         return 0;
     }
 
     // 如果max_size为0，不检查文件大小上限
     if (size_range->max_size == 0) {
-        return (metadata->size >= size_range->min_size);
+        return (entry->size >= size_range->min_size);
     }
 
-    return (metadata->size >= size_range->min_size && metadata->size <= size_range->max_size);
+    return (entry->size >= size_range->min_size && entry->size <= size_range->max_size);
 }
 
 // 按用户/组筛选
-int filter_by_user(const FileMetadata *metadata, const ExcludeUserGroup *exclude_usergroup) {
-    if (metadata == NULL || exclude_usergroup == NULL) {
+int filter_by_user(const CatalogEntry *entry, const ExcludeUserGroup *exclude_usergroup) {
+    if (entry == NULL || exclude_usergroup == NULL) {
         return 0;
     }
 
@@ -104,7 +165,7 @@ int filter_by_user(const FileMetadata *metadata, const ExcludeUserGroup *exclude
         for (int i = 0; i < exclude_usergroup->user_count; i++) {
             // 在Windows上，uid实际上是SIDs的简化，这里简化处理
             // 实际实现中需要将uid转换为用户名进行比较
-            if (metadata->uid == atoi(exclude_usergroup->exclude_users[i])) {
+            if (entry->uid == atoi(exclude_usergroup->exclude_users[i])) {
                 return 0;
             }
         }
@@ -115,7 +176,7 @@ int filter_by_user(const FileMetadata *metadata, const ExcludeUserGroup *exclude
         for (int i = 0; i < exclude_usergroup->group_count; i++) {
             // 在Windows上，gid实际上是SIDs的简化，这里简化处理
             // 实际实现中需要将gid转换为组名进行比较
-            if (metadata->gid == atoi(exclude_usergroup->exclude_groups[i])) {
+            if (entry->gid == atoi(exclude_usergroup->exclude_groups[i])) {
                 return 0;
             }
         }
@@ -125,14 +186,14 @@ int filter_by_user(const FileMetadata *metadata, const ExcludeUserGroup *exclude
 }
 
 // 按文件名筛选
-int filter_by_filename(const FileMetadata *metadata, const ExcludeFilename *exclude_filename) {
-    if (metadata == NULL || exclude_filename == NULL) {
+int filter_by_filename(const char *name, const ExcludeFilename *exclude_filename) {
+    if (name == NULL || exclude_filename == NULL) {
         return 0;
     }
 
     // 检查排除文件名模式（简化实现，只支持精确匹配）
     if (exclude_filename->pattern[0] != 0) {
-        if (strcmp(metadata->name, exclude_filename->pattern) == 0) {
+        if (strcmp(name, exclude_filename->pattern) == 0) {
             return 0; // 匹配到排除文件名，排除该文件
         }
     }
@@ -141,15 +202,15 @@ int filter_by_filename(const FileMetadata *metadata, const ExcludeFilename *excl
 }
 
 // 按目录筛选
-int filter_by_directory(const FileMetadata *metadata, const ExcludeDirectory *exclude_directory) {
-    if (metadata == NULL) {
+int filter_by_directory(const char *path, const ExcludeDirectory *exclude_directory) {
+    if (path == NULL) {
         return 0;
     }
 
     // 检查是否在排除目录列表中
     if (exclude_directory != NULL) {
         for (int i = 0; i < exclude_directory->count; i++) {
-            if (strstr(metadata->path, exclude_directory->paths[i]) != NULL) {
+            if (strstr(path, exclude_directory->paths[i]) != NULL) {
                 return 0;
             }
         }
@@ -157,3 +218,76 @@ int filter_by_directory(const FileMetadata *metadata, const ExcludeDirectory *ex
 
     return 1;
 }
+
+// 辅助函数：是否为路径分隔符
+static int filter_is_separator(char c) {
+    return c == '/' || c == '\\';
+}
+
+// 通配符匹配
+int filter_match_glob(const char *pattern, const char *text) {
+    while (*pattern != '\0') {
+        if (pattern[0] == '*' && pattern[1] == '*') {
+            // "**/"可以匹配空，否则'**'匹配包括分隔符在内的任意字符
+            pattern += 2;
+            if (filter_is_separator(*pattern) && filter_match_glob(pattern + 1, text)) {
+                return 1;
+            }
+            for (;; text++) {
+                if (filter_match_glob(pattern, text)) {
+                    return 1;
+                }
+                if (*text == '\0') {
+                    return 0;
+                }
+            }
+        }
+        if (*pattern == '*') {
+            pattern++;
+            for (;; text++) {
+                if (filter_match_glob(pattern, text)) {
+                    return 1;
+                }
+                if (*text == '\0' || filter_is_separator(*text)) {
+                    return 0;
+                }
+            }
+        }
+        if (*text == '\0') {
+            return 0;
+        }
+        if (*pattern == '?') {
+            if (filter_is_separator(*text)) {
+                return 0;
+            }
+        } else if (filter_is_separator(*pattern)) {
+            if (!filter_is_separator(*text)) {
+                return 0;
+            }
+        } else if (*pattern != *text) {
+            return 0;
+        }
+        pattern++;
+        text++;
+    }
+    return *text == '\0';
+}
+
+// 按包含模式筛选：含分隔符的模式与相对路径匹配，否则与文件名匹配；没有模式时不筛选
+int filter_by_include(const char *name, const char *path, const char *const *patterns, int count) {
+    if (name == NULL || path == NULL) {
+        return 0;
+    }
+    if (count <= 0) {
+        return 1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        const char *pattern = patterns[i];
+        int has_separator = strchr(pattern, '/') != NULL || strchr(pattern, '\\') != NULL;
+        if (filter_match_glob(pattern, has_separator ? path : name)) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,265 @@
+#include "hash.h"
+
+// SHA-256的轮常量
+static const unsigned int sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define SHA256_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+// 辅助函数：处理一个64字节的数据块
+static void sha256_block(unsigned int state[8], const unsigned char *block) {
+    unsigned int w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((unsigned int)block[i * 4] << 24) | ((unsigned int)block[i * 4 + 1] << 16) |
+               ((unsigned int)block[i * 4 + 2] << 8) | (unsigned int)block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        unsigned int s0 = SHA256_ROTR(w[i - 15], 7) ^ SHA256_ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        unsigned int s1 = SHA256_ROTR(w[i - 2], 17) ^ SHA256_ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    unsigned int a = state[0], b = state[1], c = state[2], d = state[3];
+    unsigned int e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        unsigned int s1 = SHA256_ROTR(e, 6) ^ SHA256_ROTR(e, 11) ^ SHA256_ROTR(e, 25);
+        unsigned int ch = (e & f) ^ (~e & g);
+        unsigned int t1 = h + s1 + ch + sha256_k[i] + w[i];
+        unsigned int s0 = SHA256_ROTR(a, 2) ^ SHA256_ROTR(a, 13) ^ SHA256_ROTR(a, 22);
+        unsigned int maj = (a & b) ^ (a & c) ^ (b & c);
+        unsigned int t2 = s0 + maj;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+// 初始化
+void sha256_init(Sha256 *ctx) {
+    static const unsigned int initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(ctx->state, initial, sizeof(initial));
+    ctx->length = 0;
+    ctx->block_len = 0;
+}
+
+// 加入数据：先补满缓存的不完整块，整块直接处理，剩余部分缓存
+void sha256_update(Sha256 *ctx, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    ctx->length += size;
+
+    if (ctx->block_len > 0) {
+        size_t chunk = 64 - ctx->block_len;
+        if (chunk > size) {
+            chunk = size;
+        }
+        memcpy(ctx->block + ctx->block_len, bytes, chunk);
+        ctx->block_len += chunk;
+        bytes += chunk;
+        size -= chunk;
+        if (ctx->block_len < 64) {
+            return;
+        }
+        sha256_block(ctx->state, ctx->block);
+        ctx->block_len = 0;
+    }
+
+    while (size >= 64) {
+        sha256_block(ctx->state, bytes);
+        bytes += 64;
+        size -= 64;
+    }
+    memcpy(ctx->block, bytes, size);
+    ctx->block_len = size;
+}
+
+// 得到摘要：填充0x80和零，最后8字节是以位计的数据长度（大端序）
+void sha256_final(Sha256 *ctx, unsigned char digest[SHA256_SIZE]) {
+    unsigned long long bits = ctx->length * 8;
+
+    ctx->block[ctx->block_len++] = 0x80;
+    if (ctx->block_len > 56) {
+        memset(ctx->block + ctx->block_len, 0, 64 - ctx->block_len);
+        sha256_block(ctx->state, ctx->block);
+        ctx->block_len = 0;
+    }
+    memset(ctx->block + ctx->block_len, 0, 56 - ctx->block_len);
+    for (int i = 0; i < 8; i++) {
+        ctx->block[56 + i] = (unsigned char)(bits >> (56 - i * 8));
+    }
+    sha256_block(ctx->state, ctx->block);
+
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4] = (unsigned char)(ctx->state[i] >> 24);
+        digest[i * 4 + 1] = (unsigned char)(ctx->state[i] >> 16);
+        digest[i * 4 + 2] = (unsigned char)(ctx->state[i] >> 8);
+        digest[i * 4 + 3] = (unsigned char)ctx->state[i];
+    }
+}
+
+// 一次计算一段数据的摘要
+void sha256(const void *data, size_t size, unsigned char digest[SHA256_SIZE]) {
+    Sha256 ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, data, size);
+    sha256_final(&ctx, digest);
+}
+
+// XXH64的素数常量
+#define XXH64_PRIME1 0x9E3779B185EBCA87ull
+#define XXH64_PRIME2 0xC2B2AE3D27D4EB4Full
+#define XXH64_PRIME3 0x165667B19E3779F9ull
+#define XXH64_PRIME4 0x85EBCA77C2B2AE63ull
+#define XXH64_PRIME5 0x27D4EB2F165667C5ull
+
+#define XXH64_ROTL(x, n) (((x) << (n)) | ((x) >> (64 - (n))))
+
+// 辅助函数：读取小端序的64位和32位整数
+static unsigned long long xxh64_read64(const unsigned char *data) {
+    unsigned long long value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static unsigned int xxh64_read32(const unsigned char *data) {
+    unsigned int value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+// 辅助函数：累加器加入8字节
+static unsigned long long xxh64_round(unsigned long long acc, unsigned long long input) {
+    acc += input * XXH64_PRIME2;
+    acc = XXH64_ROTL(acc, 31);
+    return acc * XXH64_PRIME1;
+}
+
+// 辅助函数：合并一个累加器
+static unsigned long long xxh64_merge(unsigned long long hash, unsigned long long acc) {
+    hash ^= xxh64_round(0, acc);
+    return hash * XXH64_PRIME1 + XXH64_PRIME4;
+}
+
+// 辅助函数：处理连续的32字节数据块，4个累加器各取8字节
+static void xxh64_stripes(unsigned long long lanes[4], const unsigned char *data, size_t count) {
+    unsigned long long v1 = lanes[0], v2 = lanes[1], v3 = lanes[2], v4 = lanes[3];
+    for (size_t i = 0; i < count; i++, data += 32) {
+        v1 = xxh64_round(v1, xxh64_read64(data));
+        v2 = xxh64_round(v2, xxh64_read64(data + 8));
+        v3 = xxh64_round(v3, xxh64_read64(data + 16));
+        v4 = xxh64_round(v4, xxh64_read64(data + 24));
+    }
+    lanes[0] = v1;
+    lanes[1] = v2;
+    lanes[2] = v3;
+    lanes[3] = v4;
+}
+
+// 初始化XXH64计算状态
+void xxh64_init(Xxh64 *ctx, unsigned long long seed) {
+    ctx->lanes[0] = seed + XXH64_PRIME1 + XXH64_PRIME2;
+    ctx->lanes[1] = seed + XXH64_PRIME2;
+    ctx->lanes[2] = seed;
+    ctx->lanes[3] = seed - XXH64_PRIME1;
+    ctx->seed = seed;
+    ctx->length = 0;
+    ctx->block_len = 0;
+}
+
+// 加入数据：先补满缓存的不完整块，整块直接处理，剩余部分缓存
+void xxh64_update(Xxh64 *ctx, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    ctx->length += size;
+
+    if (ctx->block_len > 0) {
+        size_t chunk = 32 - ctx->block_len;
+        if (chunk > size) {
+            chunk = size;
+        }
+        memcpy(ctx->block + ctx->block_len, bytes, chunk);
+        ctx->block_len += chunk;
+        bytes += chunk;
+        size -= chunk;
+        if (ctx->block_len < 32) {
+            return;
+        }
+        xxh64_stripes(ctx->lanes, ctx->block, 1);
+        ctx->block_len = 0;
+    }
+
+    xxh64_stripes(ctx->lanes, bytes, size / 32);
+    bytes += size & ~(size_t)31;
+    size &= 31;
+    memcpy(ctx->block, bytes, size);
+    ctx->block_len = size;
+}
+
+// 得到摘要：合并累加器（不足32字节时只用种子），再依次加入缓存的剩余数据，最后混合各位
+unsigned long long xxh64_final(const Xxh64 *ctx) {
+    unsigned long long hash;
+    if (ctx->length >= 32) {
+        hash = XXH64_ROTL(ctx->lanes[0], 1) + XXH64_ROTL(ctx->lanes[1], 7) +
+               XXH64_ROTL(ctx->lanes[2], 12) + XXH64_ROTL(ctx->lanes[3], 18);
+        for (int i = 0; i < 4; i++) {
+            hash = xxh64_merge(hash, ctx->lanes[i]);
+        }
+    } else {
+        hash = ctx->seed + XXH64_PRIME5;
+    }
+    hash += ctx->length;
+
+    const unsigned char *bytes = ctx->block;
+    size_t size = ctx->block_len;
+    for (; size >= 8; bytes += 8, size -= 8) {
+        hash ^= xxh64_round(0, xxh64_read64(bytes));
+        hash = XXH64_ROTL(hash, 27) * XXH64_PRIME1 + XXH64_PRIME4;
+    }
+    if (size >= 4) {
+        hash ^= (unsigned long long)xxh64_read32(bytes) * XXH64_PRIME1;
+        hash = XXH64_ROTL(hash, 23) * XXH64_PRIME2 + XXH64_PRIME3;
+        bytes += 4;
+        size -= 4;
+    }
+    for (; size > 0; bytes++, size--) {
+        hash ^= *bytes * XXH64_PRIME5;
+        hash = XXH64_ROTL(hash, 11) * XXH64_PRIME1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= XXH64_PRIME2;
+    hash ^= hash >> 29;
+    hash *= XXH64_PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+// 一次计算一段数据的摘要
+unsigned long long xxh64(const void *data, size_t size, unsigned long long seed) {
+    Xxh64 ctx;
+    xxh64_init(&ctx, seed);
+    xxh64_update(&ctx, data, size);
+    return xxh64_final(&ctx);
+}
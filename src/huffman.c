@@ -2,25 +2,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-// 计算字符频率
-void calculate_frequency(FILE *input_fp, unsigned long frequency[256]) {
-    unsigned char buffer[4096];
-    size_t bytes_read;
-    
-    // 初始化频率数组
-    memset(frequency, 0, 256 * sizeof(unsigned long));
-    
-    // 读取文件并计算频率
-    while ((bytes_read = fread(buffer, 1, sizeof(buffer), input_fp)) > 0) {
-        for (size_t i = 0; i < bytes_read; i++) {
-            frequency[buffer[i]]++;
-        }
-    }
-    
-    // 重置文件指针到文件开头
-    fseek(input_fp, 0, SEEK_SET);
-}
-
 // 创建Huffman树节点
 HuffmanNode* create_huffman_node(unsigned char data, unsigned long frequency) {
     HuffmanNode *node = (HuffmanNode *)malloc(sizeof(HuffmanNode));
@@ -178,91 +159,11 @@ void generate_huffman_codes(HuffmanNode *root, unsigned char code[], int top, ch
     }
 }
 
-// Huffman压缩实现
-BackupResult huffman_compress(FILE *input_fp, FILE *output_fp) {
-    unsigned long frequency[256];
-    HuffmanNode *root;
-    unsigned char code[256];
-    char codes[256][256];
-    CompressHeader header;
-    
-    // 计算字符频率
-    calculate_frequency(input_fp, frequency);
-    
-    // 构建Huffman树
-    root = build_huffman_tree(frequency);
-    if (root == NULL) {
-        return BACKUP_ERROR_MEMORY;
-    }
-    
-    // 生成Huffman编码
-    generate_huffman_codes(root, code, 0, codes);
-    
-    // 写入压缩文件头部
-    strcpy((char*)header.magic, "COMP");
-    header.version = 1;
-    header.algorithm = COMPRESS_ALGORITHM_HAFF;
-    fseek(input_fp, 0, SEEK_END);
-    header.original_size = ftell(input_fp);
-    fseek(input_fp, 0, SEEK_SET);
-    header.compressed_size = 0; // 后续更新
-    
-    fwrite(&header, sizeof(CompressHeader), 1, output_fp);
-    
-    // 写入频率表，用于解压
-    fwrite(frequency, sizeof(unsigned long), 256, output_fp);
-    
-    // 压缩文件数据
-    unsigned char buffer[4096];
-    unsigned char output_buffer = 0;
-    int bit_count = 0;
-    size_t bytes_read;
-    
-    while ((bytes_read = fread(buffer, 1, sizeof(buffer), input_fp)) > 0) {
-        for (size_t i = 0; i < bytes_read; i++) {
-            char *huff_code = codes[buffer[i]];
-            for (int j = 0; huff_code[j] != '\0'; j++) {
-                // 将Huffman编码写入输出缓冲区
-                output_buffer <<= 1;
-                if (huff_code[j] == '1') {
-                    output_buffer |= 1;
-                }
-                bit_count++;
-                
-                // 如果输出缓冲区已满，写入文件
-                if (bit_count == 8) {
-                    fwrite(&output_buffer, 1, 1, output_fp);
-                    output_buffer = 0;
-                    bit_count = 0;
-                }
-            }
-        }
-    }
-    
-    // 处理剩余的位
-    if (bit_count > 0) {
-        output_buffer <<= (8 - bit_count);
-        fwrite(&output_buffer, 1, 1, output_fp);
-    }
-    
-    // 更新压缩后文件大小
-    fseek(output_fp, 0, SEEK_END);
-    header.compressed_size = ftell(output_fp) - sizeof(CompressHeader);
-    fseek(output_fp, 0, SEEK_SET);
-    fwrite(&header, sizeof(CompressHeader), 1, output_fp);
-    
-    // 释放Huffman树
-    // 注意：这里应该实现一个释放Huffman树的函数，暂时省略
-    
-    return BACKUP_SUCCESS;
-}
-
-// Huffman解压实现
-BackupResult huffman_decompress(FILE *input_fp, FILE *output_fp) {
+// Huffman解压实现（版本1格式）
+BackupResult huffman_decompress_legacy(FILE *input_fp, FILE *output_fp) {
     CompressHeader header;
     unsigned long frequency[256];
     HuffmanNode *root;
-    unsigned char buffer[4096];
     size_t bytes_read;
     unsigned long bytes_written = 0;
     
@@ -314,3 +215,434 @@ BackupResult huffman_decompress(FILE *input_fp, FILE *output_fp) {
     
     return BACKUP_SUCCESS;
 }
+
+// 释放Huffman树
+void free_huffman_tree(HuffmanNode *root) {
+    if (root == NULL) {
+        return;
+    }
+
+    free_huffman_tree(root->left);
+    free_huffman_tree(root->right);
+    free(root);
+}
+
+// Huffman流式编码的配置（版本2格式）
+// 数据按块编码，每块格式为：原始长度（unsigned int）、频率表（256个unsigned int）、按位编码的数据（补齐到整字节）
+// 原始长度为0的块表示流结束
+#define HUFFMAN_BLOCK_SIZE (1024 * 1024)
+#define HUFFMAN_BLOCK_HEADER_SIZE (sizeof(unsigned int) * 257)
+
+// Huffman流式编码阶段
+typedef struct {
+    ByteWriter base;
+    unsigned char *block;                 // 当前块的原始数据
+    size_t block_len;
+    unsigned long long code_bits[256];    // 每个字符的编码（高位在前）
+    unsigned char code_len[256];          // 每个字符的编码长度
+    char codes[256][256];                 // generate_huffman_codes生成的字符串编码
+    unsigned long long bit_buffer;
+    int bit_count;
+    unsigned char output[STREAM_BUFFER_SIZE];
+    size_t output_len;
+} HuffmanEncoder;
+
+// Huffman流式解码阶段的状态
+typedef enum {
+    HUFFMAN_STATE_HEADER,  // 读取块头部
+    HUFFMAN_STATE_BITS,    // 解码块数据
+    HUFFMAN_STATE_END      // 已读到结束块
+} HuffmanDecodeState;
+
+// Huffman流式解码阶段
+typedef struct {
+    ByteWriter base;
+    HuffmanDecodeState state;
+    unsigned char header[HUFFMAN_BLOCK_HEADER_SIZE]; // 块头部缓冲区
+    size_t header_len;
+    unsigned int block_size;              // 当前块的原始长度
+    unsigned int decoded;                 // 当前块已解码的字节数
+    HuffmanNode *root;
+    HuffmanNode *current;
+    unsigned char output[STREAM_BUFFER_SIZE];
+    size_t output_len;
+} HuffmanDecoder;
+
+// 将输出缓冲区写入下游
+static BackupResult huffman_flush_output(ByteWriter *next, unsigned char *output, size_t *output_len) {
+    if (*output_len == 0) {
+        return BACKUP_SUCCESS;
+    }
+
+    BackupResult result = stream_write(next, output, *output_len);
+    *output_len = 0;
+    return result;
+}
+
+// 向输出缓冲区写入数据
+static BackupResult huffman_encoder_put(HuffmanEncoder *encoder, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+
+    while (size > 0) {
+        if (encoder->output_len == sizeof(encoder->output)) {
+            BackupResult result = huffman_flush_output(encoder->base.next, encoder->output, &encoder->output_len);
+            if (result != BACKUP_SUCCESS) {
+                return result;
+            }
+        }
+
+        size_t space = sizeof(encoder->output) - encoder->output_len;
+        size_t chunk = (size < space) ? size : space;
+        memcpy(encoder->output + encoder->output_len, bytes, chunk);
+        encoder->output_len += chunk;
+        bytes += chunk;
+        size -= chunk;
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+// 编码当前块
+static BackupResult huffman_encode_block(HuffmanEncoder *encoder) {
+    unsigned long frequency[256];
+    unsigned int block_header[257];
+    unsigned char code[256];
+    BackupResult result;
+
+    if (encoder->block_len == 0) {
+        return BACKUP_SUCCESS;
+    }
+
+    // 统计字符频率
+    memset(frequency, 0, sizeof(frequency));
+    for (size_t i = 0; i < encoder->block_len; i++) {
+        frequency[encoder->block[i]]++;
+    }
+
+    // 写入块头部
+    block_header[0] = (unsigned int)encoder->block_len;
+    for (int i = 0; i < 256; i++) {
+        block_header[i + 1] = (unsigned int)frequency[i];
+    }
+    result = huffman_encoder_put(encoder, block_header, sizeof(block_header));
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+
+    // 构建Huffman树并生成编码
+    HuffmanNode *root = build_huffman_tree(frequency);
+    if (root == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    memset(encoder->codes, 0, sizeof(encoder->codes));
+    generate_huffman_codes(root, code, 0, encoder->codes);
+    free_huffman_tree(root);
+
+    for (int i = 0; i < 256; i++) {
+        encoder->code_bits[i] = 0;
+        encoder->code_len[i] = (unsigned char)strlen(encoder->codes[i]);
+        for (int j = 0; j < encoder->code_len[i]; j++) {
+            encoder->code_bits[i] = (encoder->code_bits[i] << 1) | (encoder->codes[i][j] == '1');
+        }
+    }
+
+    // 按位编码块数据（只有一种字符时编码长度为0，不输出数据）
+    encoder->bit_buffer = 0;
+    encoder->bit_count = 0;
+    for (size_t i = 0; i < encoder->block_len; i++) {
+        unsigned char c = encoder->block[i];
+        encoder->bit_buffer = (encoder->bit_buffer << encoder->code_len[c]) | encoder->code_bits[c];
+        encoder->bit_count += encoder->code_len[c];
+
+        while (encoder->bit_count >= 8) {
+            encoder->bit_count -= 8;
+            if (encoder->output_len == sizeof(encoder->output)) {
+                result = huffman_flush_output(encoder->base.next, encoder->output, &encoder->output_len);
+                if (result != BACKUP_SUCCESS) {
+                    return result;
+                }
+            }
+            encoder->output[encoder->output_len++] = (unsigned char)(encoder->bit_buffer >> encoder->bit_count);
+        }
+    }
+
+    // 处理剩余的位
+    if (encoder->bit_count > 0) {
+        unsigned char last = (unsigned char)(encoder->bit_buffer << (8 - encoder->bit_count));
+        result = huffman_encoder_put(encoder, &last, 1);
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+    }
+
+    encoder->block_len = 0;
+    return BACKUP_SUCCESS;
+}
+
+// Huffman编码阶段：写入数据
+static BackupResult huffman_encoder_write(ByteWriter *writer, const unsigned char *data, size_t size) {
+    HuffmanEncoder *encoder = (HuffmanEncoder *)writer;
+
+    while (size > 0) {
+        size_t space = HUFFMAN_BLOCK_SIZE - encoder->block_len;
+        size_t chunk = (size < space) ? size : space;
+        memcpy(encoder->block + encoder->block_len, data, chunk);
+        encoder->block_len += chunk;
+        data += chunk;
+        size -= chunk;
+
+        if (encoder->block_len == HUFFMAN_BLOCK_SIZE) {
+            BackupResult result = huffman_encode_block(encoder);
+            if (result != BACKUP_SUCCESS) {
+                return result;
+            }
+        }
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+// Huffman编码阶段：编码最后一块并写入结束块
+static BackupResult huffman_encoder_finish(ByteWriter *writer) {
+    HuffmanEncoder *encoder = (HuffmanEncoder *)writer;
+    unsigned int end_block = 0;
+
+    BackupResult result = huffman_encode_block(encoder);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+
+    result = huffman_encoder_put(encoder, &end_block, sizeof(end_block));
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+
+    return huffman_flush_output(encoder->base.next, encoder->output, &encoder->output_len);
+}
+
+// Huffman编码阶段：释放资源
+static void huffman_encoder_destroy(ByteWriter *writer) {
+    HuffmanEncoder *encoder = (HuffmanEncoder *)writer;
+
+    free(encoder->block);
+    free(encoder);
+}
+
+// 创建Huffman编码阶段
+ByteWriter *huffman_encoder_create(ByteWriter *next) {
+    HuffmanEncoder *encoder = (HuffmanEncoder *)calloc(1, sizeof(HuffmanEncoder));
+    if (encoder == NULL) {
+        return NULL;
+    }
+
+    encoder->block = (unsigned char *)malloc(HUFFMAN_BLOCK_SIZE);
+    if (encoder->block == NULL) {
+        free(encoder);
+        return NULL;
+    }
+
+    encoder->base.write = huffman_encoder_write;
+    encoder->base.finish = huffman_encoder_finish;
+    encoder->base.destroy = huffman_encoder_destroy;
+    encoder->base.next = next;
+
+    return &encoder->base;
+}
+
+// 输出一个解码后的字节
+static BackupResult huffman_decoder_put(HuffmanDecoder *decoder, unsigned char c) {
+    decoder->output[decoder->output_len++] = c;
+    decoder->decoded++;
+
+    if (decoder->output_len == sizeof(decoder->output)) {
+        return huffman_flush_output(decoder->base.next, decoder->output, &decoder->output_len);
+    }
+    return BACKUP_SUCCESS;
+}
+
+// 当前块解码完成，准备读取下一个块头部
+static void huffman_decoder_end_block(HuffmanDecoder *decoder) {
+    free_huffman_tree(decoder->root);
+    decoder->root = NULL;
+    decoder->current = NULL;
+    decoder->header_len = 0;
+    decoder->state = HUFFMAN_STATE_HEADER;
+}
+
+// 解析块头部并重建Huffman树
+static BackupResult huffman_decoder_start_block(HuffmanDecoder *decoder) {
+    unsigned int block_header[257];
+    unsigned long frequency[256];
+    unsigned long total = 0;
+
+    memcpy(block_header, decoder->header, sizeof(block_header));
+    for (int i = 0; i < 256; i++) {
+        frequency[i] = block_header[i + 1];
+        total += frequency[i];
+    }
+    if (total != block_header[0]) {
+        return BACKUP_ERROR_COMPRESS;
+    }
+
+    decoder->block_size = block_header[0];
+    decoder->decoded = 0;
+    decoder->root = build_huffman_tree(frequency);
+    if (decoder->root == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    decoder->current = decoder->root;
+
+    // 只有一种字符时没有编码数据，直接输出
+    if (is_leaf_node(decoder->root)) {
+        while (decoder->decoded < decoder->block_size) {
+            BackupResult result = huffman_decoder_put(decoder, decoder->root->data);
+            if (result != BACKUP_SUCCESS) {
+                return result;
+            }
+        }
+        huffman_decoder_end_block(decoder);
+        return BACKUP_SUCCESS;
+    }
+
+    decoder->state = HUFFMAN_STATE_BITS;
+    return BACKUP_SUCCESS;
+}
+
+// Huffman解码阶段：写入压缩数据
+static BackupResult huffman_decoder_write(ByteWriter *writer, const unsigned char *data, size_t size) {
+    HuffmanDecoder *decoder = (HuffmanDecoder *)writer;
+    BackupResult result;
+
+    while (size > 0) {
+        switch (decoder->state) {
+            case HUFFMAN_STATE_HEADER:
+                {
+                    // 先读取原始长度，长度为0表示结束块；否则继续读取频率表
+                    size_t need = (decoder->header_len < sizeof(unsigned int)) ? sizeof(unsigned int) : HUFFMAN_BLOCK_HEADER_SIZE;
+                    size_t chunk = need - decoder->header_len;
+                    if (chunk > size) {
+                        chunk = size;
+                    }
+                    memcpy(decoder->header + decoder->header_len, data, chunk);
+                    decoder->header_len += chunk;
+                    data += chunk;
+                    size -= chunk;
+
+                    if (decoder->header_len == sizeof(unsigned int)) {
+                        unsigned int block_size;
+                        memcpy(&block_size, decoder->header, sizeof(unsigned int));
+                        if (block_size == 0) {
+                            decoder->state = HUFFMAN_STATE_END;
+                        }
+                    } else if (decoder->header_len == HUFFMAN_BLOCK_HEADER_SIZE) {
+                        result = huffman_decoder_start_block(decoder);
+                        if (result != BACKUP_SUCCESS) {
+                            return result;
+                        }
+                    }
+                }
+                break;
+
+            case HUFFMAN_STATE_BITS:
+                {
+                    unsigned char input_byte = *data++;
+                    size--;
+
+                    for (int i = 7; i >= 0; i--) {
+                        decoder->current = ((input_byte >> i) & 1) ? decoder->current->right : decoder->current->left;
+                        if (decoder->current == NULL) {
+                            return BACKUP_ERROR_COMPRESS;
+                        }
+
+                        if (is_leaf_node(decoder->current)) {
+                            result = huffman_decoder_put(decoder, decoder->current->data);
+                            if (result != BACKUP_SUCCESS) {
+                                return result;
+                            }
+                            decoder->current = decoder->root;
+
+                            // 块解码完成，丢弃该字节剩余的填充位
+                            if (decoder->decoded == decoder->block_size) {
+                                huffman_decoder_end_block(decoder);
+                                break;
+                            }
+                        }
+                    }
+                }
+                break;
+
+            case HUFFMAN_STATE_END:
+                // 结束块之后不应再有数据
+                return BACKUP_ERROR_COMPRESS;
+        }
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+// Huffman解码阶段：检查是否完整读到结束块
+static BackupResult huffman_decoder_finish(ByteWriter *writer) {
+    HuffmanDecoder *decoder = (HuffmanDecoder *)writer;
+
+    if (decoder->state != HUFFMAN_STATE_END) {
+        return BACKUP_ERROR_COMPRESS;
+    }
+
+    return huffman_flush_output(decoder->base.next, decoder->output, &decoder->output_len);
+}
+
+// Huffman解码阶段：释放资源
+static void huffman_decoder_destroy(ByteWriter *writer) {
+    HuffmanDecoder *decoder = (HuffmanDecoder *)writer;
+
+    free_huffman_tree(decoder->root);
+    free(decoder);
+}
+
+// 创建Huffman解码阶段
+ByteWriter *huffman_decoder_create(ByteWriter *next) {
+    HuffmanDecoder *decoder = (HuffmanDecoder *)calloc(1, sizeof(HuffmanDecoder));
+    if (decoder == NULL) {
+        return NULL;
+    }
+
+    decoder->base.write = huffman_decoder_write;
+    decoder->base.finish = huffman_decoder_finish;
+    decoder->base.destroy = huffman_decoder_destroy;
+    decoder->base.next = next;
+    decoder->state = HUFFMAN_STATE_HEADER;
+
+    return &decoder->base;
+}
+
+// Huffman压缩数据流（不含压缩文件头部）
+BackupResult huffman_compress_stream(ByteReader *input, ByteWriter *output) {
+    return stream_transform(input, huffman_encoder_create(output), output);
+}
+
+// Huffman解压数据流（不含压缩文件头部）
+BackupResult huffman_decompress_stream(ByteReader *input, ByteWriter *output) {
+    return stream_transform(input, huffman_decoder_create(output), output);
+}
+
+// Huffman压缩实现
+BackupResult huffman_compress(FILE *input_fp, FILE *output_fp) {
+    ByteReader *input = file_reader_create(input_fp);
+    ByteWriter *output = file_writer_create(output_fp);
+    BackupResult result = (input != NULL && output != NULL) ? huffman_compress_stream(input, output) : BACKUP_ERROR_MEMORY;
+
+    reader_destroy(input);
+    stream_destroy(output);
+    return result;
+}
+
+// Huffman解压实现
+BackupResult huffman_decompress(FILE *input_fp, FILE *output_fp) {
+    ByteReader *input = file_reader_create(input_fp);
+    ByteWriter *output = file_writer_create(output_fp);
+    BackupResult result = (input != NULL && output != NULL) ? huffman_decompress_stream(input, output) : BACKUP_ERROR_MEMORY;
+
+    reader_destroy(input);
+    stream_destroy(output);
+    return result;
+}
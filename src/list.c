@@ -0,0 +1,66 @@
+#include "list.h"
+#include "restore.h"
+#include "platform.h"
+
+// 最近一次列出的统计
+static ListStats last_list_stats;
+
+// 列出主函数
+BackupResult list_data(const ListOptions *options, ListCallback callback, void *context) {
+    memset(&last_list_stats, 0, sizeof(ListStats));
+    if (options == NULL || options->backup_file[0] == 0 || callback == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+    if (!platform_path_exists(options->backup_file, NULL)) {
+        return BACKUP_ERROR_PATH;
+    }
+    double start_time = platform_monotonic_time();
+
+    Archive *archive = NULL;
+    BackupResult result = archive_open_index(options->backup_file, &archive);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+
+    // 与还原相同的选择：先按路径选中，再按筛选条件排除；筛选后没有文件时列出为空，不算失败
+    RestoreOptions filter;
+    memset(&filter, 0, sizeof(RestoreOptions));
+    memcpy(filter.paths, options->paths, sizeof(filter.paths));
+    filter.path_count = options->path_count;
+    filter.file_types = options->file_types;
+    filter.create_time_range = options->create_time_range;
+    filter.modify_time_range = options->modify_time_range;
+    filter.access_time_range = options->access_time_range;
+    filter.size_range = options->size_range;
+    filter.exclude_filename = options->exclude_filename;
+    filter.exclude_directory = options->exclude_directory;
+    memcpy(filter.include_patterns, options->include_patterns, sizeof(filter.include_patterns));
+    filter.include_count = options->include_count;
+
+    unsigned int count = archive_entry_count(archive);
+    unsigned char *selected = (unsigned char *)calloc(count + 1, 1);
+    result = (selected != NULL) ? restore_select(archive, &filter, selected) : BACKUP_ERROR_MEMORY;
+    if (result == BACKUP_ERROR_NO_FILES) {
+        result = BACKUP_SUCCESS;
+    }
+    for (unsigned int i = 0; i < count && result == BACKUP_SUCCESS; i++) {
+        if (selected[i]) {
+            const ArchiveEntry *entry = archive_entry(archive, i);
+            callback(entry, context);
+            last_list_stats.files++;
+            last_list_stats.bytes += entry->item.size;
+        }
+    }
+
+    free(selected);
+    archive_close(archive);
+    last_list_stats.seconds = platform_monotonic_time() - start_time;
+    return result;
+}
+
+// 获取最近一次列出的统计
+void list_get_stats(ListStats *stats) {
+    if (stats != NULL) {
+        *stats = last_list_stats;
+    }
+}
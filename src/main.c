@@ -1,5 +1,153 @@
 #include "main.h"
+#include "backup.h"
+#include "restore.h"
+#include "verify.h"
+#include "list.h"
 #include <stdio.h>
+#include <time.h>
+
+// 打印备份流水线各阶段的统计，输入队列平均深度接近容量的阶段是瓶颈
+static void print_pipeline_stats(void) {
+    PipelineStats stats;
+    backup_get_pipeline_stats(&stats);
+
+    printf("流水线阶段统计：\n");
+    for (int i = 0; i < PIPELINE_STAGE_COUNT; i++) {
+        const PipelineStageStats *stage = &stats.stages[i];
+        if (!stage->enabled) {
+            continue;
+        }
+        if (i == PIPELINE_STAGE_TRAVERSE) {
+            printf("  %s: 找到 %llu 个文件\n", pipeline_stage_name((PipelineStage)i), stats.files);
+            continue;
+        }
+        if (stage->input.capacity == 0) {
+            printf("  %s: 输入 %llu 字节\n", pipeline_stage_name((PipelineStage)i), stage->bytes_in);
+            continue;
+        }
+        double average = (stage->input.pushed > 0) ? (double)stage->input.depth_sum / stage->input.pushed : 0.0;
+        printf("  %s: 输入 %llu 字节，队列深度 平均 %.2f / 最大 %u / 容量 %u，上游等待 %llu 次，本阶段等待 %llu 次\n",
+               pipeline_stage_name((PipelineStage)i), stage->bytes_in, average,
+               stage->input.max_depth, stage->input.capacity,
+               stage->input.full_waits, stage->input.empty_waits);
+    }
+    printf("  瓶颈阶段: %s\n", pipeline_stage_name(pipeline_bottleneck(&stats)));
+
+    if (stats.unchanged_files > 0) {
+        printf("  增量备份: %llu 个文件（%llu 字节）没有变化，未读取\n", stats.unchanged_files, stats.unchanged_bytes);
+    }
+
+    // 吞吐量按源文件数据计算，确实有文件由内核直接复制时同时给出复制的字节数，便于与经过用户态缓冲区的打包比较
+    double throughput = (stats.seconds > 0) ? (double)stats.bytes / stats.seconds / (1024.0 * 1024.0) : 0.0;
+    if (stats.zero_copy && stats.copied_bytes > 0) {
+        printf("  吞吐量: %llu 字节 / %.3f 秒 = %.1f MB/s（零拷贝打包，内核直接复制 %llu 字节）\n",
+               stats.bytes, stats.seconds, throughput, stats.copied_bytes);
+    } else {
+        printf("  吞吐量: %llu 字节 / %.3f 秒 = %.1f MB/s（经过用户态缓冲区）\n", stats.bytes, stats.seconds, throughput);
+    }
+}
+
+// 打印去重备份的分块存储统计，不是去重备份时不打印
+static void print_chunk_stats(void) {
+    ChunkStoreStats stats;
+    backup_get_chunk_stats(&stats);
+    if (stats.chunks == 0) {
+        return;
+    }
+
+    printf("去重统计：\n");
+    printf("  数据 %llu 字节分为 %llu 块，新保存 %llu 块 %llu 字节，分块存储共 %llu 块\n",
+           stats.bytes, stats.chunks, stats.new_chunks, stats.new_bytes, stats.stored_chunks);
+    if (stats.delta_chunks > 0) {
+        printf("  其中 %llu 块（%llu 字节）相对于上一版本按差异保存\n", stats.delta_chunks, stats.delta_bytes);
+    }
+}
+
+// 打印从备份文件直接提取的统计，经过解包处理链还原时没有统计
+static void print_archive_stats(void) {
+    ArchiveStats stats;
+    restore_get_archive_stats(&stats);
+    if (stats.files == 0) {
+        return;
+    }
+
+    double throughput = (stats.seconds > 0) ? (double)stats.bytes / stats.seconds / (1024.0 * 1024.0) : 0.0;
+    printf("提取统计：\n");
+    if (stats.copied_bytes > 0) {
+        printf("  提取 %llu 个文件，%llu 字节 / %.3f 秒 = %.1f MB/s（内核直接复制 %llu 字节）\n",
+               stats.files, stats.bytes, stats.seconds, throughput, stats.copied_bytes);
+    } else {
+        printf("  提取 %llu 个文件，%llu 字节 / %.3f 秒 = %.1f MB/s\n", stats.files, stats.bytes, stats.seconds, throughput);
+    }
+}
+
+// 打印校验发现的问题，由校验线程调用，每个问题一次输出一整行
+static void print_verify_problem(const ArchiveEntry *entry, ArchiveVerifyProblem problem, void *context) {
+    (void)context;
+    const char *reason = "备份数据与内容摘要不符";
+    if (problem == ARCHIVE_VERIFY_UNREADABLE) {
+        reason = "无法读取备份数据";
+    } else if (problem == ARCHIVE_VERIFY_SOURCE_CHANGED) {
+        reason = "与源文件不同";
+    } else if (problem == ARCHIVE_VERIFY_SOURCE_MISSING) {
+        reason = "源文件不存在或无法读取";
+    }
+    printf("  %.*s: %s\n", (int)entry->item.path_length, entry->path, reason);
+}
+
+// 打印校验统计，吞吐量按读取的备份数据计算
+static void print_verify_stats(void) {
+    ArchiveVerifyStats stats;
+    verify_get_stats(&stats);
+
+    double throughput = (stats.seconds > 0) ? (double)stats.bytes / stats.seconds / (1024.0 * 1024.0 * 1024.0) : 0.0;
+    printf("校验统计：\n");
+    printf("  校验 %llu 个文件（其中 %llu 个有内容摘要），%llu 字节 / %.3f 秒 = %.2f GB/s\n",
+           stats.files, stats.hashed_files, stats.bytes, stats.seconds, throughput);
+    if (stats.corrupt + stats.unreadable + stats.source_changed + stats.source_missing > 0) {
+        printf("  数据损坏 %llu 个，无法读取 %llu 个，与源文件不同 %llu 个，源文件缺失 %llu 个\n",
+               stats.corrupt, stats.unreadable, stats.source_changed, stats.source_missing);
+    }
+}
+
+// 打印列出的一个文件：类型、权限、大小、修改时间、路径，符号链接和硬链接还有链接目标
+// 相邻文件的修改时间相同的较多，只在时间变化时重新格式化
+static void print_list_entry(const ArchiveEntry *entry, void *context) {
+    static long long last_time = -1;
+    static char time_text[32] = "";
+    (void)context;
+
+    const Pack2Item *item = &entry->item;
+    if (item->modify_time != last_time) {
+        time_t modify_time = (time_t)item->modify_time;
+        struct tm *local = localtime(&modify_time);
+        if (local == NULL || strftime(time_text, sizeof(time_text), "%Y-%m-%d %H:%M:%S", local) == 0) {
+            strcpy(time_text, "-");
+        }
+        last_time = item->modify_time;
+    }
+
+    char type = '-';
+    if (item->flags & PACK2_ITEM_HARDLINK) {
+        type = 'h';
+    } else if (item->type == FILE_TYPE_DIRECTORY) {
+        type = 'd';
+    } else if (item->type == FILE_TYPE_SYMLINK) {
+        type = 'l';
+    }
+    printf("%c %04o %12llu %s %.*s", type, item->mode & 07777, item->size, time_text, (int)item->path_length, entry->path);
+    if (item->symlink_length > 0) {
+        printf(" %s %.*s", (type == 'h') ? "=>" : "->", (int)item->symlink_length, entry->symlink_target);
+    }
+    putchar('\n');
+}
+
+// 打印列出统计
+static void print_list_stats(void) {
+    ListStats stats;
+    list_get_stats(&stats);
+    printf("共 %llu 个文件，%llu 字节，耗时 %.3f 秒\n", stats.files, stats.bytes, stats.seconds);
+}
 
 // 打印帮助信息
 void print_help() {
@@ -11,11 +159,35 @@ void print_help() {
     printf("    -a <算法>：打包算法（mypack/tar）\n");
     printf("    -c <算法>：压缩算法（none/haff/lz77）\n");
     printf("    -e <算法> <密钥>：加密算法（none/aes/des）和密钥\n");
+    printf("    -j <线程数>：并行遍历目录的线程数（默认使用全部处理器）\n");
+    printf("    -S：按路径排序文件，使备份文件内容与遍历线程的调度无关（需要先完成遍历）\n");
+    printf("    -L：按文件在磁盘上的物理位置排序读取顺序，减少机械硬盘的寻道（需要先完成遍历）\n");
+    printf("    -D：去重仓库，文件数据分块存入目标目录下的分块存储，只保存新的块，上一次的备份文件按时间改名保留（只支持mypack，不能加密）\n");
+    printf("    -I：增量备份（隐含-D，不能压缩），与上一次的备份相比路径、大小、修改时间和inode都没有变化的文件不再读取，修改过的文件的新块相对于上一版本的块按差异保存\n");
     printf("\n");
     printf("还原功能：\n");
     printf("  restore -f <备份文件> -t <目标路径> [选项]\n");
     printf("  选项：\n");
     printf("    -e <算法> <密钥>：解密算法（none/aes/des）和密钥\n");
+    printf("    -p <路径>：只还原指定的文件或目录，可指定多次（需要未压缩、未加密的mypack备份文件）\n");
+    printf("    -i <模式>：只还原与通配符模式匹配的文件，可指定多次（含'/'的模式匹配相对路径，否则匹配文件名；'**'匹配任意多级目录）\n");
+    printf("    -x <文件名>：不还原该文件名的文件\n");
+    printf("    -X <目录>：不还原路径中包含该目录的文件，可指定多次\n");
+    printf("    -z <最小> <最大>：只还原大小在该范围内的文件（字节，最大为0表示不限）\n");
+    printf("    以上筛选条件根据备份文件中的索引判断，不读取未选中的文件的数据，同样需要未压缩、未加密的备份文件\n");
+    printf("    -j <线程数>：同时提取文件的线程数（默认使用全部处理器，需要未压缩、未加密的备份文件）\n");
+    printf("\n");
+    printf("校验功能：\n");
+    printf("  verify -f <备份文件> [选项]\n");
+    printf("  选项：\n");
+    printf("    -s <源路径>：同时与源目录中的文件比较，找出备份后被修改或删除的文件\n");
+    printf("    -j <线程数>：同时校验文件的线程数（默认使用全部处理器，需要未压缩、未加密的备份文件）\n");
+    printf("\n");
+    printf("列出功能：\n");
+    printf("  list -f <备份文件> [选项]\n");
+    printf("  选项：\n");
+    printf("    -p <路径>：只列出指定的文件或目录，可指定多次（只读取索引，需要未压缩、未加密的备份文件）\n");
+    printf("    -i <模式>、-x <文件名>、-X <目录>、-z <最小> <最大>：与还原的筛选条件相同，只列出选中的文件\n");
     printf("\n");
     printf("压缩功能：\n");
     printf("  compress -i <输入文件> -o <输出文件> -a <算法>\n");
@@ -40,6 +212,11 @@ void print_help() {
     printf("示例：\n");
     printf("  backup -s C:\\data -t D:\\backup -a mypack -c haff -e aes 123456\n");
     printf("  restore -f D:\\backup\\backup.dat -t C:\\restore -e aes 123456\n");
+    printf("  restore -f D:\\backup\\backup.dat -t C:\\restore -p config\\app.ini\n");
+    printf("  restore -f D:\\backup\\backup.dat -t C:\\restore -p docs -i *.txt\n");
+    printf("  verify -f D:\\backup\\backup.dat -s C:\\data\n");
+    printf("  list -f D:\\backup\\backup.dat -p config\n");
+    printf("  list -f D:\\backup\\backup.dat -i *.txt -z 1024 0\n");
     printf("  compress -i input.txt -o output.cmp -a haff\n");
     printf("  decompress -i input.cmp -o output.txt\n");
     printf("  encrypt -i input.txt -o output.enc -a aes -k 123456\n");
@@ -47,7 +224,7 @@ void print_help() {
 }
 
 // 解析命令行参数
-int parse_args(int argc, char *argv[], int *operation, BackupOptions *backup_opt, RestoreOptions *restore_opt,
+int parse_args(int argc, char *argv[], int *operation, BackupOptions *backup_opt, RestoreOptions *restore_opt, VerifyOptions *verify_opt, ListOptions *list_opt,
                char *compress_input, char *compress_output, CompressAlgorithm *compress_algorithm,
                char *decompress_input, char *decompress_output,
                char *encrypt_input, char *encrypt_output, EncryptAlgorithm *encrypt_algorithm, char *encrypt_key,
@@ -69,6 +246,10 @@ int parse_args(int argc, char *argv[], int *operation, BackupOptions *backup_opt
         *operation = 4; // 加密
     } else if (strcmp(argv[1], "decrypt") == 0) {
         *operation = 5; // 解密
+    } else if (strcmp(argv[1], "verify") == 0) {
+        *operation = 6; // 校验
+    } else if (strcmp(argv[1], "list") == 0) {
+        *operation = 7; // 列出
     } else {
         return -1;
     }
@@ -110,6 +291,25 @@ int parse_args(int argc, char *argv[], int *operation, BackupOptions *backup_opt
                 }
                 strcpy(backup_opt->encrypt_key, argv[i + 2]);
                 i += 3;
+            } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+                backup_opt->traverse_threads = atoi(argv[i + 1]);
+                if (backup_opt->traverse_threads <= 0) {
+                    return -1;
+                }
+                i += 2;
+            } else if (strcmp(argv[i], "-S") == 0) {
+                backup_opt->traverse_sort = 1;
+                i += 1;
+            } else if (strcmp(argv[i], "-L") == 0) {
+                backup_opt->traverse_layout = 1;
+                i += 1;
+            } else if (strcmp(argv[i], "-D") == 0) {
+                backup_opt->dedup = 1;
+                i += 1;
+            } else if (strcmp(argv[i], "-I") == 0) {
+                backup_opt->dedup = 1;
+                backup_opt->incremental = 1;
+                i += 1;
             } else {
                 return -1;
             }
@@ -141,6 +341,38 @@ int parse_args(int argc, char *argv[], int *operation, BackupOptions *backup_opt
                 }
                 strcpy(restore_opt->encrypt_key, argv[i + 2]);
                 i += 3;
+            } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+                if (restore_opt->path_count >= (int)(sizeof(restore_opt->paths) / sizeof(restore_opt->paths[0]))) {
+                    return -1;
+                }
+                restore_opt->paths[restore_opt->path_count++] = argv[i + 1];
+                i += 2;
+            } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+                if (restore_opt->include_count >= (int)(sizeof(restore_opt->include_patterns) / sizeof(restore_opt->include_patterns[0]))) {
+                    return -1;
+                }
+                restore_opt->include_patterns[restore_opt->include_count++] = argv[i + 1];
+                i += 2;
+            } else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc) {
+                snprintf(restore_opt->exclude_filename.pattern, sizeof(restore_opt->exclude_filename.pattern), "%s", argv[i + 1]);
+                i += 2;
+            } else if (strcmp(argv[i], "-X") == 0 && i + 1 < argc) {
+                if (restore_opt->exclude_directory.count >= (int)(sizeof(restore_opt->exclude_directory.paths) / sizeof(restore_opt->exclude_directory.paths[0]))) {
+                    return -1;
+                }
+                snprintf(restore_opt->exclude_directory.paths[restore_opt->exclude_directory.count++],
+                         sizeof(restore_opt->exclude_directory.paths[0]), "%s", argv[i + 1]);
+                i += 2;
+            } else if (strcmp(argv[i], "-z") == 0 && i + 2 < argc) {
+                restore_opt->size_range.min_size = strtoul(argv[i + 1], NULL, 10);
+                restore_opt->size_range.max_size = strtoul(argv[i + 2], NULL, 10);
+                i += 3;
+            } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+                restore_opt->threads = atoi(argv[i + 1]);
+                if (restore_opt->threads <= 0) {
+                    return -1;
+                }
+                i += 2;
             } else {
                 return -1;
             }
@@ -264,15 +496,93 @@ int parse_args(int argc, char *argv[], int *operation, BackupOptions *backup_opt
             return -1;
         }
     }
+    // 解析校验参数
+    else if (*operation == 6) {
+        int i = 2;
+        while (i < argc) {
+            if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+                // 路径超出选项中的缓冲区时报错，不截断后校验另一个文件
+                if (snprintf(verify_opt->backup_file, sizeof(verify_opt->backup_file), "%s", argv[i + 1]) >= (int)sizeof(verify_opt->backup_file)) {
+                    return BACKUP_ERROR_PARAM;
+                }
+                i += 2;
+            } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+                if (snprintf(verify_opt->source_path, sizeof(verify_opt->source_path), "%s", argv[i + 1]) >= (int)sizeof(verify_opt->source_path)) {
+                    return BACKUP_ERROR_PARAM;
+                }
+                i += 2;
+            } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+                verify_opt->threads = atoi(argv[i + 1]);
+                if (verify_opt->threads <= 0) {
+                    return -1;
+                }
+                i += 2;
+            } else {
+                return -1;
+            }
+        }
+
+        // 检查必需参数
+        if (verify_opt->backup_file[0] == 0) {
+            return -1;
+        }
+    }
+    // 解析列出参数
+    else if (*operation == 7) {
+        int i = 2;
+        while (i < argc) {
+            if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+                if (snprintf(list_opt->backup_file, sizeof(list_opt->backup_file), "%s", argv[i + 1]) >= (int)sizeof(list_opt->backup_file)) {
+                    return BACKUP_ERROR_PARAM;
+                }
+                i += 2;
+            } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+                if (list_opt->path_count >= (int)(sizeof(list_opt->paths) / sizeof(list_opt->paths[0]))) {
+                    return -1;
+                }
+                list_opt->paths[list_opt->path_count++] = argv[i + 1];
+                i += 2;
+            } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+                if (list_opt->include_count >= (int)(sizeof(list_opt->include_patterns) / sizeof(list_opt->include_patterns[0]))) {
+                    return -1;
+                }
+                list_opt->include_patterns[list_opt->include_count++] = argv[i + 1];
+                i += 2;
+            } else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc) {
+                snprintf(list_opt->exclude_filename.pattern, sizeof(list_opt->exclude_filename.pattern), "%s", argv[i + 1]);
+                i += 2;
+            } else if (strcmp(argv[i], "-X") == 0 && i + 1 < argc) {
+                if (list_opt->exclude_directory.count >= (int)(sizeof(list_opt->exclude_directory.paths) / sizeof(list_opt->exclude_directory.paths[0]))) {
+                    return -1;
+                }
+                snprintf(list_opt->exclude_directory.paths[list_opt->exclude_directory.count++],
+                         sizeof(list_opt->exclude_directory.paths[0]), "%s", argv[i + 1]);
+                i += 2;
+            } else if (strcmp(argv[i], "-z") == 0 && i + 2 < argc) {
+                list_opt->size_range.min_size = strtoul(argv[i + 1], NULL, 10);
+                list_opt->size_range.max_size = strtoul(argv[i + 2], NULL, 10);
+                i += 3;
+            } else {
+                return -1;
+            }
+        }
+
+        // 检查必需参数
+        if (list_opt->backup_file[0] == 0) {
+            return -1;
+        }
+    }
 
     return 0;
 }
 
 int main(int argc, char *argv[]) {
-    int operation = -1; // 0: 备份, 1: 还原, 2: 压缩, 3: 解压, 4: 加密, 5: 解密
+    int operation = -1; // 0: 备份, 1: 还原, 2: 压缩, 3: 解压, 4: 加密, 5: 解密, 6: 校验, 7: 列出
     BackupOptions backup_opt = {0};
     RestoreOptions restore_opt = {0};
-    BackupResult result;
+    VerifyOptions verify_opt = {0};
+    ListOptions list_opt = {0};
+    BackupResult result = BACKUP_SUCCESS;
     
     // 压缩相关参数
     char compress_input[256] = {0};
@@ -304,13 +614,13 @@ int main(int argc, char *argv[]) {
     
     // 初始化大小范围：允许所有大小的文件
     backup_opt.size_range.min_size = 0;
-    backup_opt.size_range.max_size = 0xFFFFFFFF;
+    backup_opt.size_range.max_size = 0;
     
     restore_opt.encrypt_enable = 0;
     restore_opt.encrypt_algorithm = ENCRYPT_ALGORITHM_NONE;
 
     // 解析命令行参数
-    if (parse_args(argc, argv, &operation, &backup_opt, &restore_opt,
+    if (parse_args(argc, argv, &operation, &backup_opt, &restore_opt, &verify_opt, &list_opt,
                    compress_input, compress_output, &compress_algorithm,
                    decompress_input, decompress_output,
                    encrypt_input, encrypt_output, &encrypt_algorithm, encrypt_key,
@@ -329,6 +639,8 @@ int main(int argc, char *argv[]) {
             result = backup_data(&backup_opt);
             if (result == BACKUP_SUCCESS) {
                 printf("备份成功！\n");
+                print_pipeline_stats();
+                print_chunk_stats();
             } else {
                 printf("备份失败，错误码: %d\n", result);
             }
@@ -342,6 +654,9 @@ int main(int argc, char *argv[]) {
             result = restore_data(&restore_opt);
             if (result == BACKUP_SUCCESS) {
                 printf("还原成功！\n");
+                print_archive_stats();
+            } else if (result == BACKUP_ERROR_NO_FILES) {
+                printf("还原失败：没有与指定路径和筛选条件匹配的文件\n");
             } else {
                 printf("还原失败，错误码: %d\n", result);
             }
@@ -398,7 +713,45 @@ int main(int argc, char *argv[]) {
                 printf("解密失败，错误码: %d\n", result);
             }
             break;
+
+        case 6: // 校验
+            printf("开始校验备份文件...\n");
+            printf("备份文件: %s\n", verify_opt.backup_file);
+            if (verify_opt.source_path[0] != 0) {
+                printf("源路径: %s\n", verify_opt.source_path);
+            }
+
+            result = verify_data(&verify_opt, print_verify_problem, NULL);
+            if (result == BACKUP_SUCCESS) {
+                // 没有内容摘要的文件（旧格式或Tar备份）只确认可以读取，不能称为校验成功
+                ArchiveVerifyStats verify_stats;
+                verify_get_stats(&verify_stats);
+                if (verify_stats.hashed_files < verify_stats.files) {
+                    printf("校验完成，但 %llu 个文件没有内容摘要，数据未经校验！\n", verify_stats.files - verify_stats.hashed_files);
+                } else {
+                    printf("校验成功！\n");
+                }
+                print_verify_stats();
+            } else if (result == BACKUP_ERROR_CHECKSUM) {
+                printf("校验发现问题！\n");
+                print_verify_stats();
+            } else {
+                printf("校验失败，错误码: %d\n", result);
+            }
+            break;
+
+        case 7: // 列出
+            // 文件较多时输出量大，使用较大的输出缓冲区
+            setvbuf(stdout, NULL, _IOFBF, 1024 * 1024);
+            result = list_data(&list_opt, print_list_entry, NULL);
+            if (result == BACKUP_SUCCESS) {
+                print_list_stats();
+            } else {
+                printf("列出失败，错误码: %d\n", result);
+            }
+            break;
     }
 
-    return 0;
+    // 操作失败（包括校验发现问题）时返回非零退出码，便于脚本和定时任务判断结果
+    return (result == BACKUP_SUCCESS) ? 0 : 1;
 }
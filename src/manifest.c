@@ -0,0 +1,129 @@
+#include "manifest.h"
+#include "platform.h"
+
+#define MANIFEST_SLOT_EMPTY 0xFFFFFFFFu
+
+struct Manifest {
+    Archive *archive;               // 上一次的备份文件
+    unsigned int *slots;            // 按路径查找文件的开放寻址表，保存索引中的位置
+    unsigned int slot_mask;         // 容量减一，容量是2的幂
+};
+
+// 辅助函数：路径的哈希值（FNV-1a）
+static unsigned int manifest_hash(const char *path, size_t length) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)path[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// 打开上一次的备份文件并建立路径哈希表
+BackupResult manifest_open(const char *path, Manifest **manifest) {
+    if (path == NULL || manifest == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+    *manifest = NULL;
+    if (!platform_path_exists(path, NULL)) {
+        return BACKUP_ERROR_PATH;
+    }
+
+    Manifest *result_manifest = (Manifest *)calloc(1, sizeof(Manifest));
+    if (result_manifest == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    // 只有去重备份记录了块引用表，其他备份文件不能沿用
+    BackupResult result = archive_open(path, &result_manifest->archive);
+    if (result != BACKUP_SUCCESS) {
+        goto cleanup;
+    }
+    unsigned int count = archive_entry_count(result_manifest->archive);
+    int chunked = 0;
+    for (unsigned int i = 0; i < count && !chunked; i++) {
+        chunked = (archive_entry(result_manifest->archive, i)->item.flags & PACK2_ITEM_CHUNKED) != 0;
+    }
+    if (!chunked) {
+        result = BACKUP_ERROR_PACK;
+        goto cleanup;
+    }
+
+    // 哈希表的装载率不超过一半
+    unsigned int capacity = 1024;
+    while (capacity < count * 2) {
+        capacity *= 2;
+    }
+    result_manifest->slots = (unsigned int *)malloc((size_t)capacity * sizeof(unsigned int));
+    if (result_manifest->slots == NULL) {
+        result = BACKUP_ERROR_MEMORY;
+        goto cleanup;
+    }
+    memset(result_manifest->slots, 0xFF, (size_t)capacity * sizeof(unsigned int));
+    result_manifest->slot_mask = capacity - 1;
+
+    for (unsigned int i = 0; i < count; i++) {
+        const ArchiveEntry *entry = archive_entry(result_manifest->archive, i);
+        unsigned int slot = manifest_hash(entry->path, entry->item.path_length) & result_manifest->slot_mask;
+        while (result_manifest->slots[slot] != MANIFEST_SLOT_EMPTY) {
+            slot = (slot + 1) & result_manifest->slot_mask;
+        }
+        result_manifest->slots[slot] = i;
+    }
+
+cleanup:
+    if (result != BACKUP_SUCCESS) {
+        manifest_close(result_manifest);
+        return result;
+    }
+    *manifest = result_manifest;
+    return BACKUP_SUCCESS;
+}
+
+// 关闭上一次的备份文件
+void manifest_close(Manifest *manifest) {
+    if (manifest != NULL) {
+        archive_close(manifest->archive);
+        free(manifest->slots);
+        free(manifest);
+    }
+}
+
+// 按路径查找文件项
+const ArchiveEntry *manifest_find(const Manifest *manifest, const char *path) {
+    if (manifest == NULL) {
+        return NULL;
+    }
+
+    size_t length = strlen(path);
+    unsigned int slot = manifest_hash(path, length) & manifest->slot_mask;
+    for (; manifest->slots[slot] != MANIFEST_SLOT_EMPTY; slot = (slot + 1) & manifest->slot_mask) {
+        const ArchiveEntry *previous = archive_entry(manifest->archive, manifest->slots[slot]);
+        if (previous->item.path_length == length && memcmp(previous->path, path, length) == 0) {
+            return previous;
+        }
+    }
+    return NULL;
+}
+
+// 查找没有变化的文件
+const ArchiveEntry *manifest_find_unchanged(const Manifest *manifest, const char *path, const CatalogEntry *entry) {
+    if (manifest == NULL || entry->type != FILE_TYPE_REGULAR) {
+        return NULL;
+    }
+
+    const ArchiveEntry *previous = manifest_find(manifest, path);
+    if (previous == NULL) {
+        return NULL;
+    }
+    const Pack2Item *item = &previous->item;
+    if ((item->flags & PACK2_ITEM_CHUNKED) && item->type == (unsigned int)entry->type && item->size == entry->size &&
+        item->modify_time == entry->modify_time && item->inode == entry->inode) {
+        return previous;
+    }
+    return NULL;
+}
+
+// 文件项的块引用表
+const unsigned char *manifest_chunks(const Manifest *manifest, const ArchiveEntry *entry) {
+    return archive_entry_data(manifest->archive, entry);
+}
@@ -1,4 +1,6 @@
 #include "main.h"
+
+#ifdef _WIN32
 #include <windows.h>
 
 // 获取文件元数据
@@ -133,3 +135,94 @@ BackupResult set_file_metadata(const char *path, const FileMetadata *metadata) {
 
     return BACKUP_SUCCESS;
 }
+
+#else
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// 获取文件元数据（符号链接本身的元数据，不跟随链接）
+BackupResult get_file_metadata(const char *path, FileMetadata *metadata) {
+    if (path == NULL || metadata == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    struct stat st;
+    if (lstat(path, &st) != 0) {
+        return BACKUP_ERROR_FILE;
+    }
+
+    // 初始化元数据
+    memset(metadata, 0, sizeof(FileMetadata));
+    strncpy(metadata->path, path, sizeof(metadata->path) - 1);
+
+    // 提取文件名
+    const char *filename = strrchr(path, '/');
+    strncpy(metadata->name, (filename != NULL) ? filename + 1 : path, sizeof(metadata->name) - 1);
+
+    // 确定文件类型
+    if (S_ISDIR(st.st_mode)) {
+        metadata->type = FILE_TYPE_DIRECTORY;
+    } else if (S_ISLNK(st.st_mode)) {
+        metadata->type = FILE_TYPE_SYMLINK;
+        ssize_t length = readlink(path, metadata->symlink_target, sizeof(metadata->symlink_target) - 1);
+        if (length >= 0) {
+            metadata->symlink_target[length] = '\0';
+        }
+    } else if (S_ISBLK(st.st_mode)) {
+        metadata->type = FILE_TYPE_BLOCK;
+    } else if (S_ISCHR(st.st_mode)) {
+        metadata->type = FILE_TYPE_CHARACTER;
+    } else if (S_ISSOCK(st.st_mode)) {
+        metadata->type = FILE_TYPE_SOCKET;
+    } else if (S_ISFIFO(st.st_mode)) {
+        metadata->type = FILE_TYPE_FIFO;
+    } else {
+        metadata->type = FILE_TYPE_REGULAR;
+    }
+
+    // 只有普通文件需要打包数据
+    metadata->size = (metadata->type == FILE_TYPE_REGULAR) ? (unsigned long)st.st_size : 0;
+
+    // POSIX没有通用的创建时间，使用状态改变时间代替
+    metadata->create_time = st.st_ctime;
+    metadata->modify_time = st.st_mtime;
+    metadata->access_time = st.st_atime;
+
+    metadata->mode = st.st_mode & 07777;
+    metadata->uid = st.st_uid;
+    metadata->gid = st.st_gid;
+
+    return BACKUP_SUCCESS;
+}
+
+// 设置文件元数据
+BackupResult set_file_metadata(const char *path, const FileMetadata *metadata) {
+    if (path == NULL || metadata == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    // 设置访问时间和修改时间（创建时间无法设置）
+    struct timespec times[2];
+    times[0].tv_sec = metadata->access_time;
+    times[0].tv_nsec = 0;
+    times[1].tv_sec = metadata->modify_time;
+    times[1].tv_nsec = 0;
+    if (utimensat(AT_FDCWD, path, times, AT_SYMLINK_NOFOLLOW) != 0) {
+        return BACKUP_ERROR_FILE;
+    }
+
+    // 设置文件权限，符号链接的权限没有意义
+    if (metadata->type != FILE_TYPE_SYMLINK && chmod(path, metadata->mode & 07777) != 0) {
+        return BACKUP_ERROR_FILE;
+    }
+
+    // 设置所有者需要特权，非特权用户还原时失败是正常的，忽略错误
+    if (lchown(path, metadata->uid, metadata->gid) != 0) {
+        // 保留当前用户作为所有者
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+#endif
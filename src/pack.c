@@ -1,543 +1,2016 @@
 #include "pack.h"
 #include "main.h"
-#include <windows.h>
+#include "platform.h"
+#include "dir_cache.h"
+#include "manifest.h"
+#include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
 
-// MyPack打包实现
-BackupResult mypack_pack(FILE *fp, const FileMetadata *files, int file_count) {
-    PackHeader header;
-    PackFileItem *items = NULL;
-    unsigned long data_offset = 0;
-    int i;
+// 打包时读取源文件的缓冲区大小
+#define PACK_BUFFER_SIZE STREAM_BUFFER_SIZE
 
-    // 分配文件项数组
-    items = (PackFileItem *)malloc(file_count * sizeof(PackFileItem));
-    if (items == NULL) {
-        return BACKUP_ERROR_MEMORY;
-    }
+// 解包时Tar长名称记录中名称的最大字节数，更长的记录视为损坏
+#define TAR_LONG_NAME_MAX 65536
 
-    // 计算头部大小和数据偏移量
-    header.magic[0] = 'B';
-    header.magic[1] = 'A';
-    header.magic[2] = 'C';
-    header.magic[3] = 'K';
-    header.version = 1;
-    header.file_count = file_count;
-    header.header_size = sizeof(PackHeader) + file_count * sizeof(PackFileItem);
-    data_offset = header.header_size;
-    header.data_offset = data_offset;
-
-    // 写入头部
-    if (write_pack_header(fp, &header) != BACKUP_SUCCESS) {
-        free(items);
-        return BACKUP_ERROR_PACK;
+// 打开文件数据的读取端，未指定数据来源时从磁盘读取
+static ByteReader *pack_source_open(PackSource *source, const char *path, unsigned long long size) {
+    if (source != NULL && source->open != NULL) {
+        return source->open(source, path, size);
     }
+    return file_reader_open(path);
+}
 
-    // 写入文件项并计算偏移量
-    for (i = 0; i < file_count; i++) {
-        // 填充文件项
-        strcpy(items[i].path, files[i].path);
-        strcpy(items[i].name, files[i].name);
-        items[i].type = files[i].type;
-        items[i].size = files[i].size;
-        items[i].offset = data_offset;
-        items[i].create_time = files[i].create_time;
-        items[i].modify_time = files[i].modify_time;
-        items[i].access_time = files[i].access_time;
-        items[i].mode = files[i].mode;
-        items[i].uid = files[i].uid;
-        items[i].gid = files[i].gid;
-        strcpy(items[i].symlink_target, files[i].symlink_target);
-
-        // 写入文件项
-        if (write_pack_file_item(fp, &items[i]) != BACKUP_SUCCESS) {
-            free(items);
-            return BACKUP_ERROR_PACK;
-        }
+// 将文件数据写入处理链，写入长度严格等于打包时记录的大小
+// 如果文件在遍历之后发生了变化，超出部分被截断，不足部分补零，保证数据偏移量与文件项一致
+// 数据由数据来源直接复制时copy_hash（不为NULL时）返回复制的数据的内容摘要
+static BackupResult pack_file_data(ByteWriter *writer, PackSource *source, const char *path, unsigned long long size, unsigned char *buffer,
+                                   unsigned long long *copy_hash) {
+    if (source != NULL && source->copy != NULL) {
+        return source->copy(source, writer, path, size, copy_hash);
+    }
 
-        // 更新数据偏移量
-        data_offset += files[i].size;
+    ByteReader *reader = pack_source_open(source, path, size);
+    if (reader == NULL) {
+        return BACKUP_ERROR_FILE;
     }
 
-    // 写入文件数据
-    for (i = 0; i < file_count; i++) {
-        FILE *src_fp = fopen(files[i].path, "rb");
-        if (src_fp == NULL) {
-            free(items);
-            return BACKUP_ERROR_FILE;
+    BackupResult result = BACKUP_SUCCESS;
+    unsigned long long remaining = size;
+    while (remaining > 0) {
+        size_t chunk = (remaining < PACK_BUFFER_SIZE) ? remaining : PACK_BUFFER_SIZE;
+        size_t bytes_read = 0;
+        result = stream_read(reader, buffer, chunk, &bytes_read);
+        if (result != BACKUP_SUCCESS) {
+            break;
         }
-
-        // 定位到文件数据位置
-        if (fseek(fp, items[i].offset, SEEK_SET) != 0) {
-            fclose(src_fp);
-            free(items);
-            return BACKUP_ERROR_FILE;
+        if (bytes_read == 0) {
+            // 文件变短，补零
+            memset(buffer, 0, chunk);
+            bytes_read = chunk;
         }
 
-        // 复制文件数据
-        char buffer[4096];
-        size_t bytes_read, bytes_written;
-        while ((bytes_read = fread(buffer, 1, sizeof(buffer), src_fp)) > 0) {
-            bytes_written = fwrite(buffer, 1, bytes_read, fp);
-            if (bytes_written != bytes_read) {
-                fclose(src_fp);
-                free(items);
-                return BACKUP_ERROR_FILE;
-            }
+        result = stream_write(writer, buffer, bytes_read);
+        if (result != BACKUP_SUCCESS) {
+            break;
         }
+        remaining -= bytes_read;
+    }
+
+    reader_destroy(reader);
+    return result;
+}
+
+// 直接从磁盘读取的稀疏文件
+typedef struct {
+    FILE *fp;
+    PlatformExtent *extents;        // 数据段，按偏移量升序
+    unsigned int count;
+    unsigned long long data_size;   // 数据段的总字节数
+} PackSparse;
 
-        fclose(src_fp);
+// 辅助函数：打开稀疏文件并查找前size字节中的数据段
+static BackupResult pack_sparse_open(PackSparse *sparse, const char *path, unsigned long long size) {
+    memset(sparse, 0, sizeof(PackSparse));
+    sparse->fp = fopen(path, "rb");
+    if (sparse->fp == NULL) {
+        return BACKUP_ERROR_FILE;
     }
 
-    // 清理资源
-    free(items);
+    BackupResult result = platform_file_extents(sparse->fp, size, &sparse->extents, &sparse->count);
+    if (result != BACKUP_SUCCESS) {
+        fclose(sparse->fp);
+        sparse->fp = NULL;
+        return result;
+    }
+    for (unsigned int i = 0; i < sparse->count; i++) {
+        sparse->data_size += sparse->extents[i].length;
+    }
     return BACKUP_SUCCESS;
 }
 
-// Tar打包实现
-BackupResult tar_pack(FILE *fp, const FileMetadata *files, int file_count) {
-    // 简化的Tar格式实现
-    char header[512];
-    int i;
-
-    for (i = 0; i < file_count; i++) {
-        // 清空Tar文件头
-        memset(header, 0, 512);
-        
-        // 文件名（100字节）
-        strncpy(header, files[i].name, 100);
-        
-        // 文件模式（8字节，八进制）
-        sprintf(header + 100, "%07o", files[i].mode);
-        
-        // UID（8字节，八进制）
-        sprintf(header + 108, "%07o", files[i].uid);
-        
-        // GID（8字节，八进制）
-        sprintf(header + 116, "%07o", files[i].gid);
-        
-        // 文件大小（12字节，八进制）
-        sprintf(header + 124, "%011lo", (unsigned long)files[i].size);
-        
-        // 修改时间（12字节，八进制）
-        sprintf(header + 136, "%011lo", (unsigned long)files[i].modify_time);
-        
-        // 类型标志（1字节）
-        header[156] = '0'; // 普通文件
-        
-        // 魔术字（8字节）
-        strcpy(header + 257, "ustar  ");
-        
-        // 写入文件头
-        if (fwrite(header, 1, 512, fp) != 512) {
-            return BACKUP_ERROR_FILE;
+// 辅助函数：关闭稀疏文件
+static void pack_sparse_close(PackSparse *sparse) {
+    if (sparse->fp != NULL) {
+        fclose(sparse->fp);
+    }
+    free(sparse->extents);
+    memset(sparse, 0, sizeof(PackSparse));
+}
+
+// 辅助函数：写入length字节的零
+static BackupResult pack_write_zeros(ByteWriter *writer, unsigned long long length, unsigned char *buffer) {
+    size_t filled = (length < PACK_BUFFER_SIZE) ? (size_t)length : PACK_BUFFER_SIZE;
+    memset(buffer, 0, filled);
+    while (length > 0) {
+        size_t chunk = (length < filled) ? (size_t)length : filled;
+        BackupResult result = stream_write(writer, buffer, chunk);
+        if (result != BACKUP_SUCCESS) {
+            return result;
         }
-        
-        // 写入文件数据
-        FILE *src_fp = fopen(files[i].path, "rb");
-        if (src_fp == NULL) {
-            return BACKUP_ERROR_FILE;
+        length -= chunk;
+    }
+    return BACKUP_SUCCESS;
+}
+
+// 辅助函数：写入稀疏文件的数据段，只读取数据段，文件变短时补零
+// holes不为0时空洞部分写入零，写入长度严格等于size；为0时只依次写入各数据段的数据
+static BackupResult pack_sparse_data(ByteWriter *writer, const PackSparse *sparse, unsigned long long size, int holes, unsigned char *buffer) {
+    BackupResult result = BACKUP_SUCCESS;
+    unsigned long long position = 0;
+
+    for (unsigned int i = 0; i < sparse->count && result == BACKUP_SUCCESS; i++) {
+        const PlatformExtent *extent = &sparse->extents[i];
+        if (holes) {
+            result = pack_write_zeros(writer, extent->offset - position, buffer);
+        }
+        if (result == BACKUP_SUCCESS) {
+            result = platform_seek(sparse->fp, (long long)extent->offset, SEEK_SET);
         }
-        
-        char buffer[4096];
-        size_t bytes_read, bytes_written;
-        size_t remaining = files[i].size;
-        while (remaining > 0) {
-            bytes_read = fread(buffer, 1, (remaining < sizeof(buffer)) ? remaining : sizeof(buffer), src_fp);
+
+        unsigned long long remaining = extent->length;
+        while (result == BACKUP_SUCCESS && remaining > 0) {
+            size_t chunk = (remaining < PACK_BUFFER_SIZE) ? (size_t)remaining : PACK_BUFFER_SIZE;
+            size_t bytes_read = fread(buffer, 1, chunk, sparse->fp);
             if (bytes_read == 0) {
-                fclose(src_fp);
-                return BACKUP_ERROR_FILE;
-            }
-            
-            bytes_written = fwrite(buffer, 1, bytes_read, fp);
-            if (bytes_written != bytes_read) {
-                fclose(src_fp);
-                return BACKUP_ERROR_FILE;
-            }
-            
-            remaining -= bytes_written;
-        }
-        
-        fclose(src_fp);
-        
-        // 填充到512字节的倍数
-        if (files[i].size % 512 != 0) {
-            size_t padding = 512 - (files[i].size % 512);
-            memset(buffer, 0, padding);
-            if (fwrite(buffer, 1, padding, fp) != padding) {
-                return BACKUP_ERROR_FILE;
+                if (ferror(sparse->fp)) {
+                    result = BACKUP_ERROR_FILE;
+                    break;
+                }
+                // 文件变短，补零
+                memset(buffer, 0, chunk);
+                bytes_read = chunk;
             }
+            result = stream_write(writer, buffer, bytes_read);
+            remaining -= bytes_read;
         }
+        position = extent->offset + extent->length;
     }
-    
-    // 写入两个512字节的结束块
-    char end_block[512] = {0};
-    if (fwrite(end_block, 1, 512, fp) != 512 || 
-        fwrite(end_block, 1, 512, fp) != 512) {
-        return BACKUP_ERROR_FILE;
+
+    if (result == BACKUP_SUCCESS && holes) {
+        result = pack_write_zeros(writer, size - position, buffer);
     }
-    
-    return BACKUP_SUCCESS;
+    return result;
 }
 
-// 打包文件
-BackupResult pack_files(const char *output_path, const FileMetadata *files, int file_count, PackAlgorithm algorithm) {
-    FILE *fp = NULL;
-    BackupResult result = BACKUP_SUCCESS;
+// 辅助函数：填写Tar文件路径，超过100字节的路径在'/'处拆分，前半部分写入ustar前缀字段（155字节）
+static int tar_set_path(char *header, const char *path) {
+    size_t length = strlen(path);
+    if (length <= 100) {
+        memcpy(header, path, length);
+        return 0;
+    }
 
-    // 检查参数
-    if (output_path == NULL || files == NULL || file_count <= 0) {
-        return BACKUP_ERROR_PARAM;
+    // 从后向前查找使两部分都放得下的分隔位置
+    for (size_t i = length - 1; i > 0; i--) {
+        if (path[i] == '/' && i <= 155 && length - i - 1 <= 100) {
+            memcpy(header + 345, path, i);
+            memcpy(header, path + i + 1, length - i - 1);
+            return 0;
+        }
+        if (length - i > 101) {
+            break;
+        }
     }
+    return -1;
+}
 
-    // 打开输出文件
-    fp = fopen(output_path, "wb");
-    if (fp == NULL) {
-        return BACKUP_ERROR_FILE;
+// 辅助函数：填写Tar文件大小字段（12字节），超过11位八进制数（8GB）时使用GNU的base-256编码
+static void tar_set_size(char *field, unsigned long long size) {
+    if (size <= 077777777777ULL) {
+        sprintf(field, "%011llo", size);
+        return;
+    }
+    field[0] = (char)0x80;
+    for (int i = 11; i > 0; i--) {
+        field[i] = (char)(size & 0xFF);
+        size >>= 8;
     }
+}
 
-    // 根据算法选择打包方式
-    switch (algorithm) {
-        case PACK_ALGORITHM_MYPACK:
-            result = mypack_pack(fp, files, file_count);
-            break;
-        case PACK_ALGORITHM_TAR:
-            result = tar_pack(fp, files, file_count);
-            break;
-        default:
-            result = mypack_pack(fp, files, file_count);
-            break;
+// 辅助函数：解析Tar文件大小字段，支持base-256编码
+static unsigned long long tar_parse_size(const char *field) {
+    unsigned long long size = 0;
+    if ((unsigned char)field[0] & 0x80) {
+        for (int i = 1; i < 12; i++) {
+            size = (size << 8) | (unsigned char)field[i];
+        }
+        return size;
     }
 
-    // 清理资源
-    fclose(fp);
-    return result;
+    char size_str[13] = {0};
+    strncpy(size_str, field, 12);
+    sscanf(size_str, "%llo", &size);
+    return size;
 }
 
-// MyPack解包实现
-BackupResult mypack_unpack(FILE *fp, FileMetadata **files, int *file_count) {
-    PackHeader header;
-    PackFileItem *items = NULL;
-    int i;
+// MyPack索引引用的文件：索引在结束时根据目录清单生成，打包过程中只记录编号和数据偏移量
+typedef struct {
+    unsigned int id;
+    unsigned long long offset;
+    unsigned int flags;            // 文件项标志和数据段数量，不能从目录清单得到
+    unsigned int extent_count;
+    unsigned int link;             // 硬链接到的文件编号，不是硬链接时为CATALOG_NONE
+    unsigned long long content_hash; // 内容摘要，文件数据写完后才得到
+} PackIndexRef;
 
-    // 读取头部
-    if (read_pack_header(fp, &header) != BACKUP_SUCCESS) {
-        return BACKUP_ERROR_PACK;
+// 计算内容摘要的写入端：数据计入摘要后原样写入target
+typedef struct {
+    ByteWriter base;
+    ByteWriter *target;
+    Xxh64 state;
+} PackHashWriter;
+
+// 流式打包状态
+struct PackStream {
+    ByteWriter *writer;
+    PackAlgorithm algorithm;
+    PackSource *source;
+    unsigned char *buffer;
+    char *path;                    // 当前文件的相对路径
+    size_t path_capacity;
+    unsigned long long position;   // 已写入的字节数
+    CatalogLinks links;            // 已保存数据的硬链接组
+    char *target;                  // 硬链接到的文件的相对路径
+    size_t target_capacity;
+    ByteWriter *chunker;           // 去重打包时的分块写入端，文件数据存入分块存储（否则为NULL）
+    const Manifest *previous;      // 增量备份时上一次的备份清单（否则为NULL）
+    PackHashWriter hasher;         // 当前文件的内容摘要
+    const Catalog *catalog;        // MyPack索引引用的目录清单
+    PackIndexRef *index;           // MyPack索引引用的文件
+    unsigned int index_count;
+    unsigned int index_capacity;
+};
+
+// 格式是否支持流式打包（不需要预先知道文件数量）
+int pack_stream_supported(PackAlgorithm algorithm) {
+    return algorithm == PACK_ALGORITHM_TAR || algorithm == PACK_ALGORITHM_MYPACK;
+}
+
+// 辅助函数：写入处理链并累计写入位置
+static BackupResult pack_stream_write(PackStream *stream, const void *data, size_t size) {
+    BackupResult result = stream_write(stream->writer, data, size);
+    if (result == BACKUP_SUCCESS) {
+        stream->position += size;
     }
+    return result;
+}
 
-    // 检查魔术字
-    if (memcmp(header.magic, "BACK", 4) != 0) {
-        return BACKUP_ERROR_PACK;
+// 计算内容摘要的写入端：写入数据
+static BackupResult pack_hash_write(ByteWriter *writer, const unsigned char *data, size_t size) {
+    PackHashWriter *hasher = (PackHashWriter *)writer;
+    xxh64_update(&hasher->state, data, size);
+    return stream_write(hasher->target, data, size);
+}
+
+// 辅助函数：开始计算一个文件的内容摘要，返回写入文件数据的写入端
+static ByteWriter *pack_hash_begin(PackHashWriter *hasher, ByteWriter *target) {
+    memset(&hasher->base, 0, sizeof(ByteWriter));
+    hasher->base.write = pack_hash_write;
+    hasher->target = target;
+    xxh64_init(&hasher->state, PACK2_HASH_SEED);
+    return &hasher->base;
+}
+
+// 辅助函数：文件数据是否由数据来源直接写入备份文件，不经过打包模块
+static int pack_source_direct(const PackSource *source, unsigned long long size) {
+    return source != NULL && source->copy != NULL && size >= source->copy_min_size;
+}
+
+// 辅助函数：创建流式打包状态，store不为NULL时为去重打包，previous不为NULL时为增量备份
+static PackStream *pack_stream_init(ByteWriter *writer, PackAlgorithm algorithm, PackSource *source, ChunkStore *store, const Manifest *previous) {
+    if (writer == NULL || !pack_stream_supported(algorithm)) {
+        return NULL;
     }
 
-    // 分配文件项数组
-    items = (PackFileItem *)malloc(header.file_count * sizeof(PackFileItem));
-    if (items == NULL) {
-        return BACKUP_ERROR_MEMORY;
+    PackStream *stream = (PackStream *)calloc(1, sizeof(PackStream));
+    if (stream == NULL) {
+        return NULL;
+    }
+    stream->buffer = (unsigned char *)malloc(PACK_BUFFER_SIZE);
+    if (stream->buffer == NULL) {
+        free(stream);
+        return NULL;
+    }
+    stream->writer = writer;
+    stream->algorithm = algorithm;
+    stream->source = source;
+    stream->previous = previous;
+    catalog_links_init(&stream->links);
+    if (store != NULL) {
+        stream->chunker = chunk_writer_create(store);
+        if (stream->chunker == NULL) {
+            pack_stream_destroy(stream);
+            return NULL;
+        }
     }
 
-    // 读取文件项
-    for (i = 0; i < header.file_count; i++) {
-        if (read_pack_file_item(fp, &items[i]) != BACKUP_SUCCESS) {
-            free(items);
-            return BACKUP_ERROR_PACK;
+    // MyPack版本2以魔术字和版本号开头
+    if (algorithm == PACK_ALGORITHM_MYPACK) {
+        Pack2Signature signature;
+        memcpy(signature.magic, "BACK", 4);
+        signature.version = PACK_VERSION_2;
+        if (pack_stream_write(stream, &signature, sizeof(Pack2Signature)) != BACKUP_SUCCESS) {
+            pack_stream_destroy(stream);
+            return NULL;
         }
     }
+    return stream;
+}
 
-    // 分配输出文件元数据数组
-    *files = (FileMetadata *)malloc(header.file_count * sizeof(FileMetadata));
-    if (*files == NULL) {
-        free(items);
-        return BACKUP_ERROR_MEMORY;
+// 创建流式打包状态，格式不支持流式打包时返回NULL
+PackStream *pack_stream_create(ByteWriter *writer, PackAlgorithm algorithm, PackSource *source) {
+    return pack_stream_init(writer, algorithm, source, NULL, NULL);
+}
+
+// 创建去重打包的流式打包状态
+PackStream *pack_stream_create_chunked(ByteWriter *writer, PackSource *source, ChunkStore *store, const Manifest *previous) {
+    if (store == NULL) {
+        return NULL;
     }
-    *file_count = header.file_count;
-
-    // 提取文件数据
-    for (i = 0; i < header.file_count; i++) {
-        // 填充输出文件元数据
-        strcpy((*files)[i].path, items[i].path);
-        strcpy((*files)[i].name, items[i].name);
-        (*files)[i].type = items[i].type;
-        (*files)[i].size = items[i].size;
-        (*files)[i].create_time = items[i].create_time;
-        (*files)[i].modify_time = items[i].modify_time;
-        (*files)[i].access_time = items[i].access_time;
-        (*files)[i].mode = items[i].mode;
-        (*files)[i].uid = items[i].uid;
-        (*files)[i].gid = items[i].gid;
-        strcpy((*files)[i].symlink_target, items[i].symlink_target);
-
-        // 定位到文件数据位置
-        if (fseek(fp, items[i].offset, SEEK_SET) != 0) {
-            free(items);
-            free(*files);
-            return BACKUP_ERROR_FILE;
-        }
+    return pack_stream_init(writer, PACK_ALGORITHM_MYPACK, source, store, previous);
+}
 
-        // 创建目录结构
-        char dir_path[256];
-        strcpy(dir_path, items[i].path);
-        char *last_slash = strrchr(dir_path, '\\');
-        if (last_slash != NULL) {
-            *last_slash = '\0';
-            // 递归创建目录
-            char temp_path[256];
-            strcpy(temp_path, dir_path);
-            
-            // 创建目录（递归）
-            char *ptr = temp_path + 1;
-            while ((ptr = strchr(ptr, '\\')) != NULL) {
-                *ptr = '\0';
-                CreateDirectory(temp_path, NULL);
-                *ptr = '\\';
-                ptr++;
-            }
-            
-            // 创建最终目录
-            CreateDirectory(temp_path, NULL);
+// 辅助函数：文件项中符号链接目标位置保存的内容：硬链接是链接到的文件的路径（构建在stream->target中），其他文件是符号链接目标
+static BackupResult mypack_item_target(PackStream *stream, const Catalog *catalog, unsigned int id, unsigned int link, const char **target) {
+    if (link == CATALOG_NONE) {
+        *target = catalog_symlink_target(catalog, id);
+        return BACKUP_SUCCESS;
+    }
+    BackupResult result = catalog_path_buffer(catalog, link, &stream->target, &stream->target_capacity);
+    *target = stream->target;
+    return result;
+}
+
+// 辅助函数：填写MyPack版本2的文件项，路径已在stream->path中
+static void mypack_fill_item(PackStream *stream, const Catalog *catalog, unsigned int id, unsigned long long offset, const char *target, Pack2Item *item) {
+    const CatalogEntry *entry = catalog_entry(catalog, id);
+
+    memset(item, 0, sizeof(Pack2Item));
+    item->offset = offset;
+    item->size = entry->size;
+    item->create_time = entry->create_time;
+    item->modify_time = entry->modify_time;
+    item->access_time = entry->access_time;
+    item->type = entry->type;
+    item->mode = entry->mode;
+    item->uid = entry->uid;
+    item->gid = entry->gid;
+    item->path_length = (unsigned int)strlen(stream->path);
+    item->symlink_length = (unsigned int)strlen(target);
+    item->inode = entry->inode;
+}
+
+// 辅助函数：写入文件项及其后的路径和符号链接目标
+static BackupResult mypack_write_item(PackStream *stream, const char *target, const Pack2Item *item) {
+    BackupResult result = pack_stream_write(stream, item, sizeof(Pack2Item));
+    if (result == BACKUP_SUCCESS) {
+        result = pack_stream_write(stream, stream->path, item->path_length);
+    }
+    if (result == BACKUP_SUCCESS && item->symlink_length > 0) {
+        result = pack_stream_write(stream, target, item->symlink_length);
+    }
+    return result;
+}
+
+// 辅助函数：去重打包时把普通文件的数据按内容分块存入分块存储，块引用留在分块写入端中
+// 稀疏文件的空洞按零写入，全零的块只保存一次；writer是分块写入端或其前面计算内容摘要的写入端
+static BackupResult mypack_chunk_file(PackStream *stream, ByteWriter *writer, const PackSparse *sparse, int is_sparse, unsigned long long size) {
+    BackupResult result;
+    if (is_sparse) {
+        result = pack_sparse_data(writer, sparse, size, 1, stream->buffer);
+    } else {
+        result = pack_file_data(writer, stream->source, stream->path, size, stream->buffer, NULL);
+    }
+    if (result == BACKUP_SUCCESS) {
+        result = stream->chunker->finish(stream->chunker);
+    }
+    return result;
+}
+
+// 写入一个MyPack文件记录：标记、文件项、路径、符号链接目标和文件数据，并记入索引
+// 有空洞的稀疏文件只保存数据段表和数据段，同一文件已经保存过数据的硬链接只记录链接到的路径，
+// 去重打包时普通文件的数据先存入分块存储，文件数据位置只保存块引用表，增量备份时没有变化的文件直接沿用上一次的块引用表；
+// 普通文件的数据经过打包模块时同时计算内容摘要，写在文件数据之后
+static BackupResult mypack_pack_file(PackStream *stream, const Catalog *catalog, unsigned int id) {
+    if (stream->catalog != NULL && stream->catalog != catalog) {
+        return BACKUP_ERROR_PARAM;
+    }
+    stream->catalog = catalog;
+
+    BackupResult result = catalog_path_buffer(catalog, id, &stream->path, &stream->path_capacity);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+
+    // 记入索引
+    if (stream->index_count == stream->index_capacity) {
+        unsigned int capacity = (stream->index_capacity > 0) ? stream->index_capacity * 2 : 1024;
+        PackIndexRef *index = (PackIndexRef *)realloc(stream->index, capacity * sizeof(PackIndexRef));
+        if (index == NULL) {
+            return BACKUP_ERROR_MEMORY;
         }
+        stream->index = index;
+        stream->index_capacity = capacity;
+    }
 
-        // 写入文件数据
-        FILE *dst_fp = fopen(items[i].path, "wb");
-        if (dst_fp == NULL) {
-            free(items);
-            free(*files);
-            return BACKUP_ERROR_FILE;
+    unsigned int link;
+    const char *target;
+    result = catalog_link_source(catalog, &stream->links, id, &link);
+    if (result == BACKUP_SUCCESS) {
+        result = mypack_item_target(stream, catalog, id, link, &target);
+    }
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+
+    const ArchiveEntry *unchanged = NULL;
+    if (link == CATALOG_NONE && stream->chunker != NULL) {
+        unchanged = manifest_find_unchanged(stream->previous, stream->path, catalog_entry(catalog, id));
+    }
+
+    PackSparse sparse;
+    memset(&sparse, 0, sizeof(PackSparse));
+    int is_sparse = link == CATALOG_NONE && unchanged == NULL && (catalog_entry(catalog, id)->flags & CATALOG_FLAG_SPARSE) != 0;
+    if (is_sparse) {
+        result = pack_sparse_open(&sparse, stream->path, catalog_entry(catalog, id)->size);
+        if (result != BACKUP_SUCCESS) {
+            return result;
         }
+    }
 
-        char buffer[4096];
-        size_t bytes_read, bytes_written;
-        size_t remaining = items[i].size;
-        while (remaining > 0) {
-            bytes_read = fread(buffer, 1, (remaining < sizeof(buffer)) ? remaining : sizeof(buffer), fp);
-            if (bytes_read == 0) {
-                fclose(dst_fp);
-                free(items);
-                free(*files);
-                return BACKUP_ERROR_FILE;
-            }
+    // 文件数据紧随文件项、路径和符号链接目标之后
+    Pack2Item item;
+    mypack_fill_item(stream, catalog, id, 0, target, &item);
+    item.offset = stream->position + PACK2_TAG_SIZE + sizeof(Pack2Item) + item.path_length + item.symlink_length;
 
-            bytes_written = fwrite(buffer, 1, bytes_read, dst_fp);
-            if (bytes_written != bytes_read) {
-                fclose(dst_fp);
-                free(items);
-                free(*files);
-                return BACKUP_ERROR_FILE;
-            }
+    // 内容摘要：普通文件的数据经过打包模块时计算，由数据来源直接复制的文件由数据来源计算，没有变化的文件沿用上一次的摘要
+    int hashed;
+    if (unchanged != NULL) {
+        hashed = (unchanged->item.flags & PACK2_ITEM_HASHED) != 0;
+    } else {
+        hashed = link == CATALOG_NONE && item.type == FILE_TYPE_REGULAR;
+    }
+    int direct = !is_sparse && stream->chunker == NULL && pack_source_direct(stream->source, item.size);
+    unsigned long long copy_hash = 0;
+    const void *chunks = NULL;
+    if (link != CATALOG_NONE) {
+        item.flags = PACK2_ITEM_HARDLINK;
+    } else if (unchanged != NULL) {
+        item.flags = PACK2_ITEM_CHUNKED;
+        item.extent_count = unchanged->item.extent_count;
+        chunks = manifest_chunks(stream->previous, unchanged);
+    } else if (stream->chunker != NULL && item.type == FILE_TYPE_REGULAR) {
+        // 修改过的文件以上一次的块引用表为基准做差异编码
+        const ArchiveEntry *base = manifest_find(stream->previous, stream->path);
+        if (base != NULL && (base->item.flags & PACK2_ITEM_CHUNKED)) {
+            chunk_writer_set_base(stream->chunker, manifest_chunks(stream->previous, base), base->item.extent_count);
+        }
+        result = mypack_chunk_file(stream, pack_hash_begin(&stream->hasher, stream->chunker), &sparse, is_sparse, item.size);
+        if (result != BACKUP_SUCCESS) {
+            pack_sparse_close(&sparse);
+            return result;
+        }
+        item.flags = PACK2_ITEM_CHUNKED;
+        chunks = chunk_writer_refs(stream->chunker, &item.extent_count);
+    } else if (is_sparse && sparse.data_size < item.size) {
+        item.flags = PACK2_ITEM_SPARSE;
+        item.extent_count = sparse.count;
+    }
+    if (hashed) {
+        item.flags |= PACK2_ITEM_HASHED;
+    }
+    stream->index[stream->index_count].id = id;
+    stream->index[stream->index_count].offset = item.offset;
+    stream->index[stream->index_count].flags = item.flags;
+    stream->index[stream->index_count].extent_count = item.extent_count;
+    stream->index[stream->index_count].link = link;
+    stream->index[stream->index_count].content_hash = 0;
+    stream->index_count++;
 
-            remaining -= bytes_written;
+    result = pack_stream_write(stream, PACK2_TAG_FILE, PACK2_TAG_SIZE);
+    if (result == BACKUP_SUCCESS) {
+        result = mypack_write_item(stream, target, &item);
+    }
+    ByteWriter *data_writer = (hashed && stream->chunker == NULL) ? pack_hash_begin(&stream->hasher, stream->writer) : stream->writer;
+    if (result == BACKUP_SUCCESS && (item.flags & PACK2_ITEM_CHUNKED)) {
+        // 块引用表
+        result = pack_stream_write(stream, chunks, (size_t)item.extent_count * sizeof(ChunkRef));
+        chunk_writer_reset(stream->chunker);
+    } else if (result == BACKUP_SUCCESS && (item.flags & PACK2_ITEM_SPARSE)) {
+        // 数据段表和各数据段的数据
+        for (unsigned int i = 0; i < sparse.count && result == BACKUP_SUCCESS; i++) {
+            Pack2Extent extent;
+            extent.offset = sparse.extents[i].offset;
+            extent.length = sparse.extents[i].length;
+            result = pack_stream_write(stream, &extent, sizeof(Pack2Extent));
+        }
+        if (result == BACKUP_SUCCESS) {
+            result = pack_sparse_data(data_writer, &sparse, item.size, 0, stream->buffer);
+            stream->position += sparse.data_size;
         }
+    } else if (result == BACKUP_SUCCESS && is_sparse) {
+        result = pack_sparse_data(data_writer, &sparse, item.size, 1, stream->buffer);
+        stream->position += item.size;
+    } else if (result == BACKUP_SUCCESS && link == CATALOG_NONE) {
+        result = pack_file_data(data_writer, stream->source, stream->path, item.size, stream->buffer, hashed ? &copy_hash : NULL);
+        stream->position += item.size;
+    }
 
-        fclose(dst_fp);
+    // 文件数据之后是内容摘要，同时记入索引
+    if (result == BACKUP_SUCCESS && hashed) {
+        unsigned long long hash = (unchanged != NULL) ? unchanged->item.content_hash : direct ? copy_hash : xxh64_final(&stream->hasher.state);
+        stream->index[stream->index_count - 1].content_hash = hash;
+        result = pack_stream_write(stream, &hash, sizeof(hash));
     }
 
-    // 清理资源
-    free(items);
-    return BACKUP_SUCCESS;
+    pack_sparse_close(&sparse);
+    return result;
 }
 
-// Tar解包实现
-BackupResult tar_unpack(FILE *fp, FileMetadata **files, int *file_count) {
-    // 简化的Tar解包实现
-    char header[512];
-    size_t bytes_read;
-    int count = 0;
-    int max_files = 100;
-    
-    // 分配初始文件元数据数组
-    *files = (FileMetadata *)malloc(max_files * sizeof(FileMetadata));
-    if (*files == NULL) {
-        return BACKUP_ERROR_MEMORY;
+// 索引排序时的路径和索引项
+typedef struct {
+    const char *path;
+    PackIndexRef ref;
+} PackIndexSort;
+
+// 辅助函数：索引项按路径比较
+static int compare_index_path(const void *a, const void *b) {
+    return strcmp(((const PackIndexSort *)a)->path, ((const PackIndexSort *)b)->path);
+}
+
+// 辅助函数：索引按路径排序，还原单个文件时可以二分查找
+static BackupResult mypack_sort_index(PackStream *stream) {
+    unsigned int count = stream->index_count;
+    if (count < 2) {
+        return BACKUP_SUCCESS;
     }
-    
-    while (1) {
-        // 读取Tar文件头
-        bytes_read = fread(header, 1, 512, fp);
-        if (bytes_read != 512) {
-            // 检查是否遇到文件结束
-            if (feof(fp)) {
-                break;
-            } else {
-                free(*files);
-                return BACKUP_ERROR_FILE;
-            }
+
+    // 路径依次存入一块缓冲区，全部构建完成后再设置指针（缓冲区可能重新分配）
+    PackIndexSort *sort = (PackIndexSort *)malloc(count * sizeof(PackIndexSort));
+    size_t *offsets = (size_t *)malloc(count * sizeof(size_t));
+    char *paths = NULL;
+    size_t paths_len = 0;
+    size_t paths_capacity = 0;
+    BackupResult result = (sort != NULL && offsets != NULL) ? BACKUP_SUCCESS : BACKUP_ERROR_MEMORY;
+
+    for (unsigned int i = 0; i < count && result == BACKUP_SUCCESS; i++) {
+        result = catalog_path_buffer(stream->catalog, stream->index[i].id, &stream->path, &stream->path_capacity);
+        if (result != BACKUP_SUCCESS) {
+            break;
         }
-        
-        // 检查文件头是否全零（结束块）
-        int all_zero = 1;
-        for (int i = 0; i < 512; i++) {
-            if (header[i] != 0) {
-                all_zero = 0;
-                break;
+        size_t length = strlen(stream->path) + 1;
+        if (paths_len + length > paths_capacity) {
+            size_t capacity = (paths_capacity > 0) ? paths_capacity * 2 : 65536;
+            while (capacity < paths_len + length) {
+                capacity *= 2;
             }
-        }
-        if (all_zero) {
-            // 再读一个块，确认是否是结束标记（两个连续的全零块）
-            bytes_read = fread(header, 1, 512, fp);
-            if (bytes_read == 512) {
-                // 检查第二个块是否也是全零
-                int second_all_zero = 1;
-                for (int i = 0; i < 512; i++) {
-                    if (header[i] != 0) {
-                        second_all_zero = 0;
-                        break;
-                    }
-                }
-                if (second_all_zero) {
-                    // 找到结束标记，退出循环
-                    break;
-                } else {
-                    // 不是结束标记，将文件指针移回
-                    fseek(fp, -512, SEEK_CUR);
-                }
-            } else {
-                // 读取失败，退出循环
+            char *new_paths = (char *)realloc(paths, capacity);
+            if (new_paths == NULL) {
+                result = BACKUP_ERROR_MEMORY;
                 break;
             }
+            paths = new_paths;
+            paths_capacity = capacity;
         }
-        
-        // 解析文件名
-        char filename[256] = {0};
-        strncpy(filename, header, 100);
-        
-        // 跳过空文件名（可能是填充块）
-        if (filename[0] == '\0') {
-            continue;
-        }
-        
-        // 解析文件大小
-        char size_str[13] = {0};
-        strncpy(size_str, header + 124, 12);
-        unsigned long size = 0;
-        sscanf(size_str, "%lo", &size);
-        
-        // 解析文件模式
-        char mode_str[9] = {0};
-        strncpy(mode_str, header + 100, 8);
-        int mode = 0;
-        sscanf(mode_str, "%o", &mode); // 使用%o而不是%lo，因为mode是int类型
-        
-        // 解析UID和GID
-        char uid_str[9] = {0};
-        char gid_str[9] = {0};
-        strncpy(uid_str, header + 108, 8);
-        strncpy(gid_str, header + 116, 8);
-        int uid = 0, gid = 0;
-        sscanf(uid_str, "%o", &uid); // 使用%o而不是%lo
-        sscanf(gid_str, "%o", &gid); // 使用%o而不是%lo
-        
-        // 解析修改时间
-        char mtime_str[13] = {0};
-        strncpy(mtime_str, header + 136, 12);
-        unsigned long mtime = 0;
-        sscanf(mtime_str, "%lo", &mtime);
-        
-        // 扩展文件元数据数组（如果需要）
-        if (count >= max_files) {
-            max_files *= 2;
-            FileMetadata *new_files = (FileMetadata *)realloc(*files, max_files * sizeof(FileMetadata));
-            if (new_files == NULL) {
-                free(*files);
-                return BACKUP_ERROR_MEMORY;
-            }
-            *files = new_files;
-        }
-        
-        // 填充文件元数据
-        strcpy((*files)[count].path, filename);
-        strcpy((*files)[count].name, filename);
-        (*files)[count].type = FILE_TYPE_REGULAR;
-        (*files)[count].size = size;
-        (*files)[count].create_time = mtime;
-        (*files)[count].modify_time = mtime;
-        (*files)[count].access_time = mtime;
-        (*files)[count].mode = mode;
-        (*files)[count].uid = uid;
-        (*files)[count].gid = gid;
-        (*files)[count].symlink_target[0] = '\0';
-        
-        // 写入文件数据
-        FILE *dst_fp = fopen(filename, "wb");
-        if (dst_fp == NULL) {
-            free(*files);
-            return BACKUP_ERROR_FILE;
+        memcpy(paths + paths_len, stream->path, length);
+        offsets[i] = paths_len;
+        paths_len += length;
+    }
+
+    if (result == BACKUP_SUCCESS) {
+        for (unsigned int i = 0; i < count; i++) {
+            sort[i].path = paths + offsets[i];
+            sort[i].ref = stream->index[i];
         }
-        
-        char buffer[4096];
-        size_t bytes_written;
-        size_t remaining = size;
-        while (remaining > 0) {
-            bytes_read = fread(buffer, 1, (remaining < sizeof(buffer)) ? remaining : sizeof(buffer), fp);
-            if (bytes_read == 0) {
-                fclose(dst_fp);
-                free(*files);
-                return BACKUP_ERROR_FILE;
-            }
-            
-            bytes_written = fwrite(buffer, 1, bytes_read, dst_fp);
-            if (bytes_written != bytes_read) {
-                fclose(dst_fp);
-                free(*files);
-                return BACKUP_ERROR_FILE;
-            }
-            
-            remaining -= bytes_written;
-        }
-        
-        fclose(dst_fp);
-        
-        // 跳过文件数据后的填充
-        if (size % 512 != 0) {
-            size_t padding = 512 - (size % 512);
-            if (fseek(fp, padding, SEEK_CUR) != 0) {
-                free(*files);
-                return BACKUP_ERROR_FILE;
-            }
+        qsort(sort, count, sizeof(PackIndexSort), compare_index_path);
+        for (unsigned int i = 0; i < count; i++) {
+            stream->index[i] = sort[i].ref;
         }
-        
-        count++;
     }
-    
-    // 调整数组大小
-    *files = (FileMetadata *)realloc(*files, count * sizeof(FileMetadata));
-    if (*files == NULL && count > 0) {
-        return BACKUP_ERROR_MEMORY;
+
+    free(paths);
+    free(offsets);
+    free(sort);
+    return result;
+}
+
+// 写入MyPack索引和尾部
+static BackupResult mypack_pack_end(PackStream *stream) {
+    BackupResult result = mypack_sort_index(stream);
+    if (result != BACKUP_SUCCESS) {
+        return result;
     }
-    
-    *file_count = count;
-    return BACKUP_SUCCESS;
+
+    Pack2Trailer trailer;
+    memset(&trailer, 0, sizeof(Pack2Trailer));
+    trailer.index_offset = stream->position;
+    trailer.file_count = stream->index_count;
+    trailer.flags = PACK2_FLAG_SORTED;
+    if (stream->chunker != NULL) {
+        trailer.flags |= PACK2_FLAG_CHUNKED;
+    }
+    memcpy(trailer.magic, PACK2_TRAILER_MAGIC, sizeof(trailer.magic));
+
+    result = pack_stream_write(stream, PACK2_TAG_INDEX, PACK2_TAG_SIZE);
+    for (unsigned int i = 0; i < stream->index_count && result == BACKUP_SUCCESS; i++) {
+        unsigned int id = stream->index[i].id;
+        const char *target;
+        result = catalog_path_buffer(stream->catalog, id, &stream->path, &stream->path_capacity);
+        if (result == BACKUP_SUCCESS) {
+            result = mypack_item_target(stream, stream->catalog, id, stream->index[i].link, &target);
+        }
+        if (result == BACKUP_SUCCESS) {
+            Pack2Item item;
+            mypack_fill_item(stream, stream->catalog, id, stream->index[i].offset, target, &item);
+            item.flags = stream->index[i].flags;
+            item.extent_count = stream->index[i].extent_count;
+            item.content_hash = stream->index[i].content_hash;
+            result = mypack_write_item(stream, target, &item);
+        }
+    }
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+
+    trailer.index_size = stream->position - trailer.index_offset;
+    return pack_stream_write(stream, &trailer, sizeof(Pack2Trailer));
 }
 
-// 解包文件
-BackupResult unpack_files(const char *input_path, FileMetadata **files, int *file_count, PackAlgorithm algorithm) {
-    FILE *fp = NULL;
-    BackupResult result = BACKUP_SUCCESS;
+// 辅助函数：填写Tar文件头的魔术字和校验和，文件头的其他字段已经填好
+static void tar_finish_header(char *header) {
+    // 魔术字和版本（ustar格式）
+    memcpy(header + 257, "ustar", 6);
+    memcpy(header + 263, "00", 2);
 
-    // 检查参数
-    if (input_path == NULL || files == NULL || file_count == NULL) {
-        return BACKUP_ERROR_PARAM;
+    // 校验和：计算时校验和字段按8个空格处理
+    unsigned int checksum = 0;
+    memset(header + 148, ' ', 8);
+    for (int i = 0; i < 512; i++) {
+        checksum += (unsigned char)header[i];
     }
+    sprintf(header + 148, "%06o", checksum);
+}
 
-    // 打开输入文件
-    fp = fopen(input_path, "rb");
-    if (fp == NULL) {
-        return BACKUP_ERROR_FILE;
+// 辅助函数：写入GNU长名称记录（类型'L'为下一项的路径，类型'K'为下一项的链接目标），数据是以'\0'结尾的名称
+static BackupResult tar_write_long_name(PackStream *stream, char type, const char *value) {
+    size_t length = strlen(value) + 1;
+    char header[512];
+    memset(header, 0, 512);
+    strcpy(header, "././@LongLink");
+    sprintf(header + 100, "%07o", 0644u);
+    sprintf(header + 108, "%07o", 0u);
+    sprintf(header + 116, "%07o", 0u);
+    tar_set_size(header + 124, length);
+    sprintf(header + 136, "%011lo", 0ul);
+    header[156] = type;
+    tar_finish_header(header);
+
+    BackupResult result = pack_stream_write(stream, header, 512);
+    if (result == BACKUP_SUCCESS) {
+        result = pack_stream_write(stream, value, length);
+    }
+    if (result == BACKUP_SUCCESS && length % 512 != 0) {
+        memset(stream->buffer, 0, 512 - length % 512);
+        result = pack_stream_write(stream, stream->buffer, 512 - length % 512);
     }
+    return result;
+}
 
-    // 根据算法选择解包方式
-    switch (algorithm) {
-        case PACK_ALGORITHM_MYPACK:
-            result = mypack_unpack(fp, files, file_count);
-            break;
-        case PACK_ALGORITHM_TAR:
-            result = tar_unpack(fp, files, file_count);
-            break;
-        default:
-            result = mypack_unpack(fp, files, file_count);
-            break;
+// 写入一个Tar文件项：512字节的文件头、文件数据和填充
+// 同一文件已经保存过数据的硬链接写成类型'1'的链接项
+// ustar字段放不下的路径和链接目标先写入GNU长名称记录，文件头中的字段只保存截断的名称
+static BackupResult tar_pack_file(PackStream *stream, const Catalog *catalog, unsigned int id) {
+    const CatalogEntry *file = catalog_entry(catalog, id);
+    BackupResult result = catalog_path_buffer(catalog, id, &stream->path, &stream->path_capacity);
+    if (result != BACKUP_SUCCESS) {
+        return result;
     }
 
-    // 清理资源
-    fclose(fp);
+    unsigned int link;
+    result = catalog_link_source(catalog, &stream->links, id, &link);
+    if (result == BACKUP_SUCCESS && link != CATALOG_NONE) {
+        result = catalog_path_buffer(catalog, link, &stream->target, &stream->target_capacity);
+    }
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+    int is_link = link != CATALOG_NONE;
+    unsigned long long size = is_link ? 0 : file->size;
+
+    // 简化的Tar格式实现
+    char header[512];
+    memset(header, 0, 512);
+
+    // 文件路径（100字节，较长时使用155字节的前缀字段，仍然放不下时使用长名称记录）
+    if (tar_set_path(header, stream->path) != 0) {
+        result = tar_write_long_name(stream, 'L', stream->path);
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+        memcpy(header, stream->path, 100);
+    }
+    if (is_link && strlen(stream->target) > 100) {
+        result = tar_write_long_name(stream, 'K', stream->target);
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+    }
+
+    // 文件模式（8字节，八进制）
+    sprintf(header + 100, "%07o", (unsigned int)file->mode);
+
+    // UID（8字节，八进制）
+    sprintf(header + 108, "%07o", file->uid);
+
+    // GID（8字节，八进制）
+    sprintf(header + 116, "%07o", file->gid);
+
+    // 文件大小（12字节，八进制），链接项没有数据
+    tar_set_size(header + 124, size);
+
+    // 修改时间（12字节，八进制）
+    sprintf(header + 136, "%011lo", (unsigned long)file->modify_time);
+
+    // 类型标志（1字节）和链接目标（100字节，可以不以'\0'结尾）
+    if (is_link) {
+        header[156] = '1'; // 硬链接
+        size_t target_length = strlen(stream->target);
+        memcpy(header + 157, stream->target, (target_length < 100) ? target_length : 100);
+    } else {
+        header[156] = '0'; // 普通文件
+    }
+    tar_finish_header(header);
+
+    // 写入文件头
+    result = pack_stream_write(stream, header, 512);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+
+    // 写入文件数据，Tar不能表示空洞，稀疏文件只读取数据段，空洞部分写入零
+    if (is_link) {
+        return BACKUP_SUCCESS;
+    } else if (file->flags & CATALOG_FLAG_SPARSE) {
+        PackSparse sparse;
+        result = pack_sparse_open(&sparse, stream->path, file->size);
+        if (result == BACKUP_SUCCESS) {
+            result = pack_sparse_data(stream->writer, &sparse, file->size, 1, stream->buffer);
+            pack_sparse_close(&sparse);
+        }
+    } else {
+        result = pack_file_data(stream->writer, stream->source, stream->path, file->size, stream->buffer, NULL);
+    }
+    stream->position += file->size;
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+
+    // 填充到512字节的倍数
+    if (file->size % 512 != 0) {
+        size_t padding = 512 - (file->size % 512);
+        memset(stream->buffer, 0, padding);
+        result = pack_stream_write(stream, stream->buffer, padding);
+    }
+    return result;
+}
+
+// 流式打包：加入一个文件
+BackupResult pack_stream_add(PackStream *stream, const Catalog *catalog, unsigned int id) {
+    if (stream == NULL || catalog == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+    if (stream->algorithm == PACK_ALGORITHM_MYPACK) {
+        return mypack_pack_file(stream, catalog, id);
+    }
+    return tar_pack_file(stream, catalog, id);
+}
+
+// 流式打包：写入格式的结束部分
+BackupResult pack_stream_end(PackStream *stream) {
+    if (stream == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+    if (stream->algorithm == PACK_ALGORITHM_MYPACK) {
+        return mypack_pack_end(stream);
+    }
+
+    // 写入两个512字节的结束块
+    memset(stream->buffer, 0, 1024);
+    return pack_stream_write(stream, stream->buffer, 1024);
+}
+
+// 释放流式打包状态
+void pack_stream_destroy(PackStream *stream) {
+    if (stream != NULL) {
+        free(stream->buffer);
+        free(stream->path);
+        free(stream->target);
+        free(stream->index);
+        catalog_links_free(&stream->links);
+        stream_destroy(stream->chunker);
+        free(stream);
+    }
+}
+
+// 辅助函数：按目录清单的文件列表顺序流式打包，store不为NULL时为去重打包，previous不为NULL时为增量备份
+static BackupResult pack_catalog(ByteWriter *writer, PackAlgorithm algorithm, const Catalog *catalog, PackSource *source, ChunkStore *store, const Manifest *previous) {
+    PackStream *stream = pack_stream_init(writer, algorithm, source, store, previous);
+    if (stream == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    BackupResult result = BACKUP_SUCCESS;
+    unsigned int file_count = catalog_file_count(catalog);
+    for (unsigned int i = 0; i < file_count && result == BACKUP_SUCCESS; i++) {
+        result = pack_stream_add(stream, catalog, catalog_file_id(catalog, i));
+    }
+    if (result == BACKUP_SUCCESS) {
+        result = pack_stream_end(stream);
+    }
+
+    pack_stream_destroy(stream);
+    return result;
+}
+
+// MyPack打包实现
+BackupResult mypack_pack(ByteWriter *writer, const Catalog *catalog, PackSource *source) {
+    return pack_catalog(writer, PACK_ALGORITHM_MYPACK, catalog, source, NULL, NULL);
+}
+
+// Tar打包实现
+BackupResult tar_pack(ByteWriter *writer, const Catalog *catalog, PackSource *source) {
+    return pack_catalog(writer, PACK_ALGORITHM_TAR, catalog, source, NULL, NULL);
+}
+
+// MyPack去重打包实现
+BackupResult mypack_pack_chunked(ByteWriter *writer, const Catalog *catalog, PackSource *source, ChunkStore *store, const Manifest *previous) {
+    if (store == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+    return pack_catalog(writer, PACK_ALGORITHM_MYPACK, catalog, source, store, previous);
+}
+
+// 打包文件到处理链
+BackupResult pack_files_stream(ByteWriter *writer, const FileMetadata *files, int file_count, PackAlgorithm algorithm) {
+    // 检查参数
+    if (writer == NULL || files == NULL || file_count <= 0) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    // 文件列表转换为目录清单
+    Catalog *catalog = catalog_create();
+    if (catalog == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    for (int i = 0; i < file_count; i++) {
+        CatalogEntry stat;
+        catalog_stat_from_metadata(&files[i], &stat);
+        if (catalog_add_path(catalog, files[i].path, &stat, files[i].symlink_target) == CATALOG_NONE) {
+            catalog_destroy(catalog);
+            return BACKUP_ERROR_MEMORY;
+        }
+    }
+
+    // 根据算法选择打包方式
+    BackupResult result;
+    switch (algorithm) {
+        case PACK_ALGORITHM_TAR:
+            result = tar_pack(writer, catalog, NULL);
+            break;
+        case PACK_ALGORITHM_MYPACK:
+        default:
+            result = mypack_pack(writer, catalog, NULL);
+            break;
+    }
+
+    catalog_destroy(catalog);
+    return result;
+}
+
+// 打包文件
+BackupResult pack_files(const char *output_path, const FileMetadata *files, int file_count, PackAlgorithm algorithm) {
+    FILE *fp = NULL;
+    BackupResult result = BACKUP_SUCCESS;
+
+    // 检查参数
+    if (output_path == NULL || files == NULL || file_count <= 0) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    // 打开输出文件
+    fp = fopen(output_path, "wb");
+    if (fp == NULL) {
+        return BACKUP_ERROR_FILE;
+    }
+
+    ByteWriter *writer = file_writer_create(fp);
+    if (writer == NULL) {
+        fclose(fp);
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    // 打包并冲刷输出
+    result = pack_files_stream(writer, files, file_count, algorithm);
+    if (result == BACKUP_SUCCESS) {
+        result = stream_finish(writer);
+    }
+
+    // 清理资源
+    stream_destroy(writer);
+    fclose(fp);
+    return result;
+}
+
+// 辅助函数：解析Tar文件头
+static void tar_parse_header(const char *header, FileMetadata *metadata) {
+    memset(metadata, 0, sizeof(FileMetadata));
+
+    // 解析文件路径，ustar格式的较长路径分为前缀和文件名两部分
+    char name[101] = {0};
+    strncpy(name, header, 100);
+    if (memcmp(header + 257, "ustar", 6) == 0 && header[345] != '\0') {
+        char prefix[156] = {0};
+        strncpy(prefix, header + 345, 155);
+        size_t prefix_length = strlen(prefix);
+        size_t name_length = strlen(name);
+        if (prefix_length + 1 + name_length < sizeof(metadata->path)) {
+            memcpy(metadata->path, prefix, prefix_length);
+            metadata->path[prefix_length] = '/';
+            memcpy(metadata->path + prefix_length + 1, name, name_length + 1);
+        }
+    } else {
+        strcpy(metadata->path, name);
+    }
+    const char *base_name = strrchr(metadata->path, '/');
+    strcpy(metadata->name, (base_name != NULL) ? base_name + 1 : metadata->path);
+
+    // 解析文件大小
+    unsigned long long size = tar_parse_size(header + 124);
+
+    // 解析文件模式
+    char mode_str[9] = {0};
+    strncpy(mode_str, header + 100, 8);
+    unsigned int mode = 0;
+    sscanf(mode_str, "%o", &mode);
+
+    // 解析UID和GID
+    char uid_str[9] = {0};
+    char gid_str[9] = {0};
+    strncpy(uid_str, header + 108, 8);
+    strncpy(gid_str, header + 116, 8);
+    unsigned int uid = 0, gid = 0;
+    sscanf(uid_str, "%o", &uid);
+    sscanf(gid_str, "%o", &gid);
+
+    // 解析修改时间
+    char mtime_str[13] = {0};
+    strncpy(mtime_str, header + 136, 12);
+    unsigned long mtime = 0;
+    sscanf(mtime_str, "%lo", &mtime);
+
+    metadata->type = FILE_TYPE_REGULAR;
+    metadata->size = size;
+    metadata->create_time = mtime;
+    metadata->modify_time = mtime;
+    metadata->access_time = mtime;
+    metadata->mode = mode;
+    metadata->uid = uid;
+    metadata->gid = gid;
+    metadata->symlink_target[0] = '\0';
+}
+
+// 解包文件
+BackupResult unpack_files(const char *input_path, FileMetadata **files, int *file_count, PackAlgorithm algorithm) {
+    FILE *fp = NULL;
+    BackupResult result = BACKUP_SUCCESS;
+
+    // 检查参数
+    if (input_path == NULL || files == NULL || file_count == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    // 打开输入文件
+    fp = fopen(input_path, "rb");
+    if (fp == NULL) {
+        return BACKUP_ERROR_FILE;
+    }
+
+    // 根据算法选择解包方式
+    switch (algorithm) {
+        case PACK_ALGORITHM_MYPACK:
+            result = mypack_unpack(fp, files, file_count);
+            break;
+        case PACK_ALGORITHM_TAR:
+            result = tar_unpack(fp, files, file_count);
+            break;
+        default:
+            result = mypack_unpack(fp, files, file_count);
+            break;
+    }
+
+    // 清理资源
+    fclose(fp);
+    return result;
+}
+
+// 流式解包阶段的状态
+typedef enum {
+    UNPACK_STATE_DETECT,         // 根据魔术字识别打包格式
+    UNPACK_STATE_MYPACK_HEADER,  // 读取MyPack头部
+    UNPACK_STATE_MYPACK_ITEMS,   // 读取MyPack文件项表
+    UNPACK_STATE_MYPACK_DATA,    // 提取MyPack文件数据
+    UNPACK_STATE_MYPACK2_TAG,    // 读取MyPack版本2的记录标记
+    UNPACK_STATE_MYPACK2_ITEM,   // 读取MyPack版本2的文件项
+    UNPACK_STATE_MYPACK2_NAMES,  // 读取MyPack版本2的路径和符号链接目标
+    UNPACK_STATE_MYPACK2_EXTENTS, // 读取MyPack版本2稀疏文件的数据段表
+    UNPACK_STATE_MYPACK2_CHUNKS, // 读取MyPack版本2分块文件的块引用表
+    UNPACK_STATE_MYPACK2_DATA,   // 提取MyPack版本2的文件数据
+    UNPACK_STATE_MYPACK2_HASH,   // 读取MyPack版本2文件数据之后的内容摘要并校验
+    UNPACK_STATE_TAR_HEADER,     // 读取Tar文件头
+    UNPACK_STATE_TAR_LONG_NAME,  // 读取Tar长名称记录的名称
+    UNPACK_STATE_TAR_DATA,       // 提取Tar文件数据
+    UNPACK_STATE_TAR_PADDING,    // 跳过Tar数据填充
+    UNPACK_STATE_END             // 解包完成，忽略剩余数据
+} UnpackState;
+
+// 流式解包阶段：将解包后的文件直接写入当前工作目录
+typedef struct {
+    ByteWriter base;
+    UnpackState state;
+    unsigned char record[sizeof(PackFileItem) + 512]; // 头部或文件项缓冲区
+    size_t record_len;
+    PackHeader header;
+    PackFileItem *items;               // MyPack文件项表
+    unsigned int item_capacity;        // 文件项表已分配的项数，随读到的文件项增长
+    Pack2Item item;                    // MyPack版本2的当前文件项
+    Pack2Extent *extents;              // 稀疏文件的数据段表
+    size_t extents_len;                // 已读取的数据段表字节数
+    unsigned int extent_capacity;
+    unsigned int extent_index;         // 下一个要写入的数据段
+    ChunkRef *chunks;                  // 分块文件的块引用表
+    size_t chunks_len;                 // 已读取的块引用表字节数
+    unsigned int chunk_capacity;
+    char *chunk_path;                  // 块数据文件的路径，未设置时不能解包分块文件
+    FILE *chunk_file;                  // 块数据文件，第一次遇到分块文件时打开
+    unsigned char *chunk_buffer;       // 从块数据文件读取一块的缓冲区（CHUNK_READ_BUFFER_SIZE字节）
+    char *names;                       // MyPack版本2的当前路径和符号链接目标
+    size_t names_len;
+    size_t names_capacity;
+    unsigned int item_count;           // 已读取的文件项数量
+    unsigned int current;              // 当前提取的文件项
+    unsigned long long position;       // 当前在打包数据中的位置
+    FILE *output;                      // 正在写入的文件
+    DirCache *dirs;                    // 已创建的目录，第一次打开输出文件时创建
+    char **extracted;                  // 本次已解包文件的路径（开放寻址散列表），硬链接只能链接到其中的文件
+    size_t extracted_count;
+    size_t extracted_capacity;         // 散列表槽数，为2的幂
+    unsigned long long remaining;      // 当前文件（或填充）剩余的字节数
+    Xxh64 hash;                        // 当前文件已写出数据的内容摘要（文件项含PACK2_ITEM_HASHED时计算）
+    unsigned long padding;             // Tar数据后的填充字节数
+    char *tar_long_path;               // 长名称记录给出的下一项的路径，没有时为NULL
+    char *tar_long_link;               // 长名称记录给出的下一项的链接目标，没有时为NULL
+    char *tar_long_name;               // 正在读取的长名称（指向上面两者之一）
+    size_t tar_long_length;            // 已读取的长名称字节数
+
+    // 解包的文件列表（调用方不需要时为NULL）
+    FileMetadata **out_files;
+    int *out_count;
+    FileMetadata *files;
+    int file_count;
+    int file_capacity;
+} UnpackWriter;
+
+// 辅助函数：从输入中收集定长记录，收集完整时返回1
+static int unpack_collect(UnpackWriter *unpack, const unsigned char **data, size_t *size, size_t record_size) {
+    size_t need = record_size - unpack->record_len;
+    size_t chunk = (*size < need) ? *size : need;
+
+    memcpy(unpack->record + unpack->record_len, *data, chunk);
+    unpack->record_len += chunk;
+    unpack->position += chunk;
+    *data += chunk;
+    *size -= chunk;
+
+    return unpack->record_len == record_size;
+}
+
+// 辅助函数：记录解包的文件元数据
+static BackupResult unpack_record(UnpackWriter *unpack, const FileMetadata *metadata) {
+    if (unpack->out_files == NULL) {
+        return BACKUP_SUCCESS;
+    }
+
+    if (unpack->file_count >= unpack->file_capacity) {
+        int capacity = (unpack->file_capacity > 0) ? unpack->file_capacity * 2 : 100;
+        FileMetadata *new_files = (FileMetadata *)realloc(unpack->files, capacity * sizeof(FileMetadata));
+        if (new_files == NULL) {
+            return BACKUP_ERROR_MEMORY;
+        }
+        unpack->files = new_files;
+        unpack->file_capacity = capacity;
+    }
+
+    unpack->files[unpack->file_count++] = *metadata;
+    return BACKUP_SUCCESS;
+}
+
+// 辅助函数：将MyPack文件项转换为文件元数据
+static void pack_item_to_metadata(const PackFileItem *item, FileMetadata *metadata) {
+    memset(metadata, 0, sizeof(FileMetadata));
+    strcpy(metadata->path, item->path);
+    strcpy(metadata->name, item->name);
+    metadata->type = item->type;
+    metadata->size = item->size;
+    metadata->create_time = item->create_time;
+    metadata->modify_time = item->modify_time;
+    metadata->access_time = item->access_time;
+    metadata->mode = item->mode;
+    metadata->uid = item->uid;
+    metadata->gid = item->gid;
+    strcpy(metadata->symlink_target, item->symlink_target);
+}
+
+// 辅助函数：将MyPack版本2的文件项转换为文件元数据，超出FileMetadata长度的路径被截断
+static void pack2_item_to_metadata(const Pack2Item *item, const char *path, const char *symlink_target, FileMetadata *metadata) {
+    memset(metadata, 0, sizeof(FileMetadata));
+    snprintf(metadata->path, sizeof(metadata->path), "%s", path);
+    const char *base_name = strrchr(path, PATH_SEPARATOR);
+    snprintf(metadata->name, sizeof(metadata->name), "%s", (base_name != NULL) ? base_name + 1 : path);
+    metadata->type = (FileType)item->type;
+    metadata->size = item->size;
+    metadata->create_time = item->create_time;
+    metadata->modify_time = item->modify_time;
+    metadata->access_time = item->access_time;
+    metadata->mode = item->mode;
+    metadata->uid = item->uid;
+    metadata->gid = item->gid;
+    snprintf(metadata->symlink_target, sizeof(metadata->symlink_target), "%s", symlink_target);
+}
+
+// 辅助函数：将数据写入当前输出文件
+static BackupResult unpack_output(UnpackWriter *unpack, const unsigned char **data, size_t *size) {
+    size_t chunk = (*size < unpack->remaining) ? *size : (size_t)unpack->remaining;
+
+    if (chunk > 0 && fwrite(*data, 1, chunk, unpack->output) != chunk) {
+        return BACKUP_ERROR_FILE;
+    }
+    if (unpack->state == UNPACK_STATE_MYPACK2_DATA && (unpack->item.flags & PACK2_ITEM_HASHED)) {
+        xxh64_update(&unpack->hash, *data, chunk);
+    }
+    unpack->remaining -= chunk;
+    unpack->position += chunk;
+    *data += chunk;
+    *size -= chunk;
+
+    return BACKUP_SUCCESS;
+}
+
+// 检查备份文件中的路径能否作为还原路径，规则见pack.h
+int pack_path_safe(const char *path, size_t length) {
+    if (length == 0 || path[0] == '/' || path[0] == '\\' ||
+        (length >= 2 && isalpha((unsigned char)path[0]) && path[1] == ':') ||
+        memchr(path, '\0', length) != NULL) {
+        return 0;
+    }
+    size_t start = 0;
+    for (size_t i = 0; i <= length; i++) {
+        if (i == length || path[i] == '/' || path[i] == '\\') {
+            if (i - start == 2 && path[start] == '.' && path[start + 1] == '.') {
+                return 0;
+            }
+            start = i + 1;
+        }
+    }
+    return 1;
+}
+
+// 辅助函数：创建解包文件所在的目录，路径已经由pack_path_safe()检查过
+// 通过目录缓存创建，同一目录下的文件不再重复创建目录；缓存不可用时逐级创建
+static void unpack_make_parent(UnpackWriter *unpack, const char *path) {
+    if (unpack->dirs == NULL) {
+        unpack->dirs = dir_cache_create(".");
+    }
+    if (unpack->dirs == NULL || dir_cache_make_parent(unpack->dirs, path, strlen(path)) != BACKUP_SUCCESS) {
+        platform_make_parent_directories(path);
+    }
+}
+
+// 辅助函数：已解包路径散列表的散列值
+static size_t unpack_path_hash(const char *path) {
+    unsigned int hash = 2166136261u;
+    for (; *path != '\0'; path++) {
+        hash = (hash ^ (unsigned char)*path) * 16777619u;
+    }
+    return hash;
+}
+
+// 辅助函数：查找已解包的路径，返回所在槽或应插入的空槽
+static size_t unpack_extracted_slot(char **slots, size_t capacity, const char *path) {
+    size_t slot = unpack_path_hash(path) & (capacity - 1);
+    while (slots[slot] != NULL && strcmp(slots[slot], path) != 0) {
+        slot = (slot + 1) & (capacity - 1);
+    }
+    return slot;
+}
+
+// 辅助函数：记录已解包的路径，散列表超过半满时加倍
+static BackupResult unpack_remember(UnpackWriter *unpack, const char *path) {
+    if ((unpack->extracted_count + 1) * 2 > unpack->extracted_capacity) {
+        size_t capacity = (unpack->extracted_capacity > 0) ? unpack->extracted_capacity * 2 : 256;
+        char **slots = (char **)calloc(capacity, sizeof(char *));
+        if (slots == NULL) {
+            return BACKUP_ERROR_MEMORY;
+        }
+        for (size_t i = 0; i < unpack->extracted_capacity; i++) {
+            if (unpack->extracted[i] != NULL) {
+                slots[unpack_extracted_slot(slots, capacity, unpack->extracted[i])] = unpack->extracted[i];
+            }
+        }
+        free(unpack->extracted);
+        unpack->extracted = slots;
+        unpack->extracted_capacity = capacity;
+    }
+
+    size_t slot = unpack_extracted_slot(unpack->extracted, unpack->extracted_capacity, path);
+    if (unpack->extracted[slot] != NULL) {
+        return BACKUP_SUCCESS;
+    }
+    unpack->extracted[slot] = (char *)malloc(strlen(path) + 1);
+    if (unpack->extracted[slot] == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    strcpy(unpack->extracted[slot], path);
+    unpack->extracted_count++;
+    return BACKUP_SUCCESS;
+}
+
+// 辅助函数：打开解包输出文件，路径来自归档内容，不是目标目录下的相对路径时拒绝
+static BackupResult unpack_open(UnpackWriter *unpack, const char *path, unsigned long long size) {
+    if (!pack_path_safe(path, strlen(path))) {
+        return BACKUP_ERROR_PACK;
+    }
+    unpack_make_parent(unpack, path);
+    unpack->output = fopen(path, "wb");
+    if (unpack->output == NULL) {
+        return BACKUP_ERROR_FILE;
+    }
+    unpack->remaining = size;
+    return unpack_remember(unpack, path);
+}
+
+// 辅助函数：检查硬链接目标，只接受本次已经解包的路径
+static int unpack_link_allowed(const UnpackWriter *unpack, const char *target) {
+    return pack_path_safe(target, strlen(target)) && unpack->extracted_count > 0 &&
+           unpack->extracted[unpack_extracted_slot(unpack->extracted, unpack->extracted_capacity, target)] != NULL;
+}
+
+// 辅助函数：还原硬链接，链接到先前已经解包的同一文件，文件系统不支持硬链接时复制该文件
+// 链接目标来自归档内容，只能是本次已经解包的文件，否则归档可以把任意文件链接或复制到还原目录中
+static BackupResult unpack_link(UnpackWriter *unpack, const char *target, const char *path) {
+    if (!pack_path_safe(path, strlen(path)) || !unpack_link_allowed(unpack, target)) {
+        return BACKUP_ERROR_PACK;
+    }
+    BackupResult result = unpack_remember(unpack, path);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+    unpack_make_parent(unpack, path);
+    if (platform_make_link(target, path) == BACKUP_SUCCESS) {
+        return BACKUP_SUCCESS;
+    }
+    return platform_copy_file(target, path);
+}
+
+// 辅助函数：关闭解包输出文件
+static BackupResult unpack_close(UnpackWriter *unpack) {
+    int failed = fclose(unpack->output) != 0;
+    unpack->output = NULL;
+    return failed ? BACKUP_ERROR_FILE : BACKUP_SUCCESS;
+}
+
+// 辅助函数：为下一个文件项准备空间
+// 头部中的文件数量不可信，文件项表不按它一次分配，而是随实际读到的文件项成倍增长（不超过文件数量），
+// 输入中容纳不下的文件数量不会导致大量分配；字节数按size_t计算并检查溢出
+static BackupResult unpack_mypack_grow(UnpackWriter *unpack) {
+    if (unpack->item_count < unpack->item_capacity) {
+        return BACKUP_SUCCESS;
+    }
+    unsigned int capacity = (unpack->item_capacity > 0) ? unpack->item_capacity : 64;
+    if (unpack->item_capacity > 0) {
+        capacity = (unpack->item_capacity > UINT_MAX / 2) ? UINT_MAX : unpack->item_capacity * 2;
+    }
+    if (capacity > unpack->header.file_count) {
+        capacity = unpack->header.file_count;
+    }
+    if ((size_t)capacity > SIZE_MAX / sizeof(PackFileItem)) {
+        return BACKUP_ERROR_PACK;
+    }
+    PackFileItem *items = (PackFileItem *)realloc(unpack->items, (size_t)capacity * sizeof(PackFileItem));
+    if (items == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    unpack->items = items;
+    unpack->item_capacity = capacity;
+    return BACKUP_SUCCESS;
+}
+
+// 提取MyPack文件数据，文件项按偏移量顺序出现在数据流中
+static BackupResult unpack_mypack_data(UnpackWriter *unpack, const unsigned char **data, size_t *size) {
+    BackupResult result;
+
+    while (unpack->current < unpack->header.file_count) {
+        PackFileItem *item = &unpack->items[unpack->current];
+
+        if (unpack->output == NULL) {
+            if (item->offset < unpack->position) {
+                return BACKUP_ERROR_PACK;
+            }
+
+            // 跳过文件数据之间的空隙
+            if (item->offset > unpack->position) {
+                unsigned long long gap = item->offset - unpack->position;
+                size_t chunk = (*size < gap) ? *size : (size_t)gap;
+                unpack->position += chunk;
+                *data += chunk;
+                *size -= chunk;
+                if (unpack->position < item->offset) {
+                    return BACKUP_SUCCESS;
+                }
+            }
+
+            FileMetadata metadata;
+            pack_item_to_metadata(item, &metadata);
+            result = unpack_record(unpack, &metadata);
+            if (result != BACKUP_SUCCESS) {
+                return result;
+            }
+
+            result = unpack_open(unpack, item->path, item->size);
+            if (result != BACKUP_SUCCESS) {
+                return result;
+            }
+        }
+
+        result = unpack_output(unpack, data, size);
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+        if (unpack->remaining > 0) {
+            return BACKUP_SUCCESS;
+        }
+
+        result = unpack_close(unpack);
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+        unpack->current++;
+    }
+
+    unpack->state = UNPACK_STATE_END;
+    return BACKUP_SUCCESS;
+}
+
+// 处理一个完整的MyPack版本2记录标记：文件记录之后是索引，索引及之后的尾部在顺序解包时不需要
+static BackupResult unpack_mypack2_tag(UnpackWriter *unpack) {
+    unpack->record_len = 0;
+    if (memcmp(unpack->record, PACK2_TAG_FILE, PACK2_TAG_SIZE) == 0) {
+        unpack->state = UNPACK_STATE_MYPACK2_ITEM;
+    } else if (memcmp(unpack->record, PACK2_TAG_INDEX, PACK2_TAG_SIZE) == 0) {
+        unpack->state = UNPACK_STATE_END;
+    } else {
+        return BACKUP_ERROR_PACK;
+    }
+    return BACKUP_SUCCESS;
+}
+
+// 处理一个完整的MyPack版本2文件项，准备接收路径和符号链接目标
+static BackupResult unpack_mypack2_item(UnpackWriter *unpack) {
+    memset(&unpack->item, 0, sizeof(Pack2Item));
+    memcpy(&unpack->item, unpack->record, sizeof(Pack2Item));
+    unpack->record_len = 0;
+    if (unpack->item.path_length == 0) {
+        return BACKUP_ERROR_PACK;
+    }
+
+    size_t need = (size_t)unpack->item.path_length + unpack->item.symlink_length + 2;
+    if (need > unpack->names_capacity) {
+        char *names = (char *)realloc(unpack->names, need);
+        if (names == NULL) {
+            return BACKUP_ERROR_MEMORY;
+        }
+        unpack->names = names;
+        unpack->names_capacity = need;
+    }
+    unpack->names_len = 0;
+    unpack->state = UNPACK_STATE_MYPACK2_NAMES;
+    return BACKUP_SUCCESS;
+}
+
+// 辅助函数：当前文件的数据写完，关闭输出文件，有内容摘要时接着读取文件数据之后的摘要
+static BackupResult unpack_mypack2_done(UnpackWriter *unpack) {
+    unpack->record_len = 0;
+    unpack->state = (unpack->item.flags & PACK2_ITEM_HASHED) ? UNPACK_STATE_MYPACK2_HASH : UNPACK_STATE_MYPACK2_TAG;
+    return unpack_close(unpack);
+}
+
+// 处理文件数据之后的内容摘要，与写出的数据的摘要不同说明数据已损坏
+static BackupResult unpack_mypack2_hash(UnpackWriter *unpack) {
+    unsigned long long expected;
+    memcpy(&expected, unpack->record, sizeof(expected));
+    unpack->record_len = 0;
+    unpack->state = UNPACK_STATE_MYPACK2_TAG;
+    return (expected == xxh64_final(&unpack->hash)) ? BACKUP_SUCCESS : BACKUP_ERROR_CHECKSUM;
+}
+
+// 收集MyPack版本2分块文件的块引用表，收集完整后依次从块数据文件复制各块，块长度之和必须等于文件大小
+// data为NULL时块引用表为空
+static BackupResult unpack_mypack2_chunks(UnpackWriter *unpack, const unsigned char **data, size_t *size) {
+    size_t total = (size_t)unpack->item.extent_count * sizeof(ChunkRef);
+    if (data != NULL) {
+        size_t chunk = total - unpack->chunks_len;
+        if (chunk > *size) {
+            chunk = *size;
+        }
+        memcpy((unsigned char *)unpack->chunks + unpack->chunks_len, *data, chunk);
+        unpack->chunks_len += chunk;
+        unpack->position += chunk;
+        *data += chunk;
+        *size -= chunk;
+        if (unpack->chunks_len < total) {
+            return BACKUP_SUCCESS;
+        }
+    }
+
+    unsigned long long length = 0;
+    for (unsigned int i = 0; i < unpack->item.extent_count; i++) {
+        length += unpack->chunks[i].length;
+    }
+    if (length != unpack->item.size) {
+        return BACKUP_ERROR_PACK;
+    }
+    if (unpack->item.extent_count > 0 && unpack->chunk_file == NULL) {
+        if (unpack->chunk_path == NULL) {
+            return BACKUP_ERROR_PACK;
+        }
+        unpack->chunk_file = fopen(unpack->chunk_path, "rb");
+        unpack->chunk_buffer = (unsigned char *)malloc(CHUNK_READ_BUFFER_SIZE);
+        if (unpack->chunk_file == NULL || unpack->chunk_buffer == NULL) {
+            return BACKUP_ERROR_FILE;
+        }
+    }
+
+    // 差异块由chunk_read()读取基准块后还原
+    for (unsigned int i = 0; i < unpack->item.extent_count; i++) {
+        const ChunkRef *ref = &unpack->chunks[i];
+        BackupResult result = chunk_read(unpack->chunk_file, ref, unpack->chunk_buffer);
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+        if (fwrite(unpack->chunk_buffer, 1, ref->length, unpack->output) != ref->length) {
+            return BACKUP_ERROR_FILE;
+        }
+        if (unpack->item.flags & PACK2_ITEM_HASHED) {
+            xxh64_update(&unpack->hash, unpack->chunk_buffer, ref->length);
+        }
+    }
+    return unpack_mypack2_done(unpack);
+}
+
+// 收集MyPack版本2的路径和符号链接目标，收集完整后打开输出文件
+static BackupResult unpack_mypack2_names(UnpackWriter *unpack, const unsigned char **data, size_t *size) {
+    Pack2Item *item = &unpack->item;
+    size_t total = (size_t)item->path_length + item->symlink_length;
+    size_t chunk = total - unpack->names_len;
+    if (chunk > *size) {
+        chunk = *size;
+    }
+
+    memcpy(unpack->names + unpack->names_len, *data, chunk);
+    unpack->names_len += chunk;
+    unpack->position += chunk;
+    *data += chunk;
+    *size -= chunk;
+    if (unpack->names_len < total) {
+        return BACKUP_SUCCESS;
+    }
+
+    // 路径和符号链接目标分别以'\0'结尾
+    char *path = unpack->names;
+    char *symlink_target = unpack->names + item->path_length + 1;
+    memmove(symlink_target, unpack->names + item->path_length, item->symlink_length);
+    path[item->path_length] = '\0';
+    symlink_target[item->symlink_length] = '\0';
+
+    // 文件数据紧随其后
+    if (item->offset != unpack->position) {
+        return BACKUP_ERROR_PACK;
+    }
+
+    FileMetadata metadata;
+    pack2_item_to_metadata(item, path, symlink_target, &metadata);
+    BackupResult result = unpack_record(unpack, &metadata);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+
+    // 硬链接没有文件数据，符号链接目标的位置是链接到的文件的路径
+    if (item->flags & PACK2_ITEM_HARDLINK) {
+        unpack->state = UNPACK_STATE_MYPACK2_TAG;
+        return unpack_link(unpack, symlink_target, path);
+    }
+
+    result = unpack_open(unpack, path, item->size);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+    xxh64_init(&unpack->hash, PACK2_HASH_SEED);
+    unpack->state = UNPACK_STATE_MYPACK2_DATA;
+
+    // 分块文件先读取块引用表，再从块数据文件复制各块
+    if (item->flags & PACK2_ITEM_CHUNKED) {
+        unpack->remaining = 0;
+        unpack->chunks_len = 0;
+        if (item->extent_count > unpack->chunk_capacity) {
+            ChunkRef *chunks = (ChunkRef *)realloc(unpack->chunks, (size_t)item->extent_count * sizeof(ChunkRef));
+            if (chunks == NULL) {
+                return BACKUP_ERROR_MEMORY;
+            }
+            unpack->chunks = chunks;
+            unpack->chunk_capacity = item->extent_count;
+        }
+        unpack->state = UNPACK_STATE_MYPACK2_CHUNKS;
+        return (item->extent_count > 0) ? BACKUP_SUCCESS : unpack_mypack2_chunks(unpack, NULL, NULL);
+    }
+
+    // 稀疏文件先读取数据段表，数据从第一个数据段开始写入
+    unpack->extent_index = 0;
+    if (item->flags & PACK2_ITEM_SPARSE) {
+        unpack->remaining = 0;
+        unpack->extents_len = 0;
+        if (item->extent_count > unpack->extent_capacity) {
+            Pack2Extent *extents = (Pack2Extent *)realloc(unpack->extents, (size_t)item->extent_count * sizeof(Pack2Extent));
+            if (extents == NULL) {
+                return BACKUP_ERROR_MEMORY;
+            }
+            unpack->extents = extents;
+            unpack->extent_capacity = item->extent_count;
+        }
+        if (item->extent_count > 0) {
+            unpack->state = UNPACK_STATE_MYPACK2_EXTENTS;
+        }
+    }
+    return BACKUP_SUCCESS;
+}
+
+// 收集MyPack版本2稀疏文件的数据段表，收集完整后检查数据段按偏移量升序、互不重叠且不超出文件大小
+static BackupResult unpack_mypack2_extents(UnpackWriter *unpack, const unsigned char **data, size_t *size) {
+    size_t total = (size_t)unpack->item.extent_count * sizeof(Pack2Extent);
+    size_t chunk = total - unpack->extents_len;
+    if (chunk > *size) {
+        chunk = *size;
+    }
+
+    memcpy((unsigned char *)unpack->extents + unpack->extents_len, *data, chunk);
+    unpack->extents_len += chunk;
+    unpack->position += chunk;
+    *data += chunk;
+    *size -= chunk;
+    if (unpack->extents_len < total) {
+        return BACKUP_SUCCESS;
+    }
+
+    unsigned long long end = 0;
+    for (unsigned int i = 0; i < unpack->item.extent_count; i++) {
+        const Pack2Extent *extent = &unpack->extents[i];
+        if (extent->offset < end || extent->offset > unpack->item.size || extent->length > unpack->item.size - extent->offset) {
+            return BACKUP_ERROR_PACK;
+        }
+        end = extent->offset + extent->length;
+    }
+    unpack->state = UNPACK_STATE_MYPACK2_DATA;
+    return BACKUP_SUCCESS;
+}
+
+// 当前文件的一段数据写完：稀疏文件定位到下一个数据段，之间的部分成为空洞；
+// 全部写完后关闭输出文件，稀疏文件先设置文件大小，保留末尾的空洞
+static BackupResult unpack_mypack2_next(UnpackWriter *unpack) {
+    if (unpack->item.flags & PACK2_ITEM_SPARSE) {
+        while (unpack->remaining == 0 && unpack->extent_index < unpack->item.extent_count) {
+            const Pack2Extent *extent = &unpack->extents[unpack->extent_index++];
+            if (platform_seek(unpack->output, (long long)extent->offset, SEEK_SET) != BACKUP_SUCCESS) {
+                return BACKUP_ERROR_FILE;
+            }
+            unpack->remaining = extent->length;
+        }
+        if (unpack->remaining > 0) {
+            return BACKUP_SUCCESS;
+        }
+        if (platform_set_file_size(unpack->output, unpack->item.size) != BACKUP_SUCCESS) {
+            return BACKUP_ERROR_FILE;
+        }
+    }
+    return unpack_mypack2_done(unpack);
+}
+
+// 辅助函数：开始读取长名称记录，名称替换之前未使用的同类记录
+static BackupResult unpack_tar_long_begin(UnpackWriter *unpack, char **name, unsigned long long size) {
+    if (size == 0 || size > TAR_LONG_NAME_MAX) {
+        return BACKUP_ERROR_PACK;
+    }
+    free(*name);
+    *name = (char *)calloc((size_t)size + 1, 1);
+    if (*name == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    unpack->tar_long_name = *name;
+    unpack->tar_long_length = 0;
+    unpack->remaining = size;
+    unpack->padding = (size % 512 != 0) ? 512 - (size % 512) : 0;
+    unpack->state = UNPACK_STATE_TAR_LONG_NAME;
+    return BACKUP_SUCCESS;
+}
+
+// 辅助函数：长名称只用于紧接着的一项，用过后释放
+static void unpack_tar_long_clear(UnpackWriter *unpack) {
+    free(unpack->tar_long_path);
+    free(unpack->tar_long_link);
+    unpack->tar_long_path = NULL;
+    unpack->tar_long_link = NULL;
+}
+
+// 处理一个完整的Tar文件头
+static BackupResult unpack_tar_header(UnpackWriter *unpack) {
+    FileMetadata metadata;
+    int all_zero = 1;
+
+    unpack->record_len = 0;
+    for (int i = 0; i < 512; i++) {
+        if (unpack->record[i] != 0) {
+            all_zero = 0;
+            break;
+        }
+    }
+    if (all_zero) {
+        unpack->state = UNPACK_STATE_END;
+        return BACKUP_SUCCESS;
+    }
+
+    // GNU长名称记录（类型'L'和'K'）的数据是下一项的完整路径或链接目标
+    char type = (char)unpack->record[156];
+    if (type == 'L' || type == 'K') {
+        unsigned long long size = tar_parse_size((const char *)unpack->record + 124);
+        return unpack_tar_long_begin(unpack, (type == 'L') ? &unpack->tar_long_path : &unpack->tar_long_link, size);
+    }
+
+    // 有长名称时文件元数据中的路径被截断，文件按完整路径解包
+    tar_parse_header((const char *)unpack->record, &metadata);
+    const char *path = metadata.path;
+    if (unpack->tar_long_path != NULL) {
+        path = unpack->tar_long_path;
+        snprintf(metadata.path, sizeof(metadata.path), "%s", path);
+        const char *base_name = strrchr(path, '/');
+        snprintf(metadata.name, sizeof(metadata.name), "%s", (base_name != NULL) ? base_name + 1 : path);
+    }
+
+    BackupResult result = BACKUP_SUCCESS;
+    if (path[0] != '\0') {
+        result = unpack_record(unpack, &metadata);
+    }
+    if (result != BACKUP_SUCCESS || path[0] == '\0') {
+        unpack_tar_long_clear(unpack);
+        return result;
+    }
+
+    // 硬链接项（类型'1'）链接到先前解包的文件，链接项本身的数据（如果有）被跳过
+    if (type == '1') {
+        char target[101] = {0};
+        memcpy(target, unpack->record + 157, 100);
+        unpack->remaining = metadata.size + ((metadata.size % 512 != 0) ? 512 - (metadata.size % 512) : 0);
+        unpack->state = UNPACK_STATE_TAR_PADDING;
+        result = unpack_link(unpack, (unpack->tar_long_link != NULL) ? unpack->tar_long_link : target, path);
+        unpack_tar_long_clear(unpack);
+        return result;
+    }
+
+    result = unpack_open(unpack, path, metadata.size);
+    unpack_tar_long_clear(unpack);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+    unpack->padding = (metadata.size % 512 != 0) ? 512 - (metadata.size % 512) : 0;
+    unpack->state = UNPACK_STATE_TAR_DATA;
+    return BACKUP_SUCCESS;
+}
+
+// 流式解包阶段：写入打包数据
+static BackupResult unpack_writer_write(ByteWriter *writer, const unsigned char *data, size_t size) {
+    UnpackWriter *unpack = (UnpackWriter *)writer;
+    BackupResult result = BACKUP_SUCCESS;
+
+    while (size > 0 && result == BACKUP_SUCCESS) {
+        switch (unpack->state) {
+            case UNPACK_STATE_DETECT:
+                // MyPack的魔术字之后是版本号，版本1的头部继续读取，版本2从文件记录开始
+                if (unpack_collect(unpack, &data, &size, sizeof(Pack2Signature))) {
+                    if (memcmp(unpack->record, "BACK", 4) != 0) {
+                        unpack->state = UNPACK_STATE_TAR_HEADER;
+                    } else {
+                        Pack2Signature signature;
+                        memcpy(&signature, unpack->record, sizeof(Pack2Signature));
+                        if (signature.version == PACK_VERSION_1) {
+                            unpack->state = UNPACK_STATE_MYPACK_HEADER;
+                        } else if (signature.version == PACK_VERSION_2) {
+                            unpack->record_len = 0;
+                            unpack->state = UNPACK_STATE_MYPACK2_TAG;
+                        } else {
+                            return BACKUP_ERROR_PACK;
+                        }
+                    }
+                }
+                break;
+
+            case UNPACK_STATE_MYPACK_HEADER:
+                if (unpack_collect(unpack, &data, &size, sizeof(PackHeader))) {
+                    memcpy(&unpack->header, unpack->record, sizeof(PackHeader));
+                    unpack->record_len = 0;
+                    unpack->state = (unpack->header.file_count > 0) ? UNPACK_STATE_MYPACK_ITEMS : UNPACK_STATE_END;
+                }
+                break;
+
+            case UNPACK_STATE_MYPACK_ITEMS:
+                if (unpack_collect(unpack, &data, &size, sizeof(PackFileItem))) {
+                    result = unpack_mypack_grow(unpack);
+                    if (result != BACKUP_SUCCESS) {
+                        return result;
+                    }
+                    memcpy(&unpack->items[unpack->item_count++], unpack->record, sizeof(PackFileItem));
+                    unpack->record_len = 0;
+                    if (unpack->item_count == unpack->header.file_count) {
+                        unpack->state = UNPACK_STATE_MYPACK_DATA;
+                    }
+                }
+                break;
+
+            case UNPACK_STATE_MYPACK_DATA:
+                result = unpack_mypack_data(unpack, &data, &size);
+                break;
+
+            case UNPACK_STATE_MYPACK2_TAG:
+                if (unpack_collect(unpack, &data, &size, PACK2_TAG_SIZE)) {
+                    result = unpack_mypack2_tag(unpack);
+                }
+                break;
+
+            case UNPACK_STATE_MYPACK2_ITEM:
+                if (unpack_collect(unpack, &data, &size, sizeof(Pack2Item))) {
+                    result = unpack_mypack2_item(unpack);
+                }
+                break;
+
+            case UNPACK_STATE_MYPACK2_NAMES:
+                result = unpack_mypack2_names(unpack, &data, &size);
+                break;
+
+            case UNPACK_STATE_MYPACK2_EXTENTS:
+                result = unpack_mypack2_extents(unpack, &data, &size);
+                break;
+
+            case UNPACK_STATE_MYPACK2_CHUNKS:
+                result = unpack_mypack2_chunks(unpack, &data, &size);
+                break;
+
+            case UNPACK_STATE_MYPACK2_DATA:
+                result = unpack_output(unpack, &data, &size);
+                break;
+
+            case UNPACK_STATE_MYPACK2_HASH:
+                if (unpack_collect(unpack, &data, &size, sizeof(unsigned long long))) {
+                    result = unpack_mypack2_hash(unpack);
+                }
+                break;
+
+            case UNPACK_STATE_TAR_HEADER:
+                if (unpack_collect(unpack, &data, &size, 512)) {
+                    result = unpack_tar_header(unpack);
+                }
+                break;
+
+            case UNPACK_STATE_TAR_LONG_NAME:
+                {
+                    size_t chunk = (size < unpack->remaining) ? size : (size_t)unpack->remaining;
+                    memcpy(unpack->tar_long_name + unpack->tar_long_length, data, chunk);
+                    unpack->tar_long_length += chunk;
+                    unpack->remaining -= chunk;
+                    unpack->position += chunk;
+                    data += chunk;
+                    size -= chunk;
+                    if (unpack->remaining == 0) {
+                        // 长路径读完整之后才能检查，名称之后可能有'\0'填充
+                        if (unpack->tar_long_name == unpack->tar_long_path &&
+                            !pack_path_safe(unpack->tar_long_path, strlen(unpack->tar_long_path))) {
+                            result = BACKUP_ERROR_PACK;
+                            break;
+                        }
+                        unpack->remaining = unpack->padding;
+                        unpack->state = UNPACK_STATE_TAR_PADDING;
+                    }
+                }
+                break;
+
+            case UNPACK_STATE_TAR_DATA:
+                result = unpack_output(unpack, &data, &size);
+                if (result == BACKUP_SUCCESS && unpack->remaining == 0) {
+                    result = unpack_close(unpack);
+                    unpack->remaining = unpack->padding;
+                    unpack->state = UNPACK_STATE_TAR_PADDING;
+                }
+                break;
+
+            case UNPACK_STATE_TAR_PADDING:
+                {
+                    size_t chunk = (size < unpack->remaining) ? size : (size_t)unpack->remaining;
+                    unpack->remaining -= chunk;
+                    unpack->position += chunk;
+                    data += chunk;
+                    size -= chunk;
+                }
+                break;
+
+            case UNPACK_STATE_END:
+                return BACKUP_SUCCESS;
+        }
+
+        // 空文件和无填充的情况不需要等待更多数据
+        if (result == BACKUP_SUCCESS && unpack->state == UNPACK_STATE_MYPACK2_DATA && unpack->remaining == 0) {
+            result = unpack_mypack2_next(unpack);
+        }
+        if (result == BACKUP_SUCCESS && unpack->state == UNPACK_STATE_TAR_DATA && unpack->remaining == 0) {
+            result = unpack_close(unpack);
+            unpack->remaining = unpack->padding;
+            unpack->state = UNPACK_STATE_TAR_PADDING;
+        }
+        if (unpack->state == UNPACK_STATE_TAR_PADDING && unpack->remaining == 0) {
+            unpack->state = UNPACK_STATE_TAR_HEADER;
+        }
+    }
+
+    // MyPack末尾的空文件不需要等待更多数据
+    if (result == BACKUP_SUCCESS && unpack->state == UNPACK_STATE_MYPACK_DATA) {
+        result = unpack_mypack_data(unpack, &data, &size);
+    }
+
+    return result;
+}
+
+// 流式解包阶段：检查打包数据是否完整
+static BackupResult unpack_writer_finish(ByteWriter *writer) {
+    UnpackWriter *unpack = (UnpackWriter *)writer;
+    BackupResult result;
+
+    switch (unpack->state) {
+        case UNPACK_STATE_END:
+            result = BACKUP_SUCCESS;
+            break;
+        case UNPACK_STATE_TAR_HEADER:
+            // 缺少结束块的Tar数据也视为完整
+            result = (unpack->record_len == 0) ? BACKUP_SUCCESS : BACKUP_ERROR_PACK;
+            break;
+        default:
+            result = BACKUP_ERROR_PACK;
+            break;
+    }
+
+    // 将解包的文件列表交给调用方
+    if (result == BACKUP_SUCCESS && unpack->out_files != NULL) {
+        *unpack->out_files = unpack->files;
+        *unpack->out_count = unpack->file_count;
+        unpack->files = NULL;
+    }
+
+    return result;
+}
+
+// 流式解包阶段：释放资源
+static void unpack_writer_destroy(ByteWriter *writer) {
+    UnpackWriter *unpack = (UnpackWriter *)writer;
+
+    if (unpack->output != NULL) {
+        fclose(unpack->output);
+    }
+    if (unpack->chunk_file != NULL) {
+        fclose(unpack->chunk_file);
+    }
+    dir_cache_destroy(unpack->dirs);
+    unpack_tar_long_clear(unpack);
+    for (size_t i = 0; i < unpack->extracted_capacity; i++) {
+        free(unpack->extracted[i]);
+    }
+    free(unpack->extracted);
+    free(unpack->items);
+    free(unpack->extents);
+    free(unpack->chunks);
+    free(unpack->chunk_path);
+    free(unpack->chunk_buffer);
+    free(unpack->names);
+    free(unpack->files);
+    free(unpack);
+}
+
+// 创建流式解包阶段，根据魔术字自动识别MyPack或Tar格式
+// files和file_count不为NULL时，解包完成后返回解包的文件列表，由调用方释放
+ByteWriter *unpack_writer_create(FileMetadata **files, int *file_count) {
+    if ((files == NULL) != (file_count == NULL)) {
+        return NULL;
+    }
+
+    UnpackWriter *unpack = (UnpackWriter *)calloc(1, sizeof(UnpackWriter));
+    if (unpack == NULL) {
+        return NULL;
+    }
+
+    if (files != NULL) {
+        *files = NULL;
+        *file_count = 0;
+    }
+    unpack->out_files = files;
+    unpack->out_count = file_count;
+
+    unpack->base.write = unpack_writer_write;
+    unpack->base.finish = unpack_writer_finish;
+    unpack->base.destroy = unpack_writer_destroy;
+    unpack->base.next = NULL;
+    unpack->state = UNPACK_STATE_DETECT;
+
+    return &unpack->base;
+}
+
+// 设置分块文件的块数据文件路径（应为绝对路径，解包时当前工作目录是目标目录）
+BackupResult unpack_writer_set_chunk_store(ByteWriter *writer, const char *data_path) {
+    UnpackWriter *unpack = (UnpackWriter *)writer;
+    if (unpack == NULL || data_path == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    char *path = (char *)malloc(strlen(data_path) + 1);
+    if (path == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    strcpy(path, data_path);
+    free(unpack->chunk_path);
+    unpack->chunk_path = path;
+    return BACKUP_SUCCESS;
+}
+
+// 从读取端解包，文件写入当前工作目录，并返回解包的文件列表
+BackupResult unpack_stream(ByteReader *reader, FileMetadata **files, int *file_count) {
+    if (reader == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    ByteWriter *unpack = unpack_writer_create(files, file_count);
+    if (unpack == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    BackupResult result = stream_copy(reader, unpack);
+    if (result == BACKUP_SUCCESS) {
+        result = stream_finish(unpack);
+    }
+
+    stream_destroy(unpack);
+    return result;
+}
+
+// MyPack解包实现
+BackupResult mypack_unpack(FILE *fp, FileMetadata **files, int *file_count) {
+    char magic[4];
+
+    // 检查魔术字，再从头开始解包
+    if (fread(magic, 1, 4, fp) != 4 || memcmp(magic, "BACK", 4) != 0) {
+        return BACKUP_ERROR_PACK;
+    }
+    if (fseek(fp, -4, SEEK_CUR) != 0) {
+        return BACKUP_ERROR_FILE;
+    }
+
+    ByteReader *reader = file_reader_create(fp);
+    if (reader == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    BackupResult result = unpack_stream(reader, files, file_count);
+    reader_destroy(reader);
+    return result;
+}
+
+// Tar解包实现
+BackupResult tar_unpack(FILE *fp, FileMetadata **files, int *file_count) {
+    ByteReader *reader = file_reader_create(fp);
+    if (reader == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    BackupResult result = unpack_stream(reader, files, file_count);
+    reader_destroy(reader);
     return result;
 }
 
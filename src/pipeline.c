@@ -0,0 +1,951 @@
+#include "pipeline.h"
+#include "thread.h"
+#include "pack.h"
+#include "compress.h"
+#include "encrypt.h"
+#include "traverse.h"
+#include "platform.h"
+#include "manifest.h"
+#include <stdatomic.h>
+#include <stddef.h>
+
+// 阶段之间传递的数据块
+// copy_size不为0时数据块中是源文件的相对路径，由写入阶段把该文件的copy_size字节数据直接复制到备份文件，
+// copy_hash不为0时写入阶段还要计算复制的数据的内容摘要，通过摘要队列交回打包阶段
+typedef struct {
+    size_t len;
+    unsigned long long copy_size;
+    int copy_hash;
+    unsigned char data[PIPELINE_BLOCK_SIZE];
+} PipelineBlock;
+
+// 读取阶段交给打包阶段的文件元数据队列长度（流式遍历时使用，必须是2的幂）
+#define PIPELINE_FILE_RING_DEPTH 64
+
+// 写入阶段交回打包阶段的内容摘要队列长度（必须是2的幂）
+#define PIPELINE_HASH_RING_DEPTH 4
+
+// 未压缩、未加密时较大文件的数据可以由写入阶段通过内核直接从源文件复制到备份文件（Linux上的copy_file_range和sendfile）
+#ifdef __linux__
+#define PIPELINE_ZERO_COPY 1
+#else
+#define PIPELINE_ZERO_COPY 0
+#endif
+
+// 直接复制的最小文件大小：直接复制前需要冲刷备份文件的缓冲区，且不能由读取阶段提前读入，
+// 较小的文件省下的复制抵不上多出的系统调用和失去的并行，仍经过数据块队列
+#define PIPELINE_ZERO_COPY_MIN_SIZE (256 * 1024)
+
+typedef struct Pipeline Pipeline;
+
+// 阶段运行上下文
+typedef struct {
+    Pipeline *pipeline;
+    PipelineStage stage;
+    int enabled;
+    RingBuffer *input;             // 输入队列（第一个启用的阶段为NULL）
+    RingBuffer *output;            // 输出队列（写入阶段为NULL）
+    ByteWriter *chain;             // 压缩、加密、写入阶段的处理链
+    unsigned long long bytes_in;   // 本阶段处理的输入字节数
+    Thread thread;
+    int started;
+} PipelineContext;
+
+struct Pipeline {
+    const Catalog *catalog;        // 目录清单，流式遍历时由遍历阶段边遍历边追加
+    Catalog *tree;                 // 流式遍历时遍历阶段追加的目录清单（与catalog相同）
+    const char *root_path;         // 流式遍历的根目录
+    RingBuffer *file_ring;         // 流式遍历时读取阶段交给打包阶段的文件编号
+    Mutex queue_lock;              // 多个遍历线程向文件队列放入文件时加锁
+    const BackupOptions *options;
+    FILE *output_fp;               // 备份文件
+    ChunkStore *chunks;            // 去重打包时的分块存储，由打包阶段写入（否则为NULL）
+    const Manifest *previous;      // 增量备份时上一次的备份清单（否则为NULL）
+    int zero_copy;                 // 零拷贝打包：较大文件的数据不经过读取和打包阶段，由写入阶段直接复制
+    RingBuffer *hash_ring;         // 零拷贝打包时写入阶段交回打包阶段的直接复制数据的内容摘要
+    PipelineContext stages[PIPELINE_STAGE_COUNT];
+    unsigned long long file_total; // 读取的文件数量
+    unsigned long long copied_bytes; // 由内核直接复制的字节数（写入阶段累计）
+    unsigned long long unchanged_files; // 增量备份时没有变化、不再读取的文件数量（读取阶段累计）
+    unsigned long long unchanged_bytes;
+    atomic_int error;              // 第一个失败阶段的错误码
+};
+
+// 遍历阶段的接收端：遍历线程找到的文件放入读取阶段的输入队列
+typedef struct {
+    TraverseSink base;
+    PipelineContext *context;
+} QueueSink;
+
+// 写入队列的写入端：数据填满一个数据块后发布给下游阶段
+typedef struct {
+    ByteWriter base;
+    RingBuffer *ring;
+    PipelineBlock *block;          // 正在填充的数据块
+} RingWriter;
+
+// 打包阶段的数据来源：按文件大小从读取阶段的队列中取出文件数据
+typedef struct {
+    PackSource base;
+    ByteReader reader;             // 当前文件的读取端（内嵌，不单独分配）
+    PipelineContext *context;
+    PipelineBlock *block;          // 正在读取的数据块
+    size_t pos;                    // 在数据块中的读取位置
+    unsigned long long remaining;  // 当前文件剩余的字节数
+    ByteWriter *output;            // 打包阶段的输出（零拷贝打包时用于发布直接复制的请求）
+} RingSource;
+
+// 辅助函数：记录错误并中止所有队列，唤醒等待中的阶段
+static void pipeline_fail(Pipeline *pipeline, BackupResult result) {
+    int expected = BACKUP_SUCCESS;
+    atomic_compare_exchange_strong(&pipeline->error, &expected, (int)result);
+
+    for (int i = 0; i < PIPELINE_STAGE_COUNT; i++) {
+        if (pipeline->stages[i].input != NULL) {
+            ring_abort(pipeline->stages[i].input);
+        }
+    }
+    if (pipeline->file_ring != NULL) {
+        ring_abort(pipeline->file_ring);
+    }
+    if (pipeline->hash_ring != NULL) {
+        ring_abort(pipeline->hash_ring);
+    }
+}
+
+// 队列写入端：写入数据
+static BackupResult ring_writer_write(ByteWriter *writer, const unsigned char *data, size_t size) {
+    RingWriter *ring_writer = (RingWriter *)writer;
+
+    while (size > 0) {
+        if (ring_writer->block == NULL) {
+            ring_writer->block = (PipelineBlock *)ring_acquire(ring_writer->ring);
+            if (ring_writer->block == NULL) {
+                // 队列已中止，真正的错误码已由失败的阶段记录
+                return BACKUP_ERROR_FILE;
+            }
+            ring_writer->block->len = 0;
+            ring_writer->block->copy_size = 0;
+            ring_writer->block->copy_hash = 0;
+        }
+
+        PipelineBlock *block = ring_writer->block;
+        size_t chunk = PIPELINE_BLOCK_SIZE - block->len;
+        if (chunk > size) {
+            chunk = size;
+        }
+        memcpy(block->data + block->len, data, chunk);
+        block->len += chunk;
+        data += chunk;
+        size -= chunk;
+
+        if (block->len == PIPELINE_BLOCK_SIZE) {
+            ring_publish(ring_writer->ring);
+            ring_writer->block = NULL;
+        }
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+// 队列写入端：发布最后一个数据块并关闭队列
+static BackupResult ring_writer_finish(ByteWriter *writer) {
+    RingWriter *ring_writer = (RingWriter *)writer;
+
+    if (ring_writer->block != NULL && ring_writer->block->len > 0) {
+        ring_publish(ring_writer->ring);
+    }
+    ring_writer->block = NULL;
+    ring_close(ring_writer->ring);
+    return BACKUP_SUCCESS;
+}
+
+// 队列写入端：发布正在填充的数据块，再发布一个请求下游直接复制文件数据的数据块，hash为1时同时请求内容摘要
+static BackupResult ring_writer_copy(ByteWriter *writer, const char *path, unsigned long long size, int hash) {
+    RingWriter *ring_writer = (RingWriter *)writer;
+    size_t length = strlen(path);
+
+    if (length >= PIPELINE_BLOCK_SIZE) {
+        return BACKUP_ERROR_PATH;
+    }
+    if (ring_writer->block != NULL && ring_writer->block->len > 0) {
+        ring_publish(ring_writer->ring);
+        ring_writer->block = NULL;
+    }
+    if (ring_writer->block == NULL) {
+        ring_writer->block = (PipelineBlock *)ring_acquire(ring_writer->ring);
+        if (ring_writer->block == NULL) {
+            return BACKUP_ERROR_FILE;
+        }
+    }
+
+    PipelineBlock *block = ring_writer->block;
+    memcpy(block->data, path, length + 1);
+    block->len = length;
+    block->copy_size = size;
+    block->copy_hash = hash;
+    ring_publish(ring_writer->ring);
+    ring_writer->block = NULL;
+    return BACKUP_SUCCESS;
+}
+
+// 创建队列写入端
+static ByteWriter *ring_writer_create(RingBuffer *ring) {
+    RingWriter *ring_writer = (RingWriter *)calloc(1, sizeof(RingWriter));
+    if (ring_writer == NULL) {
+        return NULL;
+    }
+
+    ring_writer->base.write = ring_writer_write;
+    ring_writer->base.finish = ring_writer_finish;
+    ring_writer->base.destroy = NULL;
+    ring_writer->base.next = NULL;
+    ring_writer->ring = ring;
+
+    return &ring_writer->base;
+}
+
+// 辅助函数：当前文件在数据块中的下一段数据（最多size字节），使用后调用ring_source_consume
+// 读取阶段提供的数据与文件大小严格一致，数据提前结束说明流水线已中止，返回NULL
+static const unsigned char *ring_source_next(RingSource *source, size_t size, size_t *length) {
+    if (source->block == NULL) {
+        source->block = (PipelineBlock *)ring_peek(source->context->input);
+        if (source->block == NULL) {
+            return NULL;
+        }
+        source->pos = 0;
+    }
+
+    size_t chunk = source->block->len - source->pos;
+    if (chunk > size) {
+        chunk = size;
+    }
+    if (chunk > source->remaining) {
+        chunk = (size_t)source->remaining;
+    }
+    *length = chunk;
+    return source->block->data + source->pos;
+}
+
+// 辅助函数：消耗当前文件的length字节数据，数据块用完后归还给读取阶段
+static void ring_source_consume(RingSource *source, size_t length) {
+    source->pos += length;
+    source->remaining -= length;
+    source->context->bytes_in += length;
+
+    if (source->pos == source->block->len) {
+        ring_release(source->context->input);
+        source->block = NULL;
+    }
+}
+
+// 打包数据来源：读取当前文件的数据
+static BackupResult ring_source_read(ByteReader *reader, unsigned char *buffer, size_t size, size_t *bytes_read) {
+    RingSource *source = (RingSource *)((char *)reader - offsetof(RingSource, reader));
+
+    *bytes_read = 0;
+    while (size > 0 && source->remaining > 0) {
+        size_t chunk;
+        const unsigned char *data = ring_source_next(source, size, &chunk);
+        if (data == NULL) {
+            return BACKUP_ERROR_FILE;
+        }
+        memcpy(buffer, data, chunk);
+        ring_source_consume(source, chunk);
+        buffer += chunk;
+        size -= chunk;
+        *bytes_read += chunk;
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+// 打包数据来源：读取端内嵌在数据来源中，不需要释放
+static void ring_source_reader_destroy(ByteReader *reader) {
+    (void)reader;
+}
+
+// 打包数据来源：打开文件
+static ByteReader *ring_source_open(PackSource *base, const char *path, unsigned long long size) {
+    RingSource *source = (RingSource *)base;
+
+    (void)path;
+    source->remaining = size;
+    return &source->reader;
+}
+
+// 打包数据来源（零拷贝打包）：较大的文件请求写入阶段直接复制，较小的文件直接写出读取阶段读入的数据块
+// 需要内容摘要时等待写入阶段复制完成并交回摘要，写入阶段在这之前会处理完已发布的所有数据块，不会互相等待
+static BackupResult ring_source_copy(PackSource *base, ByteWriter *writer, const char *path, unsigned long long size, unsigned long long *hash) {
+    RingSource *source = (RingSource *)base;
+
+    if (size >= PIPELINE_ZERO_COPY_MIN_SIZE) {
+        source->context->bytes_in += size;
+        BackupResult result = ring_writer_copy(source->output, path, size, hash != NULL);
+        if (result != BACKUP_SUCCESS || hash == NULL) {
+            return result;
+        }
+        RingBuffer *hash_ring = source->context->pipeline->hash_ring;
+        const unsigned long long *copy_hash = (const unsigned long long *)ring_peek(hash_ring);
+        if (copy_hash == NULL) {
+            // 队列已中止，真正的错误码已由失败的阶段记录
+            return BACKUP_ERROR_FILE;
+        }
+        *hash = *copy_hash;
+        ring_release(hash_ring);
+        return BACKUP_SUCCESS;
+    }
+
+    source->remaining = size;
+    while (source->remaining > 0) {
+        size_t chunk;
+        const unsigned char *data = ring_source_next(source, PIPELINE_BLOCK_SIZE, &chunk);
+        if (data == NULL) {
+            return BACKUP_ERROR_FILE;
+        }
+        BackupResult result = stream_write(writer, data, chunk);
+        ring_source_consume(source, chunk);
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+    }
+    return BACKUP_SUCCESS;
+}
+
+// 遍历阶段的接收端：放入文件，队列满时等待读取阶段取走
+static BackupResult queue_sink_add(TraverseSink *base, const Catalog *catalog, unsigned int id) {
+    QueueSink *sink = (QueueSink *)base;
+    Pipeline *pipeline = sink->context->pipeline;
+
+    // 环形队列只支持单生产者，多个遍历线程依次放入
+    (void)catalog;
+    mutex_lock(&pipeline->queue_lock);
+    unsigned int *slot = (unsigned int *)ring_acquire(sink->context->output);
+    if (slot != NULL) {
+        *slot = id;
+        ring_publish(sink->context->output);
+    }
+    mutex_unlock(&pipeline->queue_lock);
+
+    // 队列已中止，真正的错误码已由失败的阶段记录
+    return (slot != NULL) ? BACKUP_SUCCESS : BACKUP_ERROR_FILE;
+}
+
+// 遍历阶段：并行遍历目录，找到的文件经过筛选后立即交给读取阶段
+static BackupResult pipeline_traverse(PipelineContext *context) {
+    Pipeline *pipeline = context->pipeline;
+    QueueSink sink;
+
+    sink.base.add = queue_sink_add;
+    sink.context = context;
+
+    BackupResult result = traverse_directory_to(pipeline->root_path, pipeline->tree, &sink.base, pipeline->options);
+    if (result == BACKUP_SUCCESS) {
+        ring_close(context->output);
+    }
+    return result;
+}
+
+// 辅助函数：读取一个源文件写入输出队列，写入长度严格等于文件项记录的大小
+// 文件在遍历之后发生变化时，超出部分被截断，不足部分补零
+// links记录已读取数据的硬链接组，与打包阶段按相同的顺序判断，同一文件只读取一次
+// 增量备份时与上一次相比没有变化的文件同样由打包阶段判断，沿用上一次的块引用表，不读取
+static BackupResult pipeline_read_file(PipelineContext *context, unsigned int id, CatalogLinks *links, char **path, size_t *path_capacity, PipelineBlock **current) {
+    const Catalog *catalog = context->pipeline->catalog;
+    PipelineBlock *block = *current;
+
+    // 同一文件已经读取过数据的硬链接，打包阶段只记录链接
+    unsigned int link;
+    BackupResult result = catalog_link_source(catalog, links, id, &link);
+    if (result != BACKUP_SUCCESS || link != CATALOG_NONE) {
+        return result;
+    }
+
+    // 零拷贝打包时较大文件的数据由打包阶段直接复制
+    if (context->pipeline->zero_copy && catalog_entry(catalog, id)->size >= PIPELINE_ZERO_COPY_MIN_SIZE) {
+        return BACKUP_SUCCESS;
+    }
+
+    result = catalog_path_buffer(catalog, id, path, path_capacity);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+    if (manifest_find_unchanged(context->pipeline->previous, *path, catalog_entry(catalog, id)) != NULL) {
+        context->pipeline->unchanged_files++;
+        context->pipeline->unchanged_bytes += catalog_entry(catalog, id)->size;
+        return BACKUP_SUCCESS;
+    }
+
+    // 稀疏文件由打包模块直接从磁盘只读取数据段
+    if (catalog_entry(catalog, id)->flags & CATALOG_FLAG_SPARSE) {
+        return BACKUP_SUCCESS;
+    }
+    ByteReader *reader = file_reader_open(*path);
+    if (reader == NULL) {
+        return BACKUP_ERROR_FILE;
+    }
+
+    unsigned long long remaining = catalog_entry(catalog, id)->size;
+    while (remaining > 0) {
+        if (block == NULL) {
+            block = (PipelineBlock *)ring_acquire(context->output);
+            if (block == NULL) {
+                result = BACKUP_ERROR_FILE;
+                break;
+            }
+            block->len = 0;
+        }
+
+        // 直接读入数据块，不经过中间缓冲区
+        size_t chunk = PIPELINE_BLOCK_SIZE - block->len;
+        if (chunk > remaining) {
+            chunk = (size_t)remaining;
+        }
+        size_t bytes_read = 0;
+        result = stream_read(reader, block->data + block->len, chunk, &bytes_read);
+        if (result != BACKUP_SUCCESS) {
+            break;
+        }
+        if (bytes_read == 0) {
+            // 文件变短，补零
+            memset(block->data + block->len, 0, chunk);
+            bytes_read = chunk;
+        }
+        block->len += bytes_read;
+        remaining -= bytes_read;
+        context->bytes_in += bytes_read;
+
+        if (block->len == PIPELINE_BLOCK_SIZE) {
+            ring_publish(context->output);
+            block = NULL;
+        }
+    }
+
+    reader_destroy(reader);
+    *current = block;
+    return result;
+}
+
+// 辅助函数：流式遍历时把文件编号交给打包阶段
+// 编号队列满时打包阶段可能正在等待尚未填满的数据块，先发布该数据块再等待，避免互相等待
+static BackupResult pipeline_forward_file(PipelineContext *context, unsigned int id, PipelineBlock **current) {
+    Pipeline *pipeline = context->pipeline;
+
+    if (*current != NULL && ring_depth(pipeline->file_ring) >= PIPELINE_FILE_RING_DEPTH) {
+        ring_publish(context->output);
+        *current = NULL;
+    }
+
+    unsigned int *slot = (unsigned int *)ring_acquire(pipeline->file_ring);
+    if (slot == NULL) {
+        return BACKUP_ERROR_FILE;
+    }
+    *slot = id;
+    ring_publish(pipeline->file_ring);
+    return BACKUP_SUCCESS;
+}
+
+// 读取阶段：按文件列表（或遍历阶段找到文件的）顺序读取源文件
+static BackupResult pipeline_read_files(PipelineContext *context) {
+    Pipeline *pipeline = context->pipeline;
+    PipelineBlock *block = NULL;
+    char *path = NULL;
+    size_t path_capacity = 0;
+    CatalogLinks links;
+    BackupResult result = BACKUP_SUCCESS;
+
+    catalog_links_init(&links);
+    if (context->input == NULL) {
+        unsigned int file_count = catalog_file_count(pipeline->catalog);
+        for (unsigned int i = 0; i < file_count && result == BACKUP_SUCCESS; i++) {
+            result = pipeline_read_file(context, catalog_file_id(pipeline->catalog, i), &links, &path, &path_capacity, &block);
+            pipeline->file_total++;
+        }
+    } else {
+        const unsigned int *queued;
+        while (result == BACKUP_SUCCESS && (queued = (const unsigned int *)ring_peek(context->input)) != NULL) {
+            unsigned int id = *queued;
+            ring_release(context->input);
+
+            result = pipeline_forward_file(context, id, &block);
+            if (result == BACKUP_SUCCESS) {
+                result = pipeline_read_file(context, id, &links, &path, &path_capacity, &block);
+                pipeline->file_total++;
+            }
+        }
+        if (result == BACKUP_SUCCESS && ring_aborted(context->input)) {
+            result = BACKUP_ERROR_FILE;
+        }
+    }
+
+    if (result == BACKUP_SUCCESS) {
+        if (block != NULL && block->len > 0) {
+            ring_publish(context->output);
+        }
+        ring_close(context->output);
+        if (pipeline->file_ring != NULL) {
+            ring_close(pipeline->file_ring);
+        }
+    }
+    catalog_links_free(&links);
+    free(path);
+    return result;
+}
+
+// 辅助函数：流式打包读取阶段交来的文件，直到读取阶段结束
+static BackupResult pipeline_pack_stream(PipelineContext *context, ByteWriter *writer, PackSource *source) {
+    Pipeline *pipeline = context->pipeline;
+
+    PackStream *stream;
+    if (pipeline->chunks != NULL) {
+        stream = pack_stream_create_chunked(writer, source, pipeline->chunks, pipeline->previous);
+    } else {
+        stream = pack_stream_create(writer, pipeline->options->pack_algorithm, source);
+    }
+    if (stream == NULL) {
+        return BACKUP_ERROR_PACK;
+    }
+
+    BackupResult result = BACKUP_SUCCESS;
+    const unsigned int *id;
+    while (result == BACKUP_SUCCESS && (id = (const unsigned int *)ring_peek(pipeline->file_ring)) != NULL) {
+        result = pack_stream_add(stream, pipeline->catalog, *id);
+        ring_release(pipeline->file_ring);
+    }
+    if (result == BACKUP_SUCCESS && ring_aborted(pipeline->file_ring)) {
+        result = BACKUP_ERROR_FILE;
+    }
+    if (result == BACKUP_SUCCESS) {
+        result = pack_stream_end(stream);
+    }
+
+    pack_stream_destroy(stream);
+    return result;
+}
+
+// 打包阶段：从读取阶段取出文件数据，加上打包格式的头部和文件项后写入输出队列
+static BackupResult pipeline_pack_files(PipelineContext *context) {
+    Pipeline *pipeline = context->pipeline;
+    RingSource source;
+
+    memset(&source, 0, sizeof(RingSource));
+    source.base.open = ring_source_open;
+    source.reader.read = ring_source_read;
+    source.reader.destroy = ring_source_reader_destroy;
+    source.context = context;
+
+    ByteWriter *writer = ring_writer_create(context->output);
+    if (writer == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    if (pipeline->zero_copy) {
+        source.base.copy = ring_source_copy;
+        source.base.copy_min_size = PIPELINE_ZERO_COPY_MIN_SIZE;
+        source.output = writer;
+    }
+
+    BackupResult result;
+    if (pipeline->file_ring != NULL) {
+        // 流式遍历：文件数量事先未知，逐个打包
+        result = pipeline_pack_stream(context, writer, &source.base);
+    } else if (pipeline->chunks != NULL) {
+        result = mypack_pack_chunked(writer, pipeline->catalog, &source.base, pipeline->chunks, pipeline->previous);
+    } else if (pipeline->options->pack_algorithm == PACK_ALGORITHM_TAR) {
+        result = tar_pack(writer, pipeline->catalog, &source.base);
+    } else {
+        result = mypack_pack(writer, pipeline->catalog, &source.base);
+    }
+    if (result == BACKUP_SUCCESS) {
+        result = stream_finish(writer);
+    }
+
+    stream_destroy(writer);
+    return result;
+}
+
+// 辅助函数：从备份文件读回直接复制的数据计算内容摘要，放入摘要队列交给打包阶段
+static BackupResult pipeline_hash_copied(Pipeline *pipeline, unsigned long long offset, unsigned long long size, unsigned char **buffer) {
+    if (*buffer == NULL) {
+        *buffer = (unsigned char *)malloc(STREAM_BUFFER_SIZE);
+        if (*buffer == NULL) {
+            return BACKUP_ERROR_MEMORY;
+        }
+    }
+    if (fflush(pipeline->output_fp) != 0) {
+        return BACKUP_ERROR_FILE;
+    }
+
+    Xxh64 state;
+    xxh64_init(&state, PACK2_HASH_SEED);
+    while (size > 0) {
+        size_t chunk = (size < STREAM_BUFFER_SIZE) ? (size_t)size : STREAM_BUFFER_SIZE;
+        BackupResult result = platform_read_at(fileno(pipeline->output_fp), offset, *buffer, chunk);
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+        xxh64_update(&state, *buffer, chunk);
+        offset += chunk;
+        size -= chunk;
+    }
+
+    unsigned long long *slot = (unsigned long long *)ring_acquire(pipeline->hash_ring);
+    if (slot == NULL) {
+        return BACKUP_ERROR_FILE;
+    }
+    *slot = xxh64_final(&state);
+    ring_publish(pipeline->hash_ring);
+    return BACKUP_SUCCESS;
+}
+
+// 辅助函数：写入阶段把源文件的数据直接复制到备份文件，写入长度严格等于文件项记录的大小
+// 直接写入文件描述符前先冲刷备份文件的stdio缓冲区，复制后重新定位到文件末尾，使两者的写入位置一致
+// 文件系统不支持直接复制的部分改用普通读写，文件变短时补零
+// 需要内容摘要时复制后从备份文件读回这段数据计算（刚写入的数据在页缓存中），摘要与备份文件中的数据严格一致
+static BackupResult pipeline_copy_file(PipelineContext *context, const char *path, unsigned long long size, int hash) {
+    Pipeline *pipeline = context->pipeline;
+    unsigned char *buffer = NULL;
+
+    FILE *input_fp = fopen(path, "rb");
+    if (input_fp == NULL) {
+        return BACKUP_ERROR_FILE;
+    }
+
+    unsigned long long copied = 0;
+    BackupResult result = (fflush(pipeline->output_fp) == 0) ? BACKUP_SUCCESS : BACKUP_ERROR_FILE;
+    long long start = platform_tell(pipeline->output_fp);
+    if (start < 0) {
+        result = BACKUP_ERROR_FILE;
+    }
+    if (result == BACKUP_SUCCESS) {
+        result = platform_copy_range(fileno(input_fp), 0, fileno(pipeline->output_fp), size, &copied);
+    }
+    if (result == BACKUP_SUCCESS && copied > 0) {
+        result = platform_seek(pipeline->output_fp, 0, SEEK_END);
+    }
+    pipeline->copied_bytes += copied;
+    context->bytes_in += size;
+
+    if (result == BACKUP_SUCCESS && copied < size) {
+        buffer = (unsigned char *)malloc(STREAM_BUFFER_SIZE);
+        result = (buffer != NULL) ? platform_seek(input_fp, (long long)copied, SEEK_SET) : BACKUP_ERROR_MEMORY;
+    }
+    while (result == BACKUP_SUCCESS && copied < size) {
+        size_t chunk = (size - copied < STREAM_BUFFER_SIZE) ? (size_t)(size - copied) : STREAM_BUFFER_SIZE;
+        size_t bytes_read = fread(buffer, 1, chunk, input_fp);
+        if (bytes_read == 0) {
+            if (ferror(input_fp)) {
+                result = BACKUP_ERROR_FILE;
+                break;
+            }
+            memset(buffer, 0, chunk);
+            bytes_read = chunk;
+        }
+        result = stream_write(context->chain, buffer, bytes_read);
+        copied += bytes_read;
+    }
+
+    if (result == BACKUP_SUCCESS && hash) {
+        result = pipeline_hash_copied(pipeline, (unsigned long long)start, size, &buffer);
+    }
+
+    free(buffer);
+    fclose(input_fp);
+    return result;
+}
+
+// 压缩、加密、写入阶段：从输入队列取出数据块送入本阶段的处理链
+static BackupResult pipeline_transform(PipelineContext *context) {
+    PipelineBlock *block;
+
+    while ((block = (PipelineBlock *)ring_peek(context->input)) != NULL) {
+        BackupResult result;
+        if (block->copy_size > 0) {
+            // 只有零拷贝打包时写入阶段会收到直接复制的请求
+            result = pipeline_copy_file(context, (const char *)block->data, block->copy_size, block->copy_hash);
+        } else {
+            result = stream_write(context->chain, block->data, block->len);
+            context->bytes_in += block->len;
+        }
+        ring_release(context->input);
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+    }
+
+    if (ring_aborted(context->input)) {
+        return BACKUP_ERROR_FILE;
+    }
+    return stream_finish(context->chain);
+}
+
+// 阶段线程入口
+static void pipeline_stage_run(void *arg) {
+    PipelineContext *context = (PipelineContext *)arg;
+    BackupResult result;
+
+    switch (context->stage) {
+        case PIPELINE_STAGE_TRAVERSE:
+            result = pipeline_traverse(context);
+            break;
+        case PIPELINE_STAGE_READ:
+            result = pipeline_read_files(context);
+            break;
+        case PIPELINE_STAGE_PACK:
+            result = pipeline_pack_files(context);
+            break;
+        default:
+            result = pipeline_transform(context);
+            break;
+    }
+
+    if (result != BACKUP_SUCCESS) {
+        pipeline_fail(context->pipeline, result);
+    }
+}
+
+// 辅助函数：为阶段创建处理链，链的终端是下一个阶段的输入队列或备份文件
+static BackupResult pipeline_create_chain(PipelineContext *context, FILE *output_fp) {
+    const BackupOptions *options = context->pipeline->options;
+    ByteWriter *next;
+
+    if (context->stage == PIPELINE_STAGE_WRITE) {
+        context->chain = file_writer_create(output_fp);
+        return (context->chain != NULL) ? BACKUP_SUCCESS : BACKUP_ERROR_MEMORY;
+    }
+
+    next = ring_writer_create(context->output);
+    if (next == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    if (context->stage == PIPELINE_STAGE_COMPRESS) {
+        context->chain = compress_writer_create(options->compress_algorithm, next);
+        if (context->chain == NULL) {
+            stream_destroy(next);
+            return BACKUP_ERROR_COMPRESS;
+        }
+    } else {
+        context->chain = encrypt_writer_create(options->encrypt_algorithm, options->encrypt_key, next);
+        if (context->chain == NULL) {
+            stream_destroy(next);
+            return BACKUP_ERROR_ENCRYPT;
+        }
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+// 辅助函数：创建队列、启动各阶段线程并等待结束
+static BackupResult pipeline_run(Pipeline *pipeline, FILE *output_fp, PipelineStats *stats) {
+    const BackupOptions *options = pipeline->options;
+    double start_time = platform_monotonic_time();
+    atomic_init(&pipeline->error, BACKUP_SUCCESS);
+    pipeline->output_fp = output_fp;
+
+    // 确定启用的阶段，未启用压缩或加密时对应阶段不参与流水线，只有流式遍历时启用遍历阶段
+    // 两者都未启用时较大文件的数据由写入阶段直接复制（零拷贝打包），去重打包时文件数据要经过打包阶段分块，不能直接复制
+    for (int i = 0; i < PIPELINE_STAGE_COUNT; i++) {
+        pipeline->stages[i].pipeline = pipeline;
+        pipeline->stages[i].stage = (PipelineStage)i;
+        pipeline->stages[i].enabled = 1;
+    }
+    pipeline->zero_copy = PIPELINE_ZERO_COPY && options->compress_algorithm == COMPRESS_ALGORITHM_NONE && !options->encrypt_enable &&
+                          pipeline->chunks == NULL;
+    pipeline->stages[PIPELINE_STAGE_TRAVERSE].enabled = pipeline->root_path != NULL;
+    pipeline->stages[PIPELINE_STAGE_COMPRESS].enabled = options->compress_algorithm != COMPRESS_ALGORITHM_NONE;
+    pipeline->stages[PIPELINE_STAGE_ENCRYPT].enabled = options->encrypt_enable;
+
+    // 为每个启用的阶段（第一个阶段除外）创建输入队列，并连接到上一个启用阶段的输出
+    // 读取阶段的输入是文件编号，其余阶段的输入是数据块
+    BackupResult result = BACKUP_SUCCESS;
+    PipelineContext *previous = NULL;
+    for (int i = 0; i < PIPELINE_STAGE_COUNT && result == BACKUP_SUCCESS; i++) {
+        PipelineContext *context = &pipeline->stages[i];
+        if (!context->enabled) {
+            continue;
+        }
+        if (previous != NULL) {
+            if (i == PIPELINE_STAGE_READ) {
+                context->input = ring_create(PIPELINE_FILE_QUEUE_DEPTH, sizeof(unsigned int));
+            } else {
+                context->input = ring_create(PIPELINE_QUEUE_DEPTH, sizeof(PipelineBlock));
+            }
+            if (context->input == NULL) {
+                result = BACKUP_ERROR_MEMORY;
+                break;
+            }
+            previous->output = context->input;
+        }
+        previous = context;
+    }
+
+    // 流式遍历时读取阶段把文件编号交给打包阶段
+    if (result == BACKUP_SUCCESS && pipeline->root_path != NULL) {
+        pipeline->file_ring = ring_create(PIPELINE_FILE_RING_DEPTH, sizeof(unsigned int));
+        if (pipeline->file_ring == NULL) {
+            result = BACKUP_ERROR_MEMORY;
+        }
+    }
+
+    // 零拷贝打包时写入阶段交回内容摘要，打包阶段每次等待一个摘要
+    if (result == BACKUP_SUCCESS && pipeline->zero_copy) {
+        pipeline->hash_ring = ring_create(PIPELINE_HASH_RING_DEPTH, sizeof(unsigned long long));
+        if (pipeline->hash_ring == NULL) {
+            result = BACKUP_ERROR_MEMORY;
+        }
+    }
+
+    // 创建压缩、加密、写入阶段的处理链
+    for (int i = PIPELINE_STAGE_COMPRESS; i < PIPELINE_STAGE_COUNT && result == BACKUP_SUCCESS; i++) {
+        if (pipeline->stages[i].enabled) {
+            result = pipeline_create_chain(&pipeline->stages[i], output_fp);
+        }
+    }
+
+    // 启动各阶段线程
+    for (int i = 0; i < PIPELINE_STAGE_COUNT && result == BACKUP_SUCCESS; i++) {
+        PipelineContext *context = &pipeline->stages[i];
+        if (!context->enabled) {
+            continue;
+        }
+        result = thread_create(&context->thread, pipeline_stage_run, context);
+        if (result != BACKUP_SUCCESS) {
+            pipeline_fail(pipeline, result);
+            break;
+        }
+        context->started = 1;
+    }
+
+    // 等待所有阶段结束
+    for (int i = 0; i < PIPELINE_STAGE_COUNT; i++) {
+        if (pipeline->stages[i].started) {
+            thread_join(&pipeline->stages[i].thread);
+        }
+    }
+    if (result == BACKUP_SUCCESS) {
+        result = (BackupResult)atomic_load(&pipeline->error);
+    }
+
+    // 收集统计并释放资源
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(PipelineStats));
+        stats->files = pipeline->file_total;
+        stats->bytes = pipeline->stages[PIPELINE_STAGE_PACK].bytes_in;
+        stats->copied_bytes = pipeline->copied_bytes;
+        stats->unchanged_files = pipeline->unchanged_files;
+        stats->unchanged_bytes = pipeline->unchanged_bytes;
+        stats->zero_copy = pipeline->zero_copy;
+        stats->seconds = platform_monotonic_time() - start_time;
+    }
+    for (int i = 0; i < PIPELINE_STAGE_COUNT; i++) {
+        PipelineContext *context = &pipeline->stages[i];
+        if (stats != NULL && context->enabled) {
+            stats->stages[i].enabled = 1;
+            stats->stages[i].bytes_in = context->bytes_in;
+            if (context->input != NULL) {
+                ring_get_stats(context->input, &stats->stages[i].input);
+            }
+        }
+        stream_destroy(context->chain);
+        ring_destroy(context->input);
+    }
+    ring_destroy(pipeline->file_ring);
+    ring_destroy(pipeline->hash_ring);
+
+    return result;
+}
+
+// 多线程流水线备份
+BackupResult pipeline_backup(const Catalog *catalog, const BackupOptions *options, ChunkStore *chunks, const Manifest *previous, FILE *output_fp, PipelineStats *stats) {
+    if (catalog == NULL || catalog_file_count(catalog) == 0 || options == NULL || output_fp == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    Pipeline *pipeline = (Pipeline *)calloc(1, sizeof(Pipeline));
+    if (pipeline == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    pipeline->catalog = catalog;
+    pipeline->options = options;
+    pipeline->chunks = chunks;
+    pipeline->previous = previous;
+
+    BackupResult result = pipeline_run(pipeline, output_fp, stats);
+
+    free(pipeline);
+    return result;
+}
+
+// 流式遍历备份
+BackupResult pipeline_backup_tree(const char *root_path, const BackupOptions *options, ChunkStore *chunks, const Manifest *previous, FILE *output_fp, PipelineStats *stats) {
+    if (root_path == NULL || options == NULL || output_fp == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+    if (!pack_stream_supported(options->pack_algorithm)) {
+        return BACKUP_ERROR_PACK;
+    }
+
+    Pipeline *pipeline = (Pipeline *)calloc(1, sizeof(Pipeline));
+    if (pipeline == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    pipeline->tree = catalog_create();
+    if (pipeline->tree == NULL) {
+        free(pipeline);
+        return BACKUP_ERROR_MEMORY;
+    }
+    pipeline->catalog = pipeline->tree;
+    pipeline->root_path = root_path;
+    pipeline->options = options;
+    pipeline->chunks = chunks;
+    pipeline->previous = previous;
+    mutex_init(&pipeline->queue_lock);
+
+    BackupResult result = pipeline_run(pipeline, output_fp, stats);
+    if (result == BACKUP_SUCCESS && pipeline->file_total == 0) {
+        result = BACKUP_ERROR_NO_FILES;
+    }
+
+    mutex_destroy(&pipeline->queue_lock);
+    catalog_destroy(pipeline->tree);
+    free(pipeline);
+    return result;
+}
+
+// 阶段名称
+const char *pipeline_stage_name(PipelineStage stage) {
+    switch (stage) {
+        case PIPELINE_STAGE_TRAVERSE:
+            return "遍历";
+        case PIPELINE_STAGE_READ:
+            return "读取";
+        case PIPELINE_STAGE_PACK:
+            return "打包";
+        case PIPELINE_STAGE_COMPRESS:
+            return "压缩";
+        case PIPELINE_STAGE_ENCRYPT:
+            return "加密";
+        case PIPELINE_STAGE_WRITE:
+            return "写入";
+        default:
+            return "未知";
+    }
+}
+
+// 推断瓶颈阶段
+// 最慢的阶段处理不过来时，它的输入队列会积满，上游阶段随之阻塞，
+// 因此从下游向上游查找第一个平均队列深度超过容量一半的阶段；都不满时瓶颈在第一个阶段（遍历或读取源文件）
+PipelineStage pipeline_bottleneck(const PipelineStats *stats) {
+    PipelineStage first = stats->stages[PIPELINE_STAGE_TRAVERSE].enabled ? PIPELINE_STAGE_TRAVERSE : PIPELINE_STAGE_READ;
+
+    for (int i = PIPELINE_STAGE_COUNT - 1; i > (int)first; i--) {
+        const PipelineStageStats *stage = &stats->stages[i];
+        if (!stage->enabled || stage->input.pushed == 0) {
+            continue;
+        }
+        if (stage->input.depth_sum * 2 >= stage->input.pushed * stage->input.capacity) {
+            return (PipelineStage)i;
+        }
+    }
+    return first;
+}
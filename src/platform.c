@@ -0,0 +1,563 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "platform.h"
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#endif
+#endif
+
+// 每次系统调用直接复制的最大字节数，sendfile单次最多传输约2GB
+#define PLATFORM_COPY_CHUNK (1024ULL * 1024 * 1024)
+
+// 检查路径是否存在
+int platform_path_exists(const char *path, int *is_directory) {
+#ifdef _WIN32
+    DWORD attr = GetFileAttributes(path);
+    if (attr == INVALID_FILE_ATTRIBUTES) {
+        return 0;
+    }
+    if (is_directory != NULL) {
+        *is_directory = (attr & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    }
+#else
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return 0;
+    }
+    if (is_directory != NULL) {
+        *is_directory = S_ISDIR(st.st_mode);
+    }
+#endif
+    return 1;
+}
+
+// 创建单级目录
+int platform_make_directory(const char *path) {
+#ifdef _WIN32
+    return CreateDirectory(path, NULL) != 0 || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+// 递归创建目录
+int platform_make_directories(const char *path) {
+    char temp_path[512];
+    if (strlen(path) >= sizeof(temp_path)) {
+        return 0;
+    }
+    strcpy(temp_path, path);
+
+    // 统一使用本平台的分隔符
+    for (int i = 0; temp_path[i] != '\0'; i++) {
+        if (temp_path[i] == '/' || temp_path[i] == '\\') {
+            temp_path[i] = PATH_SEPARATOR;
+        }
+    }
+
+    // 逐级创建上层目录，跳过开头的分隔符
+    char *ptr = temp_path + 1;
+    while ((ptr = strchr(ptr, PATH_SEPARATOR)) != NULL) {
+        *ptr = '\0';
+        platform_make_directory(temp_path);
+        *ptr = PATH_SEPARATOR;
+        ptr++;
+    }
+
+    // 创建最终目录
+    return platform_make_directory(temp_path);
+}
+
+// 创建文件所在的目录
+void platform_make_parent_directories(const char *path) {
+    char dir_path[512];
+    if (strlen(path) >= sizeof(dir_path)) {
+        return;
+    }
+    strcpy(dir_path, path);
+
+    char *last_slash = strrchr(dir_path, '/');
+    char *last_backslash = strrchr(dir_path, '\\');
+    if (last_backslash > last_slash) {
+        last_slash = last_backslash;
+    }
+    if (last_slash == NULL || last_slash == dir_path) {
+        return;
+    }
+    *last_slash = '\0';
+
+    platform_make_directories(dir_path);
+}
+
+// 获取当前工作目录
+BackupResult platform_get_current_directory(char *buffer, size_t size) {
+#ifdef _WIN32
+    DWORD length = GetCurrentDirectory((DWORD)size, buffer);
+    return (length > 0 && length < size) ? BACKUP_SUCCESS : BACKUP_ERROR_PATH;
+#else
+    return (getcwd(buffer, size) != NULL) ? BACKUP_SUCCESS : BACKUP_ERROR_PATH;
+#endif
+}
+
+// 切换当前工作目录
+int platform_change_directory(const char *path) {
+#ifdef _WIN32
+    return SetCurrentDirectory(path) != 0;
+#else
+    return chdir(path) == 0;
+#endif
+}
+
+// 获取绝对路径，路径不需要存在
+BackupResult platform_full_path(const char *path, char *buffer, size_t size) {
+#ifdef _WIN32
+    DWORD length = GetFullPathName(path, (DWORD)size, buffer, NULL);
+    return (length > 0 && length < size) ? BACKUP_SUCCESS : BACKUP_ERROR_PATH;
+#else
+    if (path[0] == '/') {
+        if (strlen(path) >= size) {
+            return BACKUP_ERROR_PATH;
+        }
+        strcpy(buffer, path);
+        return BACKUP_SUCCESS;
+    }
+
+    char current_dir[512];
+    if (getcwd(current_dir, sizeof(current_dir)) == NULL) {
+        return BACKUP_ERROR_PATH;
+    }
+    int length = snprintf(buffer, size, "%s/%s", current_dir, path);
+    return (length > 0 && (size_t)length < size) ? BACKUP_SUCCESS : BACKUP_ERROR_PATH;
+#endif
+}
+
+// 删除文件
+int platform_delete_file(const char *path) {
+#ifdef _WIN32
+    return DeleteFile(path) != 0;
+#else
+    return unlink(path) == 0;
+#endif
+}
+
+// 改名文件，替换已存在的目标文件
+BackupResult platform_replace_file(const char *source, const char *target) {
+#ifdef _WIN32
+    return (MoveFileEx(source, target, MOVEFILE_REPLACE_EXISTING) != 0) ? BACKUP_SUCCESS : BACKUP_ERROR_FILE;
+#else
+    return (rename(source, target) == 0) ? BACKUP_SUCCESS : BACKUP_ERROR_FILE;
+#endif
+}
+
+// 复制文件
+BackupResult platform_copy_file(const char *source, const char *target) {
+#ifdef _WIN32
+    return (CopyFile(source, target, FALSE) != 0) ? BACKUP_SUCCESS : BACKUP_ERROR_FILE;
+#else
+    FILE *src_fp = fopen(source, "rb");
+    if (src_fp == NULL) {
+        return BACKUP_ERROR_FILE;
+    }
+    FILE *dst_fp = fopen(target, "wb");
+    if (dst_fp == NULL) {
+        fclose(src_fp);
+        return BACKUP_ERROR_FILE;
+    }
+
+    BackupResult result = BACKUP_SUCCESS;
+    char buffer[65536];
+    size_t bytes_read;
+    while ((bytes_read = fread(buffer, 1, sizeof(buffer), src_fp)) > 0) {
+        if (fwrite(buffer, 1, bytes_read, dst_fp) != bytes_read) {
+            result = BACKUP_ERROR_FILE;
+            break;
+        }
+    }
+    if (ferror(src_fp)) {
+        result = BACKUP_ERROR_FILE;
+    }
+
+    fclose(src_fp);
+    if (fclose(dst_fp) != 0) {
+        result = BACKUP_ERROR_FILE;
+    }
+    return result;
+#endif
+}
+
+// 创建硬链接，path已存在时先删除
+BackupResult platform_make_link(const char *existing, const char *path) {
+    platform_delete_file(path);
+#ifdef _WIN32
+    return (CreateHardLinkA(path, existing, NULL) != 0) ? BACKUP_SUCCESS : BACKUP_ERROR_FILE;
+#else
+    return (link(existing, path) == 0) ? BACKUP_SUCCESS : BACKUP_ERROR_FILE;
+#endif
+}
+
+// 定位文件读写位置
+BackupResult platform_seek(FILE *fp, long long offset, int origin) {
+#ifdef _WIN32
+    return (_fseeki64(fp, offset, origin) == 0) ? BACKUP_SUCCESS : BACKUP_ERROR_FILE;
+#else
+    return (fseeko(fp, (off_t)offset, origin) == 0) ? BACKUP_SUCCESS : BACKUP_ERROR_FILE;
+#endif
+}
+
+// 获取文件读写位置，失败时返回-1
+long long platform_tell(FILE *fp) {
+#ifdef _WIN32
+    return _ftelli64(fp);
+#else
+    return (long long)ftello(fp);
+#endif
+}
+
+// 设置文件大小
+BackupResult platform_set_file_size(FILE *fp, unsigned long long size) {
+    if (fflush(fp) != 0) {
+        return BACKUP_ERROR_FILE;
+    }
+#ifdef _WIN32
+    return (_chsize_s(_fileno(fp), (__int64)size) == 0) ? BACKUP_SUCCESS : BACKUP_ERROR_FILE;
+#else
+    return (ftruncate(fileno(fp), (off_t)size) == 0) ? BACKUP_SUCCESS : BACKUP_ERROR_FILE;
+#endif
+}
+
+// 辅助函数：追加一个数据段
+static BackupResult extent_append(PlatformExtent **extents, unsigned int *count, unsigned int *capacity, unsigned long long offset, unsigned long long length) {
+    if (*count == *capacity) {
+        unsigned int new_capacity = (*capacity > 0) ? *capacity * 2 : 16;
+        PlatformExtent *new_extents = (PlatformExtent *)realloc(*extents, new_capacity * sizeof(PlatformExtent));
+        if (new_extents == NULL) {
+            return BACKUP_ERROR_MEMORY;
+        }
+        *extents = new_extents;
+        *capacity = new_capacity;
+    }
+    (*extents)[*count].offset = offset;
+    (*extents)[*count].length = length;
+    (*count)++;
+    return BACKUP_SUCCESS;
+}
+
+// 查找文件中的数据段
+BackupResult platform_file_extents(FILE *fp, unsigned long long size, PlatformExtent **extents, unsigned int *count) {
+    unsigned int capacity = 0;
+    BackupResult result = BACKUP_SUCCESS;
+
+    *extents = NULL;
+    *count = 0;
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    // 从每个数据段的开头找到其后的空洞，文件末尾总有一个隐含的空洞
+    int fd = fileno(fp);
+    int supported = 1;
+    unsigned long long position = 0;
+    while (position < size && result == BACKUP_SUCCESS) {
+        off_t data = lseek(fd, (off_t)position, SEEK_DATA);
+        if (data < 0) {
+            // ENXIO表示之后全是空洞，其他错误表示文件系统不支持
+            supported = (errno == ENXIO);
+            break;
+        }
+        if ((unsigned long long)data >= size) {
+            break;
+        }
+        off_t hole = lseek(fd, data, SEEK_HOLE);
+        unsigned long long end = (hole < 0 || (unsigned long long)hole > size) ? size : (unsigned long long)hole;
+        result = extent_append(extents, count, &capacity, (unsigned long long)data, end - (unsigned long long)data);
+        position = end;
+    }
+
+    // 直接移动了文件描述符的位置，stdio的读写位置需要重新定位
+    if (result == BACKUP_SUCCESS) {
+        result = platform_seek(fp, 0, SEEK_SET);
+    }
+    if (result != BACKUP_SUCCESS || supported) {
+        if (result != BACKUP_SUCCESS) {
+            free(*extents);
+            *extents = NULL;
+            *count = 0;
+        }
+        return result;
+    }
+    free(*extents);
+    *extents = NULL;
+    *count = 0;
+    capacity = 0;
+#endif
+
+    // 不能查找空洞时整个文件作为一个数据段
+    if (size > 0) {
+        result = extent_append(extents, count, &capacity, 0, size);
+    }
+    return result;
+}
+
+// 文件第一个数据段在磁盘上的物理位置
+BackupResult platform_physical_offset(const char *path, unsigned long long *offset) {
+    *offset = 0;
+#if defined(__linux__) && defined(FS_IOC_FIEMAP)
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return BACKUP_ERROR_FILE;
+    }
+
+    // 只需要第一个数据段；不同步文件数据，尚未分配的数据段（延迟分配）按没有数据段处理
+    struct {
+        struct fiemap map;
+        struct fiemap_extent extent;
+    } request;
+    memset(&request, 0, sizeof(request));
+    request.map.fm_start = 0;
+    request.map.fm_length = FIEMAP_MAX_OFFSET;
+    request.map.fm_extent_count = 1;
+
+    int failed = ioctl(fd, FS_IOC_FIEMAP, &request.map) != 0;
+    close(fd);
+    if (failed) {
+        return BACKUP_ERROR_PARAM;
+    }
+    if (request.map.fm_mapped_extents > 0 && !(request.extent.fe_flags & FIEMAP_EXTENT_UNKNOWN)) {
+        *offset = request.extent.fe_physical;
+    }
+    return BACKUP_SUCCESS;
+#else
+    (void)path;
+    return BACKUP_ERROR_PARAM;
+#endif
+}
+
+// 在文件之间直接复制数据
+BackupResult platform_copy_range(int source_fd, unsigned long long offset, int target_fd, unsigned long long size, unsigned long long *copied) {
+    *copied = 0;
+#ifdef __linux__
+    // 先使用copy_file_range，文件系统不支持（如跨文件系统、特殊文件）时改用sendfile，两者都不支持时交给调用方
+    int use_copy_range = 1;
+    while (*copied < size) {
+        size_t chunk = (size_t)((size - *copied < PLATFORM_COPY_CHUNK) ? size - *copied : PLATFORM_COPY_CHUNK);
+        off_t source_offset = (off_t)(offset + *copied);
+        ssize_t count;
+        if (use_copy_range) {
+            count = copy_file_range(source_fd, &source_offset, target_fd, NULL, chunk, 0);
+            if (count < 0 && (errno == EXDEV || errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP || errno == EBADF)) {
+                use_copy_range = 0;
+                continue;
+            }
+        } else {
+            count = sendfile(target_fd, source_fd, &source_offset, chunk);
+            if (count < 0 && (errno == EINVAL || errno == ENOSYS)) {
+                return BACKUP_SUCCESS;
+            }
+        }
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return BACKUP_ERROR_FILE;
+        }
+        if (count == 0) {
+            // 源文件提前结束
+            break;
+        }
+        *copied += (unsigned long long)count;
+    }
+#else
+    (void)source_fd;
+    (void)offset;
+    (void)target_fd;
+    (void)size;
+#endif
+    return BACKUP_SUCCESS;
+}
+
+// 按偏移量读取
+BackupResult platform_read_at(int fd, unsigned long long offset, void *buffer, size_t size) {
+    unsigned char *data = (unsigned char *)buffer;
+    while (size > 0) {
+#ifdef _WIN32
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.Offset = (DWORD)(offset & 0xFFFFFFFFu);
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD chunk = (DWORD)((size < 0x40000000u) ? size : 0x40000000u);
+        DWORD count = 0;
+        if (!ReadFile((HANDLE)_get_osfhandle(fd), data, chunk, &count, &overlapped) || count == 0) {
+            return BACKUP_ERROR_FILE;
+        }
+#else
+        ssize_t count = pread(fd, data, size, (off_t)offset);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return BACKUP_ERROR_FILE;
+        }
+#endif
+        data += count;
+        offset += (unsigned long long)count;
+        size -= (size_t)count;
+    }
+    return BACKUP_SUCCESS;
+}
+
+// 单调时钟的当前时间
+double platform_monotonic_time(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+#endif
+}
+
+// 只读映射整个文件
+BackupResult platform_map_file(const char *path, PlatformMap *map) {
+    memset(map, 0, sizeof(PlatformMap));
+#ifdef _WIN32
+    HANDLE file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return BACKUP_ERROR_FILE;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return BACKUP_ERROR_FILE;
+    }
+    map->size = (unsigned long long)size.QuadPart;
+    if (map->size == 0) {
+        CloseHandle(file);
+        return BACKUP_SUCCESS;
+    }
+    if (map->size > (SIZE_MAX >> 1)) {
+        CloseHandle(file);
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        CloseHandle(file);
+        return BACKUP_ERROR_FILE;
+    }
+    map->data = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (map->data == NULL) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return BACKUP_ERROR_MEMORY;
+    }
+    map->file = file;
+    map->mapping = mapping;
+    return BACKUP_SUCCESS;
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return BACKUP_ERROR_FILE;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return BACKUP_ERROR_FILE;
+    }
+    map->size = (unsigned long long)st.st_size;
+    if (map->size == 0) {
+        close(fd);
+        return BACKUP_SUCCESS;
+    }
+    if (map->size > (SIZE_MAX >> 1)) {
+        close(fd);
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    // 映射建立后不再需要文件描述符
+    void *data = mmap(NULL, (size_t)map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    map->data = (const unsigned char *)data;
+    return BACKUP_SUCCESS;
+#endif
+}
+
+// 解除文件映射
+void platform_unmap_file(PlatformMap *map) {
+    if (map->data != NULL) {
+#ifdef _WIN32
+        UnmapViewOfFile(map->data);
+        CloseHandle((HANDLE)map->mapping);
+        CloseHandle((HANDLE)map->file);
+#else
+        munmap((void *)map->data, (size_t)map->size);
+#endif
+    }
+    memset(map, 0, sizeof(PlatformMap));
+}
+
+// 提示映射中一段范围的访问方式
+void platform_advise(const PlatformMap *map, unsigned long long offset, unsigned long long length, PlatformAdvice advice) {
+#ifdef _WIN32
+    (void)map;
+    (void)offset;
+    (void)length;
+    (void)advice;
+#else
+    if (map->data == NULL || offset >= map->size || length == 0) {
+        return;
+    }
+    if (length > map->size - offset) {
+        length = map->size - offset;
+    }
+
+    // madvise要求起始地址按页对齐
+    unsigned long long page = (unsigned long long)sysconf(_SC_PAGESIZE);
+    unsigned long long start = offset - offset % page;
+    length += offset - start;
+
+    int flag;
+    switch (advice) {
+        case PLATFORM_ADVICE_SEQUENTIAL:
+            flag = MADV_SEQUENTIAL;
+            break;
+        case PLATFORM_ADVICE_RANDOM:
+            flag = MADV_RANDOM;
+            break;
+        case PLATFORM_ADVICE_WILLNEED:
+            flag = MADV_WILLNEED;
+            break;
+        case PLATFORM_ADVICE_PREFAULT:
+#ifdef MADV_POPULATE_READ
+            // Linux 5.14及以上，旧内核返回EINVAL时退化为WILLNEED
+            if (madvise((void *)(map->data + start), (size_t)length, MADV_POPULATE_READ) == 0) {
+                return;
+            }
+#endif
+            flag = MADV_WILLNEED;
+            break;
+        default:
+            flag = MADV_DONTNEED;
+            break;
+    }
+    madvise((void *)(map->data + start), (size_t)length, flag);
+#endif
+}
@@ -1,44 +1,20 @@
 #include "restore.h"
 #include "main.h"
-#include <windows.h>
+#include "compress.h"
+#include "encrypt.h"
+#include "platform.h"
+#include "filter.h"
 
-// 辅助函数：创建目录
-static int create_dir(const char *path) {
-    char temp_path[512];
-    strcpy(temp_path, path);
-    
-    // 替换所有的'/'为'\'
-    for (int i = 0; temp_path[i] != '\0'; i++) {
-        if (temp_path[i] == '/') {
-            temp_path[i] = '\\';
-        }
-    }
-    
-    // 创建目录（递归）
-    char *ptr = temp_path + 1;
-    while ((ptr = strchr(ptr, '\\')) != NULL) {
-        *ptr = '\0';
-        CreateDirectory(temp_path, NULL);
-        *ptr = '\\';
-        ptr++;
-    }
-    
-    return CreateDirectory(temp_path, NULL) != 0 || GetLastError() == ERROR_ALREADY_EXISTS;
-}
+// 最近一次从备份文件直接提取的统计
+static ArchiveStats last_archive_stats;
 
 // 恢复单个文件
 BackupResult restore_single_file(const char *source, const char *target, const FileMetadata *metadata) {
     // 创建目标文件的目录
-    char dir_path[512];
-    strcpy(dir_path, target);
-    char *last_slash = strrchr(dir_path, '\\');
-    if (last_slash != NULL) {
-        *last_slash = '\0';
-        create_dir(dir_path);
-    }
+    platform_make_parent_directories(target);
     
     // 复制文件
-    if (CopyFile(source, target, FALSE) == 0) {
+    if (platform_copy_file(source, target) != BACKUP_SUCCESS) {
         return BACKUP_ERROR_FILE;
     }
     
@@ -49,15 +25,19 @@ BackupResult restore_single_file(const char *source, const char *target, const F
 // 解包并提取文件
 BackupResult extract_files(const char *backup_file, const char *target_path, const RestoreOptions *options) {
     // 保存当前工作目录
-    char current_dir[256];
-    GetCurrentDirectory(256, current_dir);
+    char current_dir[512];
+    if (platform_get_current_directory(current_dir, sizeof(current_dir)) != BACKUP_SUCCESS) {
+        return BACKUP_ERROR_PATH;
+    }
 
     // 获取备份文件的绝对路径，确保在切换目录后仍然可以访问
     char backup_file_abs[512];
-    GetFullPathName(backup_file, sizeof(backup_file_abs), backup_file_abs, NULL);
+    if (platform_full_path(backup_file, backup_file_abs, sizeof(backup_file_abs)) != BACKUP_SUCCESS) {
+        return BACKUP_ERROR_PATH;
+    }
 
     // 切换到目标路径，让解包函数直接将文件提取到目标路径
-    if (!SetCurrentDirectory(target_path)) {
+    if (!platform_change_directory(target_path)) {
         return BACKUP_ERROR_PATH;
     }
 
@@ -74,39 +54,26 @@ BackupResult extract_files(const char *backup_file, const char *target_path, con
     }
     
     if (result != BACKUP_SUCCESS) {
-        SetCurrentDirectory(current_dir);
+        platform_change_directory(current_dir);
         return result;
     }
     
     // 切换回原始工作目录
-    SetCurrentDirectory(current_dir);
+    platform_change_directory(current_dir);
     
     free(files);
     return BACKUP_SUCCESS;
 }
 
-// 还原主函数
-BackupResult restore_data(const RestoreOptions *options) {
-    if (options == NULL || options->backup_file[0] == 0 || options->target_path[0] == 0) {
-        return BACKUP_ERROR_PARAM;
-    }
-
-    // 检查备份文件是否存在
-    if (GetFileAttributes(options->backup_file) == INVALID_FILE_ATTRIBUTES) {
-        return BACKUP_ERROR_PATH;
-    }
-
-    // 创建目标目录
-    if (CreateDirectory(options->target_path, NULL) == 0 && GetLastError() != ERROR_ALREADY_EXISTS) {
-        return BACKUP_ERROR_PATH;
-    }
-
+// 逐步还原：依次生成解密、解压临时文件后再解包
+// 用于版本1压缩格式的备份文件，这种格式需要整文件读取，无法在处理链中解码
+static BackupResult restore_with_temp_files(const RestoreOptions *options) {
     // 解密文件（如果需要）
     char temp_file[512];
     const char *processed_file = options->backup_file;
     
     if (options->encrypt_enable) {
-        snprintf(temp_file, sizeof(temp_file), "%s\\temp_decrypt", options->target_path);
+        snprintf(temp_file, sizeof(temp_file), "%s" PATH_SEPARATOR_STRING "temp_decrypt", options->target_path);
         BackupResult result = decrypt_file(processed_file, temp_file, options->encrypt_algorithm, options->encrypt_key);
         if (result != BACKUP_SUCCESS) {
             return result;
@@ -120,7 +87,7 @@ BackupResult restore_data(const RestoreOptions *options) {
     
     // 这里需要根据备份文件的实际压缩情况判断是否需要解压
     // 目前简单处理，假设备份文件可能是压缩的
-    snprintf(temp_uncompress, sizeof(temp_uncompress), "%s\\temp_uncompress.dat", options->target_path);
+    snprintf(temp_uncompress, sizeof(temp_uncompress), "%s" PATH_SEPARATOR_STRING "temp_uncompress.dat", options->target_path);
     BackupResult result = decompress_file(processed_file, temp_uncompress, COMPRESS_ALGORITHM_LZ77);
     if (result == BACKUP_SUCCESS) {
         final_file = temp_uncompress;
@@ -140,21 +107,220 @@ BackupResult restore_data(const RestoreOptions *options) {
     if (result != BACKUP_SUCCESS) {
         // 清理临时文件
         if (options->encrypt_enable) {
-            DeleteFile(temp_file);
+            platform_delete_file(temp_file);
         }
         if (final_file != processed_file) {
-            DeleteFile(temp_uncompress);
+            platform_delete_file(temp_uncompress);
         }
         return result;
     }
 
     // 清理临时文件
     if (options->encrypt_enable) {
-        DeleteFile(temp_file);
+        platform_delete_file(temp_file);
     }
     if (final_file != processed_file) {
-        DeleteFile(temp_uncompress);
+        platform_delete_file(temp_uncompress);
     }
 
     return BACKUP_SUCCESS;
 }
+
+// 流式还原：解密、解压、解包在内存中串联，文件直接写入目标目录
+static BackupResult restore_stream(const RestoreOptions *options, int *legacy_format) {
+    // 打开备份文件
+    ByteReader *input = file_reader_open(options->backup_file);
+    if (input == NULL) {
+        return BACKUP_ERROR_FILE;
+    }
+
+    // 构建处理链：解密（可选） -> 解压（自动识别） -> 解包
+    ByteWriter *unpack = unpack_writer_create(NULL, NULL);
+    ByteWriter *chain = unpack;
+    if (chain != NULL) {
+        ByteWriter *decompress = decompress_writer_create(chain, legacy_format);
+        if (decompress == NULL) {
+            stream_destroy(chain);
+            chain = NULL;
+        } else {
+            chain = decompress;
+        }
+    }
+    if (chain != NULL && options->encrypt_enable) {
+        ByteWriter *decipher = decrypt_writer_create(options->encrypt_key, chain);
+        if (decipher == NULL) {
+            stream_destroy(chain);
+            reader_destroy(input);
+            return BACKUP_ERROR_ENCRYPT;
+        }
+        chain = decipher;
+    }
+    if (chain == NULL) {
+        reader_destroy(input);
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    // 去重备份的分块文件从备份文件旁边的块数据文件读取，切换目录前确定其绝对路径
+    char backup_file_abs[512];
+    char chunk_path[512];
+    BackupResult result = platform_full_path(options->backup_file, backup_file_abs, sizeof(backup_file_abs));
+    if (result == BACKUP_SUCCESS) {
+        result = chunk_store_data_path(backup_file_abs, chunk_path, sizeof(chunk_path));
+    }
+    if (result == BACKUP_SUCCESS) {
+        result = unpack_writer_set_chunk_store(unpack, chunk_path);
+    }
+    if (result != BACKUP_SUCCESS) {
+        stream_destroy(chain);
+        reader_destroy(input);
+        return result;
+    }
+
+    // 保存当前工作目录，切换到目标路径，解包阶段直接将文件写入目标路径
+    char current_dir[512];
+    if (platform_get_current_directory(current_dir, sizeof(current_dir)) != BACKUP_SUCCESS ||
+        !platform_change_directory(options->target_path)) {
+        stream_destroy(chain);
+        reader_destroy(input);
+        return BACKUP_ERROR_PATH;
+    }
+
+    // 单遍读取备份文件并送入处理链
+    result = stream_copy(input, chain);
+    if (result == BACKUP_SUCCESS) {
+        result = stream_finish(chain);
+    }
+
+    // 切换回原始工作目录
+    platform_change_directory(current_dir);
+
+    stream_destroy(chain);
+    reader_destroy(input);
+    return result;
+}
+
+// 按指定的路径和筛选条件选中要还原的文件，只使用索引中的文件项，不读取文件数据
+// 没有指定路径时从全部文件开始筛选；指定的路径不在索引中时返回BACKUP_ERROR_PATH，筛选后没有文件时返回BACKUP_ERROR_NO_FILES
+BackupResult restore_select(const Archive *archive, const RestoreOptions *options, unsigned char *selected) {
+    unsigned int count = archive_entry_count(archive);
+    BackupResult result = BACKUP_SUCCESS;
+    if (options->path_count > 0) {
+        result = archive_select_paths(archive, options->paths, options->path_count, selected);
+    } else {
+        memset(selected, 1, count);
+    }
+    if (result != BACKUP_SUCCESS || !filter_restore_enabled(options)) {
+        return result;
+    }
+
+    // 索引中的路径不保证以'\0'结尾，复制出来再筛选
+    char *path = NULL;
+    size_t capacity = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        if (!selected[i]) {
+            continue;
+        }
+        const ArchiveEntry *entry = archive_entry(archive, i);
+        if ((size_t)entry->item.path_length + 1 > capacity) {
+            char *new_path = (char *)realloc(path, (size_t)entry->item.path_length + 1);
+            if (new_path == NULL) {
+                result = BACKUP_ERROR_MEMORY;
+                break;
+            }
+            path = new_path;
+            capacity = (size_t)entry->item.path_length + 1;
+        }
+        memcpy(path, entry->path, entry->item.path_length);
+        path[entry->item.path_length] = '\0';
+
+        const char *name = path;
+        for (const char *p = path; *p != '\0'; p++) {
+            if (*p == '/' || *p == '\\') {
+                name = p + 1;
+            }
+        }
+
+        CatalogEntry stat;
+        memset(&stat, 0, sizeof(CatalogEntry));
+        stat.type = (unsigned char)entry->item.type;
+        stat.mode = (unsigned short)entry->item.mode;
+        stat.uid = entry->item.uid;
+        stat.gid = entry->item.gid;
+        stat.size = entry->item.size;
+        stat.create_time = entry->item.create_time;
+        stat.modify_time = entry->item.modify_time;
+        stat.access_time = entry->item.access_time;
+        selected[i] = (unsigned char)filter_restore_entry(&stat, name, path, options);
+    }
+    free(path);
+
+    // 筛选条件排除了全部文件时视为失败，不报告没有还原任何文件的“成功”
+    if (result == BACKUP_SUCCESS && memchr(selected, 1, count) == NULL) {
+        result = BACKUP_ERROR_NO_FILES;
+    }
+    return result;
+}
+
+// 还原主函数
+BackupResult restore_data(const RestoreOptions *options) {
+    if (options == NULL || options->backup_file[0] == 0 || options->target_path[0] == 0) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    // 检查备份文件是否存在
+    if (!platform_path_exists(options->backup_file, NULL)) {
+        return BACKUP_ERROR_PATH;
+    }
+
+    // 创建目标目录
+    if (!platform_make_directory(options->target_path)) {
+        return BACKUP_ERROR_PATH;
+    }
+
+    // 选择性还原（指定路径或筛选条件）：根据索引只读取选中的文件，需要随机访问备份文件，因此不支持加密的备份文件
+    memset(&last_archive_stats, 0, sizeof(ArchiveStats));
+    int selective = options->path_count > 0 || filter_restore_enabled(options);
+    if (selective && options->encrypt_enable) {
+        return BACKUP_ERROR_PACK;
+    }
+
+    // 未加密的备份文件先尝试整体映射：未压缩的MyPack和Tar备份文件直接从备份文件中提取，不经过解包处理链
+    if (!options->encrypt_enable) {
+        Archive *archive = NULL;
+        BackupResult result = archive_open(options->backup_file, &archive);
+        if (result == BACKUP_SUCCESS) {
+            if (selective) {
+                unsigned char *selected = (unsigned char *)calloc(archive_entry_count(archive) + 1, 1);
+                result = (selected != NULL) ? restore_select(archive, options, selected) : BACKUP_ERROR_MEMORY;
+                if (result == BACKUP_SUCCESS) {
+                    result = archive_extract_selection(archive, selected, options->target_path, options->threads);
+                }
+                free(selected);
+            } else {
+                result = archive_extract_all(archive, options->target_path, options->threads);
+            }
+            archive_get_stats(archive, &last_archive_stats);
+            archive_close(archive);
+            return result;
+        }
+        if (selective) {
+            return result;
+        }
+    }
+
+    // 优先使用流式还原，版本1压缩格式在解包开始前即可识别，此时回退到逐步还原
+    int legacy_format = 0;
+    BackupResult result = restore_stream(options, &legacy_format);
+    if (result != BACKUP_SUCCESS && legacy_format) {
+        result = restore_with_temp_files(options);
+    }
+
+    return result;
+}
+
+// 获取最近一次还原的提取统计
+void restore_get_archive_stats(ArchiveStats *stats) {
+    if (stats != NULL) {
+        *stats = last_archive_stats;
+    }
+}
@@ -0,0 +1,189 @@
+#include "ring.h"
+#include "thread.h"
+#include <stdatomic.h>
+
+// 缓存行大小，生产者和消费者的索引分别放在不同的缓存行，避免伪共享
+#define RING_CACHE_LINE 64
+
+// 等待策略：先自旋，再让出时间片，长时间等待时休眠，避免空转占满处理器
+#define RING_SPIN_LIMIT 64
+#define RING_YIELD_LIMIT 256
+
+struct RingBuffer {
+    unsigned char *slots;            // 槽位存储
+    size_t element_size;             // 每个槽位的字节数
+    unsigned int capacity;           // 槽位数量（2的幂）
+    unsigned int mask;               // capacity - 1
+    atomic_int closed;               // 生产者已关闭
+    atomic_int aborted;              // 队列已中止
+
+    // 生产者写入的索引和统计
+    char pad_head[RING_CACHE_LINE];
+    atomic_uint head;                // 下一个发布的位置
+    unsigned long long pushed;
+    unsigned int max_depth;
+    unsigned long long full_waits;
+
+    // 消费者写入的索引和统计
+    char pad_tail[RING_CACHE_LINE];
+    atomic_uint tail;                // 下一个读取的位置
+    unsigned long long depth_sum;
+    unsigned long long empty_waits;
+    char pad_end[RING_CACHE_LINE];
+};
+
+// 辅助函数：等待一轮
+static void ring_backoff(unsigned int *spins) {
+    if (*spins < RING_SPIN_LIMIT) {
+        (*spins)++;
+    } else if (*spins < RING_YIELD_LIMIT) {
+        (*spins)++;
+        thread_yield();
+    } else {
+        thread_sleep(1);
+    }
+}
+
+// 创建队列
+RingBuffer *ring_create(unsigned int capacity, size_t element_size) {
+    if (capacity == 0 || element_size == 0) {
+        return NULL;
+    }
+
+    RingBuffer *ring = (RingBuffer *)calloc(1, sizeof(RingBuffer));
+    if (ring == NULL) {
+        return NULL;
+    }
+
+    // 容量向上取整为2的幂，索引可以直接用掩码取模
+    ring->capacity = 1;
+    while (ring->capacity < capacity) {
+        ring->capacity <<= 1;
+    }
+    ring->mask = ring->capacity - 1;
+    ring->element_size = element_size;
+
+    ring->slots = (unsigned char *)malloc(ring->capacity * element_size);
+    if (ring->slots == NULL) {
+        free(ring);
+        return NULL;
+    }
+
+    atomic_init(&ring->closed, 0);
+    atomic_init(&ring->aborted, 0);
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+
+    return ring;
+}
+
+// 释放队列
+void ring_destroy(RingBuffer *ring) {
+    if (ring == NULL) {
+        return;
+    }
+    free(ring->slots);
+    free(ring);
+}
+
+// 生产者：等待空闲槽位
+void *ring_acquire(RingBuffer *ring) {
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned int spins = 0;
+    int waited = 0;
+
+    while (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= ring->capacity) {
+        if (atomic_load_explicit(&ring->aborted, memory_order_relaxed)) {
+            return NULL;
+        }
+        waited = 1;
+        ring_backoff(&spins);
+    }
+    if (waited) {
+        ring->full_waits++;
+    }
+    if (atomic_load_explicit(&ring->aborted, memory_order_relaxed)) {
+        return NULL;
+    }
+
+    return ring->slots + (size_t)(head & ring->mask) * ring->element_size;
+}
+
+// 生产者：发布槽位
+void ring_publish(RingBuffer *ring) {
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed) + 1;
+    unsigned int depth = head - atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    ring->pushed++;
+    if (depth > ring->max_depth) {
+        ring->max_depth = depth;
+    }
+    atomic_store_explicit(&ring->head, head, memory_order_release);
+}
+
+// 生产者：数据结束
+void ring_close(RingBuffer *ring) {
+    atomic_store_explicit(&ring->closed, 1, memory_order_release);
+}
+
+// 消费者：等待下一个元素
+void *ring_peek(RingBuffer *ring) {
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned int spins = 0;
+    int waited = 0;
+    unsigned int head;
+
+    while ((head = atomic_load_explicit(&ring->head, memory_order_acquire)) == tail) {
+        if (atomic_load_explicit(&ring->aborted, memory_order_relaxed)) {
+            return NULL;
+        }
+        // 关闭标志在最后一个元素发布之后设置，再检查一次队列以免丢失元素
+        if (atomic_load_explicit(&ring->closed, memory_order_acquire) &&
+            atomic_load_explicit(&ring->head, memory_order_acquire) == tail) {
+            return NULL;
+        }
+        waited = 1;
+        ring_backoff(&spins);
+    }
+    if (waited) {
+        ring->empty_waits++;
+    }
+    if (atomic_load_explicit(&ring->aborted, memory_order_relaxed)) {
+        return NULL;
+    }
+
+    ring->depth_sum += head - tail;
+    return ring->slots + (size_t)(tail & ring->mask) * ring->element_size;
+}
+
+// 消费者：释放槽位
+void ring_release(RingBuffer *ring) {
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+// 中止队列
+void ring_abort(RingBuffer *ring) {
+    atomic_store_explicit(&ring->aborted, 1, memory_order_release);
+}
+
+int ring_aborted(RingBuffer *ring) {
+    return atomic_load_explicit(&ring->aborted, memory_order_acquire);
+}
+
+// 当前队列深度
+unsigned int ring_depth(RingBuffer *ring) {
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    return head - tail;
+}
+
+// 获取队列统计
+void ring_get_stats(RingBuffer *ring, RingStats *stats) {
+    stats->pushed = ring->pushed;
+    stats->depth_sum = ring->depth_sum;
+    stats->max_depth = ring->max_depth;
+    stats->capacity = ring->capacity;
+    stats->full_waits = ring->full_waits;
+    stats->empty_waits = ring->empty_waits;
+}
@@ -0,0 +1,356 @@
+// 批量获取元数据（POSIX），Windows的遍历直接使用FindNextFile返回的元数据
+#ifndef _WIN32
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "stat_batch.h"
+#include <errno.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Linux上使用statx，可以同时获取创建时间
+#if defined(__linux__) && defined(STATX_BASIC_STATS)
+#define STAT_BATCH_USE_STATX 1
+#endif
+
+// 有io_uring头文件时通过系统调用直接使用io_uring（不依赖liburing）
+#if defined(STAT_BATCH_USE_STATX) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define STAT_BATCH_USE_URING 1
+#endif
+#endif
+#endif
+
+#define STAT_BATCH_FLAGS (AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT)
+#define STAT_BATCH_MASK (STATX_BASIC_STATS | STATX_BTIME)
+
+#ifdef STAT_BATCH_USE_URING
+// io_uring实例：提交队列、完成队列和提交队列项数组都映射到用户空间
+typedef struct {
+    int fd;
+    unsigned int entries;
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_cqe *cqes;
+    struct io_uring_sqe *sqes;
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;             // 与sq_ring为同一映射时为NULL
+    size_t cq_ring_size;
+    size_t sqes_size;
+} StatUring;
+#endif
+
+struct StatBatch {
+#ifdef STAT_BATCH_USE_URING
+    int async;                 // io_uring是否可用
+    StatUring ring;
+    struct statx results[STAT_BATCH_SIZE];
+#else
+    int unused;
+#endif
+};
+
+// 辅助函数：根据文件模式确定文件类型
+static FileType type_from_mode(mode_t mode) {
+    if (S_ISDIR(mode)) {
+        return FILE_TYPE_DIRECTORY;
+    } else if (S_ISLNK(mode)) {
+        return FILE_TYPE_SYMLINK;
+    } else if (S_ISBLK(mode)) {
+        return FILE_TYPE_BLOCK;
+    } else if (S_ISCHR(mode)) {
+        return FILE_TYPE_CHARACTER;
+    } else if (S_ISSOCK(mode)) {
+        return FILE_TYPE_SOCKET;
+    } else if (S_ISFIFO(mode)) {
+        return FILE_TYPE_FIFO;
+    }
+    return FILE_TYPE_REGULAR;
+}
+
+#ifdef STAT_BATCH_USE_STATX
+// 辅助函数：statx结果转换为目录清单项的属性
+static void stat_from_statx(const struct statx *stx, CatalogEntry *stat) {
+    stat->type = (unsigned char)type_from_mode(stx->stx_mode);
+    stat->size = (stat->type == FILE_TYPE_REGULAR) ? stx->stx_size : 0;
+    stat->inode = stx->stx_ino;
+    stat->device = ((unsigned long long)stx->stx_dev_major << 32) | stx->stx_dev_minor;
+    stat->flags = ((stx->stx_mask & STATX_BLOCKS) && stx->stx_blocks * 512 < stat->size) ? CATALOG_FLAG_SPARSE : 0;
+    if (stat->type == FILE_TYPE_REGULAR && (stx->stx_mask & STATX_NLINK) && stx->stx_nlink > 1) {
+        stat->flags |= CATALOG_FLAG_LINKED;
+    }
+    stat->create_time = (stx->stx_mask & STATX_BTIME) ? stx->stx_btime.tv_sec : stx->stx_ctime.tv_sec;
+    stat->modify_time = stx->stx_mtime.tv_sec;
+    stat->access_time = stx->stx_atime.tv_sec;
+    stat->mode = stx->stx_mode & 07777;
+    stat->uid = stx->stx_uid;
+    stat->gid = stx->stx_gid;
+}
+#endif
+
+// 辅助函数：同步获取一个文件的元数据
+static int stat_one(int dir_fd, const char *name, CatalogEntry *stat) {
+#ifdef STAT_BATCH_USE_STATX
+    struct statx stx;
+    if (statx(dir_fd, name, STAT_BATCH_FLAGS, STAT_BATCH_MASK, &stx) != 0) {
+        return -1;
+    }
+    stat_from_statx(&stx, stat);
+#else
+    struct stat st;
+    if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        return -1;
+    }
+
+    // POSIX没有通用的创建时间，使用状态改变时间代替
+    stat->type = (unsigned char)type_from_mode(st.st_mode);
+    stat->size = (stat->type == FILE_TYPE_REGULAR) ? (unsigned long long)st.st_size : 0;
+    stat->inode = (unsigned long long)st.st_ino;
+    stat->device = (unsigned long long)st.st_dev;
+    stat->flags = ((unsigned long long)st.st_blocks * 512 < stat->size) ? CATALOG_FLAG_SPARSE : 0;
+    if (stat->type == FILE_TYPE_REGULAR && st.st_nlink > 1) {
+        stat->flags |= CATALOG_FLAG_LINKED;
+    }
+    stat->create_time = st.st_ctime;
+    stat->modify_time = st.st_mtime;
+    stat->access_time = st.st_atime;
+    stat->mode = st.st_mode & 07777;
+    stat->uid = st.st_uid;
+    stat->gid = st.st_gid;
+#endif
+    return 0;
+}
+
+#ifdef STAT_BATCH_USE_URING
+// 辅助函数：释放io_uring实例
+static void uring_close(StatUring *ring) {
+    if (ring->sqes != NULL && ring->sqes != MAP_FAILED) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ring != NULL && ring->cq_ring != MAP_FAILED) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (ring->sq_ring != NULL && ring->sq_ring != MAP_FAILED) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+    if (ring->fd >= 0) {
+        close(ring->fd);
+    }
+    memset(ring, 0, sizeof(StatUring));
+    ring->fd = -1;
+}
+
+// 辅助函数：创建io_uring实例，失败（内核不支持、被seccomp或sysctl禁用）时返回-1
+static int uring_open(StatUring *ring, unsigned int entries) {
+    struct io_uring_params params;
+    memset(ring, 0, sizeof(StatUring));
+    memset(&params, 0, sizeof(params));
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        ring->fd = -1;
+        return -1;
+    }
+    ring->entries = params.sq_entries;
+
+    // 映射提交队列和完成队列，内核支持时两者共用一个映射
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+    }
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        goto cleanup;
+    }
+
+    void *cq_base = ring->sq_ring;
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            goto cleanup;
+        }
+        cq_base = ring->cq_ring;
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        goto cleanup;
+    }
+
+    char *sq = (char *)ring->sq_ring;
+    char *cq = (char *)cq_base;
+    ring->sq_head = (unsigned int *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned int *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned int *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned int *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned int *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned int *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned int *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return 0;
+
+cleanup:
+    uring_close(ring);
+    return -1;
+}
+
+// 辅助函数：一次提交count个statx请求并等待全部完成，结果写入results[i]
+// 返回0表示所有请求都已完成（单个请求的成败见ok[i]），返回-1表示io_uring不可用
+static int uring_statx(StatBatch *batch, int dir_fd, const char *const names[], int count, int ok[]) {
+    StatUring *ring = &batch->ring;
+
+    // 填充提交队列项，user_data记录请求序号
+    unsigned int tail = *ring->sq_tail;
+    unsigned int mask = *ring->sq_mask;
+    for (int i = 0; i < count; i++) {
+        unsigned int index = (tail + (unsigned int)i) & mask;
+        struct io_uring_sqe *sqe = &ring->sqes[index];
+        memset(sqe, 0, sizeof(struct io_uring_sqe));
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = dir_fd;
+        sqe->addr = (unsigned long long)(uintptr_t)names[i];
+        sqe->len = STAT_BATCH_MASK;
+        sqe->off = (unsigned long long)(uintptr_t)&batch->results[i];
+        sqe->statx_flags = STAT_BATCH_FLAGS;
+        sqe->user_data = (unsigned long long)i;
+        ring->sq_array[index] = index;
+    }
+    __atomic_store_n(ring->sq_tail, tail + (unsigned int)count, __ATOMIC_RELEASE);
+
+    // 提交整批请求，然后收割完成事件直到全部完成
+    unsigned int to_submit = (unsigned int)count;
+    int completed = 0;
+    int unsupported = 0;
+    while (completed < count) {
+        long ret = syscall(__NR_io_uring_enter, ring->fd, to_submit, (unsigned int)(count - completed), IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (to_submit > 0) {
+                // 提交失败，收回未提交的请求
+                __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+                return -1;
+            }
+            break;
+        }
+        to_submit = (ret >= (long)to_submit) ? 0 : to_submit - (unsigned int)ret;
+
+        unsigned int head = *ring->cq_head;
+        unsigned int cq_tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        while (head != cq_tail) {
+            struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+            int index = (int)cqe->user_data;
+            if (index >= 0 && index < count) {
+                ok[index] = (cqe->res == 0);
+                // 内核不支持IORING_OP_STATX（5.6之前）
+                if (cqe->res == -EINVAL) {
+                    unsupported = 1;
+                }
+            }
+            completed++;
+            head++;
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    return (unsupported || completed < count) ? -1 : 0;
+}
+#endif
+
+// 创建批量获取元数据的对象，每个线程使用各自的对象
+StatBatch *stat_batch_create(void) {
+    StatBatch *batch = (StatBatch *)malloc(sizeof(StatBatch));
+    if (batch == NULL) {
+        return NULL;
+    }
+    memset(batch, 0, sizeof(StatBatch));
+
+#ifdef STAT_BATCH_USE_URING
+    // 设置BACKUP_NO_URING环境变量可以强制使用同步调用
+    batch->ring.fd = -1;
+    if (getenv("BACKUP_NO_URING") == NULL && uring_open(&batch->ring, STAT_BATCH_SIZE) == 0) {
+        if (batch->ring.entries >= STAT_BATCH_SIZE) {
+            batch->async = 1;
+        } else {
+            uring_close(&batch->ring);
+        }
+    }
+#endif
+
+    return batch;
+}
+
+// 释放对象
+void stat_batch_destroy(StatBatch *batch) {
+    if (batch == NULL) {
+        return;
+    }
+#ifdef STAT_BATCH_USE_URING
+    if (batch->async) {
+        uring_close(&batch->ring);
+    }
+#endif
+    free(batch);
+}
+
+// 是否使用io_uring异步获取
+int stat_batch_async(const StatBatch *batch) {
+#ifdef STAT_BATCH_USE_URING
+    return batch != NULL && batch->async;
+#else
+    (void)batch;
+    return 0;
+#endif
+}
+
+// 批量获取元数据
+void stat_batch_run(StatBatch *batch, int dir_fd, const char *const names[], int count, CatalogEntry stats[], int ok[]) {
+    if (count > STAT_BATCH_SIZE) {
+        count = STAT_BATCH_SIZE;
+    }
+
+#ifdef STAT_BATCH_USE_URING
+    if (batch->async && count > 1) {
+        memset(ok, 0, count * sizeof(int));
+        if (uring_statx(batch, dir_fd, names, count, ok) == 0) {
+            for (int i = 0; i < count; i++) {
+                if (ok[i]) {
+                    stat_from_statx(&batch->results[i], &stats[i]);
+                }
+            }
+            return;
+        }
+
+        // io_uring出错后不再使用，本批改为同步获取
+        uring_close(&batch->ring);
+        batch->async = 0;
+    }
+#else
+    (void)batch;
+#endif
+
+    for (int i = 0; i < count; i++) {
+        ok[i] = (stat_one(dir_fd, names[i], &stats[i]) == 0);
+    }
+}
+
+#endif // _WIN32
@@ -0,0 +1,608 @@
+#include "stream.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#define fd_read _read
+#define fd_write _write
+#define fd_close _close
+#else
+#include <unistd.h>
+#define fd_read read
+#define fd_write write
+#define fd_close close
+#endif
+
+// 文件写入端
+typedef struct {
+    ByteWriter base;
+    FILE *fp;
+} FileWriter;
+
+// 文件读取端
+typedef struct {
+    ByteReader base;
+    FILE *fp;
+    int owns_file;               // 释放时是否关闭文件
+} FileReader;
+
+// 文件描述符写入端
+typedef struct {
+    ByteWriter base;
+    int fd;
+    int owns_fd;                 // 释放时是否关闭文件描述符
+} FdWriter;
+
+// 文件描述符读取端
+typedef struct {
+    ByteReader base;
+    int fd;
+    int owns_fd;                 // 释放时是否关闭文件描述符
+} FdReader;
+
+// 内存读取端
+typedef struct {
+    ByteReader base;
+    const unsigned char *data;
+    size_t size;
+    size_t pos;
+} MemoryReader;
+
+// 内存写入端
+typedef struct {
+    ByteWriter base;
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+} MemoryWriter;
+
+// 串联读取端
+typedef struct {
+    ByteReader base;
+    ByteReader *source;          // 上游读取端
+    ByteWriter *stage;           // 处理链的首个阶段
+    MemoryWriter output;         // 处理链的终端，缓存已加工但尚未读取的数据
+    size_t output_pos;           // 已读取到的位置
+    int finished;                // 上游数据已读完且处理链已冲刷
+    unsigned char buffer[STREAM_BUFFER_SIZE];
+} ChainedReader;
+
+// 向处理链写入数据
+BackupResult stream_write(ByteWriter *writer, const void *data, size_t size) {
+    if (writer == NULL || (data == NULL && size > 0)) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    if (size == 0) {
+        return BACKUP_SUCCESS;
+    }
+
+    return writer->write(writer, (const unsigned char *)data, size);
+}
+
+// 结束处理链
+BackupResult stream_finish(ByteWriter *writer) {
+    // 上游阶段先冲刷，其输出会写入下游，然后再冲刷下游
+    while (writer != NULL) {
+        if (writer->finish != NULL) {
+            BackupResult result = writer->finish(writer);
+            if (result != BACKUP_SUCCESS) {
+                return result;
+            }
+        }
+        writer = writer->next;
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+// 释放处理链
+void stream_destroy(ByteWriter *writer) {
+    while (writer != NULL) {
+        ByteWriter *next = writer->next;
+        if (writer->destroy != NULL) {
+            writer->destroy(writer);
+        } else {
+            free(writer);
+        }
+        writer = next;
+    }
+}
+
+// 文件写入端：写入数据
+static BackupResult file_writer_write(ByteWriter *writer, const unsigned char *data, size_t size) {
+    FileWriter *file_writer = (FileWriter *)writer;
+
+    if (fwrite(data, 1, size, file_writer->fp) != size) {
+        return BACKUP_ERROR_FILE;
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+// 文件写入端：冲刷缓冲区
+static BackupResult file_writer_finish(ByteWriter *writer) {
+    FileWriter *file_writer = (FileWriter *)writer;
+
+    if (fflush(file_writer->fp) != 0) {
+        return BACKUP_ERROR_FILE;
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+// 创建文件写入端
+ByteWriter *file_writer_create(FILE *fp) {
+    if (fp == NULL) {
+        return NULL;
+    }
+
+    FileWriter *file_writer = (FileWriter *)calloc(1, sizeof(FileWriter));
+    if (file_writer == NULL) {
+        return NULL;
+    }
+
+    file_writer->base.write = file_writer_write;
+    file_writer->base.finish = file_writer_finish;
+    file_writer->base.destroy = NULL;
+    file_writer->base.next = NULL;
+    file_writer->fp = fp;
+
+    return &file_writer->base;
+}
+
+// 从读取端读取数据
+BackupResult stream_read(ByteReader *reader, void *buffer, size_t size, size_t *bytes_read) {
+    if (reader == NULL || buffer == NULL || bytes_read == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    *bytes_read = 0;
+    if (size == 0) {
+        return BACKUP_SUCCESS;
+    }
+
+    return reader->read(reader, (unsigned char *)buffer, size, bytes_read);
+}
+
+// 从读取端读取恰好size字节
+BackupResult stream_read_exact(ByteReader *reader, void *buffer, size_t size) {
+    unsigned char *bytes = (unsigned char *)buffer;
+
+    while (size > 0) {
+        size_t bytes_read;
+        BackupResult result = stream_read(reader, bytes, size, &bytes_read);
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+        if (bytes_read == 0) {
+            return BACKUP_ERROR_FILE;
+        }
+        bytes += bytes_read;
+        size -= bytes_read;
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+// 释放读取端
+void reader_destroy(ByteReader *reader) {
+    if (reader == NULL) {
+        return;
+    }
+
+    if (reader->destroy != NULL) {
+        reader->destroy(reader);
+    } else {
+        free(reader);
+    }
+}
+
+// 将读取端的全部数据写入写入端
+BackupResult stream_copy(ByteReader *reader, ByteWriter *writer) {
+    if (reader == NULL || writer == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    unsigned char *buffer = (unsigned char *)malloc(STREAM_BUFFER_SIZE);
+    if (buffer == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    BackupResult result;
+    size_t bytes_read;
+    while ((result = stream_read(reader, buffer, STREAM_BUFFER_SIZE, &bytes_read)) == BACKUP_SUCCESS && bytes_read > 0) {
+        result = stream_write(writer, buffer, bytes_read);
+        if (result != BACKUP_SUCCESS) {
+            break;
+        }
+    }
+
+    free(buffer);
+    return result;
+}
+
+// 将读取端的全部数据送入处理阶段
+BackupResult stream_transform(ByteReader *reader, ByteWriter *stage, ByteWriter *output) {
+    if (stage == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    BackupResult result = stream_copy(reader, stage);
+    if (result == BACKUP_SUCCESS) {
+        result = stream_finish(stage);
+    }
+
+    // 释放stage到output之间的各阶段，output归调用方所有
+    while (stage != NULL && stage != output) {
+        ByteWriter *next = stage->next;
+        stage->next = NULL;
+        stream_destroy(stage);
+        stage = next;
+    }
+
+    return result;
+}
+
+// 文件读取端：读取数据
+static BackupResult file_reader_read(ByteReader *reader, unsigned char *buffer, size_t size, size_t *bytes_read) {
+    FileReader *file_reader = (FileReader *)reader;
+
+    *bytes_read = fread(buffer, 1, size, file_reader->fp);
+    if (*bytes_read == 0 && ferror(file_reader->fp)) {
+        return BACKUP_ERROR_FILE;
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+// 文件读取端：释放资源
+static void file_reader_destroy(ByteReader *reader) {
+    FileReader *file_reader = (FileReader *)reader;
+
+    if (file_reader->owns_file) {
+        fclose(file_reader->fp);
+    }
+    free(file_reader);
+}
+
+// 创建文件读取端
+ByteReader *file_reader_create(FILE *fp) {
+    if (fp == NULL) {
+        return NULL;
+    }
+
+    FileReader *file_reader = (FileReader *)calloc(1, sizeof(FileReader));
+    if (file_reader == NULL) {
+        return NULL;
+    }
+
+    file_reader->base.read = file_reader_read;
+    file_reader->base.destroy = file_reader_destroy;
+    file_reader->fp = fp;
+    file_reader->owns_file = 0;
+
+    return &file_reader->base;
+}
+
+// 按路径打开文件的读取端
+ByteReader *file_reader_open(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return NULL;
+    }
+
+    ByteReader *reader = file_reader_create(fp);
+    if (reader == NULL) {
+        fclose(fp);
+        return NULL;
+    }
+    ((FileReader *)reader)->owns_file = 1;
+
+    return reader;
+}
+
+// 文件描述符写入端：写入数据
+static BackupResult fd_writer_write(ByteWriter *writer, const unsigned char *data, size_t size) {
+    FdWriter *fd_writer = (FdWriter *)writer;
+
+    while (size > 0) {
+        unsigned int chunk = (size < STREAM_BUFFER_SIZE) ? (unsigned int)size : STREAM_BUFFER_SIZE;
+        int written = (int)fd_write(fd_writer->fd, data, chunk);
+        if (written <= 0) {
+            return BACKUP_ERROR_FILE;
+        }
+        data += written;
+        size -= written;
+    }
+
+    return BACKUP_SUCCESS;
+}
+
+// 文件描述符写入端：释放资源
+static void fd_writer_destroy(ByteWriter *writer) {
+    FdWriter *fd_writer = (FdWriter *)writer;
+
+    if (fd_writer->owns_fd) {
+        fd_close(fd_writer->fd);
+    }
+    free(fd_writer);
+}
+
+// 创建文件描述符写入端
+ByteWriter *fd_writer_create(int fd) {
+    if (fd < 0) {
+        return NULL;
+    }
+
+    FdWriter *fd_writer = (FdWriter *)calloc(1, sizeof(FdWriter));
+    if (fd_writer == NULL) {
+        return NULL;
+    }
+
+    fd_writer->base.write = fd_writer_write;
+    fd_writer->base.finish = NULL;
+    fd_writer->base.destroy = fd_writer_destroy;
+    fd_writer->base.next = NULL;
+    fd_writer->fd = fd;
+    fd_writer->owns_fd = 0;
+
+    return &fd_writer->base;
+}
+
+// 文件描述符读取端：读取数据
+static BackupResult fd_reader_read(ByteReader *reader, unsigned char *buffer, size_t size, size_t *bytes_read) {
+    FdReader *fd_reader = (FdReader *)reader;
+    unsigned int chunk = (size < STREAM_BUFFER_SIZE) ? (unsigned int)size : STREAM_BUFFER_SIZE;
+
+    int count = (int)fd_read(fd_reader->fd, buffer, chunk);
+    if (count < 0) {
+        *bytes_read = 0;
+        return BACKUP_ERROR_FILE;
+    }
+
+    *bytes_read = (size_t)count;
+    return BACKUP_SUCCESS;
+}
+
+// 文件描述符读取端：释放资源
+static void fd_reader_destroy(ByteReader *reader) {
+    FdReader *fd_reader = (FdReader *)reader;
+
+    if (fd_reader->owns_fd) {
+        fd_close(fd_reader->fd);
+    }
+    free(fd_reader);
+}
+
+// 创建文件描述符读取端
+ByteReader *fd_reader_create(int fd) {
+    if (fd < 0) {
+        return NULL;
+    }
+
+    FdReader *fd_reader = (FdReader *)calloc(1, sizeof(FdReader));
+    if (fd_reader == NULL) {
+        return NULL;
+    }
+
+    fd_reader->base.read = fd_reader_read;
+    fd_reader->base.destroy = fd_reader_destroy;
+    fd_reader->fd = fd;
+    fd_reader->owns_fd = 0;
+
+    return &fd_reader->base;
+}
+
+// 创建管道
+BackupResult stream_pipe_create(ByteReader **reader, ByteWriter **writer) {
+    int fds[2];
+
+    if (reader == NULL || writer == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+#ifdef _WIN32
+    if (_pipe(fds, STREAM_BUFFER_SIZE, _O_BINARY) != 0) {
+        return BACKUP_ERROR_FILE;
+    }
+#else
+    if (pipe(fds) != 0) {
+        return BACKUP_ERROR_FILE;
+    }
+#endif
+
+    *reader = fd_reader_create(fds[0]);
+    *writer = fd_writer_create(fds[1]);
+    if (*reader == NULL || *writer == NULL) {
+        reader_destroy(*reader);
+        stream_destroy(*writer);
+        fd_close(fds[0]);
+        fd_close(fds[1]);
+        *reader = NULL;
+        *writer = NULL;
+        return BACKUP_ERROR_MEMORY;
+    }
+    ((FdReader *)*reader)->owns_fd = 1;
+    ((FdWriter *)*writer)->owns_fd = 1;
+
+    return BACKUP_SUCCESS;
+}
+
+// 内存读取端：读取数据
+static BackupResult memory_reader_read(ByteReader *reader, unsigned char *buffer, size_t size, size_t *bytes_read) {
+    MemoryReader *memory_reader = (MemoryReader *)reader;
+    size_t available = memory_reader->size - memory_reader->pos;
+    size_t chunk = (size < available) ? size : available;
+
+    memcpy(buffer, memory_reader->data + memory_reader->pos, chunk);
+    memory_reader->pos += chunk;
+    *bytes_read = chunk;
+
+    return BACKUP_SUCCESS;
+}
+
+// 创建内存读取端
+ByteReader *memory_reader_create(const void *data, size_t size) {
+    if (data == NULL && size > 0) {
+        return NULL;
+    }
+
+    MemoryReader *memory_reader = (MemoryReader *)calloc(1, sizeof(MemoryReader));
+    if (memory_reader == NULL) {
+        return NULL;
+    }
+
+    memory_reader->base.read = memory_reader_read;
+    memory_reader->base.destroy = NULL;
+    memory_reader->data = (const unsigned char *)data;
+    memory_reader->size = size;
+    memory_reader->pos = 0;
+
+    return &memory_reader->base;
+}
+
+// 内存写入端：写入数据
+static BackupResult memory_writer_write(ByteWriter *writer, const unsigned char *data, size_t size) {
+    MemoryWriter *memory_writer = (MemoryWriter *)writer;
+
+    if (memory_writer->size + size > memory_writer->capacity) {
+        size_t capacity = (memory_writer->capacity > 0) ? memory_writer->capacity : STREAM_BUFFER_SIZE;
+        while (capacity < memory_writer->size + size) {
+            capacity *= 2;
+        }
+
+        unsigned char *new_data = (unsigned char *)realloc(memory_writer->data, capacity);
+        if (new_data == NULL) {
+            return BACKUP_ERROR_MEMORY;
+        }
+        memory_writer->data = new_data;
+        memory_writer->capacity = capacity;
+    }
+
+    memcpy(memory_writer->data + memory_writer->size, data, size);
+    memory_writer->size += size;
+    return BACKUP_SUCCESS;
+}
+
+// 内存写入端：释放资源
+static void memory_writer_destroy(ByteWriter *writer) {
+    MemoryWriter *memory_writer = (MemoryWriter *)writer;
+
+    free(memory_writer->data);
+    free(memory_writer);
+}
+
+// 创建内存写入端
+ByteWriter *memory_writer_create(void) {
+    MemoryWriter *memory_writer = (MemoryWriter *)calloc(1, sizeof(MemoryWriter));
+    if (memory_writer == NULL) {
+        return NULL;
+    }
+
+    memory_writer->base.write = memory_writer_write;
+    memory_writer->base.finish = NULL;
+    memory_writer->base.destroy = memory_writer_destroy;
+    memory_writer->base.next = NULL;
+
+    return &memory_writer->base;
+}
+
+// 获取内存写入端中的数据
+const unsigned char *memory_writer_data(ByteWriter *writer, size_t *size) {
+    MemoryWriter *memory_writer = (MemoryWriter *)writer;
+
+    if (size != NULL) {
+        *size = memory_writer->size;
+    }
+    return memory_writer->data;
+}
+
+// 串联读取端的终端写入端嵌入在读取端中，由读取端负责释放
+static void chained_output_destroy(ByteWriter *writer) {
+    (void)writer;
+}
+
+// 串联读取端：读取加工后的数据，缓存不足时从上游拉取并推进处理链
+static BackupResult chained_reader_read(ByteReader *reader, unsigned char *buffer, size_t size, size_t *bytes_read) {
+    ChainedReader *chained = (ChainedReader *)reader;
+    BackupResult result;
+
+    *bytes_read = 0;
+    while (chained->output_pos == chained->output.size && !chained->finished) {
+        // 缓存已读完，重置缓存
+        chained->output.size = 0;
+        chained->output_pos = 0;
+
+        size_t count;
+        result = stream_read(chained->source, chained->buffer, sizeof(chained->buffer), &count);
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+
+        if (count == 0) {
+            chained->finished = 1;
+            result = stream_finish(chained->stage);
+        } else {
+            result = stream_write(chained->stage, chained->buffer, count);
+        }
+        if (result != BACKUP_SUCCESS) {
+            return result;
+        }
+    }
+
+    size_t available = chained->output.size - chained->output_pos;
+    size_t chunk = (size < available) ? size : available;
+    memcpy(buffer, chained->output.data + chained->output_pos, chunk);
+    chained->output_pos += chunk;
+    *bytes_read = chunk;
+
+    return BACKUP_SUCCESS;
+}
+
+// 串联读取端：释放上游读取端和处理链
+static void chained_reader_destroy(ByteReader *reader) {
+    ChainedReader *chained = (ChainedReader *)reader;
+
+    reader_destroy(chained->source);
+    if (chained->stage != &chained->output.base) {
+        stream_destroy(chained->stage);
+    }
+    free(chained->output.data);
+    free(chained);
+}
+
+// 创建串联读取端
+ByteReader *chained_reader_create(ByteReader *source) {
+    if (source == NULL) {
+        return NULL;
+    }
+
+    ChainedReader *chained = (ChainedReader *)calloc(1, sizeof(ChainedReader));
+    if (chained == NULL) {
+        return NULL;
+    }
+
+    chained->base.read = chained_reader_read;
+    chained->base.destroy = chained_reader_destroy;
+    chained->source = source;
+    chained->output.base.write = memory_writer_write;
+    chained->output.base.finish = NULL;
+    chained->output.base.destroy = chained_output_destroy;
+    chained->output.base.next = NULL;
+    chained->stage = &chained->output.base;
+
+    return &chained->base;
+}
+
+// 获取串联读取端的终端写入端
+ByteWriter *chained_reader_output(ByteReader *reader) {
+    return &((ChainedReader *)reader)->output.base;
+}
+
+// 设置串联读取端的处理链
+void chained_reader_set_stage(ByteReader *reader, ByteWriter *stage) {
+    if (stage != NULL) {
+        ((ChainedReader *)reader)->stage = stage;
+    }
+}
@@ -0,0 +1,142 @@
+#include "thread.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// 线程启动参数，由新线程在开始运行后释放
+typedef struct {
+    ThreadFunc func;
+    void *arg;
+} ThreadStart;
+
+#ifdef _WIN32
+// 线程入口：转调用户函数
+static DWORD WINAPI thread_entry(LPVOID param) {
+    ThreadStart start = *(ThreadStart *)param;
+    free(param);
+    start.func(start.arg);
+    return 0;
+}
+#else
+// 线程入口：转调用户函数
+static void *thread_entry(void *param) {
+    ThreadStart start = *(ThreadStart *)param;
+    free(param);
+    start.func(start.arg);
+    return NULL;
+}
+#endif
+
+// 创建线程并立即运行func(arg)
+BackupResult thread_create(Thread *thread, ThreadFunc func, void *arg) {
+    if (thread == NULL || func == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    ThreadStart *start = (ThreadStart *)malloc(sizeof(ThreadStart));
+    if (start == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    start->func = func;
+    start->arg = arg;
+
+#ifdef _WIN32
+    thread->handle = CreateThread(NULL, 0, thread_entry, start, 0, NULL);
+    if (thread->handle == NULL) {
+        free(start);
+        return BACKUP_ERROR_MEMORY;
+    }
+#else
+    if (pthread_create(&thread->handle, NULL, thread_entry, start) != 0) {
+        free(start);
+        return BACKUP_ERROR_MEMORY;
+    }
+#endif
+
+    return BACKUP_SUCCESS;
+}
+
+// 等待线程结束并释放线程资源
+void thread_join(Thread *thread) {
+#ifdef _WIN32
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    thread->handle = NULL;
+#else
+    pthread_join(thread->handle, NULL);
+#endif
+}
+
+// 让出当前线程的剩余时间片
+void thread_yield(void) {
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+// 当前线程休眠指定的毫秒数
+void thread_sleep(unsigned int milliseconds) {
+#ifdef _WIN32
+    Sleep(milliseconds);
+#else
+    struct timespec ts;
+    ts.tv_sec = milliseconds / 1000;
+    ts.tv_nsec = (long)(milliseconds % 1000) * 1000000L;
+    nanosleep(&ts, NULL);
+#endif
+}
+
+// 初始化互斥锁
+void mutex_init(Mutex *mutex) {
+#ifdef _WIN32
+    InitializeSRWLock((PSRWLOCK)&mutex->lock);
+#else
+    pthread_mutex_init(&mutex->lock, NULL);
+#endif
+}
+
+// 释放互斥锁
+void mutex_destroy(Mutex *mutex) {
+#ifdef _WIN32
+    (void)mutex; // SRWLOCK不需要释放
+#else
+    pthread_mutex_destroy(&mutex->lock);
+#endif
+}
+
+// 加锁
+void mutex_lock(Mutex *mutex) {
+#ifdef _WIN32
+    AcquireSRWLockExclusive((PSRWLOCK)&mutex->lock);
+#else
+    pthread_mutex_lock(&mutex->lock);
+#endif
+}
+
+// 解锁
+void mutex_unlock(Mutex *mutex) {
+#ifdef _WIN32
+    ReleaseSRWLockExclusive((PSRWLOCK)&mutex->lock);
+#else
+    pthread_mutex_unlock(&mutex->lock);
+#endif
+}
+
+// 获取可用的处理器数量
+int thread_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (info.dwNumberOfProcessors > 0) ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (int)count : 1;
+#endif
+}
@@ -0,0 +1,460 @@
+#include "traverse.h"
+#include "filter.h"
+#include "thread.h"
+#include "platform.h"
+#include <stdatomic.h>
+
+// 等待策略：没有可窃取的目录时先让出时间片，仍然没有再休眠
+#define TRAVERSE_YIELD_LIMIT 64
+
+// 待扫描目录（目录清单中的目录编号）
+typedef struct {
+    unsigned int dir;
+} TraverseTask;
+
+// 待扫描目录队列：所有者从尾部存取（深度优先，局部性好），其他线程从头部窃取（取走较浅的目录，子树较大）
+typedef struct {
+    Mutex lock;
+    TraverseTask *tasks;
+    int head;                  // 第一个元素的位置
+    int count;                 // 元素数量
+    int capacity;              // 容量（循环数组）
+} TraverseDeque;
+
+typedef struct TraverseShared TraverseShared;
+
+struct TraverseWorker {
+    TraverseShared *shared;
+    int index;
+    TraverseDeque deque;
+    unsigned int dir;          // 正在扫描的目录编号
+    char *path;                // 正在扫描的目录的相对路径
+    size_t path_capacity;
+    char *file_path;           // 按目录筛选时文件的相对路径
+    size_t file_path_capacity;
+    void *data;                // 平台相关的线程私有数据
+    Thread thread;
+    int started;
+};
+
+struct TraverseShared {
+    TraverseRoot *root;
+    const BackupOptions *options;
+    Catalog *catalog;          // 遍历结果
+    TraverseSink *sink;        // 流式遍历的接收端，可为NULL
+    TraverseWorker *workers;
+    int worker_count;
+    atomic_long pending;       // 已加入队列但尚未扫描完成的目录数量，为0时遍历结束
+    atomic_int error;          // 第一个错误
+};
+
+// 辅助函数：记录错误，所有线程随后退出
+static void traverse_fail(TraverseShared *shared, BackupResult result) {
+    int expected = BACKUP_SUCCESS;
+    atomic_compare_exchange_strong(&shared->error, &expected, (int)result);
+}
+
+// 队列：在尾部加入目录
+static BackupResult deque_push(TraverseDeque *deque, unsigned int dir) {
+    BackupResult result = BACKUP_SUCCESS;
+
+    mutex_lock(&deque->lock);
+    if (deque->count == deque->capacity) {
+        // 扩容时把循环数组展开到新数组的开头
+        int capacity = (deque->capacity > 0) ? deque->capacity * 2 : 64;
+        TraverseTask *tasks = (TraverseTask *)malloc(capacity * sizeof(TraverseTask));
+        if (tasks == NULL) {
+            result = BACKUP_ERROR_MEMORY;
+        } else {
+            for (int i = 0; i < deque->count; i++) {
+                tasks[i] = deque->tasks[(deque->head + i) % deque->capacity];
+            }
+            free(deque->tasks);
+            deque->tasks = tasks;
+            deque->head = 0;
+            deque->capacity = capacity;
+        }
+    }
+    if (result == BACKUP_SUCCESS) {
+        deque->tasks[(deque->head + deque->count) % deque->capacity].dir = dir;
+        deque->count++;
+    }
+    mutex_unlock(&deque->lock);
+
+    return result;
+}
+
+// 队列：所有者从尾部取出目录
+static int deque_pop(TraverseDeque *deque, TraverseTask *task) {
+    int found = 0;
+
+    mutex_lock(&deque->lock);
+    if (deque->count > 0) {
+        deque->count--;
+        *task = deque->tasks[(deque->head + deque->count) % deque->capacity];
+        found = 1;
+    }
+    mutex_unlock(&deque->lock);
+
+    return found;
+}
+
+// 队列：其他线程从头部窃取目录
+static int deque_steal(TraverseDeque *deque, TraverseTask *task) {
+    int found = 0;
+
+    mutex_lock(&deque->lock);
+    if (deque->count > 0) {
+        *task = deque->tasks[deque->head];
+        deque->head = (deque->head + 1) % deque->capacity;
+        deque->count--;
+        found = 1;
+    }
+    mutex_unlock(&deque->lock);
+
+    return found;
+}
+
+// 辅助函数：确保缓冲区能放下size字节
+static BackupResult reserve_buffer(char **buffer, size_t *capacity, size_t size) {
+    if (size <= *capacity) {
+        return BACKUP_SUCCESS;
+    }
+
+    size_t new_capacity = (*capacity > 0) ? *capacity : 256;
+    while (new_capacity < size) {
+        new_capacity *= 2;
+    }
+    char *new_buffer = (char *)realloc(*buffer, new_capacity);
+    if (new_buffer == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    *buffer = new_buffer;
+    *capacity = new_capacity;
+    return BACKUP_SUCCESS;
+}
+
+// 扫描到的文件，经过筛选后加入目录清单
+BackupResult traverse_add_file(TraverseWorker *worker, const char *name, const CatalogEntry *stat, const char *symlink_target) {
+    TraverseShared *shared = worker->shared;
+    const BackupOptions *options = shared->options;
+
+    // 数据过滤，只有按目录筛选时才需要构建文件的完整路径
+    if (options != NULL) {
+        const char *path = NULL;
+        if (filter_needs_path(options)) {
+            size_t dir_length = strlen(worker->path);
+            size_t length = dir_length + 1 + strlen(name) + 1;
+            if (reserve_buffer(&worker->file_path, &worker->file_path_capacity, length) != BACKUP_SUCCESS) {
+                return BACKUP_ERROR_MEMORY;
+            }
+            if (dir_length > 0) {
+                snprintf(worker->file_path, length, "%s%c%s", worker->path, PATH_SEPARATOR, name);
+            } else {
+                snprintf(worker->file_path, length, "%s", name);
+            }
+            path = worker->file_path;
+        }
+        if (!filter_entry(stat, name, path, options)) {
+            return BACKUP_SUCCESS;
+        }
+    }
+
+    unsigned int id = catalog_add_file(shared->catalog, worker->dir, name, stat, symlink_target);
+    if (id == CATALOG_NONE) {
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    // 流式遍历交给接收端
+    if (shared->sink != NULL) {
+        return shared->sink->add(shared->sink, shared->catalog, id);
+    }
+    return BACKUP_SUCCESS;
+}
+
+// 辅助函数：目录加入本线程的待扫描队列
+static BackupResult traverse_push_directory(TraverseWorker *worker, unsigned int dir) {
+    atomic_fetch_add(&worker->shared->pending, 1);
+    BackupResult result = deque_push(&worker->deque, dir);
+    if (result != BACKUP_SUCCESS) {
+        atomic_fetch_sub(&worker->shared->pending, 1);
+    }
+    return result;
+}
+
+// 扫描到的子目录，加入目录清单和本线程的待扫描队列
+BackupResult traverse_add_directory(TraverseWorker *worker, const char *name) {
+    unsigned int dir = catalog_add_directory(worker->shared->catalog, worker->dir, name);
+    if (dir == CATALOG_NONE) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    return traverse_push_directory(worker, dir);
+}
+
+// 辅助函数：扫描一个目录，先从目录清单构建目录的相对路径
+static BackupResult traverse_scan(TraverseWorker *worker, unsigned int dir) {
+    TraverseShared *shared = worker->shared;
+
+    if (catalog_path_buffer(shared->catalog, dir, &worker->path, &worker->path_capacity) != BACKUP_SUCCESS) {
+        return BACKUP_ERROR_MEMORY;
+    }
+    worker->dir = dir;
+
+    return traverse_scan_directory(shared->root, worker->path, worker, shared->options);
+}
+
+// 获取本线程的私有数据
+void *traverse_worker_data(TraverseWorker *worker) {
+    return worker->data;
+}
+
+// 辅助函数：从其他线程的队列窃取目录，从下一个线程开始轮询，避免所有空闲线程争抢同一个队列
+static int traverse_steal(TraverseWorker *worker, TraverseTask *task) {
+    TraverseShared *shared = worker->shared;
+
+    for (int i = 1; i < shared->worker_count; i++) {
+        TraverseWorker *victim = &shared->workers[(worker->index + i) % shared->worker_count];
+        if (deque_steal(&victim->deque, task)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 遍历线程入口
+static void traverse_worker_run(void *arg) {
+    TraverseWorker *worker = (TraverseWorker *)arg;
+    TraverseShared *shared = worker->shared;
+    TraverseTask task;
+    unsigned int idle = 0;
+
+    worker->data = traverse_worker_data_create(shared->root);
+
+    while (atomic_load(&shared->error) == BACKUP_SUCCESS) {
+        if (!deque_pop(&worker->deque, &task) && !traverse_steal(worker, &task)) {
+            // 所有目录都已扫描完成
+            if (atomic_load(&shared->pending) == 0) {
+                break;
+            }
+            if (idle < TRAVERSE_YIELD_LIMIT) {
+                idle++;
+                thread_yield();
+            } else {
+                thread_sleep(1);
+            }
+            continue;
+        }
+        idle = 0;
+
+        BackupResult result = traverse_scan(worker, task.dir);
+        atomic_fetch_sub(&shared->pending, 1);
+        if (result != BACKUP_SUCCESS) {
+            traverse_fail(shared, result);
+            break;
+        }
+    }
+
+    traverse_worker_data_destroy(worker->data);
+    worker->data = NULL;
+}
+
+// 辅助函数：运行并行遍历，结果加入目录清单
+static BackupResult traverse_run(const char *root_path, Catalog *catalog, TraverseSink *sink, const BackupOptions *options) {
+    // 确定线程数，默认使用全部处理器
+    int worker_count = (options != NULL && options->traverse_threads > 0) ? options->traverse_threads : thread_cpu_count();
+    if (worker_count > TRAVERSE_MAX_THREADS) {
+        worker_count = TRAVERSE_MAX_THREADS;
+    }
+
+    TraverseShared shared;
+    memset(&shared, 0, sizeof(TraverseShared));
+    shared.options = options;
+    shared.catalog = catalog;
+    shared.sink = sink;
+    shared.worker_count = worker_count;
+    atomic_init(&shared.pending, 0);
+    atomic_init(&shared.error, BACKUP_SUCCESS);
+
+    shared.root = traverse_root_open(root_path);
+    if (shared.root == NULL) {
+        return BACKUP_ERROR_PATH;
+    }
+
+    shared.workers = (TraverseWorker *)calloc(worker_count, sizeof(TraverseWorker));
+    if (shared.workers == NULL) {
+        traverse_root_close(shared.root);
+        return BACKUP_ERROR_MEMORY;
+    }
+    for (int i = 0; i < worker_count; i++) {
+        shared.workers[i].shared = &shared;
+        shared.workers[i].index = i;
+        mutex_init(&shared.workers[i].deque.lock);
+    }
+
+    // 根目录放入第一个线程的队列
+    BackupResult result = traverse_push_directory(&shared.workers[0], CATALOG_ROOT);
+
+    // 启动遍历线程，只有一个线程时直接在当前线程中运行
+    if (result == BACKUP_SUCCESS) {
+        if (worker_count == 1) {
+            traverse_worker_run(&shared.workers[0]);
+        } else {
+            for (int i = 0; i < worker_count; i++) {
+                if (thread_create(&shared.workers[i].thread, traverse_worker_run, &shared.workers[i]) != BACKUP_SUCCESS) {
+                    // 已启动的线程仍然可以完成遍历
+                    break;
+                }
+                shared.workers[i].started = 1;
+            }
+            if (!shared.workers[0].started) {
+                traverse_worker_run(&shared.workers[0]);
+            }
+            for (int i = 0; i < worker_count; i++) {
+                if (shared.workers[i].started) {
+                    thread_join(&shared.workers[i].thread);
+                }
+            }
+        }
+        result = (BackupResult)atomic_load(&shared.error);
+    }
+
+    // 清理资源
+    for (int i = 0; i < worker_count; i++) {
+        free(shared.workers[i].path);
+        free(shared.workers[i].file_path);
+        free(shared.workers[i].deque.tasks);
+        mutex_destroy(&shared.workers[i].deque.lock);
+    }
+    free(shared.workers);
+    traverse_root_close(shared.root);
+
+    return result;
+}
+
+// 辅助函数：按文件在磁盘上的物理位置排列文件列表，读取源文件时尽量顺序访问磁盘，减少机械硬盘的寻道
+// 优先按第一个数据段的物理位置排序，平台或文件系统不支持时按inode编号（多数文件系统按inode编号就近分配数据）
+// 没有数据段的文件（空文件、内联数据等）排在最前面，它们不需要读取数据块
+static BackupResult traverse_sort_layout(const char *root_path, Catalog *catalog) {
+    unsigned int count = catalog_file_count(catalog);
+    unsigned long long *keys = (unsigned long long *)malloc((count + 1) * sizeof(unsigned long long));
+    if (keys == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    BackupResult result = BACKUP_SUCCESS;
+    char *relative = NULL;
+    size_t relative_capacity = 0;
+    char *path = NULL;
+    size_t path_capacity = 0;
+    int physical = 1;
+    for (unsigned int i = 0; i < count && result == BACKUP_SUCCESS; i++) {
+        unsigned int id = catalog_file_id(catalog, i);
+        const CatalogEntry *entry = catalog_entry(catalog, id);
+        keys[i] = physical ? 0 : entry->inode;
+        if (!physical || entry->type != FILE_TYPE_REGULAR || entry->size == 0) {
+            continue;
+        }
+
+        result = catalog_path_buffer(catalog, id, &relative, &relative_capacity);
+        if (result != BACKUP_SUCCESS) {
+            break;
+        }
+        size_t length = strlen(root_path) + 1 + strlen(relative) + 1;
+        if (length > path_capacity) {
+            char *new_path = (char *)realloc(path, length);
+            if (new_path == NULL) {
+                result = BACKUP_ERROR_MEMORY;
+                break;
+            }
+            path = new_path;
+            path_capacity = length;
+        }
+        snprintf(path, path_capacity, "%s%c%s", root_path, PATH_SEPARATOR, relative);
+
+        // 不支持时已经得到的物理位置作废，全部改按inode编号；打不开的文件排在最前面，打包时再报告错误
+        if (platform_physical_offset(path, &keys[i]) == BACKUP_ERROR_PARAM) {
+            physical = 0;
+            for (unsigned int j = 0; j <= i; j++) {
+                keys[j] = catalog_entry(catalog, catalog_file_id(catalog, j))->inode;
+            }
+        }
+    }
+    if (result == BACKUP_SUCCESS) {
+        result = catalog_sort_by_key(catalog, keys);
+    }
+
+    free(relative);
+    free(path);
+    free(keys);
+    return result;
+}
+
+// 目录遍历算法
+BackupResult traverse_catalog(const char *root_path, Catalog **catalog, const BackupOptions *options) {
+    if (root_path == NULL || catalog == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    *catalog = catalog_create();
+    if (*catalog == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    BackupResult result = traverse_run(root_path, *catalog, NULL, options);
+
+    // 按路径排序，得到与线程调度无关的确定顺序
+    if (result == BACKUP_SUCCESS && options != NULL && options->traverse_sort) {
+        result = catalog_sort(*catalog);
+    }
+
+    // 按物理位置排序，路径排序的结果作为物理位置相同时的顺序
+    if (result == BACKUP_SUCCESS && options != NULL && options->traverse_layout) {
+        result = traverse_sort_layout(root_path, *catalog);
+    }
+    if (result != BACKUP_SUCCESS) {
+        catalog_destroy(*catalog);
+        *catalog = NULL;
+    }
+    return result;
+}
+
+// 兼容接口：结果转换为FileMetadata数组
+BackupResult traverse_directory(const char *root_path, FileMetadata **files, int *file_count, const BackupOptions *options) {
+    if (root_path == NULL || files == NULL || file_count == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+    *files = NULL;
+    *file_count = 0;
+
+    Catalog *catalog = NULL;
+    BackupResult result = traverse_catalog(root_path, &catalog, options);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+
+    unsigned int count = catalog_file_count(catalog);
+    if (count > 0) {
+        *files = (FileMetadata *)malloc(count * sizeof(FileMetadata));
+        if (*files == NULL) {
+            result = BACKUP_ERROR_MEMORY;
+        } else {
+            for (unsigned int i = 0; i < count; i++) {
+                if (catalog_to_metadata(catalog, catalog_file_id(catalog, i), &(*files)[*file_count]) == BACKUP_SUCCESS) {
+                    (*file_count)++;
+                }
+            }
+        }
+    }
+
+    catalog_destroy(catalog);
+    return result;
+}
+
+// 流式目录遍历
+BackupResult traverse_directory_to(const char *root_path, Catalog *catalog, TraverseSink *sink, const BackupOptions *options) {
+    if (root_path == NULL || catalog == NULL || sink == NULL || sink->add == NULL) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    return traverse_run(root_path, catalog, sink, options);
+}
@@ -0,0 +1,209 @@
+// POSIX目录遍历实现，Windows的实现见traverse.c
+#ifndef _WIN32
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "types.h"
+#include "traverse.h"
+#include "stat_batch.h"
+#include <dirent.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 遍历根目录，所有目录都通过openat相对于根目录的文件描述符打开
+struct TraverseRoot {
+    int fd;
+};
+
+// 线程私有数据：一个目录中需要获取元数据的目录项攒成一批后统一获取
+typedef struct {
+    StatBatch *batch;
+    int count;
+    char names[STAT_BATCH_SIZE][256];
+    const char *name_pointers[STAT_BATCH_SIZE];
+    CatalogEntry stats[STAT_BATCH_SIZE];
+    int ok[STAT_BATCH_SIZE];
+} TraversePending;
+
+// 辅助函数：根据目录项类型确定文件类型，类型未知时返回0
+static FileType type_from_dirent(unsigned char d_type) {
+    switch (d_type) {
+        case DT_REG:
+            return FILE_TYPE_REGULAR;
+        case DT_DIR:
+            return FILE_TYPE_DIRECTORY;
+        case DT_LNK:
+            return FILE_TYPE_SYMLINK;
+        case DT_BLK:
+            return FILE_TYPE_BLOCK;
+        case DT_CHR:
+            return FILE_TYPE_CHARACTER;
+        case DT_SOCK:
+            return FILE_TYPE_SOCKET;
+        case DT_FIFO:
+            return FILE_TYPE_FIFO;
+        default:
+            return (FileType)0;
+    }
+}
+
+// 辅助函数：打包模块只处理普通文件和符号链接，设备、套接字和管道文件不加入列表
+static int type_is_special(FileType type) {
+    return type == FILE_TYPE_BLOCK || type == FILE_TYPE_CHARACTER ||
+           type == FILE_TYPE_SOCKET || type == FILE_TYPE_FIFO;
+}
+
+// 打开遍历根目录
+TraverseRoot *traverse_root_open(const char *root_path) {
+    TraverseRoot *root = (TraverseRoot *)malloc(sizeof(TraverseRoot));
+    if (root == NULL) {
+        return NULL;
+    }
+
+    root->fd = open(root_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (root->fd < 0) {
+        free(root);
+        return NULL;
+    }
+    return root;
+}
+
+// 关闭遍历根目录
+void traverse_root_close(TraverseRoot *root) {
+    if (root != NULL) {
+        close(root->fd);
+        free(root);
+    }
+}
+
+// 创建线程私有数据
+void *traverse_worker_data_create(TraverseRoot *root) {
+    (void)root;
+    TraversePending *pending = (TraversePending *)malloc(sizeof(TraversePending));
+    if (pending == NULL) {
+        return NULL;
+    }
+
+    pending->batch = stat_batch_create();
+    if (pending->batch == NULL) {
+        free(pending);
+        return NULL;
+    }
+    pending->count = 0;
+    for (int i = 0; i < STAT_BATCH_SIZE; i++) {
+        pending->name_pointers[i] = pending->names[i];
+    }
+    return pending;
+}
+
+// 释放线程私有数据
+void traverse_worker_data_destroy(void *data) {
+    TraversePending *pending = (TraversePending *)data;
+    if (pending != NULL) {
+        stat_batch_destroy(pending->batch);
+        free(pending);
+    }
+}
+
+// 辅助函数：批量获取已攒下的目录项的元数据，再逐个加入目录清单或待扫描队列
+static BackupResult flush_pending(TraversePending *pending, int dir_fd, TraverseWorker *worker) {
+    int count = pending->count;
+    pending->count = 0;
+    if (count == 0) {
+        return BACKUP_SUCCESS;
+    }
+
+    memset(pending->stats, 0, count * sizeof(CatalogEntry));
+    stat_batch_run(pending->batch, dir_fd, pending->name_pointers, count, pending->stats, pending->ok);
+
+    BackupResult result = BACKUP_SUCCESS;
+    for (int i = 0; i < count && result == BACKUP_SUCCESS; i++) {
+        if (!pending->ok[i]) {
+            continue;
+        }
+
+        const CatalogEntry *stat = &pending->stats[i];
+        const char *name = pending->names[i];
+
+        // 目录项类型未知的目录在获取元数据后才能识别
+        if (stat->type == FILE_TYPE_DIRECTORY) {
+            result = traverse_add_directory(worker, name);
+            continue;
+        }
+        if (type_is_special((FileType)stat->type)) {
+            continue;
+        }
+
+        // 处理符号链接
+        const char *symlink_target = NULL;
+        char target[PATH_MAX];
+        if (stat->type == FILE_TYPE_SYMLINK) {
+            ssize_t target_length = readlinkat(dir_fd, name, target, sizeof(target) - 1);
+            target[(target_length > 0) ? target_length : 0] = '\0';
+            symlink_target = target;
+        }
+
+        // 筛选后加入目录清单
+        result = traverse_add_file(worker, name, stat, symlink_target);
+    }
+    return result;
+}
+
+// 扫描一个目录
+// 先读取目录项，需要获取元数据的项攒满一批（或读完目录）后统一提交，Linux上由io_uring并发执行
+BackupResult traverse_scan_directory(TraverseRoot *root, const char *rel_path, TraverseWorker *worker, const BackupOptions *options) {
+    TraversePending *pending = (TraversePending *)traverse_worker_data(worker);
+    if (pending == NULL) {
+        return BACKUP_ERROR_MEMORY;
+    }
+
+    int fd = openat(root->fd, (rel_path[0] != '\0') ? rel_path : ".", O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        return BACKUP_SUCCESS;
+    }
+
+    DIR *dir = fdopendir(fd);
+    if (dir == NULL) {
+        close(fd);
+        return BACKUP_SUCCESS;
+    }
+
+    BackupResult result = BACKUP_SUCCESS;
+    struct dirent *entry;
+    pending->count = 0;
+    while (result == BACKUP_SUCCESS && (entry = readdir(dir)) != NULL) {
+        // 跳过当前目录和父目录
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        // 目录项类型已知时，目录和不需要的类型不必获取元数据
+        FileType type = type_from_dirent(entry->d_type);
+        if (type == FILE_TYPE_DIRECTORY) {
+            result = traverse_add_directory(worker, entry->d_name);
+            continue;
+        }
+        if (type != 0 && (type_is_special(type) || (options != NULL && !(options->file_types & type)))) {
+            continue;
+        }
+
+        // 加入批次，readdir返回的目录项在下次调用后失效，需要复制文件名
+        strcpy(pending->names[pending->count++], entry->d_name);
+        if (pending->count == STAT_BATCH_SIZE) {
+            result = flush_pending(pending, fd, worker);
+        }
+    }
+    if (result == BACKUP_SUCCESS) {
+        result = flush_pending(pending, fd, worker);
+    }
+    pending->count = 0;
+
+    closedir(dir);
+    return result;
+}
+
+#endif // _WIN32
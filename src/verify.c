@@ -0,0 +1,38 @@
+#include "verify.h"
+#include "platform.h"
+
+// 最近一次校验的统计
+static ArchiveVerifyStats last_verify_stats;
+
+// 校验主函数
+BackupResult verify_data(const VerifyOptions *options, ArchiveVerifyReport report, void *context) {
+    memset(&last_verify_stats, 0, sizeof(ArchiveVerifyStats));
+    if (options == NULL || options->backup_file[0] == 0) {
+        return BACKUP_ERROR_PARAM;
+    }
+
+    // 检查备份文件和源目录是否存在
+    int is_directory = 0;
+    if (!platform_path_exists(options->backup_file, NULL) ||
+        (options->source_path[0] != 0 && (!platform_path_exists(options->source_path, &is_directory) || !is_directory))) {
+        return BACKUP_ERROR_PATH;
+    }
+
+    // 压缩或加密的备份文件不能随机访问，archive_open返回BACKUP_ERROR_PACK
+    Archive *archive = NULL;
+    BackupResult result = archive_open(options->backup_file, &archive);
+    if (result != BACKUP_SUCCESS) {
+        return result;
+    }
+    result = archive_verify(archive, (options->source_path[0] != 0) ? options->source_path : NULL,
+                            options->threads, report, context, &last_verify_stats);
+    archive_close(archive);
+    return result;
+}
+
+// 获取最近一次校验的统计
+void verify_get_stats(ArchiveVerifyStats *stats) {
+    if (stats != NULL) {
+        *stats = last_verify_stats;
+    }
+}
@@ -0,0 +1,449 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "main.h"
+#include "archive.h"
+#include "pack.h"
+#include "platform.h"
+
+// 随机访问读取的测试：截断、篡改尾部和索引、构造的头部，archive_open必须报错而不是崩溃；
+// 指向目标目录之外的路径在解析索引时被拒绝
+#define ARCHIVE_DIRECTORY "build/test/archive"
+#define ARCHIVE_SOURCE ARCHIVE_DIRECTORY "/src"
+#define ARCHIVE_OUTPUT ARCHIVE_DIRECTORY "/out"
+#define ARCHIVE_SCRATCH ARCHIVE_DIRECTORY "/scratch"
+#define ARCHIVE_BAD_FILE ARCHIVE_DIRECTORY "/bad.dat"
+#define ARCHIVE_FLIP_ROUNDS 500
+
+static int failures = 0;
+static unsigned int random_state = 1;
+
+static unsigned int next_random(void) {
+    random_state = random_state * 1103515245u + 12345u;
+    return random_state >> 8;
+}
+
+static int write_bytes(const char *path, const void *data, size_t size) {
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return 0;
+    }
+    int ok = fwrite(data, 1, size, fp) == size;
+    return (fclose(fp) == 0) && ok;
+}
+
+static unsigned char *read_bytes(const char *path, size_t *size) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    unsigned char *data = (unsigned char *)malloc(length > 0 ? (size_t)length : 1);
+    if (data != NULL && fread(data, 1, (size_t)length, fp) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+    *size = (size_t)length;
+    return data;
+}
+
+// 以随机访问方式打开数据，打开成功时再以threads个线程提取全部文件，threads为0时只打开
+static BackupResult try_archive(const unsigned char *data, size_t size, int threads) {
+    if (!write_bytes(ARCHIVE_BAD_FILE, data, size)) {
+        printf("FAIL: cannot write %s\n", ARCHIVE_BAD_FILE);
+        failures++;
+        return BACKUP_ERROR_FILE;
+    }
+    Archive *archive = NULL;
+    BackupResult result = archive_open(ARCHIVE_BAD_FILE, &archive);
+    if (result == BACKUP_SUCCESS) {
+        if (threads > 0) {
+            result = archive_extract_all(archive, ARCHIVE_SCRATCH, threads);
+        }
+        archive_close(archive);
+    }
+    return result;
+}
+
+static void expect_error(const char *what, BackupResult result, BackupResult expected) {
+    if (result != expected) {
+        printf("FAIL: %s returned %d, expected %d\n", what, result, expected);
+        failures++;
+    }
+}
+
+// 备份一个小目录，返回备份文件的内容
+static unsigned char *make_archive(size_t *size) {
+    unsigned char data[4000];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (unsigned char)next_random();
+    }
+    platform_make_directories(ARCHIVE_SOURCE "/dir");
+    platform_make_directories(ARCHIVE_OUTPUT);
+    platform_make_directories(ARCHIVE_SCRATCH);
+    if (!write_bytes(ARCHIVE_SOURCE "/a.txt", "hello, archive\n", 15) ||
+        !write_bytes(ARCHIVE_SOURCE "/dir/b.bin", data, sizeof(data)) ||
+        !write_bytes(ARCHIVE_SOURCE "/dir/empty", "", 0) ||
+        platform_make_link(ARCHIVE_SOURCE "/a.txt", ARCHIVE_SOURCE "/dir/link") != BACKUP_SUCCESS) {
+        printf("FAIL: cannot create the source tree\n");
+        failures++;
+        return NULL;
+    }
+
+    BackupOptions options;
+    memset(&options, 0, sizeof(options));
+    snprintf(options.source_path, sizeof(options.source_path), "%s", ARCHIVE_SOURCE);
+    snprintf(options.target_path, sizeof(options.target_path), "%s", ARCHIVE_OUTPUT);
+    options.file_types = FILE_TYPE_REGULAR | FILE_TYPE_DIRECTORY;
+    options.pack_algorithm = PACK_ALGORITHM_MYPACK;
+    options.traverse_sort = 1;
+    BackupResult result = backup_data(&options);
+    if (result != BACKUP_SUCCESS) {
+        printf("FAIL: backup_data returned %d\n", result);
+        failures++;
+        return NULL;
+    }
+    return read_bytes(ARCHIVE_OUTPUT "/backup.dat", size);
+}
+
+// 截断：任何长度都不能通过archive_open
+static void test_truncated(const unsigned char *archive, size_t size) {
+    for (size_t length = 0; length < size; length++) {
+        if (try_archive(archive, length, 0) == BACKUP_SUCCESS) {
+            printf("FAIL: archive_open accepted an archive truncated to %zu of %zu bytes\n", length, size);
+            failures++;
+        }
+    }
+}
+
+// 复制备份文件并替换尾部，以随机访问方式打开
+static BackupResult try_trailer(const unsigned char *archive, size_t size, unsigned char *copy, const Pack2Trailer *trailer) {
+    memcpy(copy, archive, size);
+    memcpy(copy + size - sizeof(Pack2Trailer), trailer, sizeof(Pack2Trailer));
+    return try_archive(copy, size, 0);
+}
+
+// 复制备份文件并改写offset处的文件项
+static void patch_item(const unsigned char *archive, size_t size, unsigned char *copy, size_t offset, const Pack2Item *item) {
+    memcpy(copy, archive, size);
+    if (offset <= size && size - offset >= sizeof(Pack2Item)) {
+        memcpy(copy + offset, item, sizeof(Pack2Item));
+    }
+}
+
+// 篡改尾部和索引
+static void test_corrupt_trailer(const unsigned char *archive, size_t size) {
+    unsigned char *copy = (unsigned char *)malloc(size);
+    if (copy == NULL) {
+        printf("FAIL: out of memory\n");
+        failures++;
+        return;
+    }
+    Pack2Trailer trailer;
+    Pack2Trailer bad;
+    memcpy(&trailer, archive + size - sizeof(Pack2Trailer), sizeof(Pack2Trailer));
+
+    expect_error("intact archive", try_archive(archive, size, 1), BACKUP_SUCCESS);
+
+    bad = trailer;
+    bad.index_offset = 0xFFFFFFFFFFFFFFF0ull;
+    expect_error("wrapping index_offset", try_trailer(archive, size, copy, &bad), BACKUP_ERROR_PACK);
+
+    bad = trailer;
+    bad.index_size = 0xFFFFFFFFFFFFFFF0ull;
+    expect_error("huge index_size", try_trailer(archive, size, copy, &bad), BACKUP_ERROR_PACK);
+
+    bad = trailer;
+    bad.index_offset = trailer.index_offset - 1;
+    bad.index_size = trailer.index_size + 1;
+    expect_error("misplaced index", try_trailer(archive, size, copy, &bad), BACKUP_ERROR_PACK);
+
+    bad = trailer;
+    bad.file_count = 0xFFFFFFFFu;
+    expect_error("huge file_count", try_trailer(archive, size, copy, &bad), BACKUP_ERROR_PACK);
+
+    bad = trailer;
+    bad.file_count = trailer.file_count + 1;
+    expect_error("file_count too large", try_trailer(archive, size, copy, &bad), BACKUP_ERROR_PACK);
+
+    bad = trailer;
+    bad.file_count = trailer.file_count - 1;
+    expect_error("file_count too small", try_trailer(archive, size, copy, &bad), BACKUP_ERROR_PACK);
+
+    bad = trailer;
+    memcpy(bad.magic, "BACKIDX9", 8);
+    expect_error("bad trailer magic", try_trailer(archive, size, copy, &bad), BACKUP_ERROR_PACK);
+
+    memcpy(copy, archive, size);
+    memcpy(copy + trailer.index_offset, "XNDX", PACK2_TAG_SIZE);
+    expect_error("bad index tag", try_archive(copy, size, 0), BACKUP_ERROR_PACK);
+
+    // 索引中第一个文件项的路径长度、数据范围
+    Pack2Item first;
+    Pack2Item item;
+    size_t item_offset = trailer.index_offset + PACK2_TAG_SIZE;
+    memcpy(&first, archive + item_offset, sizeof(Pack2Item));
+
+    item = first;
+    item.path_length = 0xFFFFFFFFu;
+    patch_item(archive, size, copy, item_offset, &item);
+    expect_error("huge path_length", try_archive(copy, size, 0), BACKUP_ERROR_PACK);
+
+    item = first;
+    item.path_length = 0;
+    patch_item(archive, size, copy, item_offset, &item);
+    expect_error("empty path", try_archive(copy, size, 0), BACKUP_ERROR_PACK);
+
+    // 索引中的路径改为绝对路径或上级目录
+    size_t path_offset = item_offset + sizeof(Pack2Item);
+    memcpy(copy, archive, size);
+    copy[path_offset] = '/';
+    expect_error("absolute index path", try_archive(copy, size, 0), BACKUP_ERROR_PACK);
+    if (first.path_length >= 3) {
+        memcpy(copy, archive, size);
+        memcpy(copy + path_offset, "../", 3);
+        expect_error("parent index path", try_archive(copy, size, 0), BACKUP_ERROR_PACK);
+    }
+
+    item = first;
+    item.offset = size;
+    item.size = 1;
+    item.flags &= ~PACK2_ITEM_HARDLINK;
+    patch_item(archive, size, copy, item_offset, &item);
+    expect_error("data past the end", try_archive(copy, size, 0), BACKUP_ERROR_PACK);
+
+    free(copy);
+}
+
+// 版本1：头部的文件数量远大于文件项表；未知的版本号
+static void test_corrupt_v1_header(void) {
+    unsigned char data[sizeof(PackHeader) + sizeof(PackFileItem)];
+    PackHeader header;
+    memset(data, 0, sizeof(data));
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "BACK", 4);
+    header.version = PACK_VERSION_1;
+    header.file_count = 0xFFFFFFFFu;
+    header.header_size = sizeof(PackHeader);
+    header.data_offset = sizeof(data);
+    memcpy(data, &header, sizeof(header));
+
+    expect_error("v1 huge file_count", try_archive(data, sizeof(data), 0), BACKUP_ERROR_PACK);
+
+    header.version = 99;
+    memcpy(data, &header, sizeof(header));
+    expect_error("unknown version", try_archive(data, sizeof(data), 0), BACKUP_ERROR_PACK);
+}
+
+// 填写Tar文件头
+static void tar_header(unsigned char *header, const char *name, char type, unsigned int size, const char *link) {
+    memset(header, 0, 512);
+    snprintf((char *)header, 100, "%s", name);
+    sprintf((char *)header + 100, "%07o", 0644u);
+    sprintf((char *)header + 108, "%07o", 0u);
+    sprintf((char *)header + 116, "%07o", 0u);
+    sprintf((char *)header + 124, "%011o", size);
+    sprintf((char *)header + 136, "%011o", 0u);
+    header[156] = (unsigned char)type;
+    snprintf((char *)header + 157, 100, "%s", link);
+    memcpy(header + 257, "ustar", 6);
+    memcpy(header + 263, "00", 2);
+    unsigned int checksum = 0;
+    memset(header + 148, ' ', 8);
+    for (int i = 0; i < 512; i++) {
+        checksum += header[i];
+    }
+    sprintf((char *)header + 148, "%06o", checksum);
+}
+
+// 以还原命令的方式还原ARCHIVE_BAD_FILE（未加密、未压缩的备份文件使用随机访问读取）
+static BackupResult try_restore(void) {
+    RestoreOptions options;
+    memset(&options, 0, sizeof(options));
+    snprintf(options.backup_file, sizeof(options.backup_file), "%s", ARCHIVE_BAD_FILE);
+    snprintf(options.target_path, sizeof(options.target_path), "%s", ARCHIVE_SCRATCH);
+    return restore_data(&options);
+}
+
+// 普通文件的路径指向目标目录之外：archive_open和还原都失败，目标目录之外没有创建文件
+static void test_path_escape(void) {
+    const char *paths[] = {"../escaped.txt", "dir/../../escaped.txt", "/tmp/escaped.txt", "C:/escaped.txt"};
+    unsigned char data[4 * 512];
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+        char what[128];
+        platform_delete_file(ARCHIVE_DIRECTORY "/escaped.txt");
+        memset(data, 0, sizeof(data));
+        tar_header(data, "f", '0', 5, "");
+        memcpy(data + 512, "12345", 5);
+        tar_header(data + 1024, paths[i], '0', 5, "");
+        memcpy(data + 1536, "12345", 5);
+
+        snprintf(what, sizeof(what), "tar entry \"%s\"", paths[i]);
+        expect_error(what, try_archive(data, sizeof(data), 1), BACKUP_ERROR_PACK);
+        snprintf(what, sizeof(what), "restore of tar entry \"%s\"", paths[i]);
+        expect_error(what, try_restore(), BACKUP_ERROR_PACK);
+        if (platform_path_exists(ARCHIVE_DIRECTORY "/escaped.txt", NULL)) {
+            printf("FAIL: \"%s\" was written outside the target directory\n", paths[i]);
+            failures++;
+        }
+    }
+}
+
+// 硬链接只能链接到索引中的其他文件
+static void test_tar_hardlink(void) {
+    const char *targets[] = {"/etc/hostname", "../x", "dir/../../x", "missing"};
+    unsigned char data[4 * 512];
+    for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+        memset(data, 0, sizeof(data));
+        tar_header(data, "f", '0', 5, "");
+        memcpy(data + 512, "12345", 5);
+        tar_header(data + 1024, "evil", '1', 0, targets[i]);
+
+        char what[128];
+        snprintf(what, sizeof(what), "tar hard link to \"%s\"", targets[i]);
+        expect_error(what, try_archive(data, sizeof(data), 1), BACKUP_ERROR_PACK);
+    }
+
+    // 链接到已提取的文件是允许的
+    memset(data, 0, sizeof(data));
+    tar_header(data, "f", '0', 5, "");
+    memcpy(data + 512, "12345", 5);
+    tar_header(data + 1024, "good", '1', 0, "f");
+    expect_error("tar hard link to \"f\"", try_archive(data, sizeof(data), 1), BACKUP_SUCCESS);
+}
+
+// GNU长名称记录（类型'L'）给出的超过100字节的路径，读完整之后与普通路径同样检查
+static void test_long_name_escape(void) {
+    char name[200];
+    unsigned char data[6 * 512];
+    const char *prefixes[] = {"../", "/tmp/", "dir/../../", ""};
+    for (size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); i++) {
+        snprintf(name, sizeof(name), "%s%0120d/escaped.txt", prefixes[i], 0);
+        platform_delete_file(ARCHIVE_DIRECTORY "/escaped.txt");
+        memset(data, 0, sizeof(data));
+        tar_header(data, "././@LongLink", 'L', (unsigned int)strlen(name) + 1, "");
+        memcpy(data + 512, name, strlen(name));
+        tar_header(data + 1024, "truncated", '0', 5, "");
+        memcpy(data + 1536, "12345", 5);
+        size_t size = sizeof(data);
+
+        char what[256];
+        snprintf(what, sizeof(what), "tar long name \"%s\"", name);
+        expect_error(what, try_archive(data, size, 1), (prefixes[i][0] != '\0') ? BACKUP_ERROR_PACK : BACKUP_SUCCESS);
+        if (platform_path_exists(ARCHIVE_DIRECTORY "/escaped.txt", NULL)) {
+            printf("FAIL: \"%s\" was written outside the target directory\n", name);
+            failures++;
+        }
+    }
+}
+
+// 多个线程并行提取：许多普通文件中夹着一个指向目标目录之外的文件，整个备份文件被拒绝，
+// 没有文件写到目标目录之外；去掉这个文件后并行提取成功
+static void test_parallel_escape(void) {
+    unsigned char data[34 * 512];
+    for (int evil = 1; evil >= 0; evil--) {
+        memset(data, 0, sizeof(data));
+        for (int i = 0; i < 16; i++) {
+            char name[64];
+            if (evil && i == 11) {
+                snprintf(name, sizeof(name), "../escaped.txt");
+            } else {
+                snprintf(name, sizeof(name), "parallel/file%02d.txt", i);
+            }
+            tar_header(data + i * 1024, name, '0', 5, "");
+            memcpy(data + i * 1024 + 512, "12345", 5);
+        }
+        platform_delete_file(ARCHIVE_DIRECTORY "/escaped.txt");
+        expect_error(evil ? "parallel extraction with an escaping entry" : "parallel extraction",
+                     try_archive(data, sizeof(data), 4), evil ? BACKUP_ERROR_PACK : BACKUP_SUCCESS);
+        if (platform_path_exists(ARCHIVE_DIRECTORY "/escaped.txt", NULL)) {
+            printf("FAIL: parallel extraction wrote outside the target directory\n");
+            failures++;
+        }
+    }
+}
+
+// 选择性提取：要提取的路径只用来在索引中查找，不会成为输出路径
+static void test_select_escape(void) {
+    const char *escape[] = {"../escaped.txt"};
+    const char *inside[] = {"a.txt"};
+    Archive *archive = NULL;
+    platform_delete_file(ARCHIVE_DIRECTORY "/escaped.txt");
+    BackupResult result = archive_open(ARCHIVE_OUTPUT "/backup.dat", &archive);
+    if (result != BACKUP_SUCCESS) {
+        expect_error("archive_open", result, BACKUP_SUCCESS);
+        return;
+    }
+    expect_error("extract \"../escaped.txt\"", archive_extract_paths(archive, escape, 1, ARCHIVE_SCRATCH, 2), BACKUP_ERROR_PATH);
+    expect_error("extract \"a.txt\"", archive_extract_paths(archive, inside, 1, ARCHIVE_SCRATCH, 2), BACKUP_SUCCESS);
+    archive_close(archive);
+
+    // 备份文件中有指向目标目录之外的文件时，选择它还原同样失败
+    unsigned char data[4 * 512];
+    memset(data, 0, sizeof(data));
+    tar_header(data, "../escaped.txt", '0', 5, "");
+    memcpy(data + 512, "12345", 5);
+    write_bytes(ARCHIVE_BAD_FILE, data, sizeof(data));
+    RestoreOptions options;
+    memset(&options, 0, sizeof(options));
+    snprintf(options.backup_file, sizeof(options.backup_file), "%s", ARCHIVE_BAD_FILE);
+    snprintf(options.target_path, sizeof(options.target_path), "%s", ARCHIVE_SCRATCH);
+    options.paths[0] = escape[0];
+    options.path_count = 1;
+    expect_error("restore of selected \"../escaped.txt\"", restore_data(&options), BACKUP_ERROR_PACK);
+
+    if (platform_path_exists(ARCHIVE_DIRECTORY "/escaped.txt", NULL)) {
+        printf("FAIL: selective extraction wrote outside the target directory\n");
+        failures++;
+    }
+}
+
+// 随机改写若干字节：结果可以是成功或错误，但不能崩溃（配合AddressSanitizer运行）
+static void test_random_flips(const unsigned char *archive, size_t size) {
+    unsigned char *copy = (unsigned char *)malloc(size);
+    if (copy == NULL) {
+        printf("FAIL: out of memory\n");
+        failures++;
+        return;
+    }
+    for (int round = 0; round < ARCHIVE_FLIP_ROUNDS; round++) {
+        memcpy(copy, archive, size);
+        int flips = 1 + (int)(next_random() % 4);
+        for (int i = 0; i < flips; i++) {
+            copy[next_random() % size] ^= (unsigned char)(1 + next_random() % 255);
+        }
+        try_archive(copy, size, 1);
+    }
+    free(copy);
+}
+
+int main() {
+    size_t size = 0;
+    unsigned char *archive = make_archive(&size);
+    if (archive == NULL || size < sizeof(Pack2Signature) + sizeof(Pack2Trailer)) {
+        printf("test_archive: cannot create the test archive\n");
+        free(archive);
+        return 1;
+    }
+
+    test_corrupt_trailer(archive, size);
+    test_truncated(archive, size);
+    test_corrupt_v1_header();
+    test_path_escape();
+    test_tar_hardlink();
+    test_long_name_escape();
+    test_parallel_escape();
+    test_select_escape();
+    test_random_flips(archive, size);
+    free(archive);
+
+    if (failures > 0) {
+        printf("test_archive: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("test_archive: OK\n");
+    return 0;
+}
@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "main.h"
+#include "backup.h"
+#include "platform.h"
+
+// 去重备份的测试：备份后还原与源文件相同，内容没有变化时再次备份不保存新的块；
+// 增量备份只读取变化了的文件
+#define DEDUP_DIRECTORY "build/test/dedup"
+#define DEDUP_SOURCE DEDUP_DIRECTORY "/src"
+#define DEDUP_TARGET DEDUP_DIRECTORY "/repo"
+#define DEDUP_RESTORE DEDUP_DIRECTORY "/restore"
+
+static int failures = 0;
+
+// 源目录中的文件（相对路径），还原后逐一比较
+static const char *source_files[] = {
+    "small.txt",
+    "big.bin",
+    "dir/text.txt",
+    "dir/hard"
+};
+#define SOURCE_FILE_COUNT (sizeof(source_files) / sizeof(source_files[0]))
+
+static int write_bytes(const char *path, const void *data, size_t size) {
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return 0;
+    }
+    int ok = fwrite(data, 1, size, fp) == size;
+    return (fclose(fp) == 0) && ok;
+}
+
+static unsigned char *read_bytes(const char *path, size_t *size) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    unsigned char *data = (unsigned char *)malloc(length > 0 ? (size_t)length : 1);
+    if (data != NULL && fread(data, 1, (size_t)length, fp) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+    *size = (size_t)length;
+    return data;
+}
+
+// 创建源目录：几个块大小的随机数据、小文件和硬链接
+static int make_source(void) {
+    size_t big_size = 512 * 1024;
+    unsigned char *big = (unsigned char *)malloc(big_size);
+    if (big == NULL) {
+        return 0;
+    }
+    unsigned int seed = 11;
+    for (size_t i = 0; i < big_size; i++) {
+        seed = seed * 1103515245u + 12345u;
+        big[i] = (unsigned char)(seed >> 16);
+    }
+
+    platform_make_directories(DEDUP_SOURCE "/dir");
+    platform_make_directories(DEDUP_TARGET);
+    platform_delete_file(DEDUP_TARGET "/backup.dat");
+    platform_delete_file(DEDUP_TARGET "/" CHUNK_STORE_DATA_NAME);
+    platform_delete_file(DEDUP_TARGET "/" CHUNK_STORE_INDEX_NAME);
+    int ok = write_bytes(DEDUP_SOURCE "/small.txt", "small file\n", 11) &&
+             write_bytes(DEDUP_SOURCE "/big.bin", big, big_size) &&
+             write_bytes(DEDUP_SOURCE "/dir/text.txt", "some text\n", 10) &&
+             platform_make_link(DEDUP_SOURCE "/small.txt", DEDUP_SOURCE "/dir/hard") == BACKUP_SUCCESS;
+    free(big);
+    return ok;
+}
+
+// 比较还原目录与源目录中的各文件
+static void compare_tree(const char *what) {
+    for (size_t i = 0; i < SOURCE_FILE_COUNT; i++) {
+        char source_path[512];
+        char restore_path[512];
+        snprintf(source_path, sizeof(source_path), "%s/%s", DEDUP_SOURCE, source_files[i]);
+        snprintf(restore_path, sizeof(restore_path), "%s/%s", DEDUP_RESTORE, source_files[i]);
+
+        size_t source_size = 0;
+        size_t restore_size = 0;
+        unsigned char *source = read_bytes(source_path, &source_size);
+        unsigned char *restored = read_bytes(restore_path, &restore_size);
+        if (source == NULL || restored == NULL) {
+            printf("FAIL: %s: cannot read %s\n", what, (source == NULL) ? source_path : restore_path);
+            failures++;
+        } else if (source_size != restore_size || memcmp(source, restored, source_size) != 0) {
+            printf("FAIL: %s: %s differs after restore\n", what, source_files[i]);
+            failures++;
+        }
+        free(source);
+        free(restored);
+    }
+}
+
+// 去重备份、还原并比较，返回本次备份的分块存储统计
+static int round_trip(const char *what, int incremental, ChunkStoreStats *stats) {
+    BackupOptions options;
+    memset(&options, 0, sizeof(options));
+    snprintf(options.source_path, sizeof(options.source_path), "%s", DEDUP_SOURCE);
+    snprintf(options.target_path, sizeof(options.target_path), "%s", DEDUP_TARGET);
+    options.file_types = FILE_TYPE_REGULAR | FILE_TYPE_DIRECTORY;
+    options.pack_algorithm = PACK_ALGORITHM_MYPACK;
+    options.dedup = 1;
+    options.incremental = incremental;
+
+    BackupResult result = backup_data(&options);
+    if (result != BACKUP_SUCCESS) {
+        printf("FAIL: %s: backup_data returned %d\n", what, result);
+        failures++;
+        return 0;
+    }
+    backup_get_chunk_stats(stats);
+
+    RestoreOptions restore;
+    memset(&restore, 0, sizeof(restore));
+    snprintf(restore.backup_file, sizeof(restore.backup_file), "%s/backup.dat", DEDUP_TARGET);
+    snprintf(restore.target_path, sizeof(restore.target_path), "%s", DEDUP_RESTORE);
+    result = restore_data(&restore);
+    if (result != BACKUP_SUCCESS) {
+        printf("FAIL: %s: restore_data returned %d\n", what, result);
+        failures++;
+        return 0;
+    }
+    compare_tree(what);
+    return 1;
+}
+
+// 第一次备份保存全部块，内容不变时再次备份没有新的块
+static void test_dedup(void) {
+    ChunkStoreStats stats;
+    if (!round_trip("dedup", 0, &stats)) {
+        return;
+    }
+    if (stats.new_chunks == 0 || stats.new_chunks != stats.stored_chunks) {
+        printf("FAIL: first dedup backup stored %llu of %llu chunks\n", stats.new_chunks, stats.stored_chunks);
+        failures++;
+    }
+    unsigned long long stored = stats.stored_chunks;
+    if (!round_trip("dedup again", 0, &stats)) {
+        return;
+    }
+    if (stats.new_chunks != 0 || stats.stored_chunks != stored) {
+        printf("FAIL: unchanged dedup backup stored %llu new chunks\n", stats.new_chunks);
+        failures++;
+    }
+}
+
+// 修改一个文件后增量备份：只有这个文件被重新分块，其他文件沿用上一次的块引用
+static void test_incremental(void) {
+    const char *changed = "changed for the incremental backup\n";
+    if (!write_bytes(DEDUP_SOURCE "/dir/text.txt", changed, strlen(changed))) {
+        printf("FAIL: cannot modify the source tree\n");
+        failures++;
+        return;
+    }
+    ChunkStoreStats stats;
+    if (!round_trip("incremental", 1, &stats)) {
+        return;
+    }
+    if (stats.bytes != strlen(changed)) {
+        printf("FAIL: incremental backup chunked %llu bytes, expected %zu\n", stats.bytes, strlen(changed));
+        failures++;
+    }
+}
+
+int main() {
+    if (!make_source()) {
+        printf("test_dedup: cannot create the source tree\n");
+        return 1;
+    }
+
+    test_dedup();
+    test_incremental();
+
+    if (failures > 0) {
+        printf("test_dedup: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("test_dedup: OK\n");
+    return 0;
+}
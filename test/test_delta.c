@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "chunk_store.h"
+#include "platform.h"
+
+// 差异块的测试：编码后从块数据文件读回与原数据相同，损坏的编码被拒绝
+#define DELTA_DIRECTORY "build/test/delta"
+#define DELTA_DATA_SIZE (64 * 1024)
+
+static int failures = 0;
+
+static void fill_random(unsigned char *data, size_t size, unsigned int seed) {
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = (unsigned char)(seed >> 16);
+    }
+}
+
+static void check_result(const char *what, BackupResult result, BackupResult expected) {
+    if (result != expected) {
+        printf("FAIL: %s returned %d, expected %d\n", what, result, expected);
+        failures++;
+    }
+}
+
+// 写入基准块和修改过的块，修改过的块应保存为差异块，读回后与原数据相同
+static void test_delta_round_trip(void) {
+    unsigned char *base = (unsigned char *)malloc(DELTA_DATA_SIZE);
+    unsigned char *changed = (unsigned char *)malloc(DELTA_DATA_SIZE);
+    unsigned char *buffer = (unsigned char *)malloc(CHUNK_READ_BUFFER_SIZE);
+    if (base == NULL || changed == NULL || buffer == NULL) {
+        printf("FAIL: out of memory\n");
+        failures++;
+        goto cleanup;
+    }
+    fill_random(base, DELTA_DATA_SIZE, 1);
+    memcpy(changed, base, DELTA_DATA_SIZE);
+    // 修改几处，其中一处插入数据使后面的内容整体移动
+    memset(changed + 100, 0xAA, 50);
+    memmove(changed + 30000 + 7, changed + 30000, DELTA_DATA_SIZE - 30000 - 7);
+    memcpy(changed + 30000, "INSERT!", 7);
+    changed[DELTA_DATA_SIZE - 1] ^= 0xFF;
+
+    platform_make_directories(DELTA_DIRECTORY);
+    platform_delete_file(DELTA_DIRECTORY "/" CHUNK_STORE_DATA_NAME);
+    platform_delete_file(DELTA_DIRECTORY "/" CHUNK_STORE_INDEX_NAME);
+
+    ChunkStore *store = NULL;
+    ChunkRef base_ref;
+    ChunkRef changed_ref;
+    check_result("chunk_store_open", chunk_store_open(DELTA_DIRECTORY, &store), BACKUP_SUCCESS);
+    if (store == NULL) {
+        goto cleanup;
+    }
+    check_result("chunk_store_put(base)", chunk_store_put(store, base, DELTA_DATA_SIZE, NULL, &base_ref), BACKUP_SUCCESS);
+    check_result("chunk_store_close", chunk_store_close(store), BACKUP_SUCCESS);
+
+    // 基准块只能是上一次备份保存的块，重新打开后再写入修改过的块
+    store = NULL;
+    check_result("chunk_store_open", chunk_store_open(DELTA_DIRECTORY, &store), BACKUP_SUCCESS);
+    if (store == NULL) {
+        goto cleanup;
+    }
+    check_result("chunk_store_put(changed)", chunk_store_put(store, changed, DELTA_DATA_SIZE, &base_ref, &changed_ref), BACKUP_SUCCESS);
+    check_result("chunk_store_close", chunk_store_close(store), BACKUP_SUCCESS);
+    if (failures > 0) {
+        goto cleanup;
+    }
+    if (base_ref.delta_length != 0 || changed_ref.delta_length == 0 || changed_ref.delta_length > DELTA_DATA_SIZE / 2) {
+        printf("FAIL: expected a delta chunk, got delta_length %u (base %u)\n", changed_ref.delta_length, base_ref.delta_length);
+        failures++;
+        goto cleanup;
+    }
+
+    FILE *data = fopen(DELTA_DIRECTORY "/" CHUNK_STORE_DATA_NAME, "rb");
+    if (data == NULL) {
+        printf("FAIL: cannot open %s\n", CHUNK_STORE_DATA_NAME);
+        failures++;
+        goto cleanup;
+    }
+    check_result("chunk_read(base)", chunk_read(data, &base_ref, buffer), BACKUP_SUCCESS);
+    if (memcmp(buffer, base, DELTA_DATA_SIZE) != 0) {
+        printf("FAIL: base chunk differs after chunk_read\n");
+        failures++;
+    }
+    check_result("chunk_read(delta)", chunk_read(data, &changed_ref, buffer), BACKUP_SUCCESS);
+    if (memcmp(buffer, changed, DELTA_DATA_SIZE) != 0) {
+        printf("FAIL: delta chunk differs after chunk_read\n");
+        failures++;
+    }
+
+    // 差异编码的长度被篡改时读取失败
+    ChunkRef damaged = changed_ref;
+    damaged.delta_length = (unsigned int)sizeof(ChunkDeltaHeader) - 1;
+    check_result("chunk_read(short delta)", chunk_read(data, &damaged, buffer), BACKUP_ERROR_PACK);
+    fclose(data);
+
+cleanup:
+    free(base);
+    free(changed);
+    free(buffer);
+}
+
+// 直接构造编码：正确的编码能还原，越界的指令和不完整的编码返回BACKUP_ERROR_PACK
+static void test_delta_apply(void) {
+    unsigned char base[16];
+    unsigned char output[16];
+    unsigned char delta[sizeof(ChunkDeltaHeader) + 2 * sizeof(ChunkDeltaOp) + 4];
+    for (int i = 0; i < 16; i++) {
+        base[i] = (unsigned char)('a' + i);
+    }
+
+    ChunkDeltaHeader header;
+    memset(&header, 0, sizeof(header));
+    header.base_length = sizeof(base);
+    header.op_count = 2;
+    ChunkDeltaOp ops[2];
+    ops[0].base_offset = 4;
+    ops[0].length = 8;
+    ops[1].base_offset = CHUNK_DELTA_LITERAL;
+    ops[1].length = 4;
+    memcpy(delta, &header, sizeof(header));
+    memcpy(delta + sizeof(header), ops, sizeof(ops));
+    memcpy(delta + sizeof(header) + sizeof(ops), "WXYZ", 4);
+
+    check_result("chunk_delta_apply", chunk_delta_apply(delta, sizeof(delta), base, sizeof(base), output, 12), BACKUP_SUCCESS);
+    if (memcmp(output, "efghijklWXYZ", 12) != 0) {
+        printf("FAIL: chunk_delta_apply produced wrong data\n");
+        failures++;
+    }
+
+    // 缺少新数据、缺少指令、缺少头部
+    check_result("truncated literal", chunk_delta_apply(delta, sizeof(delta) - 1, base, sizeof(base), output, 12), BACKUP_ERROR_PACK);
+    check_result("truncated ops", chunk_delta_apply(delta, sizeof(header) + sizeof(ChunkDeltaOp), base, sizeof(base), output, 12), BACKUP_ERROR_PACK);
+    check_result("truncated header", chunk_delta_apply(delta, sizeof(header) - 1, base, sizeof(base), output, 12), BACKUP_ERROR_PACK);
+    // 还原后的长度与编码不符
+    check_result("length mismatch", chunk_delta_apply(delta, sizeof(delta), base, sizeof(base), output, 11), BACKUP_ERROR_PACK);
+    check_result("length mismatch", chunk_delta_apply(delta, sizeof(delta), base, sizeof(base), output, 13), BACKUP_ERROR_PACK);
+
+    // 复制指令超出基准块
+    ops[0].base_offset = 12;
+    memcpy(delta + sizeof(header), ops, sizeof(ops));
+    check_result("copy past base", chunk_delta_apply(delta, sizeof(delta), base, sizeof(base), output, 12), BACKUP_ERROR_PACK);
+    ops[0].base_offset = 0xFFFFFFF0u;
+    memcpy(delta + sizeof(header), ops, sizeof(ops));
+    check_result("copy offset overflow", chunk_delta_apply(delta, sizeof(delta), base, sizeof(base), output, 12), BACKUP_ERROR_PACK);
+
+    // 指令条数超出编码长度
+    header.op_count = 0x7FFFFFFFu;
+    memcpy(delta, &header, sizeof(header));
+    check_result("huge op_count", chunk_delta_apply(delta, sizeof(delta), base, sizeof(base), output, 12), BACKUP_ERROR_PACK);
+}
+
+int main() {
+    test_delta_round_trip();
+    test_delta_apply();
+
+    if (failures > 0) {
+        printf("test_delta: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("test_delta: OK\n");
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "filter.h"
+
+// 通配符匹配和包含模式筛选的测试
+static int failures = 0;
+
+static void check_glob(const char *pattern, const char *text, int expected) {
+    int matched = filter_match_glob(pattern, text);
+    if (matched != expected) {
+        printf("FAIL: filter_match_glob(\"%s\", \"%s\") = %d, expected %d\n", pattern, text, matched, expected);
+        failures++;
+    }
+}
+
+int main() {
+    // 普通字符和'?'
+    check_glob("a.txt", "a.txt", 1);
+    check_glob("a.txt", "a.txt2", 0);
+    check_glob("a.tx", "a.txt", 0);
+    check_glob("", "", 1);
+    check_glob("", "a", 0);
+    check_glob("?.txt", "a.txt", 1);
+    check_glob("?.txt", ".txt", 0);
+    check_glob("a?b", "a/b", 0);
+    check_glob("a?b", "a\\b", 0);
+
+    // '*'不跨越分隔符
+    check_glob("*", "", 1);
+    check_glob("*", "abc", 1);
+    check_glob("*.c", "main.c", 1);
+    check_glob("*.c", "src/main.c", 0);
+    check_glob("src/*.c", "src/main.c", 1);
+    check_glob("src/*.c", "src/sub/main.c", 0);
+    check_glob("*a*b", "xxaxxb", 1);
+    check_glob("*a*b", "xxaxxbx", 0);
+    check_glob("a*", "a/b", 0);
+
+    // '**'跨越任意多级目录，"**/"可以匹配空
+    check_glob("**", "", 1);
+    check_glob("**", "a/b/c", 1);
+    check_glob("**/*.c", "main.c", 1);
+    check_glob("**/*.c", "src/main.c", 1);
+    check_glob("**/*.c", "src/a/b/main.c", 1);
+    check_glob("**/*.c", "src/main.h", 0);
+    check_glob("src/**/x", "src/x", 1);
+    check_glob("src/**/x", "src/a/b/x", 1);
+    check_glob("src/**/x", "srcx", 0);
+    check_glob("src/**", "src/a/b", 1);
+    check_glob("src/**", "other/a", 0);
+    check_glob("a**b", "a/x/b", 1);
+
+    // '/'和'\\'都是分隔符，可以互相匹配
+    check_glob("src/*.c", "src\\main.c", 1);
+    check_glob("src\\*.c", "src/main.c", 1);
+    check_glob("**\\*.c", "a/b\\c.c", 1);
+    check_glob("src/*.c", "src-main.c", 0);
+
+    // 包含模式：含分隔符的模式与相对路径匹配，否则与文件名匹配
+    const char *patterns[] = {"*.log", "docs/**"};
+    if (!filter_by_include("a.log", "x/y/a.log", patterns, 2) ||
+        !filter_by_include("readme", "docs/en/readme", patterns, 2) ||
+        filter_by_include("readme", "src/readme", patterns, 2) ||
+        !filter_by_include("any", "any", patterns, 0)) {
+        printf("FAIL: filter_by_include\n");
+        failures++;
+    }
+
+    if (failures > 0) {
+        printf("test_glob: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("test_glob: OK\n");
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ring.h"
+#include "thread.h"
+
+// 环形队列的测试：单线程时的回绕和顺序、两个线程之间大量元素的传递、关闭和中止
+static int failures = 0;
+
+#define PRODUCER_COUNT 1000000u
+
+typedef struct {
+    RingBuffer *ring;
+    unsigned int count;
+} ProducerArgs;
+
+static void producer_run(void *arg) {
+    ProducerArgs *args = (ProducerArgs *)arg;
+    for (unsigned int i = 0; i < args->count; i++) {
+        unsigned int *slot = (unsigned int *)ring_acquire(args->ring);
+        if (slot == NULL) {
+            return;
+        }
+        *slot = i;
+        ring_publish(args->ring);
+    }
+    ring_close(args->ring);
+}
+
+// 单线程：容量向上取整为2的幂，反复填满、取空使位置多次回绕，元素按发布顺序取出
+static void test_wrap_single_thread(void) {
+    RingBuffer *ring = ring_create(3, sizeof(unsigned int));
+    if (ring == NULL) {
+        printf("FAIL: ring_create\n");
+        failures++;
+        return;
+    }
+
+    unsigned int next_in = 0;
+    unsigned int next_out = 0;
+    for (int round = 0; round < 1000; round++) {
+        // 每轮放入1到4个元素，使读写位置落在槽位的不同位置
+        unsigned int batch = (unsigned int)(round % 4) + 1;
+        for (unsigned int i = 0; i < batch; i++) {
+            unsigned int *slot = (unsigned int *)ring_acquire(ring);
+            *slot = next_in++;
+            ring_publish(ring);
+        }
+        if (ring_depth(ring) != batch) {
+            printf("FAIL: depth %u after publishing %u\n", ring_depth(ring), batch);
+            failures++;
+        }
+        for (unsigned int i = 0; i < batch; i++) {
+            const unsigned int *slot = (const unsigned int *)ring_peek(ring);
+            if (slot == NULL || *slot != next_out) {
+                printf("FAIL: expected %u, got %s%u\n", next_out, (slot == NULL) ? "NULL " : "", (slot != NULL) ? *slot : 0);
+                failures++;
+                ring_destroy(ring);
+                return;
+            }
+            next_out++;
+            ring_release(ring);
+        }
+    }
+
+    RingStats stats;
+    ring_get_stats(ring, &stats);
+    if (stats.capacity != 4 || stats.pushed != next_in || stats.max_depth != 4) {
+        printf("FAIL: stats capacity %u pushed %llu max_depth %u\n", stats.capacity, stats.pushed, stats.max_depth);
+        failures++;
+    }
+
+    // 关闭后取完剩余元素得到NULL
+    unsigned int *slot = (unsigned int *)ring_acquire(ring);
+    *slot = 42;
+    ring_publish(ring);
+    ring_close(ring);
+    const unsigned int *last = (const unsigned int *)ring_peek(ring);
+    if (last == NULL || *last != 42) {
+        printf("FAIL: element published before close was lost\n");
+        failures++;
+    } else {
+        ring_release(ring);
+    }
+    if (ring_peek(ring) != NULL || ring_aborted(ring)) {
+        printf("FAIL: closed ring should return NULL without being aborted\n");
+        failures++;
+    }
+    ring_destroy(ring);
+}
+
+// 两个线程：小容量的队列中传递大量元素，消费者看到的序列必须完整且有序
+static void test_two_threads(void) {
+    ProducerArgs args;
+    args.ring = ring_create(8, sizeof(unsigned int));
+    args.count = PRODUCER_COUNT;
+    if (args.ring == NULL) {
+        printf("FAIL: ring_create\n");
+        failures++;
+        return;
+    }
+
+    Thread thread;
+    if (thread_create(&thread, producer_run, &args) != BACKUP_SUCCESS) {
+        printf("FAIL: thread_create\n");
+        failures++;
+        ring_destroy(args.ring);
+        return;
+    }
+
+    unsigned int expected = 0;
+    const unsigned int *slot;
+    while ((slot = (const unsigned int *)ring_peek(args.ring)) != NULL) {
+        if (*slot != expected) {
+            printf("FAIL: expected %u, got %u\n", expected, *slot);
+            failures++;
+            ring_abort(args.ring);
+            break;
+        }
+        expected++;
+        ring_release(args.ring);
+    }
+    thread_join(&thread);
+    if (expected != PRODUCER_COUNT && failures == 0) {
+        printf("FAIL: received %u of %u elements\n", expected, PRODUCER_COUNT);
+        failures++;
+    }
+    ring_destroy(args.ring);
+}
+
+// 中止：双方都得到NULL，队列中剩余的元素被丢弃
+static void test_abort(void) {
+    RingBuffer *ring = ring_create(2, sizeof(unsigned int));
+    unsigned int *slot = (unsigned int *)ring_acquire(ring);
+    *slot = 1;
+    ring_publish(ring);
+    ring_abort(ring);
+    if (!ring_aborted(ring) || ring_acquire(ring) != NULL || ring_peek(ring) != NULL) {
+        printf("FAIL: aborted ring should return NULL to both sides\n");
+        failures++;
+    }
+    ring_destroy(ring);
+}
+
+int main() {
+    test_wrap_single_thread();
+    test_two_threads();
+    test_abort();
+
+    if (failures > 0) {
+        printf("test_ring: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("test_ring: OK\n");
+    return 0;
+}
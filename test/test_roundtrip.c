@@ -0,0 +1,253 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "main.h"
+#include "platform.h"
+
+// 备份后还原的测试：每种打包格式、压缩算法和加密算法的组合，还原后的文件与源文件完全相同；
+// 普通文件的路径指向目标目录之外的备份文件，无论直接提取还是经过解包处理链都不能还原
+#define ROUNDTRIP_DIRECTORY "build/test/roundtrip"
+#define ROUNDTRIP_SOURCE ROUNDTRIP_DIRECTORY "/src"
+#define ROUNDTRIP_KEY "roundtrip-key-0123"
+#define ROUNDTRIP_ESCAPE ROUNDTRIP_DIRECTORY "/escape"
+#define ROUNDTRIP_LONG_DIR "a_directory_name_that_is_rather_long_0123456789/another_directory_name_that_is_long_too_0123456789"
+
+static int failures = 0;
+
+// 源目录中的文件（相对路径），还原后逐一比较
+static const char *source_files[] = {
+    "small.txt",
+    "empty",
+    "big.bin",
+    "text/compressible.txt",
+    "text/hard",
+    ROUNDTRIP_LONG_DIR "/file_with_a_long_name.txt"
+};
+#define SOURCE_FILE_COUNT (sizeof(source_files) / sizeof(source_files[0]))
+
+static int write_bytes(const char *path, const void *data, size_t size) {
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return 0;
+    }
+    int ok = fwrite(data, 1, size, fp) == size;
+    return (fclose(fp) == 0) && ok;
+}
+
+static unsigned char *read_bytes(const char *path, size_t *size) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    unsigned char *data = (unsigned char *)malloc(length > 0 ? (size_t)length : 1);
+    if (data != NULL && fread(data, 1, (size_t)length, fp) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+    *size = (size_t)length;
+    return data;
+}
+
+// 创建源目录：小文件、空文件、超过零拷贝阈值的文件、容易压缩的文件、硬链接和超过100字节的路径
+static int make_source(void) {
+    size_t big_size = 300 * 1024;
+    unsigned char *big = (unsigned char *)malloc(big_size);
+    char *text = (char *)malloc(100 * 1024);
+    if (big == NULL || text == NULL) {
+        free(big);
+        free(text);
+        return 0;
+    }
+    unsigned int seed = 7;
+    for (size_t i = 0; i < big_size; i++) {
+        seed = seed * 1103515245u + 12345u;
+        big[i] = (unsigned char)(seed >> 16);
+    }
+    size_t text_size = 0;
+    for (int line = 0; text_size + 64 < 100 * 1024; line++) {
+        text_size += (size_t)sprintf(text + text_size, "line %d: the quick brown fox jumps over the lazy dog\n", line);
+    }
+
+    platform_make_directories(ROUNDTRIP_SOURCE "/text");
+    platform_make_directories(ROUNDTRIP_SOURCE "/" ROUNDTRIP_LONG_DIR);
+    int ok = write_bytes(ROUNDTRIP_SOURCE "/small.txt", "small file\n", 11) &&
+             write_bytes(ROUNDTRIP_SOURCE "/empty", "", 0) &&
+             write_bytes(ROUNDTRIP_SOURCE "/big.bin", big, big_size) &&
+             write_bytes(ROUNDTRIP_SOURCE "/text/compressible.txt", text, text_size) &&
+             write_bytes(ROUNDTRIP_SOURCE "/" ROUNDTRIP_LONG_DIR "/file_with_a_long_name.txt", "long path\n", 10) &&
+             platform_make_link(ROUNDTRIP_SOURCE "/small.txt", ROUNDTRIP_SOURCE "/text/hard") == BACKUP_SUCCESS;
+    free(big);
+    free(text);
+    return ok;
+}
+
+// 比较还原目录与源目录中的各文件
+static void compare_tree(const char *what, const char *restore_dir) {
+    for (size_t i = 0; i < SOURCE_FILE_COUNT; i++) {
+        char source_path[512];
+        char restore_path[1024];
+        snprintf(source_path, sizeof(source_path), "%s/%s", ROUNDTRIP_SOURCE, source_files[i]);
+        snprintf(restore_path, sizeof(restore_path), "%s/%s", restore_dir, source_files[i]);
+
+        size_t source_size = 0;
+        size_t restore_size = 0;
+        unsigned char *source = read_bytes(source_path, &source_size);
+        unsigned char *restored = read_bytes(restore_path, &restore_size);
+        if (source == NULL || restored == NULL) {
+            printf("FAIL: %s: cannot read %s\n", what, (source == NULL) ? source_path : restore_path);
+            failures++;
+        } else if (source_size != restore_size || memcmp(source, restored, source_size) != 0) {
+            printf("FAIL: %s: %s differs after restore\n", what, source_files[i]);
+            failures++;
+        }
+        free(source);
+        free(restored);
+    }
+}
+
+static void init_backup_options(BackupOptions *options, const char *target) {
+    memset(options, 0, sizeof(BackupOptions));
+    snprintf(options->source_path, sizeof(options->source_path), "%s", ROUNDTRIP_SOURCE);
+    snprintf(options->target_path, sizeof(options->target_path), "%s", target);
+    options->file_types = FILE_TYPE_REGULAR | FILE_TYPE_DIRECTORY;
+}
+
+static BackupResult restore_to(const char *backup_file, const char *target, const BackupOptions *backup) {
+    RestoreOptions options;
+    memset(&options, 0, sizeof(options));
+    snprintf(options.backup_file, sizeof(options.backup_file), "%s", backup_file);
+    snprintf(options.target_path, sizeof(options.target_path), "%s", target);
+    options.encrypt_enable = backup->encrypt_enable;
+    options.encrypt_algorithm = backup->encrypt_algorithm;
+    memcpy(options.encrypt_key, backup->encrypt_key, sizeof(options.encrypt_key));
+    return restore_data(&options);
+}
+
+// 备份、还原并比较，返回备份是否成功
+static int round_trip(const char *what, const BackupOptions *options) {
+    char backup_file[512];
+    char restore_dir[512];
+    snprintf(backup_file, sizeof(backup_file), "%s/backup.dat", options->target_path);
+    snprintf(restore_dir, sizeof(restore_dir), "%s/restore", options->target_path);
+
+    BackupResult result = backup_data(options);
+    if (result != BACKUP_SUCCESS) {
+        printf("FAIL: %s: backup_data returned %d\n", what, result);
+        failures++;
+        return 0;
+    }
+    result = restore_to(backup_file, restore_dir, options);
+    if (result != BACKUP_SUCCESS) {
+        printf("FAIL: %s: restore_data returned %d\n", what, result);
+        failures++;
+        return 0;
+    }
+    compare_tree(what, restore_dir);
+    return 1;
+}
+
+// 打包格式 × 压缩算法 × 加密算法
+static void test_combinations(void) {
+    const PackAlgorithm packs[] = {PACK_ALGORITHM_MYPACK, PACK_ALGORITHM_TAR};
+    const CompressAlgorithm compressions[] = {COMPRESS_ALGORITHM_NONE, COMPRESS_ALGORITHM_LZ77, COMPRESS_ALGORITHM_HAFF};
+    const EncryptAlgorithm encryptions[] = {ENCRYPT_ALGORITHM_NONE, ENCRYPT_ALGORITHM_AES, ENCRYPT_ALGORITHM_DES};
+    const char *pack_names[] = {"mypack", "tar"};
+    const char *compress_names[] = {"none", "lz77", "haff"};
+    const char *encrypt_names[] = {"none", "aes", "des"};
+
+    for (int p = 0; p < 2; p++) {
+        for (int c = 0; c < 3; c++) {
+            for (int e = 0; e < 3; e++) {
+                char what[64];
+                char target[256];
+                snprintf(what, sizeof(what), "%s+%s+%s", pack_names[p], compress_names[c], encrypt_names[e]);
+                snprintf(target, sizeof(target), "%s/%s_%s_%s", ROUNDTRIP_DIRECTORY, pack_names[p], compress_names[c], encrypt_names[e]);
+
+                BackupOptions options;
+                init_backup_options(&options, target);
+                options.pack_algorithm = packs[p];
+                options.compress_algorithm = compressions[c];
+                if (encryptions[e] != ENCRYPT_ALGORITHM_NONE) {
+                    options.encrypt_enable = 1;
+                    options.encrypt_algorithm = encryptions[e];
+                    snprintf(options.encrypt_key, sizeof(options.encrypt_key), "%s", ROUNDTRIP_KEY);
+                }
+                round_trip(what, &options);
+            }
+        }
+    }
+}
+
+// 填写Tar文件头
+static void tar_header(unsigned char *header, const char *name, char type, unsigned int size) {
+    memset(header, 0, 512);
+    snprintf((char *)header, 100, "%s", name);
+    sprintf((char *)header + 100, "%07o", 0644u);
+    sprintf((char *)header + 108, "%07o", 0u);
+    sprintf((char *)header + 116, "%07o", 0u);
+    sprintf((char *)header + 124, "%011o", size);
+    sprintf((char *)header + 136, "%011o", 0u);
+    header[156] = (unsigned char)type;
+    memcpy(header + 257, "ustar", 6);
+    memcpy(header + 263, "00", 2);
+    unsigned int checksum = 0;
+    memset(header + 148, ' ', 8);
+    for (int i = 0; i < 512; i++) {
+        checksum += header[i];
+    }
+    sprintf((char *)header + 148, "%06o", checksum);
+}
+
+// 还原含有"../escaped.txt"的Tar备份文件：未压缩时直接从映射中提取，压缩后经过流式解包，两者都必须失败
+static void test_escape(void) {
+    unsigned char data[6 * 512];
+    memset(data, 0, sizeof(data));
+    tar_header(data, "inside.txt", '0', 5);
+    memcpy(data + 512, "12345", 5);
+    tar_header(data + 1024, "../escaped.txt", '0', 5);
+    memcpy(data + 1536, "12345", 5);
+    platform_make_directories(ROUNDTRIP_ESCAPE);
+    platform_delete_file(ROUNDTRIP_ESCAPE "/escaped.txt");
+    if (!write_bytes(ROUNDTRIP_ESCAPE "/evil.tar", data, sizeof(data)) ||
+        compress_file(ROUNDTRIP_ESCAPE "/evil.tar", ROUNDTRIP_ESCAPE "/evil.cmp", COMPRESS_ALGORITHM_LZ77) != BACKUP_SUCCESS) {
+        printf("FAIL: cannot create the escaping backup files\n");
+        failures++;
+        return;
+    }
+
+    BackupOptions none;
+    memset(&none, 0, sizeof(none));
+    const char *files[] = {ROUNDTRIP_ESCAPE "/evil.tar", ROUNDTRIP_ESCAPE "/evil.cmp"};
+    for (int i = 0; i < 2; i++) {
+        BackupResult result = restore_to(files[i], ROUNDTRIP_ESCAPE "/restore", &none);
+        if (result != BACKUP_ERROR_PACK) {
+            printf("FAIL: restoring %s returned %d, expected %d\n", files[i], result, BACKUP_ERROR_PACK);
+            failures++;
+        }
+        if (platform_path_exists(ROUNDTRIP_ESCAPE "/escaped.txt", NULL)) {
+            printf("FAIL: restoring %s wrote outside the target directory\n", files[i]);
+            failures++;
+        }
+    }
+}
+
+int main() {
+    if (!make_source()) {
+        printf("test_roundtrip: cannot create the source tree\n");
+        return 1;
+    }
+
+    test_combinations();
+    test_escape();
+
+    if (failures > 0) {
+        printf("test_roundtrip: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("test_roundtrip: OK\n");
+    return 0;
+}
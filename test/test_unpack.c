@@ -0,0 +1,355 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "main.h"
+#include "pack.h"
+#include "platform.h"
+
+// 流式解包的测试：截断、篡改的文件记录和头部必须报错而不是崩溃，指向目标目录之外的路径被拒绝
+// 加密或压缩的备份文件总是经过流式解包还原
+#define UNPACK_DIRECTORY "build/test/unpack"
+#define UNPACK_SOURCE UNPACK_DIRECTORY "/src"
+#define UNPACK_OUTPUT UNPACK_DIRECTORY "/out"
+#define UNPACK_SCRATCH UNPACK_DIRECTORY "/scratch"
+#define UNPACK_FLIP_ROUNDS 500
+
+static int failures = 0;
+static char original_dir[1024];
+static unsigned int random_state = 1;
+
+static unsigned int next_random(void) {
+    random_state = random_state * 1103515245u + 12345u;
+    return random_state >> 8;
+}
+
+static int write_bytes(const char *path, const void *data, size_t size) {
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return 0;
+    }
+    int ok = fwrite(data, 1, size, fp) == size;
+    return (fclose(fp) == 0) && ok;
+}
+
+static unsigned char *read_bytes(const char *path, size_t *size) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    unsigned char *data = (unsigned char *)malloc(length > 0 ? (size_t)length : 1);
+    if (data != NULL && fread(data, 1, (size_t)length, fp) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+    *size = (size_t)length;
+    return data;
+}
+
+// 以流式解包处理数据，解包到临时目录，step是每次写入的字节数
+static BackupResult try_unpack(const unsigned char *data, size_t size, size_t step) {
+    if (!platform_change_directory(UNPACK_SCRATCH)) {
+        printf("FAIL: cannot enter %s\n", UNPACK_SCRATCH);
+        failures++;
+        return BACKUP_ERROR_PATH;
+    }
+    ByteWriter *writer = unpack_writer_create(NULL, NULL);
+    BackupResult result = (writer != NULL) ? BACKUP_SUCCESS : BACKUP_ERROR_MEMORY;
+    for (size_t offset = 0; offset < size && result == BACKUP_SUCCESS; offset += step) {
+        result = stream_write(writer, data + offset, (size - offset < step) ? size - offset : step);
+    }
+    if (result == BACKUP_SUCCESS) {
+        result = stream_finish(writer);
+    }
+    stream_destroy(writer);
+    platform_change_directory(original_dir);
+    return result;
+}
+
+static void expect_error(const char *what, BackupResult result, BackupResult expected) {
+    if (result != expected) {
+        printf("FAIL: %s returned %d, expected %d\n", what, result, expected);
+        failures++;
+    }
+}
+
+// 备份一个小目录，返回备份文件的内容
+static unsigned char *make_archive(size_t *size) {
+    unsigned char data[4000];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (unsigned char)next_random();
+    }
+    platform_make_directories(UNPACK_SOURCE "/dir");
+    platform_make_directories(UNPACK_OUTPUT);
+    platform_make_directories(UNPACK_SCRATCH);
+    if (!write_bytes(UNPACK_SOURCE "/a.txt", "hello, archive\n", 15) ||
+        !write_bytes(UNPACK_SOURCE "/dir/b.bin", data, sizeof(data)) ||
+        !write_bytes(UNPACK_SOURCE "/dir/empty", "", 0) ||
+        platform_make_link(UNPACK_SOURCE "/a.txt", UNPACK_SOURCE "/dir/link") != BACKUP_SUCCESS) {
+        printf("FAIL: cannot create the source tree\n");
+        failures++;
+        return NULL;
+    }
+
+    BackupOptions options;
+    memset(&options, 0, sizeof(options));
+    snprintf(options.source_path, sizeof(options.source_path), "%s", UNPACK_SOURCE);
+    snprintf(options.target_path, sizeof(options.target_path), "%s", UNPACK_OUTPUT);
+    options.file_types = FILE_TYPE_REGULAR | FILE_TYPE_DIRECTORY;
+    options.pack_algorithm = PACK_ALGORITHM_MYPACK;
+    options.traverse_sort = 1;
+    BackupResult result = backup_data(&options);
+    if (result != BACKUP_SUCCESS) {
+        printf("FAIL: backup_data returned %d\n", result);
+        failures++;
+        return NULL;
+    }
+    return read_bytes(UNPACK_OUTPUT "/backup.dat", size);
+}
+
+// 截断：流式解包读到索引标记即结束，在此之前的任何截断都必须被发现
+static void test_truncated(const unsigned char *archive, size_t size) {
+    Pack2Trailer trailer;
+    memcpy(&trailer, archive + size - sizeof(Pack2Trailer), sizeof(Pack2Trailer));
+    expect_error("intact archive", try_unpack(archive, size, 4096), BACKUP_SUCCESS);
+    for (size_t length = 0; length < trailer.index_offset + PACK2_TAG_SIZE && length < size; length++) {
+        if (try_unpack(archive, length, 1 + length % 97) == BACKUP_SUCCESS) {
+            printf("FAIL: unpack writer accepted an archive truncated to %zu of %zu bytes\n", length, size);
+            failures++;
+        }
+    }
+}
+
+// 篡改第一个文件记录
+static void test_corrupt_record(const unsigned char *archive, size_t size) {
+    unsigned char *copy = (unsigned char *)malloc(size);
+    if (copy == NULL) {
+        printf("FAIL: out of memory\n");
+        failures++;
+        return;
+    }
+
+    Pack2Item item;
+    size_t item_offset = sizeof(Pack2Signature) + PACK2_TAG_SIZE;
+    memcpy(copy, archive, size);
+    memcpy(&item, archive + item_offset, sizeof(Pack2Item));
+    item.path_length = 0xFFFFFFFFu;
+    memcpy(copy + item_offset, &item, sizeof(Pack2Item));
+    if (try_unpack(copy, size, 4096) == BACKUP_SUCCESS) {
+        printf("FAIL: unpack writer accepted a huge path_length\n");
+        failures++;
+    }
+
+    memcpy(copy, archive, size);
+    memcpy(copy + sizeof(Pack2Signature), "FILX", PACK2_TAG_SIZE);
+    if (try_unpack(copy, size, 4096) == BACKUP_SUCCESS) {
+        printf("FAIL: unpack writer accepted a bad record tag\n");
+        failures++;
+    }
+    free(copy);
+}
+
+// 版本1：头部的文件数量远大于文件项表；未知的版本号
+static void test_corrupt_v1_header(void) {
+    unsigned char data[sizeof(PackHeader) + sizeof(PackFileItem)];
+    PackHeader header;
+    memset(data, 0, sizeof(data));
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "BACK", 4);
+    header.version = PACK_VERSION_1;
+    header.file_count = 0xFFFFFFFFu;
+    header.header_size = sizeof(PackHeader);
+    header.data_offset = sizeof(data);
+    memcpy(data, &header, sizeof(header));
+    if (try_unpack(data, sizeof(data), sizeof(data)) == BACKUP_SUCCESS) {
+        printf("FAIL: unpack writer accepted a v1 header with a huge file_count\n");
+        failures++;
+    }
+
+    header.version = 99;
+    memcpy(data, &header, sizeof(header));
+    if (try_unpack(data, sizeof(data), sizeof(data)) == BACKUP_SUCCESS) {
+        printf("FAIL: unpack writer accepted an unknown version\n");
+        failures++;
+    }
+}
+
+// 填写Tar文件头
+static void tar_header(unsigned char *header, const char *name, char type, unsigned int size, const char *link) {
+    memset(header, 0, 512);
+    snprintf((char *)header, 100, "%s", name);
+    sprintf((char *)header + 100, "%07o", 0644u);
+    sprintf((char *)header + 108, "%07o", 0u);
+    sprintf((char *)header + 116, "%07o", 0u);
+    sprintf((char *)header + 124, "%011o", size);
+    sprintf((char *)header + 136, "%011o", 0u);
+    header[156] = (unsigned char)type;
+    snprintf((char *)header + 157, 100, "%s", link);
+    memcpy(header + 257, "ustar", 6);
+    memcpy(header + 263, "00", 2);
+    unsigned int checksum = 0;
+    memset(header + 148, ' ', 8);
+    for (int i = 0; i < 512; i++) {
+        checksum += header[i];
+    }
+    sprintf((char *)header + 148, "%06o", checksum);
+}
+
+// 构造只有一个文件记录的MyPack数据（流式解包读到索引标记即结束），返回字节数
+static size_t mypack_single(unsigned char *buffer, const char *path, const char *content) {
+    Pack2Signature signature;
+    Pack2Item item;
+    size_t size = 0;
+    memcpy(signature.magic, "BACK", 4);
+    signature.version = PACK_VERSION_2;
+    memcpy(buffer, &signature, sizeof(signature));
+    size += sizeof(signature);
+    memcpy(buffer + size, PACK2_TAG_FILE, PACK2_TAG_SIZE);
+    size += PACK2_TAG_SIZE;
+
+    memset(&item, 0, sizeof(item));
+    item.type = FILE_TYPE_REGULAR;
+    item.mode = 0644;
+    item.size = strlen(content);
+    item.path_length = (unsigned int)strlen(path);
+    item.offset = size + sizeof(item) + item.path_length;
+    memcpy(buffer + size, &item, sizeof(item));
+    size += sizeof(item);
+    memcpy(buffer + size, path, item.path_length);
+    size += item.path_length;
+    memcpy(buffer + size, content, strlen(content));
+    size += strlen(content);
+    memcpy(buffer + size, PACK2_TAG_INDEX, PACK2_TAG_SIZE);
+    return size + PACK2_TAG_SIZE;
+}
+
+// GNU长名称记录（类型'L'）给出的超过100字节的路径，读完整之后与普通路径同样检查
+static void test_long_name_escape(void) {
+    char name[200];
+    unsigned char data[6 * 512];
+    const char *prefixes[] = {"../", "/tmp/", "dir/../../", ""};
+    for (size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); i++) {
+        snprintf(name, sizeof(name), "%s%0120d/escaped.txt", prefixes[i], 0);
+        platform_delete_file(UNPACK_DIRECTORY "/escaped.txt");
+        memset(data, 0, sizeof(data));
+        tar_header(data, "././@LongLink", 'L', (unsigned int)strlen(name) + 1, "");
+        memcpy(data + 512, name, strlen(name));
+        tar_header(data + 1024, "truncated", '0', 5, "");
+        memcpy(data + 1536, "12345", 5);
+        size_t size = sizeof(data);
+
+        char what[256];
+        snprintf(what, sizeof(what), "tar long name \"%s\"", name);
+        expect_error(what, try_unpack(data, size, 100), (prefixes[i][0] != '\0') ? BACKUP_ERROR_PACK : BACKUP_SUCCESS);
+        if (platform_path_exists(UNPACK_DIRECTORY "/escaped.txt", NULL)) {
+            printf("FAIL: \"%s\" was written outside the target directory\n", name);
+            failures++;
+        }
+    }
+}
+
+// 随机改写若干字节：结果可以是成功或错误，但不能崩溃（配合AddressSanitizer运行）
+static void test_random_flips(const unsigned char *archive, size_t size) {
+    unsigned char *copy = (unsigned char *)malloc(size);
+    if (copy == NULL) {
+        printf("FAIL: out of memory\n");
+        failures++;
+        return;
+    }
+    for (int round = 0; round < UNPACK_FLIP_ROUNDS; round++) {
+        memcpy(copy, archive, size);
+        int flips = 1 + (int)(next_random() % 4);
+        for (int i = 0; i < flips; i++) {
+            copy[next_random() % size] ^= (unsigned char)(1 + next_random() % 255);
+        }
+        try_unpack(copy, size, 1 + next_random() % 600);
+    }
+    free(copy);
+}
+
+// 普通文件的路径指向目标目录之外时，Tar和MyPack都被拒绝，目标目录之外没有创建文件
+static void test_path_escape(void) {
+    const char *paths[] = {"../escaped.txt", "dir/../../escaped.txt", "/tmp/escaped.txt", "C:/escaped.txt", "..\\escaped.txt"};
+    unsigned char data[4 * 512];
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+        char what[128];
+        platform_delete_file(UNPACK_DIRECTORY "/escaped.txt");
+
+        memset(data, 0, sizeof(data));
+        tar_header(data, paths[i], '0', 5, "");
+        memcpy(data + 512, "12345", 5);
+        snprintf(what, sizeof(what), "tar entry \"%s\"", paths[i]);
+        expect_error(what, try_unpack(data, sizeof(data), 512), BACKUP_ERROR_PACK);
+
+        size_t size = mypack_single(data, paths[i], "12345");
+        snprintf(what, sizeof(what), "mypack entry \"%s\"", paths[i]);
+        expect_error(what, try_unpack(data, size, 7), BACKUP_ERROR_PACK);
+
+        if (platform_path_exists(UNPACK_DIRECTORY "/escaped.txt", NULL)) {
+            printf("FAIL: \"%s\" was written outside the target directory\n", paths[i]);
+            failures++;
+        }
+    }
+
+    // 目标目录下的路径（包括"."组成部分）是允许的
+    size_t size = mypack_single(data, "./sub/inside.txt", "12345");
+    expect_error("mypack entry \"./sub/inside.txt\"", try_unpack(data, size, 7), BACKUP_SUCCESS);
+}
+
+// 硬链接指向绝对路径、上级目录或尚未解包的文件，或者硬链接本身在目标目录之外时被拒绝
+static void test_hardlink_escape(void) {
+    const char *targets[] = {"/etc/hostname", "../x", "dir/../../x", "missing", "f"};
+    const char *names[] = {"evil", "evil", "evil", "evil", "../evil"};
+    unsigned char data[4 * 512];
+    for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+        memset(data, 0, sizeof(data));
+        tar_header(data, "f", '0', 5, "");
+        memcpy(data + 512, "12345", 5);
+        tar_header(data + 1024, names[i], '1', 0, targets[i]);
+
+        char what[128];
+        snprintf(what, sizeof(what), "tar hard link \"%s\" to \"%s\"", names[i], targets[i]);
+        expect_error(what, try_unpack(data, sizeof(data), 512), BACKUP_ERROR_PACK);
+    }
+
+    // 链接到已解包的文件是允许的
+    memset(data, 0, sizeof(data));
+    tar_header(data, "f", '0', 5, "");
+    memcpy(data + 512, "12345", 5);
+    tar_header(data + 1024, "good", '1', 0, "f");
+    expect_error("tar hard link to \"f\"", try_unpack(data, sizeof(data), 512), BACKUP_SUCCESS);
+}
+
+int main() {
+    if (platform_get_current_directory(original_dir, sizeof(original_dir)) != BACKUP_SUCCESS) {
+        printf("FAIL: cannot get the current directory\n");
+        return 1;
+    }
+
+    size_t size = 0;
+    unsigned char *archive = make_archive(&size);
+    if (archive == NULL || size < sizeof(Pack2Signature) + sizeof(Pack2Trailer)) {
+        printf("test_unpack: cannot create the test archive\n");
+        free(archive);
+        return 1;
+    }
+
+    test_truncated(archive, size);
+    test_corrupt_record(archive, size);
+    test_corrupt_v1_header();
+    test_path_escape();
+    test_hardlink_escape();
+    test_long_name_escape();
+    test_random_flips(archive, size);
+    free(archive);
+
+    if (failures > 0) {
+        printf("test_unpack: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("test_unpack: OK\n");
+    return 0;
+}
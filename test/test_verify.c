@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "main.h"
+#include "verify.h"
+#include "platform.h"
+
+// 校验的测试：完好的备份通过校验且每个文件都有内容摘要，损坏的数据、变化和缺失的源文件被发现
+#define VERIFY_DIRECTORY "build/test/verify"
+#define VERIFY_SOURCE VERIFY_DIRECTORY "/src"
+#define VERIFY_OUTPUT VERIFY_DIRECTORY "/out"
+#define VERIFY_BAD_FILE VERIFY_DIRECTORY "/bad.dat"
+#define VERIFY_CONTENT "content that verify must check\n"
+
+static int failures = 0;
+
+// 校验发现的各种问题的次数
+typedef struct {
+    int problems[ARCHIVE_VERIFY_SOURCE_MISSING + 1];
+} VerifyReports;
+
+static void count_report(const ArchiveEntry *entry, ArchiveVerifyProblem problem, void *context) {
+    (void)entry;
+    ((VerifyReports *)context)->problems[problem]++;
+}
+
+static int write_bytes(const char *path, const void *data, size_t size) {
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return 0;
+    }
+    int ok = fwrite(data, 1, size, fp) == size;
+    return (fclose(fp) == 0) && ok;
+}
+
+static unsigned char *read_bytes(const char *path, size_t *size) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    unsigned char *data = (unsigned char *)malloc(length > 0 ? (size_t)length : 1);
+    if (data != NULL && fread(data, 1, (size_t)length, fp) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+    *size = (size_t)length;
+    return data;
+}
+
+// 创建源目录（包括超过零拷贝阈值的文件）并备份
+static int make_backup(void) {
+    size_t big_size = 300 * 1024;
+    unsigned char *big = (unsigned char *)malloc(big_size);
+    if (big == NULL) {
+        return 0;
+    }
+    unsigned int seed = 3;
+    for (size_t i = 0; i < big_size; i++) {
+        seed = seed * 1103515245u + 12345u;
+        big[i] = (unsigned char)(seed >> 16);
+    }
+    platform_make_directories(VERIFY_SOURCE "/dir");
+    platform_make_directories(VERIFY_OUTPUT);
+    int ok = write_bytes(VERIFY_SOURCE "/checked.txt", VERIFY_CONTENT, strlen(VERIFY_CONTENT)) &&
+             write_bytes(VERIFY_SOURCE "/dir/big.bin", big, big_size) &&
+             write_bytes(VERIFY_SOURCE "/dir/other.txt", "other\n", 6);
+    free(big);
+    if (!ok) {
+        return 0;
+    }
+
+    BackupOptions options;
+    memset(&options, 0, sizeof(options));
+    snprintf(options.source_path, sizeof(options.source_path), "%s", VERIFY_SOURCE);
+    snprintf(options.target_path, sizeof(options.target_path), "%s", VERIFY_OUTPUT);
+    options.file_types = FILE_TYPE_REGULAR | FILE_TYPE_DIRECTORY;
+    options.pack_algorithm = PACK_ALGORITHM_MYPACK;
+    BackupResult result = backup_data(&options);
+    if (result != BACKUP_SUCCESS) {
+        printf("FAIL: backup_data returned %d\n", result);
+        failures++;
+        return 0;
+    }
+    return 1;
+}
+
+// 校验备份文件，source_path为NULL时不与源目录比较
+static BackupResult run_verify(const char *backup_file, const char *source_path, VerifyReports *reports, ArchiveVerifyStats *stats) {
+    VerifyOptions options;
+    memset(&options, 0, sizeof(options));
+    memset(reports, 0, sizeof(VerifyReports));
+    snprintf(options.backup_file, sizeof(options.backup_file), "%s", backup_file);
+    if (source_path != NULL) {
+        snprintf(options.source_path, sizeof(options.source_path), "%s", source_path);
+    }
+    BackupResult result = verify_data(&options, count_report, reports);
+    verify_get_stats(stats);
+    return result;
+}
+
+// 完好的备份：每个文件都有内容摘要（包括由内核直接复制的大文件）
+static void test_intact(void) {
+    VerifyReports reports;
+    ArchiveVerifyStats stats;
+    BackupResult result = run_verify(VERIFY_OUTPUT "/backup.dat", VERIFY_SOURCE, &reports, &stats);
+    if (result != BACKUP_SUCCESS || stats.files != 3 || stats.hashed_files != stats.files) {
+        printf("FAIL: verify_data returned %d, %llu files, %llu hashed\n", result, stats.files, stats.hashed_files);
+        failures++;
+    }
+}
+
+// 改写备份中一个文件的数据
+static void test_corrupt_data(void) {
+    size_t size = 0;
+    unsigned char *archive = read_bytes(VERIFY_OUTPUT "/backup.dat", &size);
+    unsigned char *found = NULL;
+    for (size_t i = 0; archive != NULL && i + strlen(VERIFY_CONTENT) <= size; i++) {
+        if (memcmp(archive + i, VERIFY_CONTENT, strlen(VERIFY_CONTENT)) == 0) {
+            found = archive + i;
+            break;
+        }
+    }
+    if (found == NULL) {
+        printf("FAIL: cannot find the file data in the backup\n");
+        failures++;
+        free(archive);
+        return;
+    }
+    found[0] ^= 0x20;
+    write_bytes(VERIFY_BAD_FILE, archive, size);
+    free(archive);
+
+    VerifyReports reports;
+    ArchiveVerifyStats stats;
+    BackupResult result = run_verify(VERIFY_BAD_FILE, NULL, &reports, &stats);
+    if (result != BACKUP_ERROR_CHECKSUM || stats.corrupt != 1 || reports.problems[ARCHIVE_VERIFY_CORRUPT] != 1) {
+        printf("FAIL: corrupt data: verify_data returned %d, %llu corrupt\n", result, stats.corrupt);
+        failures++;
+    }
+}
+
+// 源文件内容变化和源文件缺失
+static void test_source_changes(void) {
+    char changed[] = VERIFY_CONTENT;
+    changed[0] ^= 0x20;
+    if (!write_bytes(VERIFY_SOURCE "/checked.txt", changed, strlen(changed)) ||
+        !platform_delete_file(VERIFY_SOURCE "/dir/other.txt")) {
+        printf("FAIL: cannot modify the source tree\n");
+        failures++;
+        return;
+    }
+
+    VerifyReports reports;
+    ArchiveVerifyStats stats;
+    BackupResult result = run_verify(VERIFY_OUTPUT "/backup.dat", VERIFY_SOURCE, &reports, &stats);
+    if (result != BACKUP_ERROR_CHECKSUM || stats.source_changed != 1 || stats.source_missing != 1 ||
+        reports.problems[ARCHIVE_VERIFY_SOURCE_CHANGED] != 1 || reports.problems[ARCHIVE_VERIFY_SOURCE_MISSING] != 1) {
+        printf("FAIL: source changes: verify_data returned %d, %llu changed, %llu missing\n", result, stats.source_changed, stats.source_missing);
+        failures++;
+    }
+}
+
+int main() {
+    if (!make_backup()) {
+        printf("test_verify: cannot create the test backup\n");
+        return 1;
+    }
+
+    test_intact();
+    test_corrupt_data();
+    test_source_changes();
+
+    if (failures > 0) {
+        printf("test_verify: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("test_verify: OK\n");
+    return 0;
+}